@@ -73,6 +73,8 @@ public:
                         .write_then_read = config.write_then_read},
                        "Aw9523", config.log_level)
       , config_(config) {
+    // the inputs can change at any time and must not be cached
+    set_registers_volatile({(uint8_t)Registers::INPORT0, (uint8_t)Registers::INPORT1});
     if (config.auto_init) {
       std::error_code ec;
       initialize(ec);
@@ -1,12 +1,16 @@
 #pragma once
 
+#include <algorithm>
 #include <bitset>
 #include <chrono>
 #include <cstdint>
 #include <functional>
+#include <initializer_list>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "base_component.hpp"
@@ -21,6 +25,14 @@ namespace espp {
 ///
 /// The peripheral is protected by a mutex to ensure that only one
 /// operation can be performed at a time.
+///
+/// It can optionally keep a shadow copy of the registers (see
+/// set_register_cache_enabled), so that reading a register which was already
+/// read or written (e.g. in the read-modify-write functions such as
+/// set_bits_in_register) does not need a bus transaction. Registers whose
+/// value can change without being written by this class (status, data, FIFO,
+/// self-clearing registers, etc.) must be marked volatile by the driver (see
+/// set_register_volatile), so that they are never cached.
 template <std::integral RegisterAddressType = std::uint8_t, bool UseAddress = true>
 class BasePeripheral : public BaseComponent {
 public:
@@ -92,9 +104,11 @@ public:
   /// \param address The address of the peripheral
   /// \note This function is thread safe
   /// \note This function is only available if UseAddress is true
+  /// \note This clears the register cache
   void set_address(uint8_t address) requires(UseAddress) {
     std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     base_config_.address = address;
+    register_cache_.clear();
   }
 
   /// Set the probe function
@@ -174,9 +188,11 @@ public:
   ///       this function can be used to change the configuration after the
   ///       peripheral has been created - for instance if the peripheral could
   ///       be found on different communications buses.
+  /// \note This clears the register cache
   void set_config(const Config &config) {
     std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     base_config_ = config;
+    register_cache_.clear();
   }
 
   /// Set the configuration for the peripheral
@@ -186,9 +202,76 @@ public:
   ///       this function can be used to change the configuration after the
   ///       peripheral has been created - for instance if the peripheral could
   ///       be found on different communications buses.
+  /// \note This clears the register cache
   void set_config(Config &&config) {
     std::lock_guard<std::recursive_mutex> lock(base_mutex_);
     base_config_ = std::move(config);
+    register_cache_.clear();
+  }
+
+  /// Statistics of the register cache
+  struct RegisterCacheStats {
+    size_t hits{0};   ///< Number of register reads served from the cache
+    size_t misses{0}; ///< Number of reads of cacheable registers which went to the peripheral
+  };
+
+  /// Enable or disable the register cache
+  /// \param enabled True to keep a shadow copy of the (non-volatile) registers
+  ///        read from / written to the peripheral, and serve register reads
+  ///        from it when possible
+  /// \note This function is thread safe
+  /// \note The cache is disabled by default. Disabling it clears it.
+  /// \note Writes are passed through to the peripheral, and multi-byte
+  ///       register reads / writes are assumed to auto-increment the register
+  ///       address, as most peripherals do.
+  /// \note Registers written with write() / write_many() (rather than the
+  ///       *_to_register functions) are not tracked, so after such writes (or
+  ///       after resetting the peripheral) invalidate_register_cache() must be
+  ///       called.
+  void set_register_cache_enabled(bool enabled) {
+    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    register_cache_enabled_ = enabled;
+    register_cache_.clear();
+  }
+
+  /// Whether the register cache is enabled
+  /// \return True if the register cache is enabled
+  bool is_register_cache_enabled() const { return register_cache_enabled_; }
+
+  /// Clear the register cache, so that the registers are read from the
+  /// peripheral the next time they are needed
+  /// \note This function is thread safe
+  void invalidate_register_cache() {
+    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    register_cache_.clear();
+  }
+
+  /// Remove registers from the register cache, so that they are read from the
+  /// peripheral the next time they are needed
+  /// \param register_address The address of the first register to remove
+  /// \param count The number of consecutive registers to remove
+  /// \note This function is thread safe
+  void invalidate_register_cache(RegisterAddressType register_address, size_t count = 1) {
+    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    for (size_t i = 0; i < count; i++) {
+      register_cache_.erase(static_cast<RegisterAddressType>(register_address + i));
+    }
+  }
+
+  /// Get the statistics of the register cache
+  /// \return The number of hits and misses since the peripheral was created
+  ///         or reset_register_cache_stats() was called
+  /// \note This function is thread safe
+  RegisterCacheStats register_cache_stats() {
+    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    return register_cache_stats_;
+  }
+
+  /// Reset the statistics of the register cache
+  /// \note This function is thread safe
+  void reset_register_cache_stats() {
+    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    register_cache_stats_ = {};
   }
 
 protected:
@@ -205,6 +288,43 @@ protected:
   /// \return The configuration for the peripheral
   const Config &config() const { return base_config_; }
 
+  /// Mark a register as volatile (or not)
+  /// \param register_address The address of the register
+  /// \param is_volatile True if the value of the register can change without
+  ///        it being written (status, data, FIFO, self-clearing registers,
+  ///        etc.), in which case it is never cached
+  /// \note This function is thread safe
+  void set_register_volatile(RegisterAddressType register_address, bool is_volatile = true) {
+    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    if (is_volatile) {
+      volatile_registers_.insert(register_address);
+      register_cache_.erase(register_address);
+    } else {
+      volatile_registers_.erase(register_address);
+    }
+  }
+
+  /// Mark registers as volatile, so that they are never cached
+  /// \param register_addresses The addresses of the registers
+  /// \note This function is thread safe
+  void set_registers_volatile(std::initializer_list<RegisterAddressType> register_addresses) {
+    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    for (auto register_address : register_addresses) {
+      set_register_volatile(register_address);
+    }
+  }
+
+  /// Mark consecutive registers as volatile, so that they are never cached
+  /// \param register_address The address of the first register
+  /// \param count The number of consecutive registers
+  /// \note This function is thread safe
+  void set_registers_volatile(RegisterAddressType register_address, size_t count) {
+    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    for (size_t i = 0; i < count; i++) {
+      set_register_volatile(static_cast<RegisterAddressType>(register_address + i));
+    }
+  }
+
   /// Get the address of the peripheral
   /// \return The address of the peripheral
   uint8_t address() const { return base_config_.address; }
@@ -467,13 +587,7 @@ protected:
   /// \param ec The error code to set if there is an error
   void write_u8_to_register(RegisterAddressType reg_addr, uint8_t data, std::error_code &ec) {
     logger_.debug("write u8 to register 0x{:x}", reg_addr);
-    // use the size of the register address to determine how many bytes the
-    // register address is
-    static constexpr size_t reg_addr_size = sizeof(RegisterAddressType);
-    uint8_t buffer[reg_addr_size + 1];
-    put_register_bytes(reg_addr, buffer);
-    buffer[reg_addr_size] = data;
-    write(buffer, reg_addr_size + 1, ec);
+    write_to_register(reg_addr, &data, 1, ec);
   }
 
   /// Write a uint16_t to the peripheral
@@ -482,14 +596,10 @@ protected:
   /// \param ec The error code to set if there is an error
   void write_u16_to_register(RegisterAddressType reg_addr, uint16_t data, std::error_code &ec) {
     logger_.debug("write u16 to register 0x{:x}", reg_addr);
-    // use the size of the register address to determine how many bytes the
-    // register address is
-    static constexpr size_t reg_addr_size = sizeof(RegisterAddressType);
-    uint8_t buffer[reg_addr_size + 2];
-    put_register_bytes(reg_addr, buffer);
-    buffer[reg_addr_size] = (data >> 8) & 0xff;
-    buffer[reg_addr_size + 1] = data & 0xff;
-    write(buffer, reg_addr_size + 2, ec);
+    uint8_t buffer[2];
+    buffer[0] = (data >> 8) & 0xff;
+    buffer[1] = data & 0xff;
+    write_to_register(reg_addr, buffer, 2, ec);
   }
 
   /// Write many bytes to a register on the peripheral
@@ -500,13 +610,7 @@ protected:
   void write_many_to_register(RegisterAddressType reg_addr, const uint8_t *data, size_t length,
                               std::error_code &ec) {
     logger_.debug("write {} bytes to register 0x{:x}", length, reg_addr);
-    // use the size of the register address to determine how many bytes the
-    // register address is
-    static constexpr size_t reg_addr_size = sizeof(RegisterAddressType);
-    uint8_t buffer[length + reg_addr_size];
-    put_register_bytes(reg_addr, buffer);
-    std::copy(data, data + length, buffer + reg_addr_size);
-    write(buffer, length + reg_addr_size, ec);
+    write_to_register(reg_addr, data, length, ec);
   }
 
   /// Write many bytes to a register on the peripheral
@@ -526,19 +630,9 @@ protected:
   uint8_t read_u8_from_register(RegisterAddressType register_address, std::error_code &ec) {
     logger_.debug("read u8 from register 0x{:x}", register_address);
     uint8_t data = 0;
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
-    if (base_config_.read_register) {
-      read_register(register_address, &data, 1, ec);
-    } else {
-      // use the size of the register address to determine how many bytes the
-      // register address is
-      static constexpr size_t reg_addr_size = sizeof(RegisterAddressType);
-      uint8_t buffer[reg_addr_size];
-      put_register_bytes(register_address, buffer);
-      write_then_read(buffer, reg_addr_size, &data, 1, ec);
-      if (ec) {
-        return 0;
-      }
+    read_from_register(register_address, &data, 1, ec);
+    if (ec) {
+      return 0;
     }
     return data;
   }
@@ -550,19 +644,9 @@ protected:
   uint16_t read_u16_from_register(RegisterAddressType register_address, std::error_code &ec) {
     logger_.debug("read u16 from register 0x{:x}", register_address);
     uint8_t data[2];
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
-    if (base_config_.read_register) {
-      read_register(register_address, data, 2, ec);
-    } else {
-      // use the size of the register address to determine how many bytes the
-      // register address is
-      static constexpr size_t reg_addr_size = sizeof(RegisterAddressType);
-      uint8_t buffer[reg_addr_size];
-      put_register_bytes(register_address, buffer);
-      write_then_read(buffer, reg_addr_size, (uint8_t *)&data, 2, ec);
-      if (ec) {
-        return 0;
-      }
+    read_from_register(register_address, data, 2, ec);
+    if (ec) {
+      return 0;
     }
     return (data[0] << 8) | data[1];
   }
@@ -576,17 +660,7 @@ protected:
                                std::error_code &ec) {
     logger_.debug("read_many_from_register {} bytes from register 0x{:x}", length,
                   register_address);
-    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
-    if (base_config_.read_register) {
-      read_register(register_address, data, length, ec);
-    } else {
-      // use the size of the register address to determine how many bytes the
-      // register address is
-      static constexpr size_t reg_addr_size = sizeof(RegisterAddressType);
-      uint8_t buffer[reg_addr_size];
-      put_register_bytes(register_address, buffer);
-      write_then_read(buffer, reg_addr_size, data, length, ec);
-    }
+    read_from_register(register_address, data, length, ec);
   }
 
   /// Read many bytes from a register on the peripheral
@@ -730,6 +804,83 @@ protected:
     write_u8_to_register(register_address, data, ec);
   }
 
+  // Write bytes to consecutive registers, updating the register cache
+  void write_to_register(RegisterAddressType register_address, const uint8_t *data, size_t length,
+                         std::error_code &ec) {
+    // use the size of the register address to determine how many bytes the
+    // register address is
+    static constexpr size_t reg_addr_size = sizeof(RegisterAddressType);
+    uint8_t buffer[length + reg_addr_size];
+    put_register_bytes(register_address, buffer);
+    std::copy(data, data + length, buffer + reg_addr_size);
+    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    write(buffer, length + reg_addr_size, ec);
+    if (!register_cache_enabled_) {
+      return;
+    }
+    if (ec) {
+      // the peripheral may or may not have the new values
+      invalidate_register_cache(register_address, length);
+      return;
+    }
+    for (size_t i = 0; i < length; i++) {
+      auto address = static_cast<RegisterAddressType>(register_address + i);
+      if (!volatile_registers_.contains(address)) {
+        register_cache_[address] = data[i];
+      }
+    }
+  }
+
+  // Read bytes from consecutive registers, from the register cache if it has
+  // them all, otherwise from the peripheral (updating the register cache)
+  void read_from_register(RegisterAddressType register_address, uint8_t *data, size_t length,
+                          std::error_code &ec) {
+    std::lock_guard<std::recursive_mutex> lock(base_mutex_);
+    bool cacheable = register_cache_enabled_;
+    for (size_t i = 0; cacheable && i < length; i++) {
+      auto address = static_cast<RegisterAddressType>(register_address + i);
+      cacheable = !volatile_registers_.contains(address);
+    }
+    if (cacheable && read_from_register_cache(register_address, data, length)) {
+      register_cache_stats_.hits++;
+      ec.clear();
+      return;
+    }
+    if (base_config_.read_register) {
+      read_register(register_address, data, length, ec);
+    } else {
+      // use the size of the register address to determine how many bytes the
+      // register address is
+      static constexpr size_t reg_addr_size = sizeof(RegisterAddressType);
+      uint8_t buffer[reg_addr_size];
+      put_register_bytes(register_address, buffer);
+      write_then_read(buffer, reg_addr_size, data, length, ec);
+    }
+    if (!cacheable) {
+      return;
+    }
+    register_cache_stats_.misses++;
+    if (ec) {
+      return;
+    }
+    for (size_t i = 0; i < length; i++) {
+      register_cache_[static_cast<RegisterAddressType>(register_address + i)] = data[i];
+    }
+  }
+
+  // Copy consecutive registers from the register cache, if it has them all
+  bool read_from_register_cache(RegisterAddressType register_address, uint8_t *data,
+                                size_t length) {
+    for (size_t i = 0; i < length; i++) {
+      auto it = register_cache_.find(static_cast<RegisterAddressType>(register_address + i));
+      if (it == register_cache_.end()) {
+        return false;
+      }
+      data[i] = it->second;
+    }
+    return true;
+  }
+
   // Set the bytes of the register address in the buffer
   void put_register_bytes(RegisterAddressType register_address, uint8_t *data) {
     if constexpr (std::is_same_v<RegisterAddressType, uint8_t>) {
@@ -748,5 +899,11 @@ protected:
 
   Config base_config_;              ///< The configuration for the peripheral
   std::recursive_mutex base_mutex_; ///< The mutex to protect access to the peripheral
+  bool register_cache_enabled_{false}; ///< Whether the register cache is enabled
+  std::unordered_map<RegisterAddressType, uint8_t>
+      register_cache_; ///< The last known values of the non-volatile registers
+  std::unordered_set<RegisterAddressType>
+      volatile_registers_;                  ///< The registers which are never cached
+  RegisterCacheStats register_cache_stats_; ///< The hits and misses of the register cache
 };
 } // namespace espp
@@ -102,6 +102,23 @@ extern "C" void app_main(void) {
     rgb = hsv;
     fmt::print(espp::color_code(rgb), "HSV back to RGB: {}\n", rgb);
 
+    // test the integer color types, which convert without floating point math
+    fmt::print("Integer colors:\n");
+    fmt::print("---------------\n");
+    for (uint16_t h = 0; h < espp::Hsv8::HUE_MAX; h += espp::Hsv8::HUE_MAX / 12) {
+      espp::Hsv8 hsv8(h, 255, 255);
+      // NOTE: hue values: red = 0, green = 512, blue = 1024
+      auto rgb8 = hsv8.rgb();
+      fmt::print(espp::color_code(rgb8.rgb()), "HSV8 {} --> RGB8 {} --> HSV8 {}\n", hsv8, rgb8,
+                 rgb8.hsv());
+    }
+    // lookup tables for gamma correction and brightness, made at compile time
+    static constexpr auto gamma_lut = espp::make_gamma_lut(2.2f);
+    static constexpr auto dim_gamma_lut = espp::make_color_lut(2.2f, 64);
+    espp::Rgb8 orange(0xFF8000);
+    fmt::print("Orange {0} ({0:x}) gamma corrected: {1}, and dimmed to 25%: {2}\n", orange,
+               orange.apply(gamma_lut), orange.apply(dim_gamma_lut));
+
     //! [color example]
   }
 
@@ -1,12 +1,16 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 
 #include "format.hpp"
 
 namespace espp {
 class Rgb;
 class Hsv;
+struct Rgb8;
+struct Hsv8;
 
 /**
  * @brief Class representing a color using RGB color space.
@@ -156,6 +160,271 @@ public:
   Rgb rgb() const;
 };
 
+namespace detail {
+/// x * y / 255, rounded, for x, y ∈ [0, 255]
+constexpr uint8_t scale8(uint8_t x, uint8_t y) {
+  uint16_t product = x * y + 128;
+  return (product + (product >> 8)) >> 8;
+}
+
+/// Natural log of x > 0, usable in constant expressions (std::log is not)
+constexpr double constexpr_log(double x) {
+  // x = m * 2^k with m ∈ [0.5, 1), and ln(m) = 2 * atanh((m - 1) / (m + 1))
+  constexpr double ln2 = 0.6931471805599453;
+  int k = 0;
+  while (x >= 1.0) {
+    x /= 2.0;
+    k++;
+  }
+  while (x < 0.5) {
+    x *= 2.0;
+    k--;
+  }
+  double z = (x - 1.0) / (x + 1.0);
+  double z2 = z * z;
+  double term = z;
+  double sum = 0;
+  for (int n = 1; n < 40; n += 2) {
+    sum += term / n;
+    term *= z2;
+  }
+  return k * ln2 + 2.0 * sum;
+}
+
+/// e^x, usable in constant expressions (std::exp is not)
+constexpr double constexpr_exp(double x) {
+  // e^x = (e^(x / 2^n))^(2^n), with |x / 2^n| < 0.5 for the series
+  int n = 0;
+  while (x > 0.5 || x < -0.5) {
+    x /= 2.0;
+    n++;
+  }
+  double term = 1.0;
+  double sum = 1.0;
+  for (int i = 1; i < 20; i++) {
+    term *= x / i;
+    sum += term;
+  }
+  for (int i = 0; i < n; i++) {
+    sum *= sum;
+  }
+  return sum;
+}
+} // namespace detail
+
+/**
+ * @brief Lookup table mapping each 8 bit color channel value to the value to
+ *        send to the LEDs, e.g. for gamma correction or brightness scaling.
+ * @see make_gamma_lut, make_brightness_lut, make_color_lut
+ */
+using ColorLut = std::array<uint8_t, 256>;
+
+/**
+ * @brief Make a lookup table scaling the channel values by brightness.
+ * @note Can be evaluated at compile time, e.g. as
+ *       `static constexpr auto lut = espp::make_brightness_lut(128);`
+ * @param brightness Brightness ∈ [0, 255], where 255 leaves the values
+ *        unchanged.
+ * @return Lookup table with value * brightness / 255 for each value.
+ */
+constexpr ColorLut make_brightness_lut(uint8_t brightness = 255) {
+  ColorLut lut{};
+  for (size_t i = 0; i < lut.size(); i++) {
+    lut[i] = detail::scale8(i, brightness);
+  }
+  return lut;
+}
+
+/**
+ * @brief Make a lookup table applying gamma correction, and then scaling by
+ *        brightness, to the channel values.
+ * @note Can be evaluated at compile time, e.g. as
+ *       `static constexpr auto lut = espp::make_color_lut(2.2f, 128);`
+ * @param gamma Gamma exponent > 0, e.g. 2.2 to make the steps in the
+ *        perceived brightness of the LEDs even.
+ * @param brightness Brightness ∈ [0, 255], where 255 leaves the corrected
+ *        values unchanged.
+ * @return Lookup table with 255 * (value / 255)^gamma * brightness / 255 for
+ *         each value.
+ */
+constexpr ColorLut make_color_lut(float gamma, uint8_t brightness = 255) {
+  ColorLut lut{};
+  for (size_t i = 1; i < lut.size(); i++) {
+    double corrected = 255.0 * detail::constexpr_exp(gamma * detail::constexpr_log(i / 255.0));
+    lut[i] = detail::scale8(static_cast<uint8_t>(std::min(corrected + 0.5, 255.0)), brightness);
+  }
+  return lut;
+}
+
+/**
+ * @brief Make a lookup table applying gamma correction to the channel values.
+ * @note Can be evaluated at compile time, e.g. as
+ *       `static constexpr auto lut = espp::make_gamma_lut(2.2f);`
+ * @param gamma Gamma exponent > 0.
+ * @return Lookup table with 255 * (value / 255)^gamma for each value.
+ */
+constexpr ColorLut make_gamma_lut(float gamma) { return make_color_lut(gamma, 255); }
+
+/**
+ * @brief Color in the RGB color space with 8 bit integer channels, for
+ *        generating the colors of many LEDs without floating point math.
+ * @note Converts to and from Rgb, for the floating point color APIs.
+ */
+struct Rgb8 {
+  uint8_t r{0}; ///< Red value ∈ [0, 255]
+  uint8_t g{0}; ///< Green value ∈ [0, 255]
+  uint8_t b{0}; ///< Blue value ∈ [0, 255]
+
+  constexpr Rgb8() = default;
+
+  /**
+   * @brief Construct an Rgb8 from the provided channel values.
+   * @param r Red value ∈ [0, 255]
+   * @param g Green value ∈ [0, 255]
+   * @param b Blue value ∈ [0, 255]
+   */
+  constexpr Rgb8(uint8_t r, uint8_t g, uint8_t b)
+      : r(r)
+      , g(g)
+      , b(b) {}
+
+  /**
+   * @brief Construct an Rgb8 from the provided hex value.
+   * @param hex Hex value in the format 0xRRGGBB.
+   */
+  explicit constexpr Rgb8(uint32_t hex)
+      : r((hex >> 16) & 0xFF)
+      , g((hex >> 8) & 0xFF)
+      , b(hex & 0xFF) {}
+
+  /**
+   * @brief Construct an Rgb8 from the provided (floating point) Rgb.
+   * @param rgb Rgb to convert, rounding each channel to the nearest integer.
+   */
+  explicit Rgb8(const Rgb &rgb);
+
+  bool operator==(const Rgb8 &rhs) const = default;
+
+  /**
+   * @brief Get the (floating point) Rgb representation of this color.
+   * @return Rgb with each channel ∈ [0, 1].
+   */
+  Rgb rgb() const;
+
+  /**
+   * @brief Get the Hsv8 representation of this color, using integer math.
+   * @return Hsv8 representation of this color.
+   */
+  constexpr Hsv8 hsv() const;
+
+  /**
+   * @brief Get the hex representation of this color.
+   * @return Hex value in the format 0xRRGGBB.
+   */
+  constexpr uint32_t hex() const { return (r << 16) | (g << 8) | b; }
+
+  /**
+   * @brief Get this color with each channel mapped through lut.
+   * @param lut Lookup table to apply, e.g. from make_color_lut.
+   * @return The mapped color.
+   */
+  constexpr Rgb8 apply(const ColorLut &lut) const { return {lut[r], lut[g], lut[b]}; }
+};
+
+/**
+ * @brief Color in the HSV color space with integer channels, for generating
+ *        the colors of many LEDs (e.g. rainbows) without floating point math.
+ * @details The hue is split into 256 steps between each of the 6 primary and
+ *          secondary colors (red, yellow, green, cyan, blue, magenta), so
+ *          that converting to Rgb8 needs only integer multiplications.
+ * @note Converts to and from Hsv, for the floating point color APIs.
+ */
+struct Hsv8 {
+  /// Number of hue steps around the color wheel; hue ∈ [0, HUE_MAX)
+  static constexpr uint16_t HUE_MAX = 6 * 256;
+
+  uint16_t h{0}; ///< Hue ∈ [0, HUE_MAX), where red = 0, green = 512, blue = 1024
+  uint8_t s{0};  ///< Saturation ∈ [0, 255]
+  uint8_t v{0};  ///< Value ∈ [0, 255]
+
+  constexpr Hsv8() = default;
+
+  /**
+   * @brief Construct an Hsv8 from the provided values.
+   * @param h Hue, wrapped to be in range [0, HUE_MAX)
+   * @param s Saturation ∈ [0, 255]
+   * @param v Value ∈ [0, 255]
+   */
+  constexpr Hsv8(uint16_t h, uint8_t s, uint8_t v)
+      : h(h % HUE_MAX)
+      , s(s)
+      , v(v) {}
+
+  /**
+   * @brief Construct an Hsv8 from the provided (floating point) Hsv.
+   * @param hsv Hsv to convert, rounding each channel to the nearest step.
+   */
+  explicit Hsv8(const Hsv &hsv);
+
+  bool operator==(const Hsv8 &rhs) const = default;
+
+  /**
+   * @brief Get the Rgb8 representation of this color, using integer math.
+   * @return Rgb8 representation of this color.
+   */
+  constexpr Rgb8 rgb() const {
+    uint8_t fraction = h & 0xFF;
+    uint8_t p = detail::scale8(v, 255 - s);
+    uint8_t q = detail::scale8(v, 255 - detail::scale8(s, fraction));
+    uint8_t t = detail::scale8(v, 255 - detail::scale8(s, 255 - fraction));
+    switch (h >> 8) {
+    case 0:
+      return {v, t, p};
+    case 1:
+      return {q, v, p};
+    case 2:
+      return {p, v, t};
+    case 3:
+      return {p, q, v};
+    case 4:
+      return {t, p, v};
+    default:
+      return {v, p, q};
+    }
+  }
+
+  /**
+   * @brief Get the (floating point) Hsv representation of this color.
+   * @return Hsv with h ∈ [0, 360), s and v ∈ [0, 1].
+   */
+  Hsv hsv() const;
+};
+
+constexpr Hsv8 Rgb8::hsv() const {
+  uint8_t max = std::max(r, std::max(g, b));
+  uint8_t min = std::min(r, std::min(g, b));
+  int delta = max - min;
+  if (delta == 0) {
+    return {0, 0, max};
+  }
+  uint8_t s = (delta * 255 + max / 2) / max;
+  int h;
+  if (r == max) {
+    // color is between magenta and yellow
+    h = (g - b) * 256 / delta;
+  } else if (g == max) {
+    // color is between yellow and cyan
+    h = 512 + (b - r) * 256 / delta;
+  } else {
+    // color is between cyan and magenta
+    h = 1024 + (r - g) * 256 / delta;
+  }
+  if (h < 0) {
+    h += Hsv8::HUE_MAX;
+  }
+  return {static_cast<uint16_t>(h), s, max};
+}
+
 [[maybe_unused]] static auto color_code(const Rgb &rgb) {
   return fg(fmt::rgb(rgb.r * 255, rgb.g * 255, rgb.b * 255));
 }
@@ -48,3 +48,36 @@ template <> struct fmt::formatter<espp::Hsv> {
     return fmt::format_to(ctx.out(), "({}, {}, {})", hsv.h, hsv.s, hsv.v);
   }
 };
+
+// for allowing easy serialization/printing of the
+// Rgb8
+template <> struct fmt::formatter<espp::Rgb8> {
+  // Presentation format: 'd' - integer [0,255] (default), 'x' - hex integer.
+  char presentation = 'd';
+
+  template <typename ParseContext> constexpr auto parse(ParseContext &ctx) {
+    auto it = ctx.begin(), end = ctx.end();
+    if (it != end && (*it == 'd' || *it == 'x'))
+      presentation = *it++;
+    return it;
+  }
+
+  template <typename FormatContext> auto format(espp::Rgb8 const &rgb, FormatContext &ctx) const {
+    if (presentation == 'x') {
+      return fmt::format_to(ctx.out(), "{:#08X}", rgb.hex());
+    }
+    return fmt::format_to(ctx.out(), "({}, {}, {})", rgb.r, rgb.g, rgb.b);
+  }
+};
+
+// for allowing easy serialization/printing of the
+// Hsv8
+template <> struct fmt::formatter<espp::Hsv8> {
+  template <typename ParseContext> constexpr auto parse(ParseContext &ctx) const {
+    return ctx.begin();
+  }
+
+  template <typename FormatContext> auto format(espp::Hsv8 const &hsv, FormatContext &ctx) const {
+    return fmt::format_to(ctx.out(), "({}, {}, {})", hsv.h, hsv.s, hsv.v);
+  }
+};
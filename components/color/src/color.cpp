@@ -1,3 +1,5 @@
+#include <cmath>
+
 #include "color.hpp"
 
 namespace espp {
@@ -6,10 +8,10 @@ Rgb::Rgb(const float &_r, const float &_g, const float &_b)
     : r(_r)
     , g(_g)
     , b(_b) {
-  if (r > 1.0 || g > 1.0 || b > 1.0) {
-    r /= 255.;
-    g /= 255.;
-    b /= 255.;
+  if (r > 1.0f || g > 1.0f || b > 1.0f) {
+    r /= 255.0f;
+    g /= 255.0f;
+    b /= 255.0f;
   }
   r = std::clamp(r, 0.0f, 1.0f);
   g = std::clamp(g, 0.0f, 1.0f);
@@ -124,28 +126,57 @@ Rgb Hsv::rgb() const {
 
   float H = h, S = s, V = v, P, Q, T, fract;
 
-  (H == 360.) ? (H = 0.) : (H /= 60.);
-  fract = H - floor(H);
+  // NOTE: float (not double) literals, since double math is done in software
+  // on most of the ESP chips
+  (H == 360.0f) ? (H = 0.0f) : (H /= 60.0f);
+  fract = H - std::floor(H);
 
-  P = V * (1. - S);
-  Q = V * (1. - S * fract);
-  T = V * (1. - S * (1. - fract));
+  P = V * (1.0f - S);
+  Q = V * (1.0f - S * fract);
+  T = V * (1.0f - S * (1.0f - fract));
 
-  if (0. <= H && H < 1.)
+  if (0.0f <= H && H < 1.0f)
     RGB = Rgb(V, T, P);
-  else if (1. <= H && H < 2.)
+  else if (1.0f <= H && H < 2.0f)
     RGB = Rgb(Q, V, P);
-  else if (2. <= H && H < 3.)
+  else if (2.0f <= H && H < 3.0f)
     RGB = Rgb(P, V, T);
-  else if (3. <= H && H < 4.)
+  else if (3.0f <= H && H < 4.0f)
     RGB = Rgb(P, Q, V);
-  else if (4. <= H && H < 5.)
+  else if (4.0f <= H && H < 5.0f)
     RGB = Rgb(T, P, V);
-  else if (5. <= H && H < 6.)
+  else if (5.0f <= H && H < 6.0f)
     RGB = Rgb(V, P, Q);
   else
-    RGB = Rgb(0., 0., 0.);
+    RGB = Rgb(0.0f, 0.0f, 0.0f);
+
+  return RGB;
+}
+
+Rgb8::Rgb8(const Rgb &rgb)
+    : r(std::clamp(rgb.r, 0.0f, 1.0f) * 255.0f + 0.5f)
+    , g(std::clamp(rgb.g, 0.0f, 1.0f) * 255.0f + 0.5f)
+    , b(std::clamp(rgb.b, 0.0f, 1.0f) * 255.0f + 0.5f) {}
 
+Rgb Rgb8::rgb() const {
+  Rgb RGB;
+  RGB.r = r / 255.0f;
+  RGB.g = g / 255.0f;
+  RGB.b = b / 255.0f;
   return RGB;
 }
+
+Hsv8::Hsv8(const Hsv &hsv)
+    : h(static_cast<uint16_t>(std::clamp(hsv.h, 0.0f, 360.0f) * (HUE_MAX / 360.0f) + 0.5f) %
+        HUE_MAX)
+    , s(std::clamp(hsv.s, 0.0f, 1.0f) * 255.0f + 0.5f)
+    , v(std::clamp(hsv.v, 0.0f, 1.0f) * 255.0f + 0.5f) {}
+
+Hsv Hsv8::hsv() const {
+  Hsv HSV;
+  HSV.h = h * (360.0f / HUE_MAX);
+  HSV.s = s / 255.0f;
+  HSV.v = v / 255.0f;
+  return HSV;
+}
 } // namespace espp
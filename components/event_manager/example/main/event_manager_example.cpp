@@ -1,3 +1,5 @@
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <thread>
 #include <vector>
@@ -193,6 +195,122 @@ extern "C" void app_main(void) {
     logger.info("Published and received match!");
   }
 
+  {
+    logger.info("Starting zero-copy event manager example");
+    //! [event manager zero-copy example]
+    auto &em = espp::EventManager::get();
+    const std::string imu_topic = "imu/sample";
+
+    // subscribers which take an EventBuffer share the published buffer
+    // instead of getting a copy of it
+    std::atomic<int> num_samples_received{0};
+    for (int i = 0; i < 3; i++) {
+      em.add_subscriber(imu_topic, fmt::format("imu subscriber {}", i),
+                        [&](const espp::EventBuffer &buffer) {
+                          logger.debug("Got {} byte imu sample, shared by {} references",
+                                       buffer.size(), buffer.use_count());
+                          num_samples_received++;
+                        });
+    }
+
+    // resolve the topic once, so publishing doesn't look it up by name
+    auto imu_handle = em.get_topic_handle(imu_topic);
+    // pool of preallocated buffers, so publishing doesn't allocate
+    espp::EventBufferPool pool({.block_size = 64, .num_blocks = 8});
+
+    std::array<uint8_t, 64> sample{};
+    int num_samples_published = 0;
+    for (int i = 0; i < 100; i++) {
+      sample[0] = i;
+      if (em.publish(imu_handle, pool.make(sample))) {
+        num_samples_published++;
+      }
+      std::this_thread::sleep_for(1ms);
+    }
+    // let the subscribers finish
+    std::this_thread::sleep_for(10ms);
+
+    for (int i = 0; i < 3; i++) {
+      em.remove_subscriber(imu_topic, fmt::format("imu subscriber {}", i));
+    }
+    //! [event manager zero-copy example]
+    logger.info("Published {} samples, received {} samples", num_samples_published,
+                num_samples_received.load());
+  }
+
+  {
+    logger.info("Starting bounded queue event manager example");
+    //! [event manager bounded queue example]
+    auto &em = espp::EventManager::get();
+    const std::string telemetry_topic = "telemetry";
+
+    // only keep the 4 most recent events for the (slow) subscriber, dropping
+    // the oldest events if the subscriber falls behind
+    em.set_queue_config(telemetry_topic, {
+                                             .capacity = 4,
+                                             .overflow_policy =
+                                                 espp::EventManager::OverflowPolicy::DROP_OLDEST,
+                                         });
+    em.add_subscriber(telemetry_topic, "slow subscriber", [&](const std::vector<uint8_t> &data) {
+      // block here like we're doing work
+      std::this_thread::sleep_for(10ms);
+    });
+
+    for (int i = 0; i < 20; i++) {
+      std::vector<uint8_t> data{static_cast<uint8_t>(i)};
+      em.publish(telemetry_topic, data);
+    }
+    // let the subscriber finish
+    std::this_thread::sleep_for(100ms);
+
+    auto stats = em.get_topic_stats(telemetry_topic);
+    logger.info("Telemetry: published {}, dropped {}, high water mark {}", stats.num_published,
+                stats.num_dropped, stats.high_water_mark);
+    em.remove_subscriber(telemetry_topic, "slow subscriber");
+    //! [event manager bounded queue example]
+  }
+
+  {
+    logger.info("Starting dispatcher event manager example");
+    //! [event manager dispatcher example]
+    auto &em = espp::EventManager::get();
+
+    // run the subscribers of all topics on 2 shared worker tasks instead of
+    // one task per topic. NOTE: this must be done before adding subscribers.
+    em.set_dispatcher_config({
+        .num_workers = 2,
+        .task_config = {.name = "dispatcher", .stack_size_bytes = 4096},
+    });
+
+    // the alarm topic is dispatched before any of the sensor topics
+    em.set_queue_config("alarm", {.priority = 1});
+
+    std::atomic<int> num_received{0};
+    auto callback = [&](const espp::EventBuffer &buffer) { num_received++; };
+    em.add_subscriber("alarm", "alarm subscriber", callback);
+    static constexpr int num_sensors = 10;
+    for (int i = 0; i < num_sensors; i++) {
+      em.add_subscriber(fmt::format("sensor {}", i), "sensor subscriber", callback);
+    }
+
+    std::vector<uint8_t> data{0x01};
+    for (int i = 0; i < num_sensors; i++) {
+      em.publish(fmt::format("sensor {}", i), data);
+    }
+    em.publish("alarm", data);
+    // let the subscribers finish
+    std::this_thread::sleep_for(10ms);
+
+    em.remove_subscriber("alarm", "alarm subscriber");
+    for (int i = 0; i < num_sensors; i++) {
+      em.remove_subscriber(fmt::format("sensor {}", i), "sensor subscriber");
+    }
+    // go back to one task per topic
+    em.set_dispatcher_config({});
+    //! [event manager dispatcher example]
+    logger.info("Dispatcher received {} events", num_received.load());
+  }
+
   logger.info("Event manager example complete!");
 
   while (true) {
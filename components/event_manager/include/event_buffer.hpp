@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <span>
+#include <vector>
+
+namespace espp {
+class EventBufferPool;
+
+namespace detail {
+/// Control block shared by all copies of an EventBuffer. The payload bytes are
+/// either stored directly after the control block (heap allocated buffers) or
+/// in the arena of the EventBufferPool which owns the block.
+struct EventBufferBlock {
+  std::atomic<uint32_t> ref_count{0};
+  size_t size{0};
+  uint8_t *data{nullptr};
+  EventBufferPool *pool{nullptr}; ///< Owning pool, or nullptr if heap allocated.
+};
+} // namespace detail
+
+/**
+ * @brief Reference-counted, immutable byte buffer for publishing event data.
+ *
+ *        Copying an EventBuffer only increments a reference count, so a
+ *        single buffer can be published to a topic and shared by all of the
+ *        subscribers of that topic without copying the payload. The payload
+ *        is released when the last copy of the buffer is destroyed.
+ *
+ *        Buffers can either be heap allocated (one allocation per buffer,
+ *        using EventBuffer::make) or taken from a fixed-size arena (no
+ *        allocation, using EventBufferPool::make).
+ */
+class EventBuffer {
+public:
+  /**
+   * @brief Construct an empty EventBuffer.
+   */
+  EventBuffer() = default;
+
+  /**
+   * @brief Make a new heap allocated EventBuffer containing a copy of \p data.
+   * @details The control block and the payload are allocated together, so
+   *          this performs a single heap allocation.
+   * @param data The data to copy into the buffer.
+   * @return EventBuffer containing a copy of \p data.
+   */
+  static EventBuffer make(std::span<const uint8_t> data) {
+    void *memory = ::operator new(sizeof(detail::EventBufferBlock) + data.size());
+    auto *block = new (memory) detail::EventBufferBlock();
+    block->size = data.size();
+    block->data = reinterpret_cast<uint8_t *>(block + 1);
+    if (!data.empty()) {
+      std::memcpy(block->data, data.data(), data.size());
+    }
+    return EventBuffer(block);
+  }
+
+  EventBuffer(const EventBuffer &other)
+      : block_(other.block_) {
+    acquire();
+  }
+
+  EventBuffer(EventBuffer &&other) noexcept
+      : block_(other.block_) {
+    other.block_ = nullptr;
+  }
+
+  EventBuffer &operator=(const EventBuffer &other) {
+    if (this != &other) {
+      release();
+      block_ = other.block_;
+      acquire();
+    }
+    return *this;
+  }
+
+  EventBuffer &operator=(EventBuffer &&other) noexcept {
+    if (this != &other) {
+      release();
+      block_ = other.block_;
+      other.block_ = nullptr;
+    }
+    return *this;
+  }
+
+  ~EventBuffer() { release(); }
+
+  /**
+   * @brief Release this reference to the buffer, leaving it empty.
+   */
+  void reset() {
+    release();
+    block_ = nullptr;
+  }
+
+  /**
+   * @brief Whether this buffer refers to any data.
+   * @return True if the buffer is valid, false if it is empty.
+   */
+  explicit operator bool() const { return block_ != nullptr; }
+
+  /**
+   * @brief Pointer to the payload.
+   * @return Pointer to the payload, or nullptr if the buffer is empty.
+   */
+  const uint8_t *data() const { return block_ ? block_->data : nullptr; }
+
+  /**
+   * @brief Size of the payload in bytes.
+   * @return Size of the payload, or 0 if the buffer is empty.
+   */
+  size_t size() const { return block_ ? block_->size : 0; }
+
+  /**
+   * @brief Whether the payload is empty.
+   * @return True if the payload has no bytes.
+   */
+  bool empty() const { return size() == 0; }
+
+  /**
+   * @brief Iterator to the start of the payload.
+   * @return Pointer to the first byte of the payload.
+   */
+  const uint8_t *begin() const { return data(); }
+
+  /**
+   * @brief Iterator to the end of the payload.
+   * @return Pointer one past the last byte of the payload.
+   */
+  const uint8_t *end() const { return data() + size(); }
+
+  /**
+   * @brief Get a span over the payload.
+   * @return std::span<const uint8_t> over the payload.
+   */
+  std::span<const uint8_t> span() const { return {data(), size()}; }
+
+  /**
+   * @brief Number of EventBuffers currently referring to this payload.
+   * @return The reference count, or 0 if the buffer is empty.
+   */
+  size_t use_count() const { return block_ ? block_->ref_count.load() : 0; }
+
+protected:
+  friend class EventBufferPool;
+
+  explicit EventBuffer(detail::EventBufferBlock *block)
+      : block_(block) {
+    acquire();
+  }
+
+  void acquire() {
+    if (block_) {
+      block_->ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  inline void release();
+
+  detail::EventBufferBlock *block_{nullptr};
+};
+
+/**
+ * @brief Fixed-size arena of EventBuffers.
+ *
+ *        All memory for the pool is allocated when the pool is constructed,
+ *        so making buffers from the pool (and publishing / releasing them)
+ *        does not allocate. This is intended for high-rate publishers, e.g.
+ *        sensor samples, which would otherwise allocate on every publish.
+ *
+ * @note The pool must outlive every EventBuffer made from it.
+ */
+class EventBufferPool {
+public:
+  /**
+   * @brief Configuration for the EventBufferPool.
+   */
+  struct Config {
+    size_t block_size; ///< Maximum size (bytes) of each buffer made from the pool.
+    size_t num_blocks; ///< Number of buffers in the pool.
+  };
+
+  /**
+   * @brief Construct a new EventBufferPool, allocating all of its memory.
+   * @param config The configuration for the pool.
+   */
+  explicit EventBufferPool(const Config &config)
+      : block_size_(config.block_size)
+      , arena_(config.block_size * config.num_blocks)
+      , blocks_(config.num_blocks) {
+    free_.reserve(config.num_blocks);
+    for (size_t i = 0; i < config.num_blocks; i++) {
+      blocks_[i].data = arena_.data() + i * block_size_;
+      blocks_[i].pool = this;
+      free_.push_back(&blocks_[i]);
+    }
+  }
+
+  EventBufferPool(const EventBufferPool &) = delete;
+  EventBufferPool &operator=(const EventBufferPool &) = delete;
+
+  /**
+   * @brief Make a new EventBuffer from the pool containing a copy of \p data.
+   * @param data The data to copy into the buffer.
+   * @return EventBuffer containing a copy of \p data, or an empty EventBuffer
+   *         if \p data is larger than the block size or the pool has no free
+   *         buffers.
+   */
+  EventBuffer make(std::span<const uint8_t> data) {
+    if (data.size() > block_size_) {
+      return EventBuffer();
+    }
+    detail::EventBufferBlock *block = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_.empty()) {
+        return EventBuffer();
+      }
+      block = free_.back();
+      free_.pop_back();
+    }
+    block->size = data.size();
+    if (!data.empty()) {
+      std::memcpy(block->data, data.data(), data.size());
+    }
+    return EventBuffer(block);
+  }
+
+  /**
+   * @brief Maximum size of each buffer made from the pool.
+   * @return The block size in bytes.
+   */
+  size_t get_block_size() const { return block_size_; }
+
+  /**
+   * @brief Number of buffers currently available in the pool.
+   * @return The number of free buffers.
+   */
+  size_t get_num_free() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
+  }
+
+protected:
+  friend class EventBuffer;
+
+  void release(detail::EventBufferBlock *block) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(block);
+  }
+
+  size_t block_size_;
+  std::vector<uint8_t> arena_;
+  std::vector<detail::EventBufferBlock> blocks_;
+  mutable std::mutex mutex_;
+  std::vector<detail::EventBufferBlock *> free_;
+};
+
+namespace detail {
+/// FIFO stored in a ring. Storage grows (doubling) when the queue is full, but
+/// is never shrunk, so once the queue has reached its working size pushing and
+/// popping do not allocate.
+template <typename T> class RingQueue {
+public:
+  bool empty() const { return count_ == 0; }
+
+  size_t size() const { return count_; }
+
+  void reserve(size_t capacity) {
+    if (capacity > ring_.size()) {
+      resize(capacity);
+    }
+  }
+
+  void push_back(const T &value) {
+    if (count_ == ring_.size()) {
+      resize(std::max<size_t>(4, ring_.size() * 2));
+    }
+    ring_[(head_ + count_) % ring_.size()] = value;
+    count_++;
+  }
+
+  T &back() { return ring_[(head_ + count_ - 1) % ring_.size()]; }
+
+  T pop_front() {
+    T value = std::move(ring_[head_]);
+    head_ = (head_ + 1) % ring_.size();
+    count_--;
+    return value;
+  }
+
+  void clear() {
+    while (!empty()) {
+      pop_front();
+    }
+  }
+
+protected:
+  void resize(size_t capacity) {
+    std::vector<T> ring(capacity);
+    for (size_t i = 0; i < count_; i++) {
+      ring[i] = std::move(ring_[(head_ + i) % ring_.size()]);
+    }
+    ring_ = std::move(ring);
+    head_ = 0;
+  }
+
+  std::vector<T> ring_;
+  size_t head_{0};
+  size_t count_{0};
+};
+
+/// FIFO of EventBuffers, used for the queue of each topic.
+using EventBufferQueue = RingQueue<EventBuffer>;
+} // namespace detail
+
+void EventBuffer::release() {
+  if (!block_) {
+    return;
+  }
+  if (block_->ref_count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+  if (block_->pool) {
+    block_->pool->release(block_);
+  } else {
+    block_->~EventBufferBlock();
+    ::operator delete(block_);
+  }
+}
+} // namespace espp
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <deque>
 #include <mutex>
 #include <string>
@@ -7,6 +9,7 @@
 #include <vector>
 
 #include "base_component.hpp"
+#include "event_buffer.hpp"
 #include "event_map.hpp"
 #include "task.hpp"
 
@@ -18,6 +21,8 @@ namespace espp {
  *        loose coupling and low overhead. Each topic runs a thread for that
  *        topic's subscribers, executing all the callbacks in sequence and
  *        then going to sleep again until new data is published.
+ *        Alternatively, all topics can share a fixed pool of worker threads
+ *        (see set_dispatcher_config()).
  *
  * @note In c++ objects, it's recommended to call the
  *       add_publisher/add_subscriber functions in the class constructor and
@@ -31,8 +36,26 @@ namespace espp {
  *       and then deserialize your data from string in the subscriber
  *       callbacks.
  *
+ * @note For high-rate topics, data can be published as an EventBuffer, which
+ *       is reference counted and shared by every subscriber of the topic
+ *       (instead of being copied). Combined with an EventBufferPool, a
+ *       TopicHandle (resolved once with get_topic_handle()), and subscriber
+ *       callbacks which take an EventBuffer, publishing does not allocate.
+ *
+ * @note By default each topic's queue is unbounded, so a slow subscriber can
+ *       cause the queue to grow without limit. Use set_queue_config() to bound
+ *       the queue and choose what happens when it is full, and
+ *       get_topic_stats() to see how many events have been dropped and how
+ *       full the queue has been.
+ *
  * \section event_manager_ex1 Event Manager Example
  * \snippet event_manager_example.cpp event manager example
+ * \section event_manager_ex2 Event Manager Zero-Copy Example
+ * \snippet event_manager_example.cpp event manager zero-copy example
+ * \section event_manager_ex3 Event Manager Bounded Queue Example
+ * \snippet event_manager_example.cpp event manager bounded queue example
+ * \section event_manager_ex4 Event Manager Dispatcher Example
+ * \snippet event_manager_example.cpp event manager dispatcher example
  */
 class EventManager : public espp::BaseComponent {
 public:
@@ -43,6 +66,67 @@ public:
    */
   typedef std::function<void(const std::vector<uint8_t> &)> event_callback_fn;
 
+  /**
+   * @brief Function definition for function prototypes to be called when
+   *        subscription/event data is available, receiving the shared
+   *        EventBuffer which was published instead of a copy of its data.
+   * @param EventBuffer& The buffer associated with the event
+   */
+  typedef std::function<void(const EventBuffer &)> event_buffer_callback_fn;
+
+  /// Pre-resolved identifier for a topic, see get_topic_handle().
+  using TopicHandle = uint32_t;
+
+  /**
+   * @brief What to do when data is published to a topic whose queue is full.
+   */
+  enum class OverflowPolicy {
+    DROP_OLDEST, ///< Drop the oldest queued data to make room for the new data.
+    DROP_NEWEST, ///< Drop the new data, publish() returns false.
+    BLOCK,       ///< Block the publisher until there is room in the queue or the
+                 ///< block_timeout expires, after which the new data is dropped.
+    COALESCE,    ///< Replace the most recently queued data with the new data, so
+                 ///< subscribers only see the latest value.
+  };
+
+  /**
+   * @brief Configuration of the queue between a topic's publishers and its
+   *        subscribers.
+   */
+  struct QueueConfig {
+    size_t capacity{0}; ///< Maximum number of queued events, 0 for unbounded.
+    OverflowPolicy overflow_policy{
+        OverflowPolicy::DROP_OLDEST}; ///< What to do when the queue is full.
+    std::chrono::duration<float> block_timeout{
+        0}; ///< Maximum time to block the publisher for OverflowPolicy::BLOCK.
+    int priority{0}; ///< Priority lane of the topic when using a shared dispatcher (see
+                     ///< set_dispatcher_config()). Topics with pending data in a higher
+                     ///< priority lane are dispatched before topics in lower priority lanes.
+  };
+
+  /**
+   * @brief Configuration for running the subscribers of all topics on a
+   *        shared pool of worker tasks, instead of one task per topic.
+   */
+  struct DispatcherConfig {
+    size_t num_workers{0}; ///< Number of worker tasks, 0 to use one task per topic (default).
+    espp::Task::BaseConfig task_config{
+        .name = "EventManager dispatcher",
+        .stack_size_bytes = 8192}; ///< Task configuration for the workers. The worker index is
+                                   ///< appended to the name.
+  };
+
+  /**
+   * @brief Statistics for a topic's queue, which can be used to size the
+   *        queue based on real traffic.
+   */
+  struct TopicStats {
+    size_t num_published{0};   ///< Number of events queued for the subscribers.
+    size_t num_dropped{0};     ///< Number of events dropped (or coalesced) due to overflow.
+    size_t high_water_mark{0}; ///< Maximum number of events that have been queued at once.
+    size_t queue_size{0};      ///< Number of events currently queued.
+  };
+
   /**
    * @brief Get the singleton instance of the EventManager.
    * @return A reference to the EventManager singleton.
@@ -100,16 +184,135 @@ public:
                       const espp::EventManager::event_callback_fn &callback,
                       const espp::Task::BaseConfig &task_config);
 
+  /**
+   * @brief Register a subscriber for \p component on \p topic which receives
+   *        the published EventBuffer instead of a copy of the data.
+   * @param topic Topic name for the data being subscribed to.
+   * @param component Name of the component publishing data.
+   * @param callback The event_buffer_callback_fn to be called when receiving
+   *        data on \p topic.
+   * @param stack_size_bytes The stack size in bytes to use for the subscriber
+   * @note The stack size is only used if a subscriber is not already registered
+   *       for that topic. If a subscriber is already registered for that topic,
+   *       the stack size is ignored.
+   * @return True if the subscriber was added, false if it was already
+   *         registered for that component.
+   */
+  bool add_subscriber(const std::string &topic, const std::string &component,
+                      const espp::EventManager::event_buffer_callback_fn &callback,
+                      const size_t stack_size_bytes = 8192);
+
+  /**
+   * @brief Register a subscriber for \p component on \p topic which receives
+   *        the published EventBuffer instead of a copy of the data.
+   * @param topic Topic name for the data being subscribed to.
+   * @param component Name of the component publishing data.
+   * @param callback The event_buffer_callback_fn to be called when receiving
+   *        data on \p topic.
+   * @param task_config The task configuration to use for the subscriber.
+   * @note The task_config is only used if a subscriber is not already
+   *       registered for that topic. If a subscriber is already registered for
+   *       that topic, the task_config is ignored.
+   * @return True if the subscriber was added, false if it was already
+   *         registered for that component.
+   */
+  bool add_subscriber(const std::string &topic, const std::string &component,
+                      const espp::EventManager::event_buffer_callback_fn &callback,
+                      const espp::Task::BaseConfig &task_config);
+
+  /**
+   * @brief Configure how subscriber callbacks are run.
+   * @details By default, each topic with subscribers gets its own task which
+   *          runs that topic's subscriber callbacks. With
+   *          DispatcherConfig::num_workers > 0, the subscriber callbacks of
+   *          all topics are instead run by a shared pool of worker tasks. The
+   *          callbacks for a given topic are still called in the order the
+   *          data was published, and never by more than one worker at a time,
+   *          and topics are dispatched according to the priority in their
+   *          QueueConfig.
+   * @note This must be called before any subscribers are added. When using the
+   *       dispatcher, the stack size / task config passed to add_subscriber()
+   *       is ignored.
+   * @param dispatcher_config The dispatcher configuration.
+   * @return True if the configuration was applied, false if there are already
+   *         subscribers registered.
+   */
+  bool set_dispatcher_config(const DispatcherConfig &dispatcher_config);
+
+  /**
+   * @brief Configure the queue for \p topic.
+   * @details By default, a topic's queue is unbounded. The configuration is
+   *          kept if all subscribers are removed from the topic, and can be
+   *          set before any subscribers are added.
+   * @param topic Topic to configure the queue for.
+   * @param queue_config The queue configuration for \p topic.
+   */
+  void set_queue_config(const std::string &topic, const QueueConfig &queue_config);
+
+  /**
+   * @brief Get the queue statistics for \p topic.
+   * @param topic Topic to get the statistics for.
+   * @return The statistics for \p topic, or default (zero) statistics if
+   *         nothing has been published or subscribed on \p topic.
+   */
+  TopicStats get_topic_stats(const std::string &topic);
+
+  /**
+   * @brief Reset the queue statistics for \p topic.
+   * @details The high water mark is reset to the current queue size.
+   * @param topic Topic to reset the statistics for.
+   */
+  void reset_topic_stats(const std::string &topic);
+
+  /**
+   * @brief Get the handle for \p topic, which can be used to publish without
+   *        looking up the topic by name.
+   * @details Handles remain valid for the lifetime of the EventManager, even
+   *          if all subscribers of the topic are removed (and new ones are
+   *          added later).
+   * @param topic Topic name to get the handle for.
+   * @return The handle for \p topic.
+   */
+  TopicHandle get_topic_handle(const std::string &topic);
+
   /**
    * @brief Publish \p data on \p topic.
    * @param topic Topic to publish data on.
    * @param data Data to publish, within a vector container.
    * @return True if \p data was successfully published to \p topic, false
    *         otherwise. Publish will not occur (and will return false) if
-   *         there are no subscribers for this topic.
+   *         there are no subscribers for this topic, or if the topic's queue
+   *         is full and its overflow policy drops the new data.
    */
   bool publish(const std::string &topic, const std::vector<uint8_t> &data);
 
+  /**
+   * @brief Publish \p buffer on \p topic.
+   * @details The buffer is shared (not copied) by all subscribers of \p topic.
+   * @param topic Topic to publish data on.
+   * @param buffer Buffer to publish.
+   * @return True if \p buffer was successfully published to \p topic, false
+   *         otherwise. Publish will not occur (and will return false) if
+   *         there are no subscribers for this topic, or if the topic's queue
+   *         is full and its overflow policy drops the new data.
+   */
+  bool publish(const std::string &topic, const EventBuffer &buffer);
+
+  /**
+   * @brief Publish \p buffer on the topic identified by \p handle.
+   * @details The buffer is shared (not copied) by all subscribers of the
+   *          topic, and the topic is not looked up by name, so if \p buffer
+   *          was made from an EventBufferPool this does not allocate.
+   * @param handle Handle of the topic to publish data on, from
+   *        get_topic_handle().
+   * @param buffer Buffer to publish.
+   * @return True if \p buffer was successfully published, false otherwise.
+   *         Publish will not occur (and will return false) if there are no
+   *         subscribers for this topic, or if the topic's queue is full and
+   *         its overflow policy drops the new data.
+   */
+  bool publish(TopicHandle handle, const EventBuffer &buffer);
+
   /**
    * @brief Remove \p component's publisher for \p topic.
    * @param topic The topic that \p component was publishing on.
@@ -132,27 +335,71 @@ protected:
   EventManager()
       : espp::BaseComponent("Event Manager") {}
 
+  ~EventManager();
+
   struct SubscriberData {
+    std::string topic;
+    TopicHandle handle;
     std::mutex m;
-    bool notified = false; // Allows cv to ignore spurious wakeups
+    bool notified = false;  // Allows cv to ignore spurious wakeups
+    bool active = false;    // True while the topic has subscribers
+    bool scheduled = false; // True while the topic is queued for / running on the dispatcher
     std::condition_variable cv;
-    std::deque<std::vector<uint8_t>> deq;
+    std::condition_variable space_cv; // Notified when data is removed from deq
+    detail::EventBufferQueue deq;
+    QueueConfig queue_config;
+    TopicStats stats;
+    std::vector<uint8_t> data; // Reused to pass data to event_callback_fn subscribers
   };
 
-  bool subscriber_task_fn(const std::string &topic, std::mutex &m, std::condition_variable &cv,
-                          bool &task_notified);
+  struct Subscriber {
+    std::string component;
+    event_callback_fn callback{nullptr};
+    event_buffer_callback_fn buffer_callback{nullptr};
+  };
+
+  bool add_subscriber(const std::string &topic, const Subscriber &subscriber,
+                      const espp::Task::BaseConfig &task_config);
+
+  SubscriberData *get_subscriber_data(const std::string &topic);
+
+  bool publish(SubscriberData &sub_data, const EventBuffer &buffer);
+
+  bool call_subscribers(SubscriberData &sub_data, const EventBuffer &buffer);
+
+  bool subscriber_task_fn(TopicHandle handle, const std::string &topic, std::mutex &m,
+                          std::condition_variable &cv, bool &task_notified);
+
+  bool schedule(TopicHandle handle, int priority);
+
+  void stop_dispatcher();
+
+  bool dispatcher_task_fn();
 
   std::recursive_mutex events_mutex_;
   detail::EventMap events_;
 
   std::recursive_mutex callbacks_mutex_;
-  std::unordered_map<std::string, std::vector<std::pair<std::string, event_callback_fn>>>
-      subscriber_callbacks_;
+  std::unordered_map<std::string, std::vector<Subscriber>> subscriber_callbacks_;
 
   std::recursive_mutex tasks_mutex_;
   std::unordered_map<std::string, std::unique_ptr<Task>> subscriber_tasks_;
 
-  std::recursive_mutex data_mutex_;
-  std::unordered_map<std::string, SubscriberData> subscriber_data_;
+  std::mutex data_mutex_;
+  std::unordered_map<std::string, TopicHandle> topic_handles_;
+  // indexed by TopicHandle, never shrinks so that handles remain valid
+  std::deque<SubscriberData> subscriber_data_;
+
+  struct DispatcherLane {
+    int priority;
+    detail::RingQueue<TopicHandle> topics{};
+  };
+
+  std::mutex dispatcher_mutex_;
+  std::condition_variable dispatcher_cv_;
+  std::atomic<bool> dispatcher_running_{false};
+  // sorted by descending priority
+  std::vector<DispatcherLane> dispatcher_lanes_;
+  std::vector<std::unique_ptr<Task>> dispatcher_tasks_;
 };
 } // namespace espp
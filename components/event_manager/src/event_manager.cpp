@@ -2,6 +2,54 @@
 
 using namespace espp;
 
+EventManager::~EventManager() { stop_dispatcher(); }
+
+bool EventManager::set_dispatcher_config(const DispatcherConfig &dispatcher_config) {
+  logger_.info("Setting dispatcher to {} workers", dispatcher_config.num_workers);
+  {
+    std::lock_guard<std::recursive_mutex> lk(events_mutex_);
+    for (const auto &[topic, topic_subscribers] : events_.subscribers) {
+      if (!topic_subscribers.empty()) {
+        logger_.error("Cannot set dispatcher config, there are subscribers for topic '{}'", topic);
+        return false;
+      }
+    }
+  }
+  std::lock_guard<std::recursive_mutex> lk(tasks_mutex_);
+  stop_dispatcher();
+  if (dispatcher_config.num_workers == 0) {
+    return true;
+  }
+  dispatcher_running_ = true;
+  for (size_t i = 0; i < dispatcher_config.num_workers; i++) {
+    auto config = dispatcher_config.task_config;
+    config.name += fmt::format(" {}", i);
+    logger_.debug("Creating dispatcher task with config: {}", config);
+    auto task = Task::make_unique(
+        {.callback = [this]() -> bool { return dispatcher_task_fn(); }, .task_config = config});
+    task->start();
+    dispatcher_tasks_.push_back(std::move(task));
+  }
+  return true;
+}
+
+void EventManager::stop_dispatcher() {
+  {
+    std::lock_guard<std::mutex> lk(dispatcher_mutex_);
+    dispatcher_running_ = false;
+    dispatcher_lanes_.clear();
+  }
+  dispatcher_cv_.notify_all();
+  // NOTE: this stops and joins the tasks
+  dispatcher_tasks_.clear();
+  // any topics which were still queued on the dispatcher are no longer
+  std::lock_guard<std::mutex> lk(data_mutex_);
+  for (auto &sub_data : subscriber_data_) {
+    std::lock_guard<std::mutex> sub_data_lk(sub_data.m);
+    sub_data.scheduled = false;
+  }
+}
+
 bool EventManager::add_publisher(const std::string &topic, const std::string &component) {
   logger_.info("Adding publisher '{}' to topic '{}'", component, topic);
   std::lock_guard<std::recursive_mutex> lk(events_mutex_);
@@ -27,6 +75,26 @@ bool EventManager::add_subscriber(const std::string &topic, const std::string &c
 bool EventManager::add_subscriber(const std::string &topic, const std::string &component,
                                   const event_callback_fn &callback,
                                   const Task::BaseConfig &task_config) {
+  return add_subscriber(topic, {.component = component, .callback = callback}, task_config);
+}
+
+bool EventManager::add_subscriber(const std::string &topic, const std::string &component,
+                                  const event_buffer_callback_fn &callback,
+                                  const size_t stack_size_bytes) {
+  return add_subscriber(topic, component, callback,
+                        {.name = "", .stack_size_bytes = stack_size_bytes});
+}
+
+bool EventManager::add_subscriber(const std::string &topic, const std::string &component,
+                                  const event_buffer_callback_fn &callback,
+                                  const Task::BaseConfig &task_config) {
+  return add_subscriber(topic, {.component = component, .buffer_callback = callback},
+                        task_config);
+}
+
+bool EventManager::add_subscriber(const std::string &topic, const Subscriber &subscriber,
+                                  const Task::BaseConfig &task_config) {
+  const auto &component = subscriber.component;
   logger_.info("Adding subscriber '{}' to topic '{}'", component, topic);
   {
     std::lock_guard<std::recursive_mutex> lk(events_mutex_);
@@ -44,22 +112,35 @@ bool EventManager::add_subscriber(const std::string &topic, const std::string &c
   {
     std::lock_guard<std::recursive_mutex> lk(callbacks_mutex_);
     auto &callbacks = subscriber_callbacks_[topic];
-    auto is_component = [&component](std::pair<std::string, event_callback_fn> &e) {
-      return std::get<0>(e) == component;
-    };
+    auto is_component = [&component](const Subscriber &s) { return s.component == component; };
     auto elem = std::find_if(std::begin(callbacks), std::end(callbacks), is_component);
     if (elem != std::end(callbacks)) {
       // callback for this component is already registered, so return false
       return false;
     }
-    callbacks.emplace_back(component, callback);
+    callbacks.push_back(subscriber);
   }
   // if not in `subscriber_tasks_`
   {
     std::lock_guard<std::recursive_mutex> lk(tasks_mutex_);
-    if (!subscriber_tasks_.contains(topic)) {
-      // add to `subscriber_data_`
-      subscriber_data_[topic]; // insert default constructed data
+    if (dispatcher_running_) {
+      // the topic's data will be handled by the dispatcher tasks, so we only
+      // need to activate its entry in `subscriber_data_`
+      auto handle = get_topic_handle(topic);
+      std::lock_guard<std::mutex> data_lk(data_mutex_);
+      auto &sub_data = subscriber_data_[handle];
+      std::lock_guard<std::mutex> sub_data_lk(sub_data.m);
+      sub_data.active = true;
+    } else if (!subscriber_tasks_.contains(topic)) {
+      // activate the topic's entry in `subscriber_data_`
+      auto handle = get_topic_handle(topic);
+      {
+        std::lock_guard<std::mutex> data_lk(data_mutex_);
+        auto &sub_data = subscriber_data_[handle];
+        std::lock_guard<std::mutex> sub_data_lk(sub_data.m);
+        sub_data.active = true;
+        sub_data.notified = false;
+      }
       // create new task (using bound subscriber_task_fn) and add to
       // `subscriber_tasks_`
       using namespace std::placeholders;
@@ -70,7 +151,8 @@ bool EventManager::add_subscriber(const std::string &topic, const std::string &c
       logger_.debug("Creating task for topic '{}'", topic);
       logger_.debug("  with config: {}", config);
       subscriber_tasks_[topic] = Task::make_unique(
-          {.callback = std::bind(&EventManager::subscriber_task_fn, this, topic, _1, _2, _3),
+          {.callback =
+               std::bind(&EventManager::subscriber_task_fn, this, handle, topic, _1, _2, _3),
            .task_config = config});
       // and start it
       subscriber_tasks_[topic]->start();
@@ -79,30 +161,182 @@ bool EventManager::add_subscriber(const std::string &topic, const std::string &c
   return true;
 }
 
+EventManager::TopicHandle EventManager::get_topic_handle(const std::string &topic) {
+  std::lock_guard<std::mutex> lk(data_mutex_);
+  auto it = topic_handles_.find(topic);
+  if (it != topic_handles_.end()) {
+    return it->second;
+  }
+  TopicHandle handle = subscriber_data_.size();
+  // insert default constructed data, which is inactive until a subscriber is
+  // added for the topic
+  auto &sub_data = subscriber_data_.emplace_back();
+  sub_data.topic = topic;
+  sub_data.handle = handle;
+  topic_handles_[topic] = handle;
+  return handle;
+}
+
+void EventManager::set_queue_config(const std::string &topic, const QueueConfig &queue_config) {
+  logger_.info("Setting queue capacity for topic '{}' to {}", topic, queue_config.capacity);
+  auto handle = get_topic_handle(topic);
+  SubscriberData *sub_data;
+  {
+    std::lock_guard<std::mutex> lk(data_mutex_);
+    sub_data = &subscriber_data_[handle];
+  }
+  {
+    std::lock_guard<std::mutex> lk(sub_data->m);
+    sub_data->queue_config = queue_config;
+    // preallocate the queue so that it does not need to grow later
+    sub_data->deq.reserve(queue_config.capacity);
+  }
+  // the capacity may have increased, so wake any blocked publishers
+  sub_data->space_cv.notify_all();
+}
+
+EventManager::TopicStats EventManager::get_topic_stats(const std::string &topic) {
+  SubscriberData *sub_data = get_subscriber_data(topic);
+  if (!sub_data) {
+    return {};
+  }
+  std::lock_guard<std::mutex> lk(sub_data->m);
+  auto stats = sub_data->stats;
+  stats.queue_size = sub_data->deq.size();
+  return stats;
+}
+
+void EventManager::reset_topic_stats(const std::string &topic) {
+  SubscriberData *sub_data = get_subscriber_data(topic);
+  if (!sub_data) {
+    return;
+  }
+  std::lock_guard<std::mutex> lk(sub_data->m);
+  sub_data->stats = {};
+  sub_data->stats.high_water_mark = sub_data->deq.size();
+}
+
+EventManager::SubscriberData *EventManager::get_subscriber_data(const std::string &topic) {
+  std::lock_guard<std::mutex> lk(data_mutex_);
+  // find sub_data in `subscriber_data_`
+  auto it = topic_handles_.find(topic);
+  if (it == topic_handles_.end()) {
+    return nullptr;
+  }
+  return &subscriber_data_[it->second];
+}
+
 bool EventManager::publish(const std::string &topic, const std::vector<uint8_t> &data) {
   logger_.info("Publishing on topic '{}'", topic);
-  // find topic in `subscriber_data_`, push_back into the queue there and notify
-  // the cv.
-  // get the data queue
+  SubscriberData *sub_data = get_subscriber_data(topic);
+  if (!sub_data) {
+    return false;
+  }
+  return publish(*sub_data, EventBuffer::make(data));
+}
+
+bool EventManager::publish(const std::string &topic, const EventBuffer &buffer) {
+  logger_.info("Publishing on topic '{}'", topic);
+  SubscriberData *sub_data = get_subscriber_data(topic);
+  if (!sub_data) {
+    return false;
+  }
+  return publish(*sub_data, buffer);
+}
+
+bool EventManager::publish(TopicHandle handle, const EventBuffer &buffer) {
+  logger_.info("Publishing on topic handle {}", handle);
   SubscriberData *sub_data;
   {
-    std::lock_guard<std::recursive_mutex> lk(data_mutex_);
-    // find sub_data in `subscriber_data_`
-    if (!subscriber_data_.contains(topic)) {
+    std::lock_guard<std::mutex> lk(data_mutex_);
+    if (handle >= subscriber_data_.size()) {
+      logger_.error("Cannot publish, invalid topic handle {}", handle);
       return false;
     }
-    sub_data = &subscriber_data_[topic];
+    sub_data = &subscriber_data_[handle];
   }
+  return publish(*sub_data, buffer);
+}
+
+bool EventManager::publish(SubscriberData &sub_data, const EventBuffer &buffer) {
+  if (!buffer) {
+    logger_.error("Cannot publish an invalid (empty) EventBuffer");
+    return false;
+  }
+  bool needs_scheduling = false;
+  int priority = 0;
   {
     // lock the data queue
-    std::unique_lock<std::mutex> lk(sub_data->m);
-    // push the data into the queue
-    sub_data->deq.push_back(data);
-    // update the notified flag (used to ignore spurious wakeups)
-    sub_data->notified = true;
+    std::unique_lock<std::mutex> lk(sub_data.m);
+    if (!sub_data.active) {
+      // there are no subscribers for this topic
+      return false;
+    }
+    auto is_full = [&sub_data]() {
+      auto capacity = sub_data.queue_config.capacity;
+      return capacity > 0 && sub_data.deq.size() >= capacity;
+    };
+    if (is_full()) {
+      switch (sub_data.queue_config.overflow_policy) {
+      case OverflowPolicy::DROP_OLDEST:
+        while (is_full()) {
+          sub_data.deq.pop_front();
+          sub_data.stats.num_dropped++;
+        }
+        break;
+      case OverflowPolicy::DROP_NEWEST:
+        sub_data.stats.num_dropped++;
+        return false;
+      case OverflowPolicy::BLOCK: {
+        bool has_space = sub_data.space_cv.wait_for(
+            lk, sub_data.queue_config.block_timeout,
+            [&sub_data, &is_full] { return !sub_data.active || !is_full(); });
+        if (!sub_data.active) {
+          // the subscribers were removed while we were waiting
+          return false;
+        }
+        if (!has_space) {
+          sub_data.stats.num_dropped++;
+          return false;
+        }
+        break;
+      }
+      case OverflowPolicy::COALESCE:
+        // replace the latest queued data, which the subscribers have not
+        // seen yet, with the new data
+        sub_data.deq.back() = buffer;
+        sub_data.stats.num_dropped++;
+        sub_data.stats.num_published++;
+        return true;
+      }
+    }
+    // push the data into the queue, this only increments the buffer's
+    // reference count
+    sub_data.deq.push_back(buffer);
+    sub_data.stats.num_published++;
+    sub_data.stats.high_water_mark = std::max(sub_data.stats.high_water_mark, sub_data.deq.size());
+    if (dispatcher_running_) {
+      // hand the topic to the dispatcher, unless it is already queued or
+      // being run by one of the workers (which will pick up this data)
+      needs_scheduling = !sub_data.scheduled;
+      sub_data.scheduled = true;
+      priority = sub_data.queue_config.priority;
+    } else {
+      // update the notified flag (used to ignore spurious wakeups)
+      sub_data.notified = true;
+    }
+  }
+  if (needs_scheduling) {
+    if (!schedule(sub_data.handle, priority)) {
+      // the dispatcher was stopped after we marked the topic as scheduled, so
+      // no worker will ever clear the flag
+      std::lock_guard<std::mutex> lk(sub_data.m);
+      sub_data.scheduled = false;
+    }
+  } else {
+    // notify the task that there is new data in the queue
+    sub_data.cv.notify_all();
   }
-  // notify the task that there is new data in the queue
-  sub_data->cv.notify_all();
   return true;
 }
 
@@ -158,9 +392,7 @@ bool EventManager::remove_subscriber(const std::string &topic, const std::string
     std::lock_guard<std::recursive_mutex> lk(callbacks_mutex_);
     auto &callbacks = subscriber_callbacks_[topic];
 
-    auto is_component = [&component](std::pair<std::string, event_callback_fn> &e) {
-      return std::get<0>(e) == component;
-    };
+    auto is_component = [&component](const Subscriber &s) { return s.component == component; };
     auto elem = std::find_if(std::begin(callbacks), std::end(callbacks), is_component);
     if (elem != std::end(callbacks)) {
       callbacks.erase(elem);
@@ -173,51 +405,56 @@ bool EventManager::remove_subscriber(const std::string &topic, const std::string
   // if this was the last subscriber
   if (was_last_subscriber) {
     logger_.info("It was the last subscriber for '{}', cleaning up tasks", topic);
-    // notify the data (so the subscriber task function can stop waiting on the data cv)
+    // deactivate the data and drop any queued data (so the subscriber task
+    // function can stop waiting on the data cv). NOTE: the data itself is not
+    // removed so that any handles to the topic remain valid.
     {
-      std::lock_guard<std::recursive_mutex> lk(data_mutex_);
+      SubscriberData *sub_data = get_subscriber_data(topic);
       {
-        std::unique_lock<std::mutex> data_lk(subscriber_data_[topic].m);
-        subscriber_data_[topic].notified = true;
+        std::unique_lock<std::mutex> data_lk(sub_data->m);
+        sub_data->active = false;
+        sub_data->notified = true;
+        sub_data->deq.clear();
       }
-      subscriber_data_[topic].cv.notify_all();
+      sub_data->cv.notify_all();
+      // wake any publishers blocked on the full queue
+      sub_data->space_cv.notify_all();
     }
     {
       std::lock_guard<std::recursive_mutex> lk(tasks_mutex_);
-      // stop the task
-      subscriber_tasks_[topic]->stop();
-      // remove from `subscriber_tasks_`
-      subscriber_tasks_.erase(topic);
-    }
-    {
-      std::lock_guard<std::recursive_mutex> lk(data_mutex_);
-      // remove from `subscriber_data_`
-      subscriber_data_.erase(topic);
+      // stop the task (there is none if the topic is run by the dispatcher)
+      auto it = subscriber_tasks_.find(topic);
+      if (it != subscriber_tasks_.end()) {
+        it->second->stop();
+        // remove from `subscriber_tasks_`
+        subscriber_tasks_.erase(it);
+      }
     }
   }
   return true;
 }
 
-bool EventManager::subscriber_task_fn(const std::string &topic, std::mutex &m,
-                                      std::condition_variable &cv, bool &task_notified) {
+bool EventManager::subscriber_task_fn(TopicHandle handle, const std::string &topic,
+                                      std::mutex &m, std::condition_variable &cv,
+                                      bool &task_notified) {
   // get the data queue
   SubscriberData *sub_data;
   {
-    std::lock_guard<std::recursive_mutex> lk(data_mutex_);
+    std::lock_guard<std::mutex> lk(data_mutex_);
     // find sub_data in `subscriber_data_`
-    if (!subscriber_data_.contains(topic)) {
+    if (handle >= subscriber_data_.size()) {
       // stop the task, we don't have valid subscriber data
       return true;
     }
-    sub_data = &subscriber_data_[topic];
+    sub_data = &subscriber_data_[handle];
   }
   // get the data
   logger_.debug("Waiting on data for topic '{}'", topic);
   {
     // wait on sub_data's mutex/cv
     std::unique_lock<std::mutex> lk(sub_data->m);
-    sub_data->cv.wait(lk, [&sub_data] { return sub_data->notified; });
-    if (sub_data->deq.empty()) {
+    sub_data->cv.wait(lk, [&sub_data] { return sub_data->notified || !sub_data->active; });
+    if (!sub_data->active || sub_data->deq.empty()) {
       // stop the task, we were notified, but there was no data available.
       return true;
     }
@@ -226,7 +463,7 @@ bool EventManager::subscriber_task_fn(const std::string &topic, std::mutex &m,
   // so let's loop until we get all the data
   while (true) {
     logger_.debug("Getting data for topic '{}'", topic);
-    std::vector<uint8_t> data;
+    EventBuffer buffer;
     {
       std::unique_lock<std::mutex> lk(sub_data->m);
       if (sub_data->deq.empty()) {
@@ -235,30 +472,125 @@ bool EventManager::subscriber_task_fn(const std::string &topic, std::mutex &m,
         // we've gotten all the data, so break out of the loop
         break;
       }
-      // set data to sub_data's deque front
-      data = sub_data->deq.front();
-      // and pop the front data off
-      sub_data->deq.pop_front();
+      // take the buffer from the front of sub_data's queue
+      buffer = sub_data->deq.pop_front();
     }
-    // get all the callbacks
-    logger_.debug("Finding callbacks for topic '{}'", topic);
-    std::vector<std::pair<std::string, event_callback_fn>> *callbacks;
-    {
-      std::lock_guard<std::recursive_mutex> lk(callbacks_mutex_);
-      if (!subscriber_callbacks_.contains(topic)) {
-        // stop the task, we don't have any callbacks anymore.
-        return true;
+    // there is now space in the queue for any blocked publishers
+    sub_data->space_cv.notify_all();
+    if (!call_subscribers(*sub_data, buffer)) {
+      // stop the task, we don't have any callbacks anymore.
+      return true;
+    }
+  }
+  // we don't want to stop the task...
+  return false;
+}
+
+bool EventManager::call_subscribers(SubscriberData &sub_data, const EventBuffer &buffer) {
+  const auto &topic = sub_data.topic;
+  // get all the callbacks
+  logger_.debug("Finding callbacks for topic '{}'", topic);
+  std::vector<Subscriber> *callbacks;
+  {
+    std::lock_guard<std::recursive_mutex> lk(callbacks_mutex_);
+    auto it = subscriber_callbacks_.find(topic);
+    if (it == subscriber_callbacks_.end()) {
+      return false;
+    }
+    // copy here so that we don't hold this lock the whole time we're calling
+    // callbacks
+    callbacks = &it->second;
+  }
+  // call all the callbacks
+  logger_.debug("Calling {} callbacks for topic '{}'", callbacks->size(), topic);
+  bool copied_data = false;
+  for (const auto &subscriber : *callbacks) {
+    logger_.debug("Callback for '{}'", subscriber.component);
+    if (subscriber.buffer_callback) {
+      subscriber.buffer_callback(buffer);
+    } else if (subscriber.callback) {
+      // subscribers which take a vector share a single copy of the data,
+      // which reuses the same storage for every event on this topic
+      if (!copied_data) {
+        sub_data.data.assign(buffer.begin(), buffer.end());
+        copied_data = true;
       }
-      // copy here so that we don't hold this lock the whole time we're calling
-      // callbacks
-      callbacks = &subscriber_callbacks_[topic];
+      subscriber.callback(sub_data.data);
+    }
+  }
+  return true;
+}
+
+bool EventManager::schedule(TopicHandle handle, int priority) {
+  {
+    std::lock_guard<std::mutex> lk(dispatcher_mutex_);
+    if (!dispatcher_running_) {
+      return false;
+    }
+    // lanes are sorted by descending priority
+    auto lane = std::find_if(dispatcher_lanes_.begin(), dispatcher_lanes_.end(),
+                             [priority](const DispatcherLane &l) { return l.priority <= priority; });
+    if (lane == dispatcher_lanes_.end() || lane->priority != priority) {
+      lane = dispatcher_lanes_.insert(lane, {.priority = priority});
+    }
+    lane->topics.push_back(handle);
+  }
+  dispatcher_cv_.notify_one();
+  return true;
+}
+
+bool EventManager::dispatcher_task_fn() {
+  TopicHandle handle;
+  {
+    std::unique_lock<std::mutex> lk(dispatcher_mutex_);
+    auto lane = dispatcher_lanes_.end();
+    auto has_work = [this, &lane] {
+      lane = std::find_if(dispatcher_lanes_.begin(), dispatcher_lanes_.end(),
+                          [](const DispatcherLane &l) { return !l.topics.empty(); });
+      return lane != dispatcher_lanes_.end();
+    };
+    dispatcher_cv_.wait(lk, [this, &has_work] { return !dispatcher_running_ || has_work(); });
+    if (!dispatcher_running_) {
+      // stop the task
+      return true;
+    }
+    handle = lane->topics.pop_front();
+  }
+  SubscriberData *sub_data;
+  {
+    std::lock_guard<std::mutex> lk(data_mutex_);
+    sub_data = &subscriber_data_[handle];
+  }
+  // run a single event for this topic, then put the topic at the back of its
+  // lane so that busy topics cannot starve other topics of the same priority.
+  // NOTE: only one worker has the topic at any time, so its subscribers see
+  // the data in the order it was published.
+  EventBuffer buffer;
+  {
+    std::lock_guard<std::mutex> lk(sub_data->m);
+    if (sub_data->deq.empty()) {
+      sub_data->scheduled = false;
+      return false;
     }
-    // call all the callbacks
-    logger_.debug("Calling {} callbacks for topic '{}'", callbacks->size(), topic);
-    for (auto [comp, callback] : *callbacks) {
-      logger_.debug("Callback for '{}'", comp);
-      callback(data);
+    buffer = sub_data->deq.pop_front();
+  }
+  // there is now space in the queue for any blocked publishers
+  sub_data->space_cv.notify_all();
+  call_subscribers(*sub_data, buffer);
+  buffer.reset();
+  int priority;
+  {
+    std::lock_guard<std::mutex> lk(sub_data->m);
+    if (sub_data->deq.empty()) {
+      sub_data->scheduled = false;
+      return false;
     }
+    priority = sub_data->queue_config.priority;
+  }
+  if (!schedule(handle, priority)) {
+    // the dispatcher is stopping, so the topic is no longer queued
+    std::lock_guard<std::mutex> lk(sub_data->m);
+    sub_data->scheduled = false;
   }
   // we don't want to stop the task...
   return false;
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace espp {
+/**
+ * @brief Filter a block of samples through a biquad section in direct form 1.
+ *
+ * The block may hold one channel, or CHANNELS channels whose samples are
+ * interleaved (frame by frame). Each channel is filtered independently with
+ * the same coefficients. The state is copied into local variables for the
+ * block, so it stays in registers instead of being written back to memory
+ * after each sample, and for multiple channels the innermost loop runs over
+ * the channels, which are independent, so the compiler can vectorize it
+ * (SSE / AVX / NEON) with no dependency between the lanes.
+ *
+ * @tparam CHANNELS Number of interleaved channels in the block.
+ * @param b The normalized b coefficients (b0, b1, b2).
+ * @param a The normalized and negated a coefficients (-a1, -a2).
+ * @param x The previous inputs of each channel: x[n-1] of every channel,
+ *        followed by x[n-2] of every channel. Updated with the end of the
+ *        block.
+ * @param y The previous outputs of each channel, laid out as x is. Updated
+ *        with the end of the block.
+ * @param input Pointer to the interleaved input samples.
+ * @param output Pointer to the interleaved output samples, which may be the
+ *        same as input.
+ * @param frames Number of frames (samples per channel) in the block.
+ */
+template <size_t CHANNELS = 1>
+void biquad_df1_block(const std::array<float, 3> &b, const std::array<float, 2> &a, float *x,
+                      float *y, const float *input, float *output, size_t frames) {
+  const float b0 = b[0], b1 = b[1], b2 = b[2], a1 = a[0], a2 = a[1];
+  std::array<float, CHANNELS> x1, x2, y1, y2;
+  for (size_t c = 0; c < CHANNELS; c++) {
+    x1[c] = x[c];
+    x2[c] = x[CHANNELS + c];
+    y1[c] = y[c];
+    y2[c] = y[CHANNELS + c];
+  }
+  for (size_t n = 0; n < frames; n++) {
+    const float *in = input + n * CHANNELS;
+    float *out = output + n * CHANNELS;
+    for (size_t c = 0; c < CHANNELS; c++) {
+      float sample = in[c];
+      float acc = sample * b0 + x1[c] * b1 + x2[c] * b2 + y1[c] * a1 + y2[c] * a2;
+      x2[c] = x1[c];
+      x1[c] = sample;
+      y2[c] = y1[c];
+      y1[c] = acc;
+      out[c] = acc;
+    }
+  }
+  for (size_t c = 0; c < CHANNELS; c++) {
+    x[c] = x1[c];
+    x[CHANNELS + c] = x2[c];
+    y[c] = y1[c];
+    y[CHANNELS + c] = y2[c];
+  }
+}
+
+/**
+ * @brief Filter one frame (one sample of each of CHANNELS channels) through
+ *        a biquad section in direct form 1, in place.
+ *
+ * Equivalent to biquad_df1_block() with a single frame, but the state is
+ * updated where it is rather than copied in and out, which is what matters
+ * when a filter bank is updated with one sample of each channel at a time.
+ *
+ * @tparam CHANNELS Number of channels in the frame.
+ * @param b The normalized b coefficients (b0, b1, b2).
+ * @param a The normalized and negated a coefficients (-a1, -a2).
+ * @param x The previous inputs of each channel, as for biquad_df1_block().
+ * @param y The previous outputs of each channel, as for biquad_df1_block().
+ * @param frame The sample of each channel, replaced by the filtered sample.
+ */
+template <size_t CHANNELS>
+void biquad_df1_frame(const std::array<float, 3> &b, const std::array<float, 2> &a, float *x,
+                      float *y, std::array<float, CHANNELS> &frame) {
+  const float b0 = b[0], b1 = b[1], b2 = b[2], a1 = a[0], a2 = a[1];
+  // work on a local copy of the frame, which the compiler knows does not
+  // alias the state
+  std::array<float, CHANNELS> in = frame, out;
+  for (size_t c = 0; c < CHANNELS; c++) {
+    float acc = in[c] * b0 + x[c] * b1 + x[CHANNELS + c] * b2 + y[c] * a1 + y[CHANNELS + c] * a2;
+    x[CHANNELS + c] = x[c];
+    x[c] = in[c];
+    y[CHANNELS + c] = y[c];
+    y[c] = acc;
+    out[c] = acc;
+  }
+  frame = out;
+}
+
+/**
+ * @brief Filter a block of samples through a biquad section in (transposed)
+ *        direct form 2.
+ *
+ * Like biquad_df1_block(), the block may hold CHANNELS interleaved channels
+ * which are filtered independently, with the state kept in registers for the
+ * block and the channels in the innermost (vectorizable) loop.
+ *
+ * @tparam CHANNELS Number of interleaved channels in the block.
+ * @param coeffs The normalized coefficients (b0, b1, b2, a1, a2), as used by
+ *        dsps_biquad_f32.
+ * @param w The two delay elements of each channel: w[0] of every channel,
+ *        followed by w[1] of every channel. Updated with the end of the
+ *        block.
+ * @param input Pointer to the interleaved input samples.
+ * @param output Pointer to the interleaved output samples, which may be the
+ *        same as input.
+ * @param frames Number of frames (samples per channel) in the block.
+ */
+template <size_t CHANNELS = 1>
+void biquad_df2_block(const float *coeffs, float *w, const float *input, float *output,
+                      size_t frames) {
+  const float b0 = coeffs[0], b1 = coeffs[1], b2 = coeffs[2], a1 = coeffs[3], a2 = coeffs[4];
+  std::array<float, CHANNELS> w0, w1;
+  for (size_t c = 0; c < CHANNELS; c++) {
+    w0[c] = w[c];
+    w1[c] = w[CHANNELS + c];
+  }
+  for (size_t n = 0; n < frames; n++) {
+    const float *in = input + n * CHANNELS;
+    float *out = output + n * CHANNELS;
+    for (size_t c = 0; c < CHANNELS; c++) {
+      float sample = in[c];
+      float result = sample * b0 + w0[c];
+      w0[c] = sample * b1 - result * a1 + w1[c];
+      w1[c] = sample * b2 - result * a2;
+      out[c] = result;
+    }
+  }
+  for (size_t c = 0; c < CHANNELS; c++) {
+    w[c] = w0[c];
+    w[CHANNELS + c] = w1[c];
+  }
+}
+
+/**
+ * @brief Filter one frame (one sample of each of CHANNELS channels) through
+ *        a biquad section in (transposed) direct form 2, in place.
+ *
+ * Equivalent to biquad_df2_block() with a single frame, see
+ * biquad_df1_frame().
+ *
+ * @tparam CHANNELS Number of channels in the frame.
+ * @param coeffs The normalized coefficients (b0, b1, b2, a1, a2).
+ * @param w The two delay elements of each channel, as for biquad_df2_block().
+ * @param frame The sample of each channel, replaced by the filtered sample.
+ */
+template <size_t CHANNELS>
+void biquad_df2_frame(const float *coeffs, float *w, std::array<float, CHANNELS> &frame) {
+  const float b0 = coeffs[0], b1 = coeffs[1], b2 = coeffs[2], a1 = coeffs[3], a2 = coeffs[4];
+  std::array<float, CHANNELS> in = frame, out;
+  for (size_t c = 0; c < CHANNELS; c++) {
+    float result = in[c] * b0 + w[c];
+    w[c] = in[c] * b1 - result * a1 + w[CHANNELS + c];
+    w[CHANNELS + c] = in[c] * b2 - result * a2;
+    out[c] = result;
+  }
+  frame = out;
+}
+} // namespace espp
@@ -7,6 +7,7 @@
 #include "esp_dsp.h"
 #endif
 
+#include "biquad_block.hpp"
 #include "format.hpp"
 #include "transfer_function.hpp"
 
@@ -30,6 +31,9 @@ namespace espp {
  */
 class BiquadFilterDf1 {
 public:
+  /// Number of state values each channel filtered by the section needs
+  static constexpr size_t STATE_SIZE = 4;
+
   BiquadFilterDf1() {}
 
   explicit BiquadFilterDf1(const TransferFunction<3> &tf)
@@ -53,16 +57,50 @@ public:
    * @return Filtered output based on input and history.
    */
   float update(float input) {
-    float acc = input * b_[0];
-    acc = std::fma(prev_x_[0], b_[1], acc);
-    acc = std::fma(prev_x_[1], b_[2], acc);
-    acc = std::fma(prev_y_[0], a_[0], acc);
-    acc = std::fma(prev_y_[1], a_[1], acc);
-    prev_x_[1] = prev_x_[0];
-    prev_x_[0] = input;
-    prev_y_[1] = prev_y_[0];
-    prev_y_[0] = acc;
-    return prev_y_[0];
+    float output;
+    biquad_df1_block(b_, a_, prev_x_.data(), prev_y_.data(), &input, &output, 1);
+    return output;
+  }
+
+  /**
+   * @brief Filter the signal sampled by input, updating internal state, and
+   *        returning the filtered output.
+   * @param input Pointer to (floating point) array of new samples of the input data
+   * @param output Pointer to (floating point) array which will be filled with
+   *        the filtered input. May be the same as input.
+   * @param length Number of samples, should be >= length of input & output memory.
+   */
+  void update(const float *input, float *output, size_t length) {
+    biquad_df1_block(b_, a_, prev_x_.data(), prev_y_.data(), input, output, length);
+  }
+
+  /**
+   * @brief Filter CHANNELS interleaved signals with the coefficients of this
+   *        section, using (and updating) the state passed in rather than the
+   *        internal state.
+   * @tparam CHANNELS Number of interleaved channels.
+   * @param input Pointer to the interleaved input samples.
+   * @param output Pointer to the interleaved output samples. May be the same
+   *        as input.
+   * @param frames Number of samples of each channel.
+   * @param state The state of the channels, STATE_SIZE * CHANNELS values
+   *        which start zeroed.
+   */
+  template <size_t CHANNELS>
+  void update(const float *input, float *output, size_t frames, float *state) const {
+    biquad_df1_block<CHANNELS>(b_, a_, state, state + 2 * CHANNELS, input, output, frames);
+  }
+
+  /**
+   * @brief Filter one sample of each of CHANNELS signals, in place, using
+   *        (and updating) the state passed in.
+   * @tparam CHANNELS Number of channels.
+   * @param frame The sample of each channel, replaced by the filtered sample.
+   * @param state The state of the channels, as for the block update.
+   */
+  template <size_t CHANNELS>
+  void update(std::array<float, CHANNELS> &frame, float *state) const {
+    biquad_df1_frame<CHANNELS>(b_, a_, state, state + 2 * CHANNELS, frame);
   }
 
   friend struct fmt::formatter<BiquadFilterDf1>;
@@ -95,6 +133,9 @@ protected:
  */
 class BiquadFilterDf2 {
 public:
+  /// Number of state values each channel filtered by the section needs
+  static constexpr size_t STATE_SIZE = 2;
+
   BiquadFilterDf2() {}
 
   explicit BiquadFilterDf2(const TransferFunction<3> &tf)
@@ -120,19 +161,46 @@ public:
    *        returning the filtered output.
    * @param input Pointer to (floating point) array of new samples of the input data
    * @param output Pointer to (floating point) array which will be filled with
-   *        the filtered input.
+   *        the filtered input. May be the same as input.
    * @param length Number of samples, should be >= length of input & output memory.
    */
   void update(const float *input, float *output, size_t length) {
 #if defined(ESP_PLATFORM)
     dsps_biquad_f32(input, output, length, coeffs_.data(), w_.data());
 #else
-    for (size_t i = 0; i < length; i++) {
-      output[i] = update(input[i]);
-    }
+    biquad_df2_block(coeffs_.data(), w_.data(), input, output, length);
 #endif
   }
 
+  /**
+   * @brief Filter CHANNELS interleaved signals with the coefficients of this
+   *        section, using (and updating) the state passed in rather than the
+   *        internal state.
+   * @tparam CHANNELS Number of interleaved channels.
+   * @param input Pointer to the interleaved input samples.
+   * @param output Pointer to the interleaved output samples. May be the same
+   *        as input.
+   * @param frames Number of samples of each channel.
+   * @param state The state of the channels, STATE_SIZE * CHANNELS values
+   *        which start zeroed.
+   */
+  template <size_t CHANNELS>
+  void update(const float *input, float *output, size_t frames, float *state) const {
+    biquad_df2_block<CHANNELS>(coeffs_.data(), state, input, output, frames);
+  }
+
+  /**
+   * @brief Filter one sample of each of CHANNELS signals, in place, using
+   *        (and updating) the state passed in.
+   * @tparam CHANNELS Number of channels.
+   * @param frame The sample of each channel, replaced by the filtered sample.
+   * @param state The state of the channels, as for the block update.
+   */
+  template <size_t CHANNELS>
+  void update(std::array<float, CHANNELS> &frame, float *state) const {
+    biquad_df2_frame<CHANNELS>(coeffs_.data(), state, frame);
+  }
+
   /**
    * @brief Filter the signal sampled by input, updating internal state, and
    *        returning the filtered output.
@@ -144,9 +212,7 @@ public:
 #if defined(ESP_PLATFORM)
     dsps_biquad_f32(&input, &result, 1, coeffs_.data(), w_.data());
 #else
-    result = input * b_[0] + w_[0];
-    w_[0] = input * b_[1] - result * a_[0] + w_[1];
-    w_[1] = input * b_[2] - result * a_[1];
+    biquad_df2_block(coeffs_.data(), w_.data(), &input, &result, 1);
 #endif
     return result;
   }
@@ -6,6 +6,10 @@
 #include "sos_filter.hpp"
 
 namespace espp {
+/// Forward declaration, so that filter banks of this filter can use its
+/// coefficients
+template <class Filter, size_t CHANNELS> class FilterBank;
+
 /**
  * @brief Digital butterworth filter, implemented as biquad sections (Second
  *        Order Sections).
@@ -15,9 +19,11 @@ namespace espp {
  *
  * @tparam ORDER The order of the filter.
  * @tparam Impl Which Biquad implementation form to use.
+ * @tparam CHANNELS The number of (interleaved) channels to filter, see
+ *         SosFilter.
  */
-template <size_t ORDER, class Impl = BiquadFilterDf1>
-class ButterworthFilter : public SosFilter<(ORDER + 1) / 2, Impl> {
+template <size_t ORDER, class Impl = BiquadFilterDf1, size_t CHANNELS = 1>
+class ButterworthFilter : public SosFilter<(ORDER + 1) / 2, Impl, CHANNELS> {
 public:
   /**
    *  @brief Butterworth configuration.
@@ -33,9 +39,11 @@ public:
    * @param config The configuration struct for the Butterworth Filter
    */
   explicit ButterworthFilter(const Config &config)
-      : SosFilter<(ORDER + 1) / 2, Impl>(make_filter_config(config.normalized_cutoff_frequency)) {}
+      : SosFilter<(ORDER + 1) / 2, Impl, CHANNELS>(
+            make_filter_config(config.normalized_cutoff_frequency)) {}
 
-  friend struct fmt::formatter<ButterworthFilter<ORDER, Impl>>;
+  friend struct fmt::formatter<ButterworthFilter<ORDER, Impl, CHANNELS>>;
+  template <class Filter, size_t BANK_CHANNELS> friend class FilterBank;
 
 protected:
   template <size_t N = (ORDER + 1) / 2>
@@ -4,13 +4,14 @@
 
 // for allowing easy serialization/printing of the
 // espp::ButterworthFilter
-template <size_t ORDER, class Impl> struct fmt::formatter<espp::ButterworthFilter<ORDER, Impl>> {
+template <size_t ORDER, class Impl, size_t CHANNELS>
+struct fmt::formatter<espp::ButterworthFilter<ORDER, Impl, CHANNELS>> {
   template <typename ParseContext> constexpr auto parse(ParseContext &ctx) const {
     return ctx.begin();
   }
 
   template <typename FormatContext>
-  auto format(espp::ButterworthFilter<ORDER, Impl> const &f, FormatContext &ctx) const {
+  auto format(espp::ButterworthFilter<ORDER, Impl, CHANNELS> const &f, FormatContext &ctx) const {
     auto &&out = ctx.out();
     fmt::format_to(out, "Butterworth - [");
     if constexpr (ORDER > 0) {
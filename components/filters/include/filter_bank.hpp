@@ -0,0 +1,386 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+
+#include "biquad_block.hpp"
+#include "butterworth_filter.hpp"
+#include "kalman_filter.hpp"
+#include "lowpass_filter.hpp"
+#include "sos_filter.hpp"
+
+namespace espp {
+namespace detail {
+/// A type holding CHANNELS float values, which can be indexed, such as
+/// std::array<float, CHANNELS>, espp::Vector2f (CHANNELS = 2), or the Value
+/// struct of the IMU drivers (CHANNELS = 3, through its values member)
+template <typename V>
+concept IndexableValue = requires(V v) {
+  { v[0] } -> std::convertible_to<float>;
+};
+template <typename V>
+concept ValuesMemberValue = requires(V v) {
+  { v.values[0] } -> std::convertible_to<float>;
+};
+
+/// Get a reference to the channel-th value of value
+template <typename V> float &channel_value(V &value, size_t channel) {
+  if constexpr (IndexableValue<V>) {
+    return value[channel];
+  } else {
+    static_assert(ValuesMemberValue<V>, "The value type must be indexable or have a values array");
+    return value.values[channel];
+  }
+}
+
+/// Copy a multi-channel value into an array of its channels
+template <size_t CHANNELS, typename V> std::array<float, CHANNELS> to_channels(V value) {
+  std::array<float, CHANNELS> channels;
+  for (size_t i = 0; i < CHANNELS; i++) {
+    channels[i] = channel_value(value, i);
+  }
+  return channels;
+}
+
+/// Copy an array of channels into a multi-channel value
+template <size_t CHANNELS, typename V>
+V from_channels(V value, const std::array<float, CHANNELS> &channels) {
+  for (size_t i = 0; i < CHANNELS; i++) {
+    channel_value(value, i) = channels[i];
+  }
+  return value;
+}
+} // namespace detail
+
+/**
+ * @brief A bank of CHANNELS identically configured filters, each filtering
+ *        its own channel of a multi-channel signal, such as the 3 axes of an
+ *        accelerometer or the 9 axes of an IMU, with one call per sample.
+ *
+ * This is the generic version, which holds an array of the filters and works
+ * with any filter which has an update(float) function. The filters for which
+ * it is specialized (SosFilter, ButterworthFilter, LowpassFilter and
+ * KalmanFilter) instead keep the state of the channels in a structure of
+ * arrays (e.g. the first delay element of every channel, then the second),
+ * sharing the coefficients, so that all the channels are updated in a single
+ * loop which the compiler can vectorize.
+ *
+ * The samples can be passed as a std::array<float, CHANNELS>, or as any other
+ * multi-channel value type which can be indexed, such as espp::Vector2f or
+ * the Value struct of the Icm42607 / Icm20948 drivers, in which case the
+ * filtered value is returned as the same type.
+ *
+ * \section filter_bank_ex1 Example
+ * \code{.cpp}
+ *   espp::FilterBank<espp::ButterworthFilter<2, espp::BiquadFilterDf2>, 3> accel_filter(
+ *       {.normalized_cutoff_frequency = 2.0f * 20.0f / 1000.0f});
+ *   auto accel = imu.read_accelerometer(ec);
+ *   auto filtered_accel = accel_filter.update(accel);
+ * \endcode
+ *
+ * @tparam Filter The type of filter for each channel.
+ * @tparam CHANNELS The number of channels.
+ */
+template <class Filter, size_t CHANNELS> class FilterBank {
+public:
+  /**
+   * @brief Construct the filter bank with default constructed filters.
+   */
+  FilterBank() = default;
+
+  /**
+   * @brief Construct the filter bank with a copy of the filter for each
+   *        channel.
+   * @param filter The configured filter to copy for each channel.
+   */
+  explicit FilterBank(const Filter &filter) { filters_.fill(filter); }
+
+  /**
+   * @brief Filter one sample of each channel.
+   * @param input The new sample of each channel.
+   * @return The filtered sample of each channel.
+   */
+  std::array<float, CHANNELS> update(const std::array<float, CHANNELS> &input) {
+    std::array<float, CHANNELS> output;
+    for (size_t i = 0; i < CHANNELS; i++) {
+      output[i] = filters_[i].update(input[i]);
+    }
+    return output;
+  }
+
+  /**
+   * @brief Filter one sample of each channel.
+   * @param value The new sample of each channel, e.g. a Vector2f or the
+   *        Value of an IMU.
+   * @return The filtered sample of each channel, as the same type.
+   */
+  template <typename V> V update(const V &value) {
+    return detail::from_channels<CHANNELS>(value, update(detail::to_channels<CHANNELS>(value)));
+  }
+
+protected:
+  std::array<Filter, CHANNELS> filters_;
+};
+
+/**
+ * @brief A bank of second order sections filters, see FilterBank. The state
+ *        of the channels is kept in a structure of arrays for each section.
+ * @tparam N The number of second order sections.
+ * @tparam SectionImpl Which Biquad implementation form to use for the sections.
+ * @tparam CHANNELS The number of channels.
+ */
+template <size_t N, class SectionImpl, size_t CHANNELS>
+class FilterBank<SosFilter<N, SectionImpl>, CHANNELS> {
+public:
+  /**
+   * @brief Construct the filter bank.
+   * @param config Array of TransferFunction<3> for configuring each of the
+   *        biquad sections, shared by all the channels.
+   */
+  explicit FilterBank(const std::array<TransferFunction<3>, N> &config)
+      : filter_(config) {}
+
+  /**
+   * @brief Filter one sample of each channel.
+   * @param input The new sample of each channel.
+   * @return The filtered sample of each channel.
+   */
+  std::array<float, CHANNELS> update(const std::array<float, CHANNELS> &input) {
+    return filter_.update(input);
+  }
+
+  /**
+   * @brief Filter one sample of each channel.
+   * @param value The new sample of each channel, e.g. a Vector2f or the
+   *        Value of an IMU.
+   * @return The filtered sample of each channel, as the same type.
+   */
+  template <typename V> V update(const V &value) {
+    return detail::from_channels<CHANNELS>(value, update(detail::to_channels<CHANNELS>(value)));
+  }
+
+  /**
+   * @brief Filter a block of samples of each channel.
+   * @param input Pointer to the interleaved samples of the channels.
+   * @param output Pointer to the array which will be filled with the
+   *        interleaved filtered samples. May be the same as input.
+   * @param frames Number of samples of each channel.
+   */
+  void update(const float *input, float *output, size_t frames) {
+    filter_.update(input, output, frames);
+  }
+
+protected:
+  SosFilter<N, SectionImpl, CHANNELS> filter_;
+};
+
+/**
+ * @brief A bank of butterworth filters, see FilterBank. The state of the
+ *        channels is kept in a structure of arrays for each section.
+ * @tparam ORDER The order of the filters.
+ * @tparam Impl Which Biquad implementation form to use.
+ * @tparam CHANNELS The number of channels.
+ */
+template <size_t ORDER, class Impl, size_t CHANNELS>
+class FilterBank<ButterworthFilter<ORDER, Impl>, CHANNELS>
+    : public FilterBank<SosFilter<(ORDER + 1) / 2, Impl>, CHANNELS> {
+public:
+  /**
+   * @brief Construct the filter bank.
+   * @param config The configuration of the filters, shared by all the channels.
+   */
+  explicit FilterBank(const typename ButterworthFilter<ORDER, Impl>::Config &config)
+      : FilterBank<SosFilter<(ORDER + 1) / 2, Impl>, CHANNELS>(
+            ButterworthFilter<ORDER, Impl>::make_filter_config(
+                config.normalized_cutoff_frequency)) {}
+};
+
+/**
+ * @brief A bank of lowpass filters, see FilterBank. The channels share the
+ *        coefficients, and the delay elements of the channels are kept in a
+ *        structure of arrays.
+ * @tparam CHANNELS The number of channels.
+ */
+template <size_t CHANNELS> class FilterBank<LowpassFilter, CHANNELS> {
+public:
+  /**
+   * @brief Construct the filter bank.
+   * @param config The configuration of the filters, shared by all the channels.
+   */
+  explicit FilterBank(const LowpassFilter::Config &config)
+      : filter_(config) {}
+
+  /**
+   * @brief Filter one sample of each channel.
+   * @param input The new sample of each channel.
+   * @return The filtered sample of each channel.
+   */
+  std::array<float, CHANNELS> update(const std::array<float, CHANNELS> &input) {
+    std::array<float, CHANNELS> output = input;
+    biquad_df2_frame<CHANNELS>(filter_.coeffs_, state_.data(), output);
+    return output;
+  }
+
+  /**
+   * @brief Filter one sample of each channel.
+   * @param value The new sample of each channel, e.g. a Vector2f or the
+   *        Value of an IMU.
+   * @return The filtered sample of each channel, as the same type.
+   */
+  template <typename V> V update(const V &value) {
+    return detail::from_channels<CHANNELS>(value, update(detail::to_channels<CHANNELS>(value)));
+  }
+
+  /**
+   * @brief Filter a block of samples of each channel.
+   * @param input Pointer to the interleaved samples of the channels.
+   * @param output Pointer to the array which will be filled with the
+   *        interleaved filtered samples. May be the same as input.
+   * @param frames Number of samples of each channel.
+   */
+  void update(const float *input, float *output, size_t frames) {
+    biquad_df2_block<CHANNELS>(filter_.coeffs_, state_.data(), input, output, frames);
+  }
+
+  /**
+   * @brief Reset the state of all the channels to zero.
+   */
+  void reset() { state_.fill(0); }
+
+protected:
+  LowpassFilter filter_; // only used for its coefficients
+  std::array<float, 2 * CHANNELS> state_{};
+};
+
+/**
+ * @brief A bank of Kalman filters, see FilterBank. The state estimate and
+ *        covariance of the channels are kept in a structure of arrays.
+ *
+ * The states of a KalmanFilter are independent of each other (only the
+ * diagonals of its matrices affect the state estimate), so only the
+ * diagonals are kept, and each state of each channel is updated as
+ * KalmanFilter would update it.
+ *
+ * @tparam N The number of states of each filter.
+ * @tparam CHANNELS The number of channels.
+ */
+template <size_t N, size_t CHANNELS> class FilterBank<KalmanFilter<N>, CHANNELS> {
+public:
+  /// The states (or controls, or measurements) of all the channels
+  using State = std::array<std::array<float, N>, CHANNELS>;
+
+  /**
+   * @brief Construct the filter bank, with the same initial covariance and
+   *        noise as KalmanFilter.
+   */
+  FilterBank() {
+    x_.fill({});
+    p_.fill({});
+    for (auto &p : p_) {
+      p.fill(1.0f);
+    }
+    q_.fill(0.001f);
+    r_.fill(0.01f);
+  }
+
+  /// Set the process noise of all the states of all the channels
+  /// @param q Process noise
+  void set_process_noise(float q) { q_.fill(q); }
+
+  /// Set the process noise of each state, for all the channels
+  /// @param q Process noise vector
+  void set_process_noise(const std::array<float, N> &q) { q_ = q; }
+
+  /// Set the measurement noise of all the states of all the channels
+  /// @param r Measurement noise
+  void set_measurement_noise(float r) { r_.fill(r); }
+
+  /// Set the measurement noise of each state, for all the channels
+  /// @param r Measurement noise vector
+  void set_measurement_noise(const std::array<float, N> &r) { r_ = r; }
+
+  /// Predict the next state of each channel
+  /// @param u The control input of each channel
+  /// @param dt Time step
+  void predict(const State &u, float dt) {
+    for (size_t i = 0; i < N; i++) {
+      for (size_t c = 0; c < CHANNELS; c++) {
+        x_[i][c] += u[c][i] * dt;
+        p_[i][c] += q_[i];
+      }
+    }
+  }
+
+  /// Predict the next state of each channel, for filters with a single state
+  /// @param u The control input of each channel, e.g. the Value of a
+  ///        gyroscope
+  /// @param dt Time step
+  template <typename V>
+    requires(N == 1)
+  void predict(const V &u, float dt) {
+    auto channels = detail::to_channels<CHANNELS>(u);
+    for (size_t c = 0; c < CHANNELS; c++) {
+      x_[0][c] += channels[c] * dt;
+      p_[0][c] += q_[0];
+    }
+  }
+
+  /// Update the state estimate of each channel
+  /// @param z The measurement of each channel
+  void update(const State &z) {
+    for (size_t i = 0; i < N; i++) {
+      for (size_t c = 0; c < CHANNELS; c++) {
+        update_state(i, c, z[c][i]);
+      }
+    }
+  }
+
+  /// Update the state estimate of each channel, for filters with a single
+  /// state
+  /// @param z The measurement of each channel, e.g. the Value of an
+  ///        accelerometer
+  template <typename V>
+    requires(N == 1)
+  void update(const V &z) {
+    auto channels = detail::to_channels<CHANNELS>(z);
+    for (size_t c = 0; c < CHANNELS; c++) {
+      update_state(0, c, channels[c]);
+    }
+  }
+
+  /// Get the state estimate of each channel
+  /// @return State estimate of each channel
+  State get_state() const {
+    State state;
+    for (size_t i = 0; i < N; i++) {
+      for (size_t c = 0; c < CHANNELS; c++) {
+        state[c][i] = x_[i][c];
+      }
+    }
+    return state;
+  }
+
+  /// Get the state estimate of each channel, for filters with a single state
+  /// @return The state estimate of each channel, as a value of type V
+  template <typename V>
+    requires(N == 1)
+  V get_state(V value = {}) const {
+    return detail::from_channels<CHANNELS>(value, x_[0]);
+  }
+
+protected:
+  void update_state(size_t i, size_t c, float z) {
+    // the same steps as KalmanFilter::update, on the diagonal
+    float y = z - x_[i][c];
+    float k = p_[i][c] / (p_[i][c] + r_[i]);
+    x_[i][c] += k * y;
+    p_[i][c] = (1 - k) * p_[i][c];
+  }
+
+  std::array<std::array<float, CHANNELS>, N> x_; // State of each channel
+  std::array<std::array<float, CHANNELS>, N> p_; // Covariance of each channel
+  std::array<float, N> q_;                       // Process noise
+  std::array<float, N> r_;                       // Measurement noise
+};
+} // namespace espp
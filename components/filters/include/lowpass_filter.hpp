@@ -6,9 +6,14 @@
 #include "esp_dsp.h"
 #endif
 
+#include "biquad_block.hpp"
 #include "format.hpp"
 
 namespace espp {
+/// Forward declaration, so that filter banks of this filter can use its
+/// coefficients
+template <class Filter, size_t CHANNELS> class FilterBank;
+
 /**
  *  @brief Lowpass infinite impulse response (IIR) filter.
  */
@@ -47,7 +52,7 @@ public:
    *        filtered values to the data pointed to by output.
    * @param input Pointer to (floating point) array of new samples of the input data
    * @param output Pointer to (floating point) array which will be filled with
-   *        the filtered input.
+   *        the filtered input. May be the same as input.
    * @param length Number of samples, should be >= length of input & output memory.
    * @note On ESP32, the input and output arrays must have
    *       __attribute__((aligned(16))) to ensure proper alignment for the ESP32
@@ -77,6 +82,7 @@ public:
   void reset();
 
   friend struct fmt::formatter<LowpassFilter>;
+  template <class Filter, size_t CHANNELS> friend class FilterBank;
 
 protected:
   void init(const Config &config);
@@ -54,6 +54,22 @@ public:
    */
   float update(const float input);
 
+  /**
+   * @brief Filter a block of samples, updating internal state, and writing
+   *        the filtered samples to output.
+   * @details The samples are dt seconds apart, so the filter coefficient is
+   *        only computed once for the block, and the output is the same as
+   *        calling update(input) for each sample dt seconds apart. The time
+   *        the next update(input) measures starts at the end of the block.
+   * @param input Pointer to (floating point) array of new samples of the input data
+   * @param output Pointer to (floating point) array which will be filled with
+   *        the filtered input. May be the same as input.
+   * @param length Number of samples, should be >= length of input & output memory.
+   * @param dt Sample period of the block, i.e. the time between consecutive
+   *        samples, in seconds.
+   */
+  void update(const float *input, float *output, size_t length, float dt);
+
   /**
    * @brief Filter the signal sampled by input, updating internal state, and
    *        returning the filtered output.
@@ -70,6 +86,9 @@ public:
   friend struct fmt::formatter<SimpleLowpassFilter>;
 
 protected:
+  /// Get the time since the last update, in seconds, and restart it
+  float get_elapsed_time();
+
   float time_constant_ = 0.0f; /**< Time constant of the filter. */
   float prev_output_ = 0.0f;   /**< Previous output of the filter. */
 #if defined(ESP_PLATFORM)
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+
 #include "format.hpp"
 
 #include "biquad_filter.hpp"
@@ -11,8 +13,18 @@ namespace espp {
  * @note See https://en.wikipedia.org/wiki/Digital_biquad_filter
  *
  * @note See https://www.dsprelated.com/freebooks/filters/Series_Second_Order_Sections.html
+ *
+ * Blocks of samples are filtered one section at a time, so each section's
+ * coefficients and state stay in registers while it runs over the samples,
+ * rather than every sample being passed through all the sections in turn.
+ *
+ * @tparam N The number of second order sections.
+ * @tparam SectionImpl Which Biquad implementation form to use for the sections.
+ * @tparam CHANNELS The number of channels the filter filters. With more than
+ *         one channel, the channels are filtered independently (with the same
+ *         coefficients), from blocks of interleaved samples.
  */
-template <size_t N, class SectionImpl> class SosFilter {
+template <size_t N, class SectionImpl, size_t CHANNELS = 1> class SosFilter {
 public:
   /**
    * @brief Construct a second order sections filter.
@@ -30,7 +42,9 @@ public:
    * @param input New sample of the input data.
    * @return Filtered output based on input and history.
    */
-  float update(float input) {
+  float update(float input)
+    requires(CHANNELS == 1)
+  {
     float output = input;
     // pass the input through each section, in order
     for (auto &section : sections_) {
@@ -39,18 +53,77 @@ public:
     return output;
   }
 
+  /**
+   * @brief Filter a block of samples, updating internal state, and writing
+   *        the filtered samples to output.
+   * @param input Pointer to the input samples. With more than one channel,
+   *        the samples of the channels are interleaved (frame by frame).
+   * @param output Pointer to the array which will be filled with the
+   *        filtered samples, laid out as input. May be the same as input.
+   * @param frames Number of samples of each channel.
+   */
+  void update(const float *input, float *output, size_t frames) {
+    // filter the samples in chunks small enough to stay in the cache while
+    // they are passed through the sections
+    constexpr size_t chunk_frames = std::max<size_t>(1, MAX_CHUNK_SAMPLES / CHANNELS);
+    for (size_t offset = 0; offset < frames; offset += chunk_frames) {
+      size_t length = std::min(chunk_frames, frames - offset);
+      const float *chunk_input = input + offset * CHANNELS;
+      float *chunk_output = output + offset * CHANNELS;
+      for (size_t i = 0; i < N; i++) {
+        // the first section filters the input, the rest filter in place
+        const float *section_input = i == 0 ? chunk_input : chunk_output;
+        if constexpr (CHANNELS == 1) {
+          sections_[i].update(section_input, chunk_output, length);
+        } else {
+          sections_[i].template update<CHANNELS>(section_input, chunk_output, length,
+                                                 channel_state_[i].data());
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Filter one sample of each channel, updating internal state, and
+   *        returning the filtered samples.
+   * @param input New sample of each channel.
+   * @return Filtered sample of each channel.
+   */
+  std::array<float, CHANNELS> update(const std::array<float, CHANNELS> &input) {
+    std::array<float, CHANNELS> output = input;
+    if constexpr (CHANNELS == 1) {
+      output[0] = update(input[0]);
+    } else {
+      for (size_t i = 0; i < N; i++) {
+        sections_[i].template update<CHANNELS>(output, channel_state_[i].data());
+      }
+    }
+    return output;
+  }
+
   /**
    * @brief Filter the signal sampled by input, updating internal state, and
    *        returning the filtered output.
    * @param input New sample of the input data.
    * @return Filtered output based on input and history.
    */
-  float operator()(float input) { return update(input); }
+  float operator()(float input)
+    requires(CHANNELS == 1)
+  {
+    return update(input);
+  }
 
-  friend struct fmt::formatter<SosFilter<N, SectionImpl>>;
+  friend struct fmt::formatter<SosFilter<N, SectionImpl, CHANNELS>>;
 
 protected:
+  /// Maximum number of samples filtered by all the sections before moving on
+  /// to the next samples
+  static constexpr size_t MAX_CHUNK_SAMPLES = 256;
+
   std::array<SectionImpl, N> sections_;
+  // with a single channel, the sections hold the state themselves
+  std::array<std::array<float, SectionImpl::STATE_SIZE * CHANNELS>, CHANNELS == 1 ? 0 : N>
+      channel_state_{};
 };
 } // namespace espp
 
@@ -4,13 +4,14 @@
 
 // for allowing easy serialization/printing of the
 // espp::SosFilter
-template <size_t N, class SectionImpl> struct fmt::formatter<espp::SosFilter<N, SectionImpl>> {
+template <size_t N, class SectionImpl, size_t CHANNELS>
+struct fmt::formatter<espp::SosFilter<N, SectionImpl, CHANNELS>> {
   template <typename ParseContext> constexpr auto parse(ParseContext &ctx) const {
     return ctx.begin();
   }
 
   template <typename FormatContext>
-  auto format(espp::SosFilter<N, SectionImpl> const &f, FormatContext &ctx) const {
+  auto format(espp::SosFilter<N, SectionImpl, CHANNELS> const &f, FormatContext &ctx) const {
     auto &&out = ctx.out();
     format_to(out, "SoS - [");
     if constexpr (N > 0) {
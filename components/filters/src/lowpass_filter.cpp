@@ -8,9 +8,7 @@ void LowpassFilter::update(const float *input, float *output, size_t length) {
 #if defined(ESP_PLATFORM)
   dsps_biquad_f32(input, output, length, coeffs_, state_);
 #else
-  for (size_t i = 0; i < length; i++) {
-    output[i] = update(input[i]);
-  }
+  biquad_df2_block(coeffs_, state_, input, output, length);
 #endif
 }
 
@@ -21,15 +19,7 @@ float LowpassFilter::update(const float input) {
 #if defined(ESP_PLATFORM)
   dsps_biquad_f32(&input, &output, 1, coeffs_, state_);
 #else
-  // shift the input into the state buffer
-  state_[4] = state_[3];
-  state_[3] = state_[2];
-  state_[2] = state_[1];
-  state_[1] = state_[0];
-  state_[0] = input;
-  // calculate the output
-  output = coeffs_[0] * state_[0] + coeffs_[1] * state_[1] + coeffs_[2] * state_[2] +
-           coeffs_[3] * state_[3] + coeffs_[4] * state_[4];
+  biquad_df2_block(coeffs_, state_, &input, &output, 1);
 #endif
   return output;
 }
@@ -1,5 +1,7 @@
 #include "simple_lowpass_filter.hpp"
 
+#include <algorithm>
+
 using namespace espp;
 
 SimpleLowpassFilter::SimpleLowpassFilter(const Config &config)
@@ -13,15 +15,7 @@ float SimpleLowpassFilter::get_time_constant() const { return time_constant_; }
 
 float SimpleLowpassFilter::update(const float input) {
   float output;
-#if defined(ESP_PLATFORM)
-  uint64_t time = esp_timer_get_time();
-  float dt = (time - prev_time_) / 1e6f;
-  prev_time_ = time;
-#else
-  auto time = std::chrono::high_resolution_clock::now();
-  float dt = std::chrono::duration<float>(time - prev_time_).count();
-  prev_time_ = time;
-#endif
+  float dt = get_elapsed_time();
   if (dt <= 0) {
     return prev_output_;
   }
@@ -31,8 +25,42 @@ float SimpleLowpassFilter::update(const float input) {
   return output;
 }
 
+void SimpleLowpassFilter::update(const float *input, float *output, size_t length, float dt) {
+  // the samples carry their own timing, only restart the clock for the next
+  // per-sample update
+  get_elapsed_time();
+  if (length == 0) {
+    return;
+  }
+  if (dt <= 0) {
+    std::fill(output, output + length, prev_output_);
+    return;
+  }
+  // the samples are evenly spaced, so they all use the same coefficient
+  float alpha = dt / (time_constant_ + dt);
+  float prev_output = prev_output_;
+  for (size_t i = 0; i < length; i++) {
+    prev_output += alpha * (input[i] - prev_output);
+    output[i] = prev_output;
+  }
+  prev_output_ = prev_output;
+}
+
 float SimpleLowpassFilter::operator()(float input) { return update(input); }
 
+float SimpleLowpassFilter::get_elapsed_time() {
+#if defined(ESP_PLATFORM)
+  uint64_t time = esp_timer_get_time();
+  float dt = (time - prev_time_) / 1e6f;
+  prev_time_ = time;
+#else
+  auto time = std::chrono::high_resolution_clock::now();
+  float dt = std::chrono::duration<float>(time - prev_time_).count();
+  prev_time_ = time;
+#endif
+  return dt;
+}
+
 void SimpleLowpassFilter::reset() {
   prev_output_ = 0;
 #if defined(ESP_PLATFORM)
@@ -1,13 +1,18 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <charconv>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <sys/types.h>
@@ -18,25 +23,115 @@
 #include <random>
 #endif
 
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "base_component.hpp"
 #include "file_system.hpp"
 #include "task.hpp"
 #include "tcp_socket.hpp"
 
 namespace espp {
+/// Limits how many file transfers may be in progress at once, across all the
+/// client sessions of an FtpServer.
+class FtpTransferLimiter {
+public:
+  /// \brief Construct a transfer limiter.
+  /// \param max_transfers The maximum number of transfers in progress at
+  ///     once, or 0 for no limit.
+  explicit FtpTransferLimiter(size_t max_transfers)
+      : max_transfers_(max_transfers) {}
+
+  /// \brief Try to start a transfer.
+  /// \return True if the transfer may start, in which case release() must be
+  ///     called when it is done. False if max_transfers transfers are already
+  ///     in progress.
+  bool try_acquire() {
+    size_t active_transfers = active_transfers_.load();
+    do {
+      if (max_transfers_ > 0 && active_transfers >= max_transfers_) {
+        return false;
+      }
+    } while (!active_transfers_.compare_exchange_weak(active_transfers, active_transfers + 1));
+    return true;
+  }
+
+  /// \brief Finish a transfer which was started with try_acquire().
+  void release() { active_transfers_--; }
+
+  /// \brief Get the number of transfers in progress.
+  /// \return The number of transfers in progress.
+  size_t get_active_transfers() const { return active_transfers_; }
+
+  /// \brief Get the maximum number of transfers in progress at once.
+  /// \return The maximum number of transfers, or 0 if there is no limit.
+  size_t get_max_transfers() const { return max_transfers_; }
+
+protected:
+  size_t max_transfers_;
+  std::atomic<size_t> active_transfers_{0};
+};
+
 /// Class representing a client that is connected to the FTP server. This
 /// class is used by the FtpServer class to handle the client's requests.
+///
+/// Files are transferred in chunks of transfer_buffer_size bytes, through a
+/// buffer which is allocated when a transfer starts and freed when it
+/// finishes, so only the sessions with a transfer in progress (at most the
+/// transfer limiter's max_transfers) hold one. On Linux, RETR sends the file
+/// with sendfile(), so its data is copied from the page cache to the socket by
+/// the kernel, without passing through the buffer at all.
+///
+/// Interrupted transfers can be resumed with REST, which sets the offset the
+/// next RETR or STOR starts at. MLSD and MLST list directories in a machine
+/// readable format (RFC 3659); MLSD writes the listing to the data connection
+/// as the directory is read, rather than building it in memory first.
 class FtpClientSession : public BaseComponent {
 public:
+#if defined(ESP_PLATFORM)
+  /// Default size of the buffer used to transfer files, which is a multiple
+  /// of the lwIP TCP send buffer and of typical FAT cluster sizes
+  static constexpr size_t DEFAULT_TRANSFER_BUFFER_SIZE = 16 * 1024;
+#else
+  /// Default size of the buffer used to transfer files
+  static constexpr size_t DEFAULT_TRANSFER_BUFFER_SIZE = 64 * 1024;
+#endif
+
+  /// Size of the chunks directory listings and other data which is not a
+  /// file transfer are sent and received in, which do not use the transfer
+  /// buffer
+  static constexpr size_t DATA_CHUNK_SIZE = 4 * 1024;
+
+  /// \brief Construct a client session for a connected client.
+  /// \param id The id of the client session.
+  /// \param local_address The IP address of the server, used in the PASV
+  ///     response.
+  /// \param socket The control connection socket of the client.
+  /// \param root_path The directory the client starts in.
+  /// \param transfer_buffer_size The size of the chunks files are read and
+  ///     written in.
+  /// \param transfer_limiter Limits the number of file transfers in progress
+  ///     at once, shared by all the sessions of a server. If null, the
+  ///     number of transfers is not limited.
   explicit FtpClientSession(int id, std::string_view local_address,
                             std::unique_ptr<espp::TcpSocket> socket,
-                            const std::filesystem::path &root_path)
+                            const std::filesystem::path &root_path,
+                            size_t transfer_buffer_size = DEFAULT_TRANSFER_BUFFER_SIZE,
+                            std::shared_ptr<FtpTransferLimiter> transfer_limiter = nullptr)
       : BaseComponent("FtpClientSession " + std::to_string(id))
       , id_(id)
       , local_ip_address_(local_address)
       , current_directory_(root_path)
       , socket_(std::move(socket))
-      , passive_socket_({.log_level = Logger::Verbosity::WARN}) {
+      , passive_socket_({.log_level = Logger::Verbosity::WARN})
+      , transfer_buffer_size_(std::max<size_t>(1, transfer_buffer_size))
+      , transfer_limiter_(transfer_limiter) {
     logger_.debug("Client session {} created", id_);
     send_welcome_message();
     using namespace std::placeholders;
@@ -164,48 +259,72 @@ protected:
     return true;
   }
 
-  /// \brief Receive data from the client.
-  /// \details This function receives data from the client and stores it in
-  ///     the given buffer. This function uses the data socket and not the
-  ///     control socket, and handles both active and passive mode.
-  /// \param buffer The buffer to store the data in.
-  /// \param size The size of the buffer.
-  /// \return The number of bytes received.
-  std::optional<std::vector<uint8_t>> receive_data() {
+  /// \brief Open the data connection for a transfer.
+  /// \details In passive mode, this accepts the connection from the client
+  ///     on the passive socket. In active mode, this connects to the address
+  ///     and port the client sent with the PORT command.
+  /// \return True if the data connection was opened, false otherwise.
+  bool open_data_connection() {
     if (is_passive_data_connection_) {
       if (!passive_socket_.is_valid()) {
         logger_.error("Passive socket is invalid");
-        return {};
+        return false;
       }
       // accept the connection
       data_socket_ = passive_socket_.accept();
       if (!data_socket_) {
         logger_.error("Failed to accept data connection");
-        return {};
+        return false;
       }
       if (!data_socket_->is_valid()) {
         logger_.error("Failed to accept data connection");
-        return {};
+        return false;
       }
     } else {
+      if (!data_socket_) {
+        logger_.error("No data connection, the client must send PORT or PASV first");
+        return false;
+      }
       // connect to the client
       if (!data_socket_->connect({.ip_address = data_ip_address_, .port = data_port_})) {
         logger_.error("Failed to connect to client");
-        return {};
+        return false;
       }
     }
-    // receive the data
+    return true;
+  }
+
+  /// \brief Close the data connection after a transfer.
+  void close_data_connection() {
+    if (data_socket_) {
+      data_socket_->close();
+      data_socket_.reset();
+    }
+  }
+
+  /// \brief Receive data from the client.
+  /// \details This function receives data from the client and stores it in
+  ///     the given buffer. This function uses the data socket and not the
+  ///     control socket, and handles both active and passive mode.
+  /// \return The data received, or std::nullopt if the data connection could
+  ///     not be opened.
+  std::optional<std::vector<uint8_t>> receive_data() {
+    if (!open_data_connection()) {
+      return {};
+    }
+    // receive the data straight into the result, which is held in memory as
+    // a whole anyway
     std::vector<uint8_t> data;
     while (true) {
-      std::vector<uint8_t> buffer(1024);
-      std::size_t received = data_socket_->receive(buffer.data(), buffer.size());
+      size_t size = data.size();
+      data.resize(size + DATA_CHUNK_SIZE);
+      std::size_t received = data_socket_->receive(data.data() + size, DATA_CHUNK_SIZE);
+      data.resize(size + received);
       if (received == 0) {
         break;
       }
-      data.insert(data.end(), buffer.begin(), buffer.begin() + received);
     }
-    data_socket_->close();
-    data_socket_.reset();
+    close_data_connection();
     return data;
   }
 
@@ -216,34 +335,14 @@ protected:
   /// \param data The data to send.
   /// \return True if the data was sent successfully, false otherwise.
   bool send_data(std::string_view data) {
-    if (is_passive_data_connection_) {
-      if (!passive_socket_.is_valid()) {
-        logger_.error("Passive socket is invalid");
-        return false;
-      }
-      // accept the connection
-      data_socket_ = passive_socket_.accept();
-      if (!data_socket_) {
-        logger_.error("Failed to accept data connection");
-        return false;
-      }
-      if (!data_socket_->is_valid()) {
-        logger_.error("Failed to accept data connection");
-        return false;
-      }
-    } else {
-      // connect to the client
-      if (!data_socket_->connect({.ip_address = data_ip_address_, .port = data_port_})) {
-        logger_.error("Failed to connect to client");
-        return false;
-      }
+    if (!open_data_connection()) {
+      return false;
     }
     // send the data
     TcpSocket::TransmitConfig config{};
     bool success = data_socket_->transmit(data, config);
     // close the data socket
-    data_socket_->close();
-    data_socket_.reset();
+    close_data_connection();
     return success;
   }
 
@@ -255,48 +354,41 @@ protected:
   ///     receive_data() needs the whole data in memory, which is not possible
   ///     for large files.
   /// \param file_path The path to the file to store the data in.
+  /// \param offset The offset in the file to start writing at, from the REST
+  ///     command. If it is 0, the file is overwritten, otherwise the data
+  ///     before the offset is kept.
   /// \return True if the file was received successfully, false otherwise.
-  bool receive_file(std::filesystem::path &file_path) {
-    if (is_passive_data_connection_) {
-      if (!passive_socket_.is_valid()) {
-        logger_.error("Passive socket is invalid");
-        return false;
-      }
-      // accept the connection
-      data_socket_ = passive_socket_.accept();
-      if (!data_socket_) {
-        logger_.error("Failed to accept data connection");
-        return false;
-      }
-      if (!data_socket_->is_valid()) {
-        logger_.error("Failed to accept data connection");
-        return false;
-      }
-    } else {
-      // connect to the client
-      if (!data_socket_->connect({.ip_address = data_ip_address_, .port = data_port_})) {
-        logger_.error("Failed to connect to client");
-        return false;
-      }
+  bool receive_file(std::filesystem::path &file_path, uint64_t offset = 0) {
+    if (!open_data_connection()) {
+      return false;
     }
-    // open the file
-    std::ofstream file(file_path, std::ios::binary);
+    // open the file, keeping its contents if we are resuming the transfer
+    auto mode = std::ios::binary | std::ios::out;
+    if (offset > 0) {
+      mode |= std::ios::in;
+    }
+    std::fstream file(file_path, mode);
     if (!file.is_open()) {
       logger_.error("Failed to open file");
+      close_data_connection();
       return false;
     }
+    if (offset > 0) {
+      file.seekp(offset);
+    }
 
     auto start = std::chrono::high_resolution_clock::now();
     size_t total_size = 0;
-    // receive the data
+    // receive the data in large chunks, so that the file is written with few
+    // large writes
+    auto &buffer = get_transfer_buffer();
     while (true) {
-      std::vector<uint8_t> buffer(1024);
       std::size_t received = data_socket_->receive(buffer.data(), buffer.size());
       if (received == 0) {
         break;
       }
       total_size += received;
-      // write it to the filen
+      // write it to the file
       logger_.debug("Writing {} bytes", received);
       file.write(reinterpret_cast<char *>(buffer.data()), received);
     }
@@ -305,10 +397,8 @@ protected:
     logger_.info("Received {} bytes in {:.2f} seconds ({:.2f} bytes/s)", total_size, elapsed,
                  total_size / elapsed);
     file.close();
-    file.flush();
-    data_socket_->close();
-    data_socket_.reset();
-    return true;
+    close_data_connection();
+    return !file.fail();
   }
 
   /// \brief Send a file to the client.
@@ -319,73 +409,211 @@ protected:
   ///     send_data() needs the whole data in memory, which is not possible
   ///     for large files.
   /// \param file_path The path to the file to send.
+  /// \param offset The offset in the file to start sending from, from the
+  ///     REST command.
   /// \return True if the file was sent successfully, false otherwise.
-  bool send_file(std::filesystem::path &file_path) {
-    if (is_passive_data_connection_) {
-      if (!passive_socket_.is_valid()) {
-        logger_.error("Passive socket is invalid");
-        return false;
-      }
-      // accept the connection
-      data_socket_ = passive_socket_.accept();
-      if (!data_socket_) {
-        logger_.error("Failed to accept data connection");
-        return false;
-      }
-      if (!data_socket_->is_valid()) {
-        logger_.error("Failed to accept data connection");
-        return false;
-      }
+  bool send_file(std::filesystem::path &file_path, uint64_t offset = 0) {
+    if (!open_data_connection()) {
+      return false;
+    }
+
+    // send the file
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t total_size = 0;
+    bool success = false;
+#if defined(__linux__)
+    // send the file without copying it through user space, unless the file
+    // system does not support it
+    auto sent = send_file_contents_zero_copy(file_path, offset, total_size);
+    if (sent.has_value()) {
+      success = sent.value();
     } else {
-      // connect to the client
-      if (!data_socket_->connect({.ip_address = data_ip_address_, .port = data_port_})) {
-        logger_.error("Failed to connect to client");
-        return false;
-      }
+      success = send_file_contents(file_path, offset, total_size);
     }
+#else
+    success = send_file_contents(file_path, offset, total_size);
+#endif
+    auto end = std::chrono::high_resolution_clock::now();
+    float elapsed = std::chrono::duration<float>(end - start).count();
+    logger_.info("Sent {} bytes in {:.2f} seconds ({:.2f} bytes/s)", total_size, elapsed,
+                 total_size / elapsed);
 
-    TcpSocket::TransmitConfig config{};
+    // close the data socket
+    close_data_connection();
+    return success;
+  }
+
+  /// \brief Send the contents of a file over the open data connection,
+  ///     reading it in chunks of transfer_buffer_size bytes.
+  /// \param file_path The path to the file to send.
+  /// \param offset The offset in the file to start sending from.
+  /// \param total_size The number of bytes sent (output).
+  /// \return True if the rest of the file was sent, false otherwise.
+  bool send_file_contents(const std::filesystem::path &file_path, uint64_t offset,
+                          size_t &total_size) {
     // open the file
     std::ifstream file(file_path, std::ios::in | std::ios::binary);
     if (!file.is_open()) {
       logger_.error("Failed to open file");
       return false;
     }
-    // get the file size
-    file.seekg(0, std::ios::end);
-    std::size_t file_size = file.tellg();
-    logger_.debug("File size: {}", file_size);
-    file.seekg(0, std::ios::beg);
-    // send the file
-    auto start = std::chrono::high_resolution_clock::now();
-    size_t total_size = 0;
-    static constexpr std::size_t buffer_size = 1024;
-    std::unique_ptr<char[]> buffer(new char[buffer_size]);
+    if (offset > 0 && !file.seekg(offset)) {
+      logger_.error("Failed to seek to {}", offset);
+      return false;
+    }
+    TcpSocket::TransmitConfig config{};
+    auto &buffer = get_transfer_buffer();
     while (true) {
-      file.read(buffer.get(), buffer_size);
+      file.read(reinterpret_cast<char *>(buffer.data()), buffer.size());
       std::size_t bytes_read = file.gcount();
       if (bytes_read == 0) {
         break;
       }
-      std::string_view data(buffer.get(), bytes_read);
+      std::string_view data(reinterpret_cast<const char *>(buffer.data()), bytes_read);
       if (!data_socket_->transmit(data, config)) {
         logger_.error("Failed to send file");
         return false;
       }
       total_size += bytes_read;
     }
-    file.close();
-    auto end = std::chrono::high_resolution_clock::now();
-    float elapsed = std::chrono::duration<float>(end - start).count();
-    logger_.info("Sent {} bytes in {:.2f} seconds ({:.2f} bytes/s)", total_size, elapsed,
-                 total_size / elapsed);
-
-    // close the data socket
-    data_socket_->close();
-    data_socket_.reset();
     return true;
   }
 
+#if defined(__linux__)
+  /// \brief Send the contents of a file over the open data connection with
+  ///     sendfile(), which copies it from the page cache to the socket
+  ///     within the kernel.
+  /// \param file_path The path to the file to send.
+  /// \param offset The offset in the file to start sending from.
+  /// \param total_size The number of bytes sent (output).
+  /// \return True if the rest of the file was sent, false if sending failed,
+  ///     or std::nullopt if sendfile() is not supported for the file, in
+  ///     which case nothing was sent.
+  std::optional<bool> send_file_contents_zero_copy(const std::filesystem::path &file_path,
+                                                   uint64_t offset, size_t &total_size) {
+    int file_fd = ::open(file_path.c_str(), O_RDONLY);
+    if (file_fd < 0) {
+      logger_.error("Failed to open file: {}", strerror(errno));
+      return false;
+    }
+    struct stat file_stat;
+    if (::fstat(file_fd, &file_stat) != 0) {
+      logger_.error("Failed to get file size: {}", strerror(errno));
+      ::close(file_fd);
+      return false;
+    }
+    std::optional<bool> success = true;
+    off_t file_offset = offset;
+    while (file_offset < file_stat.st_size) {
+      ssize_t sent = ::sendfile(data_socket_->get_socket_fd(), file_fd, &file_offset,
+                                file_stat.st_size - file_offset);
+      if (sent < 0 && errno == EINTR) {
+        continue;
+      }
+      if (sent < 0 && file_offset == (off_t)offset && (errno == EINVAL || errno == ENOSYS)) {
+        logger_.debug("sendfile is not supported for this file, falling back to read");
+        success = std::nullopt;
+        break;
+      }
+      if (sent < 0) {
+        logger_.error("Failed to send file: {}", strerror(errno));
+        success = false;
+        break;
+      }
+      if (sent == 0) {
+        // the file was truncated while we were sending it
+        break;
+      }
+    }
+    total_size = file_offset - std::min<off_t>(file_offset, offset);
+    ::close(file_fd);
+    return success;
+  }
+#endif
+
+  /// \brief Send a directory listing to the client in the MLSD format, one
+  ///     entry at a time.
+  /// \details The entries are written to the data connection in chunks of
+  ///     about DATA_CHUNK_SIZE bytes as the directory is read, so the listing
+  ///     is never held in memory as a whole.
+  /// \param directory The directory to list.
+  /// \return True if the listing was sent successfully, false otherwise.
+  bool send_directory_listing(const std::filesystem::path &directory) {
+    if (!open_data_connection()) {
+      return false;
+    }
+    TcpSocket::TransmitConfig config{};
+    std::string chunk;
+    chunk.reserve(DATA_CHUNK_SIZE);
+    std::string entry_facts;
+    bool success = true;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, ec)) {
+      entry_facts.clear();
+      append_facts(entry_facts, entry);
+      chunk += entry_facts;
+      chunk += ' ';
+      chunk += entry.path().filename().string();
+      chunk += "\r\n";
+      // leave room for the next entry, so the chunk does not reallocate
+      if (chunk.size() + 512 > DATA_CHUNK_SIZE) {
+        success = data_socket_->transmit(chunk, config);
+        chunk.clear();
+        if (!success) {
+          break;
+        }
+      }
+    }
+    if (ec) {
+      logger_.error("Failed to list directory: {}", ec.message());
+      success = false;
+    }
+    if (success && !chunk.empty()) {
+      success = data_socket_->transmit(chunk, config);
+    }
+    close_data_connection();
+    return success;
+  }
+
+  /// \brief Append the MLST facts of a directory entry (RFC 3659), e.g.
+  ///     "type=file;size=1024;modify=20240101120000;".
+  /// \param facts The string to append the facts to.
+  /// \param entry The directory entry to describe.
+  void append_facts(std::string &facts, const std::filesystem::directory_entry &entry) {
+    std::error_code ec;
+    bool is_directory = entry.is_directory(ec);
+    facts += is_directory ? "type=dir;" : "type=file;";
+    if (!is_directory) {
+      auto size = entry.file_size(ec);
+      if (!ec) {
+        facts += fmt::format("size={};", size);
+      }
+    }
+    auto write_time = entry.last_write_time(ec);
+    if (!ec) {
+      // the modification time is in UTC, as YYYYMMDDHHMMSS
+      using namespace std::chrono;
+      auto time = system_clock::from_time_t(FileSystem::to_time_t(write_time));
+      auto days = floor<std::chrono::days>(time);
+      year_month_day date{days};
+      hh_mm_ss time_of_day{floor<seconds>(time - days)};
+      facts += fmt::format("modify={:04}{:02}{:02}{:02}{:02}{:02};", (int)date.year(),
+                           (unsigned)date.month(), (unsigned)date.day(),
+                           time_of_day.hours().count(), time_of_day.minutes().count(),
+                           time_of_day.seconds().count());
+    }
+  }
+
+  /// \brief Get the buffer used to transfer files, allocating it on first use
+  ///     in a transfer. It is freed by finish_transfer().
+  /// \return The buffer, of transfer_buffer_size bytes.
+  std::vector<uint8_t> &get_transfer_buffer() {
+    if (transfer_buffer_.size() != transfer_buffer_size_) {
+      transfer_buffer_.resize(transfer_buffer_size_);
+    }
+    return transfer_buffer_;
+  }
+
   bool parse_ftp_command(std::string_view request, std::string_view &command,
                          std::string_view &arguments) {
     // parses the command from the FTP client's request. The command is the
@@ -462,6 +690,15 @@ protected:
     if (command == "LIST") {
       return handle_list(arguments);
     }
+    if (command == "MLSD") {
+      return handle_mlsd(arguments);
+    }
+    if (command == "MLST") {
+      return handle_mlst(arguments);
+    }
+    if (command == "REST") {
+      return handle_rest(arguments);
+    }
     if (command == "SIZE") {
       return handle_size(arguments);
     }
@@ -579,6 +816,8 @@ protected:
     message += " PORT\r\n";
     message += " LIST\r\n";
     message += " SIZE\r\n";
+    message += " REST STREAM\r\n";
+    message += " MLST type*;size*;modify*;\r\n";
     message += " RETR\r\n";
     message += " STOR\r\n";
     message += " DELE\r\n";
@@ -691,15 +930,7 @@ protected:
   /// \return True if the command was handled, false otherwise.
   bool handle_pasv(std::string_view arguments) {
     logger_.info("Handling pasv: {}", arguments);
-#if defined(ESP_PLATFORM)
-    int port = esp_random() % 10000 + 1024;
-#else
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(0, std::numeric_limits<int>::max());
-    int port = dis(gen) % 10000 + 1024;
-#endif
-    // randomly select a port number
+    int port = next_passive_port();
     logger_.debug("Selected port: {}", port);
     // ensure that the socket is closed and ready to be used again
     passive_socket_.reinit();
@@ -728,6 +959,25 @@ protected:
     return send_response(227, message);
   }
 
+  /// \brief Select the port for the next passive data connection.
+  /// \details The ports are handed out in turn, starting from a random one,
+  ///     so that sessions doing transfers at the same time never listen on
+  ///     the same port. The sockets are bound with SO_REUSEPORT, so a port
+  ///     shared between two sessions would spread their data connections
+  ///     across both of them.
+  /// \return The port to listen on, between 1024 and 11023.
+  static int next_passive_port() {
+    static std::atomic<unsigned> next_port = [] {
+#if defined(ESP_PLATFORM)
+      return (unsigned)esp_random();
+#else
+      std::random_device rd;
+      return (unsigned)rd();
+#endif
+    }();
+    return (int)(next_port++ % 10000) + 1024;
+  }
+
   /// \brief Handle the PORT command.
   /// \details The PORT command is used to specify the address and port to
   ///     which the server should connect for the next data transfer.
@@ -823,12 +1073,82 @@ protected:
     return send_response(213, std::to_string(size));
   }
 
+  /// @brief Handle the MLSD command
+  /// The MLSD command lists the contents of a directory (the current
+  /// directory if none is given) in the machine readable format of RFC 3659,
+  /// over the data connection.
+  /// @param arguments The arguments of the command
+  /// @return True if the command was handled successfully, false otherwise
+  bool handle_mlsd(std::string_view arguments) {
+    logger_.info("Handling mlsd: {}", arguments);
+    std::filesystem::path directory = get_path_argument(arguments);
+    if (!std::filesystem::is_directory(directory)) {
+      return send_response(501, "Not a directory.");
+    }
+    if (!send_response(150, "File status okay; about to open data connection.")) {
+      logger_.error("Failed to send response");
+      return false;
+    }
+    if (!send_directory_listing(directory)) {
+      logger_.error("Failed to send directory listing");
+      return send_response(426, "Connection closed; transfer aborted.");
+    }
+    return send_response(226, "Closing data connection. Requested file action successful.");
+  }
+
+  /// @brief Handle the MLST command
+  /// The MLST command sends the facts about a file or directory (the current
+  /// directory if none is given) over the control connection.
+  /// @param arguments The arguments of the command
+  /// @return True if the command was handled successfully, false otherwise
+  bool handle_mlst(std::string_view arguments) {
+    logger_.info("Handling mlst: {}", arguments);
+    std::filesystem::path path = get_path_argument(arguments);
+    std::error_code ec;
+    std::filesystem::directory_entry entry(path, ec);
+    if (ec || !entry.exists(ec)) {
+      return send_response(550, "File does not exist.");
+    }
+    std::string message = fmt::format("Listing {}\r\n ", path.string());
+    append_facts(message, entry);
+    message += " " + path.string();
+    bool success = send_response(250, message, true);
+    return success && send_response(250, "End");
+  }
+
+  /// @brief Handle the REST command
+  /// The REST command sets the offset in the file at which the next RETR or
+  /// STOR starts, so that an interrupted transfer can be resumed.
+  /// @param arguments The arguments of the command
+  /// @return True if the command was handled successfully, false otherwise
+  bool handle_rest(std::string_view arguments) {
+    logger_.info("Handling rest: {}", arguments);
+    auto offset_end = arguments.find("\r\n");
+    if (offset_end == std::string_view::npos) {
+      logger_.error("Failed to parse offset");
+      return send_response(501, "Syntax error in parameters or arguments.");
+    }
+    std::string_view offset = arguments.substr(0, offset_end);
+    uint64_t restart_offset = 0;
+    auto [end, error] = std::from_chars(offset.data(), offset.data() + offset.size(), restart_offset);
+    if (error != std::errc() || end != offset.data() + offset.size()) {
+      return send_response(501, "Syntax error in parameters or arguments.");
+    }
+    restart_offset_ = restart_offset;
+    return send_response(350, fmt::format("Restarting at {}. Send STORE or RETRIEVE to initiate "
+                                          "transfer.",
+                                          restart_offset_));
+  }
+
   /// @brief Handle the RETR command
-  /// The RETR command retrieves a file from the server.
+  /// The RETR command retrieves a file from the server, starting at the
+  /// offset from a preceding REST command.
   /// @param arguments The arguments of the command
   /// @return True if the command was handled successfully, false otherwise
   bool handle_retr(std::string_view arguments) {
     logger_.info("Handling retr: {}", arguments);
+    // the restart offset only applies to the transfer which follows it
+    uint64_t offset = std::exchange(restart_offset_, 0);
     // get the path of the file to retrieve
     auto path_end = arguments.find("\r\n");
     if (path_end == std::string_view::npos) {
@@ -843,12 +1163,22 @@ protected:
     if (!std::filesystem::is_regular_file(full_path)) {
       return send_response(550, "Not a regular file.");
     }
+    std::error_code ec;
+    if (offset > std::filesystem::file_size(full_path, ec) || ec) {
+      return send_response(554, "Invalid REST parameter.");
+    }
+    if (!start_transfer()) {
+      return send_response(425, "Too many transfers in progress, try again later.");
+    }
     if (!send_response(150, "File status okay; about to open data connection.")) {
       logger_.error("Failed to send response");
+      finish_transfer();
       return false;
     }
     // send the file over the data connection
-    if (!send_file(full_path)) {
+    bool success = send_file(full_path, offset);
+    finish_transfer();
+    if (!success) {
       logger_.error("Failed to send file");
       return send_response(426, "Connection closed; transfer aborted.");
     }
@@ -856,11 +1186,14 @@ protected:
   }
 
   /// @brief Handle the STOR command
-  /// The STOR command stores a file on the server.
+  /// The STOR command stores a file on the server. After a REST command, the
+  /// data is written from the restart offset, keeping the start of the file.
   /// @param arguments The arguments of the command
   /// @return True if the command was handled successfully, false otherwise
   bool handle_stor(std::string_view arguments) {
     logger_.info("Handling stor: {}", arguments);
+    // the restart offset only applies to the transfer which follows it
+    uint64_t offset = std::exchange(restart_offset_, 0);
     // get the path of the file to store
     auto path_end = arguments.find("\r\n");
     if (path_end == std::string_view::npos) {
@@ -869,13 +1202,26 @@ protected:
     }
     std::string_view path = arguments.substr(0, path_end);
     std::filesystem::path full_path = current_directory_ / std::filesystem::path{path};
-    // NOTE: we don't check if the file exists, because we want to overwrite it
+    // NOTE: we don't check if the file exists, because we want to overwrite
+    // it, unless we are resuming the transfer of it
+    if (offset > 0) {
+      std::error_code ec;
+      if (offset > std::filesystem::file_size(full_path, ec) || ec) {
+        return send_response(554, "Invalid REST parameter.");
+      }
+    }
+    if (!start_transfer()) {
+      return send_response(425, "Too many transfers in progress, try again later.");
+    }
     if (!send_response(150, "File status okay; about to open data connection.")) {
       logger_.error("Failed to send response");
+      finish_transfer();
       return false;
     }
     // receive the file over the data connection
-    if (!receive_file(full_path)) {
+    bool success = receive_file(full_path, offset);
+    finish_transfer();
+    if (!success) {
       logger_.error("Failed to receive file");
       return send_response(426, "Connection closed; transfer aborted.");
     }
@@ -883,6 +1229,33 @@ protected:
     return send_response(226, "Closing data connection. Requested file action successful.");
   }
 
+  /// @brief Start a file transfer, if the server is not already doing its
+  ///        maximum number of transfers.
+  /// @return True if the transfer may start, false otherwise
+  bool start_transfer() { return !transfer_limiter_ || transfer_limiter_->try_acquire(); }
+
+  /// @brief Finish a file transfer which was started with start_transfer(),
+  ///        freeing the transfer buffer so that idle sessions do not hold one
+  void finish_transfer() {
+    std::vector<uint8_t>().swap(transfer_buffer_);
+    if (transfer_limiter_) {
+      transfer_limiter_->release();
+    }
+  }
+
+  /// @brief Get the path from the arguments of a command, relative to the
+  ///        current directory
+  /// @param arguments The arguments of the command
+  /// @return The path, or the current directory if the arguments are empty
+  std::filesystem::path get_path_argument(std::string_view arguments) {
+    auto path_end = arguments.find("\r\n");
+    std::string_view path = arguments.substr(0, path_end);
+    if (path.empty()) {
+      return current_directory_;
+    }
+    return current_directory_ / std::filesystem::path{path};
+  }
+
   /// @brief Handle the QUIT command
   /// The QUIT command closes the connection.
   /// @note After sending the response, the control connection is closed and the
@@ -1065,6 +1438,11 @@ private:
   std::string data_ip_address_;
   uint16_t data_port_{0};
 
+  size_t transfer_buffer_size_;
+  std::vector<uint8_t> transfer_buffer_; ///< only allocated during a file transfer
+  std::shared_ptr<FtpTransferLimiter> transfer_limiter_;
+  uint64_t restart_offset_{0}; ///< offset of the next RETR or STOR, from REST
+
   std::unique_ptr<Task> task_;
 };
 
@@ -25,6 +25,15 @@ namespace espp {
 /// \brief A class that implements a FTP server.
 class FtpServer : public BaseComponent {
 public:
+#if defined(ESP_PLATFORM)
+  /// Default maximum number of file transfers in progress at once, each of
+  /// which has a transfer buffer
+  static constexpr size_t DEFAULT_MAX_CONCURRENT_TRANSFERS = 2;
+#else
+  /// Default maximum number of file transfers in progress at once
+  static constexpr size_t DEFAULT_MAX_CONCURRENT_TRANSFERS = 8;
+#endif
+
   /// \brief A class that implements a FTP server.
   /// \note The IP Address is not currently used to select the right
   ///       interface, but is instead passed to the FtpClientSession so that
@@ -32,25 +41,42 @@ public:
   /// \param ip_address The IP address to listen on.
   /// \param port The port to listen on.
   /// \param root The root directory of the FTP server.
-  FtpServer(std::string_view ip_address, uint16_t port, const std::filesystem::path &root)
+  /// \param transfer_buffer_size The size of the chunks each client session
+  ///     reads and writes files in.
+  /// \param max_concurrent_transfers The maximum number of file transfers
+  ///     (RETR / STOR) in progress at once, across all the clients, or 0 for
+  ///     no limit. Clients can transfer several files (or several parts of a
+  ///     file, with REST) at once over separate connections; transfers over
+  ///     the limit are refused with 425 and can be retried.
+  FtpServer(std::string_view ip_address, uint16_t port, const std::filesystem::path &root,
+            size_t transfer_buffer_size = FtpClientSession::DEFAULT_TRANSFER_BUFFER_SIZE,
+            size_t max_concurrent_transfers = DEFAULT_MAX_CONCURRENT_TRANSFERS)
       : BaseComponent("FtpServer")
       , ip_address_(ip_address)
       , port_(port)
       , server_({.log_level = Logger::Verbosity::WARN})
-      , root_(root) {}
+      , root_(root)
+      , transfer_buffer_size_(transfer_buffer_size)
+      , transfer_limiter_(std::make_shared<FtpTransferLimiter>(max_concurrent_transfers)) {}
 
   /// \brief Destroy the FTP server.
   ~FtpServer() { stop(); }
 
   /// \brief Start the FTP server.
   /// Bind to the port and start accepting connections.
+  /// \param accept_timeout The timeout for accepting new connections, which
+  ///     is how long stop() may have to wait for the accept task.
   /// \return True if the server was started, false otherwise.
-  bool start() {
+  bool start(const std::chrono::duration<float> &accept_timeout = std::chrono::seconds(1)) {
     if (accept_task_ && accept_task_->is_started()) {
       logger_.error("Server was already started");
       return false;
     }
 
+    // ensure the receive timeout is set so that the accept will not block
+    // indefinitely and the accept task can be stopped.
+    server_.set_receive_timeout(accept_timeout);
+
     if (!server_.bind(port_)) {
       logger_.error("Failed to bind to port {}", port_);
       return false;
@@ -82,6 +108,10 @@ public:
     stop_accepting();
   }
 
+  /// \brief Get the number of file transfers in progress.
+  /// \return The number of file transfers in progress, across all clients.
+  size_t get_active_transfers() const { return transfer_limiter_->get_active_transfers(); }
+
 protected:
   /// \brief Stop accepting new connections.
   void stop_accepting() {
@@ -98,7 +128,8 @@ protected:
   bool accept_task_function(std::mutex &m, std::condition_variable &cv, bool &task_notified) {
     auto client_ptr = server_.accept();
     if (!client_ptr) {
-      logger_.error("Could not accept connection");
+      // the accept timed out, or failed
+      logger_.debug("Could not accept connection");
       // if we failed to accept that means there are no connections available
       // so we should delay a little bit
       using namespace std::chrono_literals;
@@ -115,8 +146,9 @@ protected:
     logger_.info("Accepted connection from {}, id {}", client_ptr->get_remote_info(), client_id);
 
     // create a new client session
-    auto client_session_ptr =
-        std::make_unique<FtpClientSession>(client_id, ip_address_, std::move(client_ptr), root_);
+    auto client_session_ptr = std::make_unique<FtpClientSession>(
+        client_id, ip_address_, std::move(client_ptr), root_, transfer_buffer_size_,
+        transfer_limiter_);
 
     // add the client session to the map of clients
     std::lock_guard<std::mutex> lk(clients_mutex_);
@@ -158,6 +190,8 @@ protected:
   std::unique_ptr<Task> accept_task_;
 
   std::filesystem::path root_;
+  size_t transfer_buffer_size_;
+  std::shared_ptr<FtpTransferLimiter> transfer_limiter_;
 
   std::mutex clients_mutex_;
   std::unordered_map<int, std::unique_ptr<FtpClientSession>> clients_;
@@ -66,6 +66,7 @@ class Icm42607 : public espp::BasePeripheral<uint8_t, Interface == icm42607::Int
   using BasePeripheral<uint8_t, Interface == icm42607::Interface::I2C>::set_bits_in_register;
   using BasePeripheral<uint8_t,
                        Interface == icm42607::Interface::I2C>::set_bits_in_register_by_mask;
+  using BasePeripheral<uint8_t, Interface == icm42607::Interface::I2C>::set_registers_volatile;
   using BasePeripheral<uint8_t, Interface == icm42607::Interface::I2C>::read;
   using BasePeripheral<uint8_t, Interface == icm42607::Interface::I2C>::base_mutex_;
   using BasePeripheral<uint8_t, Interface == icm42607::Interface::I2C>::logger_;
@@ -127,6 +128,7 @@ public:
     }
     set_write(config.write);
     set_read(config.read);
+    set_volatile_registers();
     if (config.auto_init) {
       std::error_code ec;
       init(ec);
@@ -789,6 +791,32 @@ protected:
     }
   }
 
+  // Mark the registers whose values can change without being written (status,
+  // sensor data, FIFO, self-clearing and memory access registers) and the
+  // device ID (so that init() checks the device is there), so that they are
+  // never cached
+  void set_volatile_registers() {
+    set_registers_volatile({
+        static_cast<uint8_t>(Register::MCLK_READY_STATUS),
+        static_cast<uint8_t>(Register::DEVICE_CONFIG),
+        static_cast<uint8_t>(Register::SIGNAL_PATH_RESET),
+        static_cast<uint8_t>(Register::APEX_DATA4),
+        static_cast<uint8_t>(Register::APEX_DATA5),
+        static_cast<uint8_t>(Register::APEX_CONFIG0),
+        static_cast<uint8_t>(Register::FIFO_LOST_PKT0),
+        static_cast<uint8_t>(Register::FIFO_LOST_PKT1),
+        static_cast<uint8_t>(Register::WHO_AM_I),
+    });
+    // temperature, accelerometer and gyroscope data
+    set_registers_volatile(static_cast<uint8_t>(Register::TEMP_DATA), 14);
+    // pedometer / activity data
+    set_registers_volatile(static_cast<uint8_t>(Register::APEX_DATA0), 4);
+    // interrupt status, FIFO count and FIFO data
+    set_registers_volatile(static_cast<uint8_t>(Register::INT_STATUS_DATA_READY), 7);
+    // memory bank access
+    set_registers_volatile(static_cast<uint8_t>(Register::BLK_SEL_W), 6);
+  }
+
   uint16_t get_temperature_raw(std::error_code &ec) {
     return read_u16_from_register(static_cast<uint8_t>(Register::TEMP_DATA), ec);
   }
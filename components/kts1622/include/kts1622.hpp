@@ -91,6 +91,12 @@ public:
                         .write_then_read = config.write_then_read},
                        "Kts1622", config.log_level)
       , config_(config) {
+    // the inputs and interrupt status can change at any time, and the
+    // interrupt clear registers are write-only, so they must not be cached
+    set_registers_volatile({(uint8_t)Registers::INPORT0, (uint8_t)Registers::INPORT1,
+                            (uint8_t)Registers::INT_STATUS0, (uint8_t)Registers::INT_STATUS1,
+                            (uint8_t)Registers::INT_CLEAR0, (uint8_t)Registers::INT_CLEAR1,
+                            (uint8_t)Registers::INPUT_STAT0, (uint8_t)Registers::INPUT_STAT1});
     if (config.auto_init) {
       std::error_code ec;
       initialize(ec);
@@ -2,13 +2,20 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
 #include "base_component.hpp"
 #include "color.hpp"
+#include "task.hpp"
 
 namespace espp {
 /// \brief Class to control LED strips
@@ -29,6 +36,12 @@ namespace espp {
 /// - APA102 (via SPI)
 /// - WS2812 (via the RMT peripheral)
 ///
+/// The strip can be double buffered (see Config::double_buffered), so that
+/// show() hands the frame to a task which writes it, and the next frame can be
+/// drawn while the previous one is being written. The changes since the last
+/// frame are tracked, so that protocols which can update part of the strip
+/// (see Config::write_range) only need to be sent the bytes which changed.
+///
 /// \section led_strip_ex1 Example 1: APA102 via SPI
 /// \snippet led_strip_example.cpp led strip ex1
 class LedStrip : public BaseComponent {
@@ -49,6 +62,15 @@ public:
   /// byte in the strip).
   typedef std::function<void(const uint8_t *data, size_t length)> write_fn;
 
+  /// \brief Function to write part of the data to the strip
+  /// \details For protocols which can update part of the strip. Called by
+  /// show() with only the bytes which changed since the last show().
+  /// \param data Pointer to the first byte which changed
+  /// \param length Number of bytes to write
+  /// \param offset Offset of data within the data of the whole strip (which
+  /// starts with the start frame, if any)
+  typedef std::function<void(const uint8_t *data, size_t length, size_t offset)> write_range_fn;
+
   /// \brief Byte order for the LEDs
   enum class ByteOrder {
     RGB, ///< RGB byte order
@@ -70,6 +92,26 @@ public:
     std::vector<uint8_t> end_frame{}; ///< End frame for the strip. Optional - will be sent after
                                       ///< the last LED if not empty.
     Logger::Verbosity log_level;      ///< Log level for this class
+    write_range_fn write_range{
+        nullptr}; ///< Optional function to write only the bytes which changed since the last
+                  ///< show(). If provided, it is used by show() instead of write.
+    bool double_buffered{false}; ///< If true, show() returns without waiting for the frame to
+                                 ///< be written, which is done by a task of the strip, so that
+                                 ///< the next frame can be drawn meanwhile.
+    Task::BaseConfig task_config{
+        .name = "LedStrip",
+        .stack_size_bytes = 4096}; ///< Configuration of the task which writes the frames, if
+                                   ///< double_buffered is true.
+  };
+
+  /// \brief Statistics of the frames shown on the strip
+  struct FrameStats {
+    size_t frames_shown{0};   ///< Number of frames written to the strip
+    size_t bytes_written{0};  ///< Number of bytes written to the strip
+    float frame_rate{0};      ///< Average frames per second, between the first and the last
+                              ///< frame written
+    float average_latency{0}; ///< Average time (s) from show() to the end of the write
+    float max_latency{0};     ///< Longest time (s) from show() to the end of the write
   };
 
   /// \brief Constructor
@@ -79,7 +121,8 @@ public:
       , num_leds_(config.num_leds)
       , send_brightness_(config.send_brightness)
       , byte_order_(config.byte_order)
-      , write_(config.write) {
+      , write_(config.write)
+      , write_range_(config.write_range) {
     // set the color data size
     pixel_size_ = send_brightness_ ? 4 : 3;
     data_.resize(num_leds_ * pixel_size_ + config.start_frame.size() + config.end_frame.size());
@@ -90,8 +133,36 @@ public:
               data_.end() - config.end_frame.size());
     start_offset_ = config.start_frame.size();
     end_offset_ = config.end_frame.size();
+    // where each color goes within a pixel, for the bulk APIs
+    switch (byte_order_) {
+    case ByteOrder::RGB:
+      red_index_ = 0;
+      green_index_ = 1;
+      blue_index_ = 2;
+      break;
+    case ByteOrder::GRB:
+      red_index_ = 1;
+      green_index_ = 0;
+      blue_index_ = 2;
+      break;
+    case ByteOrder::BGR:
+      red_index_ = 2;
+      green_index_ = 1;
+      blue_index_ = 0;
+      break;
+    }
+    // the whole strip must be sent the first time
+    mark_dirty(0, data_.size());
+    if (config.double_buffered) {
+      start_write_task(config.task_config);
+    }
   }
 
+  /// \brief Destructor
+  /// \details If double buffered, waits for the frame being written (if any)
+  /// to be written, and stops the task which writes the frames.
+  ~LedStrip();
+
   /// \brief Get the number of LEDs in the strip
   /// \return Number of LEDs in the strip
   size_t num_leds() const { return num_leds_; }
@@ -113,7 +184,8 @@ public:
     if (shift_by < 0)
       shift_by += num_leds_;
     std::rotate(data_.begin() + start_offset_,
-                data_.begin() + start_offset_ + pixel_size_ * shift_by, data_.end() + end_offset_);
+                data_.begin() + start_offset_ + pixel_size_ * shift_by, data_.end() - end_offset_);
+    mark_dirty(start_offset_, data_.size() - end_offset_);
   }
 
   /// \brief Shift the LEDs to the right
@@ -129,7 +201,8 @@ public:
     if (shift_by < 0)
       shift_by += num_leds_;
     std::rotate(data_.rbegin() + end_offset_, data_.rbegin() + end_offset_ + pixel_size_ * shift_by,
-                data_.rend() + start_offset_);
+                data_.rend() - start_offset_);
+    mark_dirty(start_offset_, data_.size() - end_offset_);
   }
 
   /// \brief Set the color of a single LED
@@ -174,6 +247,7 @@ public:
     }
 
     int offset = start_offset_ + index * pixel_size_;
+    mark_dirty(offset, offset + pixel_size_);
     // set the color in the array
     if (send_brightness_) {
       // set the brightness byte (encoded as 0b111nnnnn where nnnnn is the
@@ -235,26 +309,199 @@ public:
     }
   }
 
+  /// \brief Set the lookup table applied to the colors of the Rgb8 / Hsv8 APIs
+  /// \details The colors given to set_pixels and fill_gradient are mapped
+  /// through this table (e.g. for gamma correction and / or brightness) as
+  /// they are written to the strip. By default the colors are unchanged.
+  /// \param lut Lookup table, e.g. from make_color_lut, which can be generated
+  /// at compile time
+  /// \note Does not apply to the other set_pixel / set_all APIs.
+  /// \sa make_color_lut
+  /// \sa make_gamma_lut
+  /// \sa make_brightness_lut
+  void set_color_lut(const ColorLut &lut) { color_lut_ = lut; }
+
+  /// \brief Set the colors of a range of LEDs
+  /// \details The colors are mapped through the color lookup table and written
+  /// directly to the strip's data, in its byte order.
+  /// \param colors Colors to set the LEDs to, starting at LED \p first
+  /// \param first Index of the LED to set to the first color
+  /// \param brightness Brightness of the LEDs [0-31], only sent to strips
+  /// which use a brightness value (e.g. APA102). For other strips, use the
+  /// color lookup table to change the brightness.
+  /// \note Colors past the end of the strip are ignored.
+  /// \sa set_color_lut
+  /// \sa show
+  void set_pixels(std::span<const Rgb8> colors, size_t first = 0, uint8_t brightness = 0b11111) {
+    write_pixels("set_pixels", first, colors.size(), brightness,
+                 [&colors](size_t i) { return colors[i]; });
+  }
+
+  /// \brief Fill a range of LEDs with a gradient between two colors
+  /// \details The channels are interpolated linearly in RGB space, using
+  /// fixed-point math.
+  /// \param first Index of the first LED of the gradient
+  /// \param count Number of LEDs in the gradient
+  /// \param from Color of the first LED
+  /// \param to Color of the last LED
+  /// \param brightness Brightness of the LEDs [0-31], only sent to strips
+  /// which use a brightness value (e.g. APA102).
+  /// \note LEDs past the end of the strip are ignored.
+  /// \sa set_color_lut
+  /// \sa show
+  void fill_gradient(size_t first, size_t count, const Rgb8 &from, const Rgb8 &to,
+                     uint8_t brightness = 0b11111) {
+    Ramp r(from.r, to.r, count), g(from.g, to.g, count), b(from.b, to.b, count);
+    write_pixels("fill_gradient", first, count, brightness, [&](size_t i) {
+      return Rgb8(r.at(i), g.at(i), b.at(i));
+    });
+  }
+
+  /// \brief Fill a range of LEDs with a gradient between two colors
+  /// \details The channels are interpolated linearly in HSV space, using
+  /// fixed-point math. The hue does not wrap around, so e.g. from hue 0 to hue
+  /// Hsv8::HUE_MAX - 1 gives a full rainbow.
+  /// \param first Index of the first LED of the gradient
+  /// \param count Number of LEDs in the gradient
+  /// \param from Color of the first LED
+  /// \param to Color of the last LED
+  /// \param brightness Brightness of the LEDs [0-31], only sent to strips
+  /// which use a brightness value (e.g. APA102).
+  /// \note LEDs past the end of the strip are ignored.
+  /// \sa set_color_lut
+  /// \sa show
+  void fill_gradient(size_t first, size_t count, const Hsv8 &from, const Hsv8 &to,
+                     uint8_t brightness = 0b11111) {
+    Ramp h(from.h, to.h, count), s(from.s, to.s, count), v(from.v, to.v, count);
+    write_pixels("fill_gradient", first, count, brightness, [&](size_t i) {
+      return Hsv8(h.at(i), s.at(i), v.at(i)).rgb();
+    });
+  }
+
   /// \brief Show the colors on the strip
   /// \details This function writes the colors to the strip. It
   /// should be called after setting the colors of the LEDs.
-  /// \note This function blocks until the colors have been written
-  /// to the strip.
+  /// \note If not double buffered, this function blocks until the colors
+  /// have been written to the strip. If double buffered, it only waits for
+  /// the previous frame to have been written, and the colors of the next
+  /// frame can be set as soon as it returns.
+  /// \note If the strip has a write_range function, only the bytes which
+  /// changed since the last show() are written.
   /// \sa set_pixel
   /// \sa set_all
-  void show() {
-    logger_.debug("writing data {::02x}", data_);
-    write_(&data_[0], data_.size());
+  /// \sa wait_for_show
+  void show();
+
+  /// \brief Wait for the frame being written (if double buffered) to have
+  /// been written to the strip
+  /// \note Returns immediately if the strip is not double buffered.
+  void wait_for_show();
+
+  /// \brief Get the range of bytes which changed since the last show()
+  /// \return Offset (within the data of the whole strip, which starts with
+  /// the start frame) of the first byte which changed, and the number of bytes
+  /// from it to the last byte which changed. The number is 0 if nothing
+  /// changed.
+  std::pair<size_t, size_t> dirty_range() const {
+    if (dirty_begin_ >= dirty_end_) {
+      return {0, 0};
+    }
+    return {dirty_begin_, dirty_end_ - dirty_begin_};
   }
 
+  /// \brief Get the statistics of the frames shown on the strip
+  /// \return Statistics since the strip was created or the statistics were
+  /// reset
+  FrameStats frame_stats() const;
+
+  /// \brief Reset the statistics of the frames shown on the strip
+  void reset_frame_stats();
+
 protected:
+  /// Linear interpolation from one value to another over count steps, in
+  /// 16.16 fixed point
+  struct Ramp {
+    Ramp(int from, int to, size_t count)
+        : start((from << 16) + (1 << 15))
+        , step(count > 1 ? ((to - from) << 16) / static_cast<int>(count - 1) : 0) {}
+    int at(size_t i) const { return (start + step * static_cast<int>(i)) >> 16; }
+    int start;
+    int step;
+  };
+
+  static constexpr size_t NOT_DIRTY = std::numeric_limits<size_t>::max();
+
+  /// Add [begin, end) to the range of bytes which changed since the last show()
+  void mark_dirty(size_t begin, size_t end) {
+    dirty_begin_ = std::min(dirty_begin_, begin);
+    dirty_end_ = std::max(dirty_end_, end);
+  }
+
+  void start_write_task(const Task::BaseConfig &task_config);
+  bool write_task_fn(std::mutex &m, std::condition_variable &cv, bool &task_notified);
+
+  /// Write the bytes [begin, end) of buffer (or all of it, if there is no
+  /// write_range_ function), and update the stats
+  void write_frame(const uint8_t *buffer, size_t begin, size_t end,
+                   std::chrono::steady_clock::time_point shown);
+
+  /// Write color_of(i) to LED first + i, for i in [0, count) (clipped to the
+  /// strip)
+  template <typename ColorFn>
+  void write_pixels(const char *caller, size_t first, size_t count, uint8_t brightness,
+                    ColorFn &&color_of) {
+    if (first >= num_leds_) {
+      logger_.error("{}: index out of range: {}", caller, first);
+      return;
+    }
+    count = std::min(count, num_leds_ - first);
+    mark_dirty(start_offset_ + first * pixel_size_, start_offset_ + (first + count) * pixel_size_);
+    const uint8_t brightness_byte = 0b11100000 | std::min<uint8_t>(brightness, 0b11111);
+    uint8_t *pixel = &data_[start_offset_ + first * pixel_size_];
+    for (size_t i = 0; i < count; i++, pixel += pixel_size_) {
+      Rgb8 color = color_of(i);
+      uint8_t *bytes = pixel;
+      if (send_brightness_) {
+        *bytes++ = brightness_byte;
+      }
+      bytes[red_index_] = color_lut_[color.r];
+      bytes[green_index_] = color_lut_[color.g];
+      bytes[blue_index_] = color_lut_[color.b];
+    }
+  }
+
   size_t num_leds_;
   bool send_brightness_{true};
   ByteOrder byte_order_{ByteOrder::RGB};
   size_t pixel_size_{3};
   size_t start_offset_{0};
   size_t end_offset_{0};
+  uint8_t red_index_{0};
+  uint8_t green_index_{1};
+  uint8_t blue_index_{2};
+  ColorLut color_lut_{make_brightness_lut(255)};
   std::vector<uint8_t> data_;
   write_fn write_;
+  write_range_fn write_range_;
+  // bytes which changed since the last show(), empty if begin >= end
+  size_t dirty_begin_{NOT_DIRTY};
+  size_t dirty_end_{0};
+
+  // when double buffered, the frame being written by write_task_, while the
+  // next one is drawn in data_
+  std::vector<uint8_t> front_;
+  std::mutex frame_mutex_;
+  std::condition_variable frame_cv_;
+  bool frame_pending_{false};
+  bool stop_writing_{false};
+  size_t front_dirty_begin_{0};
+  size_t front_dirty_end_{0};
+  std::chrono::steady_clock::time_point front_shown_;
+  std::unique_ptr<Task> write_task_;
+
+  mutable std::mutex stats_mutex_;
+  FrameStats stats_;
+  std::chrono::steady_clock::time_point first_frame_time_;
+  float total_latency_{0};
 };
 } // namespace espp
@@ -1,3 +1,137 @@
 #include "led_strip.hpp"
 
+using namespace espp;
+
 const std::vector<uint8_t> espp::LedStrip::APA102_START_FRAME{0x00, 0x00, 0x00, 0x00};
+
+LedStrip::~LedStrip() {
+  if (!write_task_) {
+    return;
+  }
+  // stop the write task (once it has written the pending frame, if any),
+  // which waits on the frame rather than the task's condition variable
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    stop_writing_ = true;
+  }
+  frame_cv_.notify_all();
+  if (write_task_->is_started()) {
+    write_task_->stop();
+  }
+}
+
+void LedStrip::start_write_task(const Task::BaseConfig &task_config) {
+  // the front buffer starts as a copy of the back buffer (with the start /
+  // end frames), and the two are kept in sync by show()
+  front_ = data_;
+  using namespace std::placeholders;
+  write_task_ = std::make_unique<Task>(Task::Config{
+      .callback = std::bind(&LedStrip::write_task_fn, this, _1, _2, _3),
+      .task_config = task_config,
+      .log_level = Logger::Verbosity::WARN,
+  });
+  write_task_->start();
+}
+
+void LedStrip::show() {
+  auto now = std::chrono::steady_clock::now();
+  size_t begin = dirty_begin_;
+  size_t end = dirty_end_;
+  dirty_begin_ = NOT_DIRTY;
+  dirty_end_ = 0;
+  if (!write_task_) {
+    write_frame(data_.data(), begin, end, now);
+    return;
+  }
+  {
+    // the previous frame must have been written before its buffer is reused
+    std::unique_lock<std::mutex> lock(frame_mutex_);
+    frame_cv_.wait(lock, [this] { return !frame_pending_ || stop_writing_; });
+    std::swap(data_, front_);
+    front_dirty_begin_ = begin;
+    front_dirty_end_ = end;
+    front_shown_ = now;
+    frame_pending_ = true;
+  }
+  frame_cv_.notify_all();
+  // the back buffer now holds the previous frame, so bring it up to date with
+  // the bytes which changed in this frame, for the next frame to be drawn on
+  // (the write task only reads the front buffer meanwhile)
+  if (begin < end) {
+    std::copy(front_.begin() + begin, front_.begin() + end, data_.begin() + begin);
+  }
+}
+
+void LedStrip::wait_for_show() {
+  if (!write_task_) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(frame_mutex_);
+  frame_cv_.wait(lock, [this] { return !frame_pending_ || stop_writing_; });
+}
+
+bool LedStrip::write_task_fn(std::mutex &m, std::condition_variable &cv, bool &task_notified) {
+  size_t begin, end;
+  std::chrono::steady_clock::time_point shown;
+  {
+    std::unique_lock<std::mutex> lock(frame_mutex_);
+    frame_cv_.wait(lock, [this] { return stop_writing_ || frame_pending_; });
+    if (!frame_pending_) {
+      // stopping, and there is no frame left to write
+      return true;
+    }
+    begin = front_dirty_begin_;
+    end = front_dirty_end_;
+    shown = front_shown_;
+  }
+  write_frame(front_.data(), begin, end, shown);
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    frame_pending_ = false;
+  }
+  frame_cv_.notify_all();
+  // we do not want to stop the task
+  return false;
+}
+
+void LedStrip::write_frame(const uint8_t *buffer, size_t begin, size_t end,
+                           std::chrono::steady_clock::time_point shown) {
+  size_t length = 0;
+  if (write_range_) {
+    if (begin < end) {
+      length = end - begin;
+      logger_.debug("writing {} bytes at {}", length, begin);
+      write_range_(buffer + begin, length, begin);
+    }
+  } else {
+    length = data_.size();
+    logger_.debug("writing data {::02x}", std::span<const uint8_t>(buffer, length));
+    write_(buffer, length);
+  }
+  auto now = std::chrono::steady_clock::now();
+  float latency = std::chrono::duration<float>(now - shown).count();
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  if (stats_.frames_shown == 0) {
+    first_frame_time_ = now;
+  }
+  stats_.frames_shown++;
+  stats_.bytes_written += length;
+  total_latency_ += latency;
+  stats_.average_latency = total_latency_ / stats_.frames_shown;
+  stats_.max_latency = std::max(stats_.max_latency, latency);
+  float elapsed = std::chrono::duration<float>(now - first_frame_time_).count();
+  if (elapsed > 0) {
+    stats_.frame_rate = (stats_.frames_shown - 1) / elapsed;
+  }
+}
+
+LedStrip::FrameStats LedStrip::frame_stats() const {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  return stats_;
+}
+
+void LedStrip::reset_frame_stats() {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  stats_ = {};
+  total_latency_ = 0;
+}
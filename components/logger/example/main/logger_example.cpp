@@ -1,7 +1,9 @@
 #include <chrono>
 #include <functional>
 #include <thread>
+#include <vector>
 
+#include "log_sink.hpp"
 #include "logger.hpp"
 
 using namespace std::chrono_literals;
@@ -78,6 +80,83 @@ extern "C" void app_main(void) {
     //! [Cursor Commands example]
   }
 
+  {
+    //! [Async Logger example]
+    // make all loggers asynchronous, so that logging from a fast loop only
+    // formats into a buffer and doesn't wait for the console
+    espp::Logger::start_async({
+        .num_records = 64,
+        .max_record_size = 128,
+        .drain_period = 20ms,
+    });
+    auto logger = espp::Logger({.tag = "Async Logger", .level = espp::Logger::Verbosity::DEBUG});
+    // simulate a 1 kHz control loop which logs every iteration
+    for (int i = 0; i < 1000; i++) {
+      auto start = std::chrono::high_resolution_clock::now();
+      logger.debug("control loop iteration {}", i);
+      auto end = std::chrono::high_resolution_clock::now();
+      if (i % 100 == 0) {
+        logger.info("log call took {} us",
+                    std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+      }
+      std::this_thread::sleep_for(1ms);
+    }
+    // print anything remaining and go back to synchronous logging
+    espp::Logger::stop_async();
+    logger.info("dropped {} log messages", espp::Logger::get_num_dropped());
+    //! [Async Logger example]
+  }
+
+  {
+    //! [Binary Logger example]
+    // switch all loggers to binary output. Here we just keep the encoded
+    // frames in memory, but they would normally be written to a file, the
+    // uart, or a socket and decoded on the host with
+    // components/logger/python/decode_binary_log.py
+    std::vector<uint8_t> binary_log;
+    binary_log.reserve(4096);
+    espp::Logger::start_binary({
+        .write =
+            [&binary_log](std::span<const uint8_t> data) {
+              binary_log.insert(binary_log.end(), data.begin(), data.end());
+            },
+    });
+    auto logger = espp::Logger({.tag = "Binary Logger", .level = espp::Logger::Verbosity::DEBUG});
+    static constexpr int num_logs = 100;
+    for (int i = 0; i < num_logs; i++) {
+      logger.info("iteration {}, value = {:.3f}, ok = {}", i, 0.5f * i, i % 2 == 0);
+    }
+    // go back to text output
+    espp::Logger::stop_binary();
+    logger.info("binary log used {} bytes for {} messages", binary_log.size(), num_logs);
+    //! [Binary Logger example]
+  }
+
+  {
+    //! [Log Sink example]
+    // send the logs to the console (warnings and errors only) and keep the
+    // most recent logs of any level in memory, e.g. to attach to a crash report
+    auto console_sink = std::make_shared<espp::ConsoleLogSink>(
+        espp::LogSink::Config{.level = espp::Logger::Verbosity::WARN, .color = true});
+    auto memory_sink = std::make_shared<espp::MemoryLogSink>(espp::MemoryLogSink::Config{
+        .capacity_bytes = 1024,
+        .sink_config = {.level = espp::Logger::Verbosity::DEBUG,
+                        .format = espp::LogSink::Format::JSON,
+                        .batch_size_bytes = 0},
+    });
+    espp::Logger::add_sink(console_sink);
+    espp::Logger::add_sink(memory_sink);
+    auto logger = espp::Logger({.tag = "Sink Logger", .level = espp::Logger::Verbosity::DEBUG});
+    for (int i = 0; i < 10; i++) {
+      logger.debug("iteration {}", i);
+    }
+    logger.warn("something unexpected happened");
+    // go back to printing to the console
+    espp::Logger::clear_sinks();
+    fmt::print("Recent logs:\n{}", memory_sink->get_contents());
+    //! [Log Sink example]
+  }
+
   {
     //! [MultiLogger example]
     // create loggers
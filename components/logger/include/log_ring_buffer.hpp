@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace espp {
+/**
+ * @brief Lock-free, bounded, multi-producer ring buffer of fixed-size log
+ *        records.
+ *
+ *        Producers claim a record, write into it, and then commit it.
+ *        Claiming and committing are each a single atomic operation, so a
+ *        producer never blocks (if the buffer is full, claim() fails and the
+ *        caller should drop the record). Records are consumed in the order
+ *        they were claimed by a single consumer.
+ *
+ *        This is used by the espp::Logger's asynchronous mode, where one
+ *        buffer is allocated for each core and is drained by a background
+ *        thread.
+ *
+ * @note Based on Dmitry Vyukov's bounded MPMC queue, restricted to a single
+ *       consumer.
+ */
+class LogRingBuffer {
+public:
+  /**
+   * @brief Header of a record in the buffer. The record's text (the tag
+   *        followed by the message) immediately follows the header.
+   */
+  struct Record {
+    std::atomic<size_t> sequence; ///< Used to synchronize producers and the consumer.
+    uint8_t level;                ///< Verbosity of the record.
+    bool binary;                  ///< True if the text is an encoded binary log frame.
+    uint16_t size;                ///< Number of bytes of text in the record.
+    uint8_t tag_size;             ///< Number of bytes at the start of the text which are the tag.
+    bool include_time;            ///< Whether the time should be printed with the record.
+    uint32_t thread_id;           ///< Id of the thread which logged the record.
+    uint64_t timestamp_us;        ///< When the record was logged.
+
+    /**
+     * @brief Pointer to the text of the record.
+     * @return Pointer to the text of the record.
+     */
+    char *text() { return reinterpret_cast<char *>(this + 1); }
+
+    /**
+     * @brief Pointer to the text of the record.
+     * @return Pointer to the text of the record.
+     */
+    const char *text() const { return reinterpret_cast<const char *>(this + 1); }
+  };
+
+  /**
+   * @brief Construct a new LogRingBuffer, allocating all of its memory.
+   * @param num_records Number of records in the buffer. Rounded up to a power
+   *        of two.
+   * @param max_text_size Maximum number of bytes of text in each record.
+   *        Longer text must be truncated by the producer.
+   */
+  LogRingBuffer(size_t num_records, size_t max_text_size)
+      : max_text_size_(max_text_size)
+      , stride_(align(sizeof(Record) + max_text_size)) {
+    size_t n = 1;
+    while (n < num_records) {
+      n <<= 1;
+    }
+    mask_ = n - 1;
+    storage_ = std::make_unique<uint8_t[]>(n * stride_);
+    for (size_t i = 0; i < n; i++) {
+      auto *record = new (storage_.get() + i * stride_) Record();
+      record->sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  LogRingBuffer(const LogRingBuffer &) = delete;
+  LogRingBuffer &operator=(const LogRingBuffer &) = delete;
+
+  /**
+   * @brief Maximum number of bytes of text in each record.
+   * @return The maximum text size in bytes.
+   */
+  size_t max_text_size() const { return max_text_size_; }
+
+  /**
+   * @brief Claim a record to write into.
+   * @return Pointer to the record, or nullptr if the buffer is full. The
+   *         record must be committed with commit() once it has been written.
+   */
+  Record *claim() {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Record *record = at(pos);
+      size_t seq = record->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          return record;
+        }
+      } else if (diff < 0) {
+        // the consumer has not released this record yet, so we are full
+        return nullptr;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Commit a record which was returned by claim(), making it
+   *        available to the consumer.
+   * @param record The record to commit.
+   */
+  void commit(Record *record) {
+    // the record's position is its current sequence number (see claim())
+    size_t pos = record->sequence.load(std::memory_order_relaxed);
+    record->sequence.store(pos + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief Get the oldest committed record, without removing it.
+   * @note Only one thread may consume from the buffer.
+   * @return Pointer to the record, or nullptr if there is no committed record.
+   */
+  const Record *peek() const {
+    const Record *record = at(dequeue_pos_);
+    size_t seq = record->sequence.load(std::memory_order_acquire);
+    if (seq != dequeue_pos_ + 1) {
+      return nullptr;
+    }
+    return record;
+  }
+
+  /**
+   * @brief Release the record returned by peek(), so that it can be reused
+   *        by the producers.
+   * @note Only one thread may consume from the buffer.
+   */
+  void pop() {
+    Record *record = at(dequeue_pos_);
+    record->sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    dequeue_pos_++;
+  }
+
+protected:
+  static size_t align(size_t size) {
+    constexpr size_t alignment = alignof(Record);
+    return (size + alignment - 1) / alignment * alignment;
+  }
+
+  Record *at(size_t pos) const {
+    return reinterpret_cast<Record *>(storage_.get() + (pos & mask_) * stride_);
+  }
+
+  size_t max_text_size_;
+  size_t stride_;
+  size_t mask_;
+  std::unique_ptr<uint8_t[]> storage_;
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) size_t dequeue_pos_{0};
+};
+} // namespace espp
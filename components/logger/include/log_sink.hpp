@@ -0,0 +1,274 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logger.hpp"
+
+namespace espp {
+/**
+ * @brief A single log message, with its structured fields.
+ */
+struct LogRecord {
+  std::string_view tag;          ///< Tag of the logger which logged the message.
+  espp::Logger::Verbosity level; ///< Verbosity of the message.
+  uint64_t timestamp_us;         ///< When the message was logged, in microseconds.
+  uint32_t thread_id;            ///< Id of the thread (task) which logged the message.
+  std::string_view message;      ///< The formatted message.
+
+  /**
+   * @brief The single character used for the level in text output.
+   * @return 'D', 'I', 'W', or 'E'.
+   */
+  char level_char() const {
+    switch (level) {
+    case espp::Logger::Verbosity::DEBUG:
+      return 'D';
+    case espp::Logger::Verbosity::INFO:
+      return 'I';
+    case espp::Logger::Verbosity::WARN:
+      return 'W';
+    default:
+      return 'E';
+    }
+  }
+};
+
+/**
+ * @brief Base class for log outputs (sinks) which can be added to all loggers
+ *        with Logger::add_sink().
+ *
+ *        Each sink has its own verbosity, so e.g. a file can record debug logs
+ *        while the console only shows warnings. Records are formatted (as text
+ *        or as JSON lines containing the structured fields) into a buffer,
+ *        which is written out in batches of up to Config::batch_size_bytes,
+ *        whenever a record at or above Config::flush_level is written, and
+ *        when flush() (or Logger::flush()) is called. When logging is
+ *        asynchronous, the sinks are written from the background thread and
+ *        are flushed at the end of each drain.
+ *
+ *        Derived classes implement write_batch() (and optionally
+ *        flush_output()), and must call flush() in their destructor.
+ *
+ * @note Sinks must not log themselves (or call code which logs) while writing
+ *       a batch; such logs are printed to the console instead.
+ *
+ * \section log_sink_ex1 Log Sink Example
+ * \snippet logger_example.cpp Log Sink example
+ */
+class LogSink {
+public:
+  /**
+   * @brief How records are formatted.
+   */
+  enum class Format {
+    TEXT, ///< "[tag/L][s.mmm]: message" lines.
+    JSON, ///< One JSON object per line with the tag, level, timestamp, thread id and message.
+  };
+
+  /**
+   * @brief Configuration common to all sinks.
+   */
+  struct Config {
+    espp::Logger::Verbosity level{
+        espp::Logger::Verbosity::DEBUG}; /**< Minimum level of records written to this sink. */
+    Format format{Format::TEXT};          /**< How records are formatted. */
+    bool color{false};                    /**< Whether TEXT records are colored by level. */
+    size_t batch_size_bytes{512}; /**< Buffered bytes which trigger a write. 0 writes each record
+                                     immediately. */
+    espp::Logger::Verbosity flush_level{
+        espp::Logger::Verbosity::ERROR}; /**< Records at or above this level are written
+                                            immediately, along with anything buffered. */
+  };
+
+  /**
+   * @brief Construct the sink.
+   * @param config The configuration for the sink.
+   */
+  explicit LogSink(const Config &config)
+      : level_(config.level)
+      , format_(config.format)
+      , color_(config.color)
+      , batch_size_bytes_(config.batch_size_bytes)
+      , flush_level_(config.flush_level) {}
+
+  virtual ~LogSink() = default;
+
+  LogSink(const LogSink &) = delete;
+  LogSink &operator=(const LogSink &) = delete;
+
+  /**
+   * @brief Get the minimum level of records written to this sink.
+   * @return The sink's verbosity.
+   */
+  espp::Logger::Verbosity get_verbosity() const { return level_; }
+
+  /**
+   * @brief Set the minimum level of records written to this sink.
+   * @param level The new verbosity.
+   */
+  void set_verbosity(espp::Logger::Verbosity level) { level_ = level; }
+
+  /**
+   * @brief Format a record into the sink's buffer, writing out the buffer if
+   *        needed. Records below the sink's verbosity are ignored.
+   * @param record The record to write.
+   */
+  void write(const LogRecord &record);
+
+  /**
+   * @brief Write out anything buffered.
+   */
+  void flush();
+
+  /**
+   * @brief Format a record as text, e.g. "[tag/I][1.234]: message\n".
+   * @param out The buffer to append to.
+   * @param record The record to format.
+   * @param color Whether to color the text by level.
+   * @param include_time Whether to include the time, if false the text is
+   *        e.g. "[tag/I]:message\n".
+   */
+  static void format_text(fmt::memory_buffer &out, const LogRecord &record, bool color,
+                          bool include_time = true);
+
+  /**
+   * @brief Format a record as a line of JSON, e.g.
+   *        {"ts_us":1234000,"level":"I","tag":"tag","thread":1,"msg":"message"}
+   * @param out The buffer to append to.
+   * @param record The record to format.
+   */
+  static void format_json(fmt::memory_buffer &out, const LogRecord &record);
+
+protected:
+  /**
+   * @brief Write a batch of formatted records to the output.
+   * @param data The formatted records, which always end with a newline.
+   */
+  virtual void write_batch(std::string_view data) = 0;
+
+  /**
+   * @brief Flush the underlying output, if it is buffered. Called after the
+   *        last batch has been written by flush().
+   */
+  virtual void flush_output() {}
+
+  void write_buffer();
+
+  std::atomic<espp::Logger::Verbosity> level_;
+  Format format_;
+  bool color_;
+  size_t batch_size_bytes_;
+  espp::Logger::Verbosity flush_level_;
+  std::mutex mutex_;
+  fmt::memory_buffer buffer_;
+};
+
+/**
+ * @brief Sink which writes to the console (stdout), colored by level by
+ *        default.
+ */
+class ConsoleLogSink : public LogSink {
+public:
+  /**
+   * @brief Construct the sink.
+   * @param config The configuration for the sink.
+   */
+  explicit ConsoleLogSink(const LogSink::Config &config = {.color = true, .batch_size_bytes = 0})
+      : LogSink(config) {}
+
+  ~ConsoleLogSink() override { flush(); }
+
+protected:
+  void write_batch(std::string_view data) override;
+  void flush_output() override;
+};
+
+/**
+ * @brief Sink which appends to a file. On ESP this is usually a file on the
+ *        espp::FileSystem, e.g. espp::FileSystem::get_root_path() / "log.txt".
+ */
+class FileLogSink : public LogSink {
+public:
+  /**
+   * @brief Configuration for the file sink.
+   */
+  struct Config {
+    std::string path;             /**< Path of the file to write to. */
+    bool append{true};            /**< Append to the file rather than truncating it. */
+    LogSink::Config sink_config{}; /**< Configuration common to all sinks. */
+  };
+
+  /**
+   * @brief Open the file.
+   * @param config The configuration for the sink.
+   */
+  explicit FileLogSink(const Config &config);
+
+  /**
+   * @brief Write anything buffered and close the file.
+   */
+  ~FileLogSink() override;
+
+  /**
+   * @brief Whether the file was opened.
+   * @return True if the file is open.
+   */
+  bool is_open() const { return file_ != nullptr; }
+
+protected:
+  void write_batch(std::string_view data) override;
+  void flush_output() override;
+
+  std::FILE *file_{nullptr};
+};
+
+/**
+ * @brief Sink which keeps the most recent log output in a fixed-size
+ *        in-memory ring buffer, e.g. to attach to a crash report or to serve
+ *        over a network interface. When full, the oldest lines are discarded.
+ */
+class MemoryLogSink : public LogSink {
+public:
+  /**
+   * @brief Configuration for the memory sink.
+   */
+  struct Config {
+    size_t capacity_bytes{4096}; /**< Number of bytes of log output kept. */
+    LogSink::Config sink_config{
+        .batch_size_bytes = 0}; /**< Configuration common to all sinks. */
+  };
+
+  /**
+   * @brief Allocate the ring buffer.
+   * @param config The configuration for the sink.
+   */
+  explicit MemoryLogSink(const Config &config);
+
+  ~MemoryLogSink() override { flush(); }
+
+  /**
+   * @brief Get the contents of the buffer, oldest first.
+   * @return The buffered log output.
+   */
+  std::string get_contents();
+
+  /**
+   * @brief Discard the contents of the buffer.
+   */
+  void clear();
+
+protected:
+  void write_batch(std::string_view data) override;
+
+  std::mutex ring_mutex_;
+  std::vector<char> ring_;
+  size_t head_{0};
+  size_t size_{0};
+};
+} // namespace espp
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <span>
 #include <string>
 #include <string_view>
 
@@ -12,6 +17,8 @@
 #endif
 
 #include "format.hpp"
+#include "log_ring_buffer.hpp"
+#include "logger_binary_format.hpp"
 
 // Undefine the logger verbosity levels to avoid conflicts with windows / msvc
 #ifdef _MSC_VER
@@ -23,6 +30,8 @@
 
 namespace espp {
 
+class LogSink;
+
 /**
  * @brief Logger provides a wrapper around nicer / more robust formatting than
  * standard ESP_LOG* macros with the ability to change the log level at
@@ -41,12 +50,36 @@ namespace espp {
  * various types of interactive output or to maintian context with long-running
  * logs.
  *
+ * Logging can optionally be made asynchronous for all loggers (see
+ * Logger::start_async()). In this mode, the log call formats the message
+ * directly into a pre-allocated, lock-free ring buffer (one per core) without
+ * allocating, and a background thread drains the buffers to the console. If
+ * the buffers are full, messages are dropped and counted (see
+ * Logger::get_num_dropped()) rather than blocking the caller.
+ *
+ * The output can also be switched to a compact binary encoding for all loggers
+ * (see Logger::start_binary()). In this mode the log call does not format the
+ * message at all, it only records the tag id, format string id, timestamp and
+ * the raw arguments (see espp::logger_binary_format), which a host-side tool
+ * (components/logger/python/decode_binary_log.py) turns back into text. This
+ * can be combined with asynchronous logging.
+ *
+ * By default logs are printed to the console. Instead, they can be sent to one
+ * or more sinks (see espp::LogSink and Logger::add_sink()), such as a file, a
+ * UDP socket, or an in-memory ring buffer, each with its own verbosity, output
+ * format (text or JSON lines with the tag, level, timestamp, and thread id as
+ * fields) and batching.
+ *
  * \section logger_ex1 Basic Example
  * \snippet logger_example.cpp Logger example
  * \section logger_ex2 Threaded Logging and Verbosity Example
  * \snippet logger_example.cpp MultiLogger example
  * \section logger_ex3 Cursor Commands Example
  * \snippet logger_example.cpp Cursor Commands example
+ * \section logger_ex4 Async Logging Example
+ * \snippet logger_example.cpp Async Logger example
+ * \section logger_ex5 Binary Logging Example
+ * \snippet logger_example.cpp Binary Logger example
  */
 class Logger {
 
@@ -99,6 +132,37 @@ rate limit. @note Only calls that have _rate_limited suffixed will be rate limit
         espp::Logger::Verbosity::WARN; /**< The verbosity level for the logger. */
   };
 
+  /**
+   * @brief Configuration for asynchronous logging, shared by all loggers.
+   */
+  struct AsyncConfig {
+    size_t num_records{64}; /**< Number of log records buffered for each core. Rounded up to a
+                               power of two. */
+    size_t max_record_size{160}; /**< Maximum length (bytes) of each log message, including the
+                                    tag and time. Longer messages are truncated. */
+    std::chrono::duration<float> drain_period{
+        0.01f}; /**< How often the background thread prints the buffered logs. */
+    size_t stack_size_bytes{4096}; /**< Stack size of the background thread (ESP only). */
+    size_t priority{1};            /**< Priority of the background thread (ESP only). */
+    int core_id{-1}; /**< Core the background thread runs on, -1 for any (ESP only). */
+  };
+
+  /**
+   * @brief Configuration for binary log output, shared by all loggers.
+   */
+  struct BinaryConfig {
+    std::function<void(std::span<const uint8_t>)> write{
+        nullptr}; /**< Called with the encoded binary log frames, e.g. to write them to a file
+                     or socket. Called from the logging thread, or from the background thread
+                     if logging is asynchronous. @note This function must not log. */
+    size_t max_tags{128};    /**< Maximum number of tag ids. When there are more tags (or format
+                                strings) than this, all ids are forgotten and defined again as
+                                they are used. */
+    size_t max_formats{512}; /**< Maximum number of format string ids, e.g. to bound the memory
+                                used when logging with format strings which are not string
+                                literals. */
+  };
+
   /**
    * @brief Construct a new Logger object
    *
@@ -157,6 +221,8 @@ rate limit. @note Only calls that have _rate_limited suffixed will be rate limit
   void set_tag(const std::string_view tag) {
     std::lock_guard<std::mutex> lock(tag_mutex_);
     tag_ = tag;
+    // the binary tag id is for the old tag
+    binary_ids_.reset();
   }
 
   /**
@@ -207,7 +273,11 @@ rate limit. @note Only calls that have _rate_limited suffixed will be rate limit
 #if ESPP_LOGGER_DEBUG_ENABLED
     if (level_ > espp::Logger::Verbosity::DEBUG)
       return;
+    if (write_deferred(espp::Logger::Verbosity::DEBUG, rt_fmt_str, std::forward<Args>(args)...))
+      return;
     auto msg = format(rt_fmt_str, std::forward<Args>(args)...);
+    if (write_to_sinks(espp::Logger::Verbosity::DEBUG, msg))
+      return;
     if (include_time_) {
       std::lock_guard<std::mutex> lock(tag_mutex_);
       fmt::print(fg(fmt::color::gray), "[{}/D][{}]: {}\n", tag_, get_time(), msg);
@@ -227,7 +297,11 @@ rate limit. @note Only calls that have _rate_limited suffixed will be rate limit
 #if ESPP_LOGGER_INFO_ENABLED
     if (level_ > espp::Logger::Verbosity::INFO)
       return;
+    if (write_deferred(espp::Logger::Verbosity::INFO, rt_fmt_str, std::forward<Args>(args)...))
+      return;
     auto msg = format(rt_fmt_str, std::forward<Args>(args)...);
+    if (write_to_sinks(espp::Logger::Verbosity::INFO, msg))
+      return;
     if (include_time_) {
       std::lock_guard<std::mutex> lock(tag_mutex_);
       fmt::print(fg(fmt::terminal_color::green), "[{}/I][{}]: {}\n", tag_, get_time(), msg);
@@ -247,7 +321,11 @@ rate limit. @note Only calls that have _rate_limited suffixed will be rate limit
 #if ESPP_LOGGER_WARN_ENABLED
     if (level_ > espp::Logger::Verbosity::WARN)
       return;
+    if (write_deferred(espp::Logger::Verbosity::WARN, rt_fmt_str, std::forward<Args>(args)...))
+      return;
     auto msg = format(rt_fmt_str, std::forward<Args>(args)...);
+    if (write_to_sinks(espp::Logger::Verbosity::WARN, msg))
+      return;
     if (include_time_) {
       std::lock_guard<std::mutex> lock(tag_mutex_);
       fmt::print(fg(fmt::terminal_color::yellow), "[{}/W][{}]: {}\n", tag_, get_time(), msg);
@@ -267,7 +345,11 @@ rate limit. @note Only calls that have _rate_limited suffixed will be rate limit
 #if ESPP_LOGGER_ERROR_ENABLED
     if (level_ > espp::Logger::Verbosity::ERROR)
       return;
+    if (write_deferred(espp::Logger::Verbosity::ERROR, rt_fmt_str, std::forward<Args>(args)...))
+      return;
     auto msg = format(rt_fmt_str, std::forward<Args>(args)...);
+    if (write_to_sinks(espp::Logger::Verbosity::ERROR, msg))
+      return;
     if (include_time_) {
       std::lock_guard<std::mutex> lock(tag_mutex_);
       fmt::print(fg(fmt::terminal_color::red), "[{}/E][{}]: {}\n", tag_, get_time(), msg);
@@ -432,14 +514,305 @@ rate limit. @note Only calls that have _rate_limited suffixed will be rate limit
 #endif
   }
 
+  /**
+   * @brief Start asynchronous logging for all loggers.
+   * @details Once started, log calls format their message into a lock-free
+   *          ring buffer for the current core instead of printing it, and a
+   *          background thread prints the buffered messages in time order.
+   * @note The buffers are allocated the first time async logging is started
+   *       and are reused (with the same size) if it is restarted.
+   * @param config The configuration for asynchronous logging.
+   * @return True if async logging was started, false if it was already
+   *         running.
+   */
+  static bool start_async(const AsyncConfig &config);
+
+  /**
+   * @brief Stop asynchronous logging, printing any buffered messages.
+   * @details Logs after this returns are printed synchronously.
+   */
+  static void stop_async();
+
+  /**
+   * @brief Whether asynchronous logging is running.
+   * @return True if asynchronous logging is running.
+   */
+  static bool is_async();
+
+  /**
+   * @brief Print any buffered asynchronous log messages now, and write out
+   *        anything buffered by the sinks.
+   */
+  static void flush();
+
+  /**
+   * @brief Number of log messages which have been dropped because the
+   *        asynchronous log buffer was full (or, in binary mode, because
+   *        max_record_size is too small for their frame).
+   * @return The number of dropped messages since async logging was first
+   *         started.
+   */
+  static uint32_t get_num_dropped();
+
+  /**
+   * @brief Switch all loggers to binary output.
+   * @details Once started, log calls encode their tag, format string,
+   *          timestamp, and arguments (see espp::logger_binary_format) and pass
+   *          them to BinaryConfig::write instead of printing formatted text.
+   *          The stream starts with a header frame, and the tag and format
+   *          string definitions are sent again after each start.
+   * @param config The configuration for binary output.
+   * @return True if binary output was started, false if it was already
+   *         running or no write function was provided.
+   */
+  static bool start_binary(const BinaryConfig &config);
+
+  /**
+   * @brief Switch all loggers back to text output.
+   * @details Any buffered asynchronous binary records are written first.
+   */
+  static void stop_binary();
+
+  /**
+   * @brief Whether binary output is running.
+   * @return True if binary output is running.
+   */
+  static bool is_binary();
+
+  /**
+   * @brief Add a sink which all loggers write to.
+   * @details Once a sink has been added, logs are no longer printed to the
+   *          console directly, so add an espp::ConsoleLogSink to keep console
+   *          output. Binary output (see start_binary()) bypasses the sinks.
+   * @param sink The sink to add.
+   */
+  static void add_sink(std::shared_ptr<LogSink> sink);
+
+  /**
+   * @brief Remove a sink, writing out anything it has buffered.
+   * @param sink The sink to remove.
+   * @return True if the sink was removed, false if it had not been added.
+   */
+  static bool remove_sink(const std::shared_ptr<LogSink> &sink);
+
+  /**
+   * @brief Remove all sinks, writing out anything they have buffered, and go
+   *        back to printing to the console.
+   */
+  static void clear_sinks();
+
 protected:
+  /**
+   *   Write a formatted message to the sinks, if there are any.
+   *   @return True if the message was written to the sinks, false if it
+   *           should be printed.
+   */
+  bool write_to_sinks(espp::Logger::Verbosity level, std::string_view message);
+
+  /**
+   *   Get an id for the calling thread (task).
+   */
+  static uint32_t get_thread_id();
+
+  /**
+   *   Get the buffer to write asynchronous log records into.
+   *   @return The buffer for the current core, or nullptr if logging is not
+   *           asynchronous.
+   */
+  static LogRingBuffer *get_async_buffer();
+
+  /**
+   *   Count a log message which was dropped because the buffer was full, or
+   *   because its binary frame did not fit in a record.
+   */
+  static void add_dropped();
+
+  /**
+   *   Get the binary ids for this logger's tag and a format string, sending
+   *   their definitions if this is the first time they are used. The ids
+   *   are cached by the logger (by the address, size and hash of the format
+   *   string), so that this only takes the global binary lock when they are
+   *   not.
+   *   @note tag_mutex_ must be held by the caller.
+   *   @param generation Set to the generation of the ids, which changes
+   *          whenever the ids are forgotten and reused.
+   *   @return False if the definitions could not be sent.
+   */
+  bool get_binary_ids(std::string_view format, uint16_t &tag_id, uint16_t &format_id,
+                      uint32_t &generation);
+
+  /**
+   *   Pass encoded binary frames to the binary output, unless their ids are
+   *   from an older generation (in which case they are dropped).
+   *   @return False if the frames were dropped.
+   */
+  static bool write_binary_frames(std::span<const uint8_t> frames, uint32_t generation);
+
+  /**
+   *   Write the log to the binary output or the asynchronous log buffer, if
+   *   either is enabled.
+   *   @return True if the log was handled (or dropped), false if it should be
+   *           printed.
+   */
+  template <typename... Args>
+  bool write_deferred(espp::Logger::Verbosity level, std::string_view rt_fmt_str, Args &&...args) {
+    auto *buffer = get_async_buffer();
+    if (is_binary()) {
+      write_binary(buffer, level, rt_fmt_str, std::forward<Args>(args)...);
+      return true;
+    }
+    if (buffer) {
+      write_async(*buffer, level, rt_fmt_str, std::forward<Args>(args)...);
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   *   Encode a log message as a binary LOG frame.
+   */
+  template <typename... Args>
+  void write_binary(LogRingBuffer *buffer, espp::Logger::Verbosity level,
+                    std::string_view rt_fmt_str, Args &&...args) {
+    using namespace logger_binary_format;
+    uint16_t tag_id, format_id;
+    uint32_t generation;
+    {
+      std::lock_guard<std::mutex> lock(tag_mutex_);
+      if (!get_binary_ids(rt_fmt_str, tag_id, format_id, generation)) {
+        add_dropped();
+        return;
+      }
+    }
+    uint64_t time_us = get_time_us();
+    auto encode = [&](Writer &writer, bool include_args) {
+      writer.begin_frame(FrameType::LOG);
+      writer.put(static_cast<uint8_t>(level));
+      writer.put(time_us);
+      writer.put(tag_id);
+      writer.put(format_id);
+      if (include_args) {
+        (writer.put_arg(args), ...);
+      }
+      writer.end_frame();
+    };
+    auto encode_into = [&](uint8_t *data, size_t capacity) -> size_t {
+      Writer writer(data, capacity);
+      encode(writer, true);
+      if (!writer.ok()) {
+        // the arguments don't fit, so just send the format string
+        writer = Writer(data, capacity);
+        encode(writer, false);
+      }
+      return writer.ok() ? writer.size() : 0;
+    };
+    if (buffer) {
+      auto *record = buffer->claim();
+      if (!record) {
+        add_dropped();
+        return;
+      }
+      size_t size =
+          encode_into(reinterpret_cast<uint8_t *>(record->text()), buffer->max_text_size());
+      record->level = static_cast<uint8_t>(level);
+      record->binary = true;
+      record->size = static_cast<uint16_t>(size);
+      record->timestamp_us = time_us;
+      // a claimed record cannot be given back, so a record which is too small
+      // for even the frame without its arguments is committed empty, which
+      // writes nothing when it is drained
+      buffer->commit(record);
+      if (size == 0) {
+        add_dropped();
+      }
+    } else {
+      uint8_t data[256];
+      size_t size = encode_into(data, sizeof(data));
+      if (size == 0 || !write_binary_frames({data, size}, generation)) {
+        add_dropped();
+      }
+    }
+  }
+
+  /**
+   *   Get the current time in microseconds since the start of the logging
+   *   system.
+   *   @return time in microseconds since the start of the logging system.
+   */
+  static uint64_t get_time_us() {
+#if defined(ESP_PLATFORM)
+    return esp_timer_get_time();
+#else
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now - start_time_).count();
+#endif
+  }
+
+  /**
+   *   Format a log message into a record in the asynchronous log buffer.
+   */
+  template <typename... Args>
+  void write_async(LogRingBuffer &buffer, espp::Logger::Verbosity level,
+                   std::string_view rt_fmt_str, Args &&...args) {
+    auto *record = buffer.claim();
+    if (!record) {
+      add_dropped();
+      return;
+    }
+    uint64_t time_us = get_time_us();
+    char *text = record->text();
+    size_t capacity = buffer.max_text_size();
+    // store the tag and the message, the prefix is formatted when the record
+    // is printed
+    size_t size;
+    {
+      std::lock_guard<std::mutex> lock(tag_mutex_);
+      size = std::min({tag_.size(), capacity, size_t{UINT8_MAX}});
+      std::copy_n(tag_.data(), size, text);
+    }
+    record->tag_size = static_cast<uint8_t>(size);
+    size += fmt::format_to_n(text + size, capacity - size, fmt::runtime(rt_fmt_str), args...).size;
+    if (size > capacity) {
+      // mark the message as truncated
+      size = capacity;
+      std::fill(text + std::max<size_t>(size, 3) - 3, text + size, '.');
+    }
+    record->level = static_cast<uint8_t>(level);
+    record->binary = false;
+    record->size = static_cast<uint16_t>(size);
+    record->include_time = include_time_;
+    record->thread_id = get_thread_id();
+    record->timestamp_us = time_us;
+    buffer.commit(record);
+  }
+
   /**
    *   Start time for the logging system.
    */
   static std::chrono::steady_clock::time_point start_time_;
 
+  /**
+   *   The binary ids of this logger's tag and of the format strings it used
+   *   most recently.
+   */
+  struct BinaryIds {
+    static constexpr size_t NUM_FORMATS = 8;
+    struct Format {
+      const char *data{nullptr};
+      size_t size{0};
+      size_t hash{0};
+      uint16_t id{0};
+    };
+    uint32_t generation{0};
+    bool has_tag_id{false};
+    uint16_t tag_id{0};
+    std::array<Format, NUM_FORMATS> formats{};
+  };
+
   std::mutex tag_mutex_; ///< Mutex for the tag.
   std::string tag_;      ///< Name of the logger to be prepended to all logs.
+  std::unique_ptr<BinaryIds>
+      binary_ids_; ///< Cached binary ids, guarded by tag_mutex_. Only allocated in binary mode.
   std::chrono::duration<float> rate_limit_{
       0.0f}; ///< Rate limit for the logger. If set to 0, no rate limiting will be performed.
   std::chrono::high_resolution_clock::time_point
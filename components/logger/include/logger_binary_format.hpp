@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "format.hpp"
+
+namespace espp {
+/**
+ * @brief Encoding used by the espp::Logger binary output mode.
+ *
+ * The binary log is a stream of frames. Each frame starts with a 3 byte header
+ * (uint8_t type, uint16_t payload size), followed by the payload. All values
+ * are little endian.
+ *
+ * | Frame type  | Payload                                                       |
+ * |-------------|---------------------------------------------------------------|
+ * | HEADER      | "ESPP" magic, uint8_t version                                 |
+ * | TAG_DEF     | uint16_t tag id, tag text                                     |
+ * | FORMAT_DEF  | uint16_t format id, format string text                        |
+ * | LOG         | uint8_t level, uint64_t timestamp (us), uint16_t tag id,       |
+ * |             | uint16_t format id, arguments                                 |
+ *
+ * Each argument is a uint8_t ArgType followed by its value. Arguments whose
+ * types are not one of the basic types are formatted (with "{}") on the device
+ * and sent as strings.
+ *
+ * Tag and format definitions are sent once, the first time they are used (and
+ * again whenever binary output is restarted, or the ids run out and are
+ * reused, in which case a definition replaces the previous one with the same
+ * id), so the decoder must see the stream from its start. A decoder is provided in
+ * components/logger/python/decode_binary_log.py.
+ */
+namespace logger_binary_format {
+/// Version of the binary format.
+static constexpr uint8_t VERSION = 1;
+
+/// Size of the frame header.
+static constexpr size_t FRAME_HEADER_SIZE = 3;
+
+/// Type of a frame.
+enum class FrameType : uint8_t {
+  HEADER = 0,     ///< Start of the stream.
+  TAG_DEF = 1,    ///< Definition of a tag id.
+  FORMAT_DEF = 2, ///< Definition of a format string id.
+  LOG = 3,        ///< A log message.
+};
+
+/// Type of an argument in a LOG frame.
+enum class ArgType : uint8_t {
+  BOOL = 'b',    ///< 1 byte, 0 or 1.
+  CHAR = 'c',    ///< 1 byte.
+  INT = 'i',     ///< int64_t.
+  UINT = 'u',    ///< uint64_t.
+  FLOAT = 'f',   ///< 32 bit float.
+  DOUBLE = 'd',  ///< 64 bit double.
+  STRING = 's',  ///< uint16_t length, followed by the bytes.
+  POINTER = 'p', ///< uint64_t address.
+};
+
+/// Writes frames into a fixed-size buffer. If the buffer is too small, the
+/// writer stops writing and ok() returns false.
+class Writer {
+public:
+  /// Construct a writer over \p data.
+  /// \param data The buffer to write into.
+  /// \param capacity The size of the buffer.
+  Writer(uint8_t *data, size_t capacity)
+      : data_(data)
+      , capacity_(capacity) {}
+
+  /// Start a frame, the payload is everything written until end_frame().
+  /// \param type The type of the frame.
+  void begin_frame(FrameType type) {
+    frame_start_ = size_;
+    put(static_cast<uint8_t>(type));
+    put(static_cast<uint16_t>(0));
+  }
+
+  /// Finish the frame started with begin_frame(), filling in its size.
+  void end_frame() {
+    if (!ok_) {
+      return;
+    }
+    uint16_t payload_size = size_ - frame_start_ - FRAME_HEADER_SIZE;
+    std::memcpy(data_ + frame_start_ + 1, &payload_size, sizeof(payload_size));
+  }
+
+  /// Write a value.
+  /// \param value The (trivially copyable) value to write.
+  template <typename T> void put(const T &value) { put_bytes(&value, sizeof(T)); }
+
+  /// Write raw bytes.
+  /// \param bytes The bytes to write.
+  /// \param size The number of bytes to write.
+  void put_bytes(const void *bytes, size_t size) {
+    if (!ok_ || size_ + size > capacity_) {
+      ok_ = false;
+      return;
+    }
+    std::memcpy(data_ + size_, bytes, size);
+    size_ += size;
+  }
+
+  /// Write a string, prefixed with its uint16_t length.
+  /// \param str The string to write.
+  void put_string(std::string_view str) {
+    put(static_cast<uint16_t>(str.size()));
+    put_bytes(str.data(), str.size());
+  }
+
+  /// Write a log argument, with its type.
+  /// \param arg The argument to write.
+  template <typename T> void put_arg(const T &arg) {
+    using D = std::remove_cvref_t<T>;
+    if constexpr (std::is_same_v<D, bool>) {
+      put(ArgType::BOOL);
+      put(static_cast<uint8_t>(arg));
+    } else if constexpr (std::is_same_v<D, char>) {
+      put(ArgType::CHAR);
+      put(arg);
+    } else if constexpr (std::is_integral_v<D> && std::is_signed_v<D>) {
+      put(ArgType::INT);
+      put(static_cast<int64_t>(arg));
+    } else if constexpr (std::is_integral_v<D>) {
+      put(ArgType::UINT);
+      put(static_cast<uint64_t>(arg));
+    } else if constexpr (std::is_same_v<D, float>) {
+      put(ArgType::FLOAT);
+      put(arg);
+    } else if constexpr (std::is_floating_point_v<D>) {
+      put(ArgType::DOUBLE);
+      put(static_cast<double>(arg));
+    } else if constexpr (std::is_convertible_v<const D &, std::string_view>) {
+      put(ArgType::STRING);
+      put_string(std::string_view(arg));
+    } else if constexpr (std::is_pointer_v<D>) {
+      put(ArgType::POINTER);
+      put(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(arg)));
+    } else {
+      // not a basic type, so we have to format it here
+      put(ArgType::STRING);
+      put_string(fmt::format("{}", arg));
+    }
+  }
+
+  /// Whether everything written so far fit in the buffer.
+  /// \return True if nothing has been truncated.
+  bool ok() const { return ok_; }
+
+  /// Number of bytes written.
+  /// \return The number of bytes written.
+  size_t size() const { return size_; }
+
+protected:
+  uint8_t *data_;
+  size_t capacity_;
+  size_t size_{0};
+  size_t frame_start_{0};
+  bool ok_{true};
+};
+} // namespace logger_binary_format
+} // namespace espp
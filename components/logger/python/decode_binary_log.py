@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+'''
+Decode the binary log output of espp::Logger (see Logger::start_binary() and
+logger_binary_format.hpp) back into text.
+
+The binary log is a stream of frames, each with a 3 byte header (uint8_t type,
+uint16_t payload size) followed by the payload. Tag and format string
+definitions are sent the first time they are used, so the stream must be
+decoded from its start (i.e. from the HEADER frame).
+
+The format strings are {fmt} format strings, which for the common cases
+({}, {:.3f}, {:>8}, {:#x}, ...) have the same syntax as python's str.format.
+If a format string cannot be formatted in python, the format string and the
+raw arguments are printed instead.
+
+Usage:
+
+```bash
+# decode a file
+python3 decode_binary_log.py log.bin
+# decode from stdin, e.g. from a serial port or a udp socket
+cat /dev/ttyUSB0 | python3 decode_binary_log.py --follow
+```
+'''
+
+import argparse
+import struct
+import sys
+
+FRAME_HEADER = 0
+FRAME_TAG_DEF = 1
+FRAME_FORMAT_DEF = 2
+FRAME_LOG = 3
+
+FRAME_HEADER_SIZE = 3
+MAGIC = b'ESPP'
+VERSION = 1
+
+# espp::Logger::Verbosity
+LEVELS = {0: 'D', 1: 'I', 2: 'W', 3: 'E'}
+COLORS = {
+    'D': '\x1b[38;2;128;128;128m',  # gray
+    'I': '\x1b[32m',  # green
+    'W': '\x1b[33m',  # yellow
+    'E': '\x1b[31m',  # red
+}
+RESET = '\x1b[0m'
+
+
+class FloatArg(float):
+    '''A 32 bit float, which prints with the shortest representation that
+    round trips as a 32 bit float (like {fmt} does), rather than as the double
+    it is stored in.'''
+
+    def __str__(self):
+        for precision in range(1, 10):
+            text = '{:.{}g}'.format(float(self), precision)
+            if struct.unpack('<f', struct.pack('<f', float(text)))[0] == float(self):
+                return text
+        return repr(float(self))
+
+    def __format__(self, spec):
+        if spec == '':
+            return str(self)
+        return float.__format__(self, spec)
+
+
+class BoolArg(int):
+    '''A bool, which prints as "true" / "false" like {fmt} does.'''
+
+    def __str__(self):
+        return 'true' if self else 'false'
+
+    def __format__(self, spec):
+        if spec == '' or spec == 's':
+            return format(str(self), spec)
+        return int.__format__(int(self), spec)
+
+
+class Decoder:
+    def __init__(self, color=False):
+        self.color = color
+        self.tags = {}
+        self.formats = {}
+
+    def parse_args(self, payload, offset):
+        args = []
+        while offset < len(payload):
+            arg_type = chr(payload[offset])
+            offset += 1
+            if arg_type == 'b':
+                args.append(BoolArg(payload[offset]))
+                offset += 1
+            elif arg_type == 'c':
+                args.append(chr(payload[offset]))
+                offset += 1
+            elif arg_type == 'i':
+                args.append(struct.unpack_from('<q', payload, offset)[0])
+                offset += 8
+            elif arg_type == 'u' or arg_type == 'p':
+                value = struct.unpack_from('<Q', payload, offset)[0]
+                args.append(value if arg_type == 'u' else '0x{:x}'.format(value))
+                offset += 8
+            elif arg_type == 'f':
+                args.append(FloatArg(struct.unpack_from('<f', payload, offset)[0]))
+                offset += 4
+            elif arg_type == 'd':
+                args.append(struct.unpack_from('<d', payload, offset)[0])
+                offset += 8
+            elif arg_type == 's':
+                (length,) = struct.unpack_from('<H', payload, offset)
+                offset += 2
+                args.append(payload[offset:offset + length].decode('utf-8', 'replace'))
+                offset += length
+            else:
+                raise ValueError('unknown argument type {!r}'.format(arg_type))
+        return args
+
+    def format_log(self, payload):
+        level, timestamp_us, tag_id, format_id = struct.unpack_from('<BQHH', payload, 0)
+        args = self.parse_args(payload, 13)
+        tag = self.tags.get(tag_id, '<tag {}>'.format(tag_id))
+        fmt = self.formats.get(format_id)
+        if fmt is None:
+            message = '<format {}> {}'.format(format_id, args)
+        else:
+            try:
+                message = fmt.format(*args)
+            except (ValueError, IndexError, KeyError, TypeError):
+                message = '{} {}'.format(fmt, args)
+        level_char = LEVELS.get(level, '?')
+        seconds = timestamp_us / 1e6
+        text = '[{}/{}][{:.3f}]: {}'.format(tag, level_char, seconds, message)
+        if self.color:
+            text = COLORS.get(level_char, '') + text + RESET
+        return text
+
+    def handle_frame(self, frame_type, payload):
+        '''Handle a frame, returning the text to print (if any).'''
+        if frame_type == FRAME_HEADER:
+            if payload[:4] != MAGIC:
+                raise ValueError('bad magic {!r}'.format(payload[:4]))
+            if payload[4] != VERSION:
+                raise ValueError('unsupported version {}'.format(payload[4]))
+            # a new stream, so forget the previous definitions
+            self.tags = {}
+            self.formats = {}
+        elif frame_type == FRAME_TAG_DEF:
+            (tag_id,) = struct.unpack_from('<H', payload, 0)
+            self.tags[tag_id] = payload[2:].decode('utf-8', 'replace')
+        elif frame_type == FRAME_FORMAT_DEF:
+            (format_id,) = struct.unpack_from('<H', payload, 0)
+            self.formats[format_id] = payload[2:].decode('utf-8', 'replace')
+        elif frame_type == FRAME_LOG:
+            return self.format_log(payload)
+        else:
+            raise ValueError('unknown frame type {}'.format(frame_type))
+        return None
+
+    def decode(self, data):
+        '''Decode all the complete frames in data, returning the lines of text
+        and the number of bytes used.'''
+        lines = []
+        offset = 0
+        while offset + FRAME_HEADER_SIZE <= len(data):
+            frame_type, size = struct.unpack_from('<BH', data, offset)
+            if offset + FRAME_HEADER_SIZE + size > len(data):
+                break
+            payload = data[offset + FRAME_HEADER_SIZE:offset + FRAME_HEADER_SIZE + size]
+            offset += FRAME_HEADER_SIZE + size
+            text = self.handle_frame(frame_type, payload)
+            if text is not None:
+                lines.append(text)
+        return lines, offset
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode espp::Logger binary logs')
+    parser.add_argument('file', nargs='?', help='binary log file (default: stdin)')
+    parser.add_argument('--color', action='store_true', help='color the output by level')
+    parser.add_argument('--follow', action='store_true',
+                        help='decode the input as it arrives, rather than all at once')
+    args = parser.parse_args()
+
+    decoder = Decoder(color=args.color)
+    stream = open(args.file, 'rb') if args.file else sys.stdin.buffer
+    data = b''
+    with stream:
+        while True:
+            chunk = stream.read1(4096) if args.follow else stream.read()
+            if not chunk:
+                break
+            data += chunk
+            lines, used = decoder.decode(data)
+            data = data[used:]
+            for line in lines:
+                print(line, flush=args.follow)
+    if data:
+        print('{} trailing bytes (incomplete frame)'.format(len(data)), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,182 @@
+#include "log_sink.hpp"
+
+#include <algorithm>
+
+using namespace espp;
+
+void LogSink::write(const LogRecord &record) {
+  if (record.level < level_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  switch (format_) {
+  case Format::JSON:
+    format_json(buffer_, record);
+    break;
+  default:
+    format_text(buffer_, record, color_);
+    break;
+  }
+  if (buffer_.size() >= batch_size_bytes_ || record.level >= flush_level_) {
+    write_buffer();
+  }
+}
+
+void LogSink::flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  write_buffer();
+  flush_output();
+}
+
+void LogSink::write_buffer() {
+  if (buffer_.size() == 0) {
+    return;
+  }
+  write_batch({buffer_.data(), buffer_.size()});
+  buffer_.clear();
+}
+
+void LogSink::format_text(fmt::memory_buffer &out, const LogRecord &record, bool color,
+                          bool include_time) {
+  auto it = std::back_inserter(out);
+  auto seconds = record.timestamp_us / 1000000;
+  auto milliseconds = (record.timestamp_us / 1000) % 1000;
+  fmt::text_style style;
+  switch (color ? record.level : Logger::Verbosity::NONE) {
+  case Logger::Verbosity::DEBUG:
+    style = fg(fmt::color::gray);
+    break;
+  case Logger::Verbosity::INFO:
+    style = fg(fmt::terminal_color::green);
+    break;
+  case Logger::Verbosity::WARN:
+    style = fg(fmt::terminal_color::yellow);
+    break;
+  case Logger::Verbosity::ERROR:
+    style = fg(fmt::terminal_color::red);
+    break;
+  default:
+    // no color
+    break;
+  }
+  if (include_time) {
+    fmt::format_to(it, style, "[{}/{}][{}.{:03}]: {}\n", record.tag, record.level_char(), seconds,
+                   milliseconds, record.message);
+  } else {
+    fmt::format_to(it, style, "[{}/{}]:{}\n", record.tag, record.level_char(), record.message);
+  }
+}
+
+static void append_json_string(fmt::memory_buffer &out, std::string_view str) {
+  out.push_back('"');
+  for (char c : str) {
+    switch (c) {
+    case '"':
+      out.append(std::string_view("\\\""));
+      break;
+    case '\\':
+      out.append(std::string_view("\\\\"));
+      break;
+    case '\n':
+      out.append(std::string_view("\\n"));
+      break;
+    case '\r':
+      out.append(std::string_view("\\r"));
+      break;
+    case '\t':
+      out.append(std::string_view("\\t"));
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        fmt::format_to(std::back_inserter(out), "\\u{:04x}", c);
+      } else {
+        out.push_back(c);
+      }
+      break;
+    }
+  }
+  out.push_back('"');
+}
+
+void LogSink::format_json(fmt::memory_buffer &out, const LogRecord &record) {
+  fmt::format_to(std::back_inserter(out), "{{\"ts_us\":{},\"level\":\"{}\",\"tag\":",
+                 record.timestamp_us, record.level_char());
+  append_json_string(out, record.tag);
+  fmt::format_to(std::back_inserter(out), ",\"thread\":{},\"msg\":", record.thread_id);
+  append_json_string(out, record.message);
+  out.append(std::string_view("}\n"));
+}
+
+void ConsoleLogSink::write_batch(std::string_view data) {
+  std::fwrite(data.data(), 1, data.size(), stdout);
+}
+
+void ConsoleLogSink::flush_output() { std::fflush(stdout); }
+
+FileLogSink::FileLogSink(const Config &config)
+    : LogSink(config.sink_config) {
+  file_ = std::fopen(config.path.c_str(), config.append ? "a" : "w");
+}
+
+FileLogSink::~FileLogSink() {
+  flush();
+  if (file_) {
+    std::fclose(file_);
+  }
+}
+
+void FileLogSink::write_batch(std::string_view data) {
+  if (file_) {
+    std::fwrite(data.data(), 1, data.size(), file_);
+  }
+}
+
+void FileLogSink::flush_output() {
+  if (file_) {
+    std::fflush(file_);
+  }
+}
+
+MemoryLogSink::MemoryLogSink(const Config &config)
+    : LogSink(config.sink_config)
+    , ring_(std::max<size_t>(1, config.capacity_bytes)) {}
+
+std::string MemoryLogSink::get_contents() {
+  std::lock_guard<std::mutex> lock(ring_mutex_);
+  std::string contents;
+  contents.reserve(size_);
+  size_t first = std::min(size_, ring_.size() - head_);
+  contents.append(ring_.data() + head_, first);
+  contents.append(ring_.data(), size_ - first);
+  return contents;
+}
+
+void MemoryLogSink::clear() {
+  std::lock_guard<std::mutex> lock(ring_mutex_);
+  head_ = 0;
+  size_ = 0;
+}
+
+void MemoryLogSink::write_batch(std::string_view data) {
+  std::lock_guard<std::mutex> lock(ring_mutex_);
+  size_t capacity = ring_.size();
+  if (data.size() > capacity) {
+    // only the end of the data fits
+    data = data.substr(data.size() - capacity);
+  }
+  // make room by discarding the oldest bytes
+  size_t overflow = size_ + data.size() > capacity ? size_ + data.size() - capacity : 0;
+  if (overflow) {
+    // discard up to the end of the line, so that we keep whole lines
+    while (overflow < size_ && ring_[(head_ + overflow - 1) % capacity] != '\n') {
+      overflow++;
+    }
+    head_ = (head_ + overflow) % capacity;
+    size_ -= overflow;
+  }
+  size_t tail = (head_ + size_) % capacity;
+  size_t first = std::min(data.size(), capacity - tail);
+  std::copy_n(data.data(), first, ring_.data() + tail);
+  std::copy_n(data.data() + first, data.size() - first, ring_.data());
+  size_ += data.size();
+}
@@ -1,5 +1,553 @@
 #include "logger.hpp"
+#include "log_sink.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(ESP_PLATFORM)
+#include <esp_pthread.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
 
 using namespace espp;
 
 std::chrono::steady_clock::time_point Logger::start_time_ = std::chrono::steady_clock::now();
+
+namespace {
+/// The sinks which all loggers write to.
+struct SinkState {
+  using SinkList = std::vector<std::shared_ptr<LogSink>>;
+
+  // get the current sinks, which can be used without holding the mutex
+  std::shared_ptr<const SinkList> get() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sinks;
+  }
+
+  void set(std::shared_ptr<const SinkList> new_sinks) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sinks = std::move(new_sinks);
+    has_sinks = sinks && !sinks->empty();
+  }
+
+  std::atomic<bool> has_sinks{false};
+  std::mutex mutex;
+  std::shared_ptr<const SinkList> sinks;
+};
+
+SinkState sink_state;
+// serializes changes to the sink list
+std::mutex sink_update_mutex;
+
+// set while the current thread is writing to the sinks, so that logs from
+// within a sink go to the console instead of recursing into the sinks
+thread_local bool writing_to_sinks = false;
+
+// write a record to all the sinks, returning false if it should be printed
+// instead
+bool dispatch_to_sinks(const LogRecord &record) {
+  if (!sink_state.has_sinks.load(std::memory_order_relaxed) || writing_to_sinks) {
+    return false;
+  }
+  auto sinks = sink_state.get();
+  if (!sinks || sinks->empty()) {
+    return false;
+  }
+  writing_to_sinks = true;
+  for (auto &sink : *sinks) {
+    sink->write(record);
+  }
+  writing_to_sinks = false;
+  return true;
+}
+
+void flush_sinks() {
+  if (writing_to_sinks) {
+    return;
+  }
+  auto sinks = sink_state.get();
+  if (!sinks) {
+    return;
+  }
+  writing_to_sinks = true;
+  for (auto &sink : *sinks) {
+    sink->flush();
+  }
+  writing_to_sinks = false;
+}
+
+/// Hash for looking up std::string keys with a std::string_view.
+struct StringHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+};
+
+/// State for binary logging, shared by all loggers.
+struct BinaryLogState {
+  std::atomic<bool> enabled{false};
+  // changed (under the mutex) whenever the ids below are forgotten, so that
+  // the ids cached by the loggers are looked up again. 0 is never used.
+  std::atomic<uint32_t> generation{1};
+  // guards everything below
+  std::mutex mutex;
+  std::function<void(std::span<const uint8_t>)> write;
+  std::unordered_map<std::string, uint16_t, StringHash, std::equal_to<>> tag_ids;
+  struct FormatEntry {
+    size_t hash; // of the format string, to notice a different string at the same address
+    uint16_t id;
+  };
+  // keyed by the address of the format string, which is almost always a
+  // string literal
+  std::unordered_map<const char *, FormatEntry> format_ids;
+  size_t max_tags{0};
+  size_t max_formats{0};
+  size_t next_tag_id{0};
+  size_t next_format_id{0};
+
+  /// Forget all the ids, so that they are defined again when they are next
+  /// used. Must be called with the mutex held.
+  void clear_ids() {
+    tag_ids.clear();
+    format_ids.clear();
+    next_tag_id = 0;
+    next_format_id = 0;
+    uint32_t next_generation = generation.load() + 1;
+    generation = next_generation == 0 ? 1 : next_generation;
+  }
+};
+
+BinaryLogState binary_state;
+
+/// State for asynchronous logging, shared by all loggers.
+struct AsyncLogState {
+  ~AsyncLogState() { stop(); }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(thread_mutex);
+      if (!running) {
+        return;
+      }
+      // stop new records from being written, the thread prints the remaining
+      // records before it exits
+      enabled = false;
+      running = false;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  void run(std::chrono::duration<float> drain_period) {
+    std::unique_lock<std::mutex> lock(thread_mutex);
+    while (running) {
+      lock.unlock();
+      drain();
+      lock.lock();
+      cv.wait_for(lock, drain_period, [this] { return !running; });
+    }
+    lock.unlock();
+    drain();
+  }
+
+  // print all committed records, merging the per-core buffers by timestamp
+  void drain() {
+    std::lock_guard<std::mutex> lock(drain_mutex);
+    output.clear();
+    binary_output.clear();
+    bool wrote_to_sinks = false;
+    while (true) {
+      LogRingBuffer *oldest_buffer = nullptr;
+      const LogRingBuffer::Record *oldest = nullptr;
+      for (auto &buffer : buffers) {
+        auto *record = buffer->peek();
+        if (record && (!oldest || record->timestamp_us < oldest->timestamp_us)) {
+          oldest = record;
+          oldest_buffer = buffer.get();
+        }
+      }
+      if (!oldest) {
+        break;
+      }
+      std::string_view text(oldest->text(), oldest->size);
+      if (oldest->binary) {
+        binary_output.insert(binary_output.end(), text.begin(), text.end());
+        oldest_buffer->pop();
+        continue;
+      }
+      LogRecord record{
+          .tag = text.substr(0, oldest->tag_size),
+          .level = static_cast<Logger::Verbosity>(oldest->level),
+          .timestamp_us = oldest->timestamp_us,
+          .thread_id = oldest->thread_id,
+          .message = text.substr(oldest->tag_size),
+      };
+      if (dispatch_to_sinks(record)) {
+        wrote_to_sinks = true;
+      } else {
+        LogSink::format_text(output, record, true, oldest->include_time);
+      }
+      last_timestamp_us = oldest->timestamp_us;
+      oldest_buffer->pop();
+    }
+    uint32_t dropped = num_dropped;
+    if (dropped != num_dropped_reported) {
+      auto message = fmt::format("dropped {} log messages (buffer full or record too small)",
+                                 dropped - num_dropped_reported);
+      LogRecord record{
+          .tag = "Logger",
+          .level = Logger::Verbosity::WARN,
+          .timestamp_us = last_timestamp_us,
+          .thread_id = 0,
+          .message = message,
+      };
+      if (dispatch_to_sinks(record)) {
+        wrote_to_sinks = true;
+      } else {
+        LogSink::format_text(output, record, true);
+      }
+      num_dropped_reported = dropped;
+    }
+    if (wrote_to_sinks) {
+      // write out everything the sinks have batched during this drain
+      flush_sinks();
+    }
+    if (output.size()) {
+      // write all the records at once
+      std::fwrite(output.data(), 1, output.size(), stdout);
+      std::fflush(stdout);
+    }
+    if (binary_output.size()) {
+      std::lock_guard<std::mutex> binary_lock(binary_state.mutex);
+      if (binary_state.write) {
+        binary_state.write(binary_output);
+      }
+    }
+  }
+
+  std::atomic<bool> enabled{false};
+  std::atomic<uint32_t> num_dropped{0};
+  uint32_t num_dropped_reported{0};
+  uint64_t last_timestamp_us{0};
+  // one buffer per core, allocated the first time async logging is started
+  std::vector<std::unique_ptr<LogRingBuffer>> buffers;
+  std::mutex drain_mutex;
+  fmt::memory_buffer output;
+  std::vector<uint8_t> binary_output;
+  std::mutex thread_mutex;
+  std::condition_variable cv;
+  bool running{false};
+  std::thread thread;
+};
+
+AsyncLogState async_state;
+} // namespace
+
+bool Logger::start_async(const AsyncConfig &config) {
+  std::lock_guard<std::mutex> lock(async_state.thread_mutex);
+  if (async_state.running) {
+    return false;
+  }
+  if (async_state.buffers.empty()) {
+#if defined(ESP_PLATFORM)
+    size_t num_buffers = portNUM_PROCESSORS;
+#else
+    size_t num_buffers = 1;
+#endif
+    for (size_t i = 0; i < num_buffers; i++) {
+      async_state.buffers.push_back(
+          std::make_unique<LogRingBuffer>(config.num_records, config.max_record_size));
+    }
+  }
+  if (async_state.thread.joinable()) {
+    async_state.thread.join();
+  }
+#if defined(ESP_PLATFORM)
+  // configure the pthread which will be created for the std::thread, and
+  // restore the previous configuration afterwards
+  esp_pthread_cfg_t previous_cfg;
+  bool has_previous_cfg = esp_pthread_get_cfg(&previous_cfg) == ESP_OK;
+  auto cfg = esp_pthread_get_default_config();
+  cfg.stack_size = config.stack_size_bytes;
+  cfg.prio = config.priority;
+  cfg.pin_to_core = config.core_id < 0 ? tskNO_AFFINITY : config.core_id;
+  cfg.thread_name = "espp_logger";
+  esp_pthread_set_cfg(&cfg);
+#endif
+  async_state.running = true;
+  async_state.enabled = true;
+  auto drain_period = config.drain_period;
+  async_state.thread = std::thread([drain_period] { async_state.run(drain_period); });
+#if defined(ESP_PLATFORM)
+  if (has_previous_cfg) {
+    esp_pthread_set_cfg(&previous_cfg);
+  } else {
+    auto default_cfg = esp_pthread_get_default_config();
+    esp_pthread_set_cfg(&default_cfg);
+  }
+#endif
+  return true;
+}
+
+void Logger::stop_async() { async_state.stop(); }
+
+bool Logger::is_async() { return async_state.enabled; }
+
+void Logger::flush() {
+  if (!async_state.buffers.empty()) {
+    async_state.drain();
+  }
+  flush_sinks();
+}
+
+uint32_t Logger::get_num_dropped() { return async_state.num_dropped; }
+
+LogRingBuffer *Logger::get_async_buffer() {
+  if (!async_state.enabled.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+#if defined(ESP_PLATFORM)
+  return async_state.buffers[xPortGetCoreID()].get();
+#else
+  return async_state.buffers[0].get();
+#endif
+}
+
+void Logger::add_dropped() { async_state.num_dropped.fetch_add(1, std::memory_order_relaxed); }
+
+void Logger::add_sink(std::shared_ptr<LogSink> sink) {
+  if (!sink) {
+    return;
+  }
+  // copy on write, so that loggers can use the current list without locking
+  std::lock_guard<std::mutex> lock(sink_update_mutex);
+  auto sinks = sink_state.get();
+  auto new_sinks = sinks ? std::make_shared<SinkState::SinkList>(*sinks)
+                         : std::make_shared<SinkState::SinkList>();
+  new_sinks->push_back(std::move(sink));
+  sink_state.set(std::move(new_sinks));
+}
+
+bool Logger::remove_sink(const std::shared_ptr<LogSink> &sink) {
+  {
+    std::lock_guard<std::mutex> lock(sink_update_mutex);
+    auto sinks = sink_state.get();
+    if (!sinks || std::find(sinks->begin(), sinks->end(), sink) == sinks->end()) {
+      return false;
+    }
+    auto new_sinks = std::make_shared<SinkState::SinkList>();
+    std::copy_if(sinks->begin(), sinks->end(), std::back_inserter(*new_sinks),
+                 [&sink](const auto &s) { return s != sink; });
+    sink_state.set(std::move(new_sinks));
+  }
+  sink->flush();
+  return true;
+}
+
+void Logger::clear_sinks() {
+  std::shared_ptr<const SinkState::SinkList> sinks;
+  {
+    std::lock_guard<std::mutex> lock(sink_update_mutex);
+    sinks = sink_state.get();
+    sink_state.set(nullptr);
+  }
+  if (sinks) {
+    for (auto &sink : *sinks) {
+      sink->flush();
+    }
+  }
+}
+
+bool Logger::write_to_sinks(Verbosity level, std::string_view message) {
+  if (!sink_state.has_sinks.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  // copy the tag, so that we don't hold the lock while writing to the sinks
+  std::string tag;
+  {
+    std::lock_guard<std::mutex> lock(tag_mutex_);
+    tag = tag_;
+  }
+  return dispatch_to_sinks({
+      .tag = tag,
+      .level = level,
+      .timestamp_us = get_time_us(),
+      .thread_id = get_thread_id(),
+      .message = message,
+  });
+}
+
+uint32_t Logger::get_thread_id() {
+#if defined(ESP_PLATFORM)
+  return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(xTaskGetCurrentTaskHandle()));
+#else
+  return static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+#endif
+}
+
+bool Logger::start_binary(const BinaryConfig &config) {
+  if (!config.write) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(binary_state.mutex);
+    if (binary_state.enabled) {
+      return false;
+    }
+    binary_state.write = config.write;
+    // the ids are 16 bit
+    binary_state.max_tags = std::clamp<size_t>(config.max_tags, 1, UINT16_MAX + 1);
+    binary_state.max_formats = std::clamp<size_t>(config.max_formats, 1, UINT16_MAX + 1);
+    // forget the previous definitions, so that they are sent again in this
+    // stream
+    binary_state.clear_ids();
+    // start the stream with the header
+    using namespace logger_binary_format;
+    uint8_t data[FRAME_HEADER_SIZE + 5];
+    Writer writer(data, sizeof(data));
+    writer.begin_frame(FrameType::HEADER);
+    writer.put_bytes("ESPP", 4);
+    writer.put(VERSION);
+    writer.end_frame();
+    binary_state.write({data, writer.size()});
+  }
+  binary_state.enabled = true;
+  return true;
+}
+
+void Logger::stop_binary() {
+  binary_state.enabled = false;
+  // write out any buffered binary records before we remove the output
+  flush();
+  std::lock_guard<std::mutex> lock(binary_state.mutex);
+  binary_state.write = nullptr;
+}
+
+bool Logger::is_binary() { return binary_state.enabled.load(std::memory_order_relaxed); }
+
+bool Logger::get_binary_ids(std::string_view format, uint16_t &tag_id, uint16_t &format_id,
+                            uint32_t &generation) {
+  using namespace logger_binary_format;
+  // NOTE: tag_mutex_ is held by the caller, which guards binary_ids_
+  if (!binary_ids_) {
+    binary_ids_ = std::make_unique<BinaryIds>();
+  }
+  auto &cache = *binary_ids_;
+  auto format_address = reinterpret_cast<uintptr_t>(format.data());
+  auto &cached_format =
+      cache.formats[(format_address ^ (format_address >> 4)) % BinaryIds::NUM_FORMATS];
+  // the address alone is not enough, as a heap allocated format string may be
+  // freed and another one allocated at the same address
+  size_t hash = std::hash<std::string_view>{}(format);
+  generation = binary_state.generation.load(std::memory_order_acquire);
+  if (cache.generation == generation && cache.has_tag_id &&
+      cached_format.data == format.data() && cached_format.size == format.size() &&
+      cached_format.hash == hash) {
+    // the usual case: this logger has already used this format string
+    tag_id = cache.tag_id;
+    format_id = cached_format.id;
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(binary_state.mutex);
+  // send a definition frame, in order with the log frames which use it
+  auto send_definition = [](FrameType type, uint16_t id, std::string_view text) -> bool {
+    if (auto *buffer = get_async_buffer()) {
+      auto *record = buffer->claim();
+      if (!record) {
+        return false;
+      }
+      // truncate the text if it does not fit in the record
+      size_t capacity = buffer->max_text_size();
+      text = text.substr(0, capacity - std::min(capacity, FRAME_HEADER_SIZE + sizeof(id)));
+      Writer writer(reinterpret_cast<uint8_t *>(record->text()), capacity);
+      writer.begin_frame(type);
+      writer.put(id);
+      writer.put_bytes(text.data(), text.size());
+      writer.end_frame();
+      record->level = static_cast<uint8_t>(Verbosity::NONE);
+      record->binary = true;
+      record->size = writer.size();
+      record->timestamp_us = get_time_us();
+      buffer->commit(record);
+      return true;
+    }
+    if (!binary_state.write) {
+      return false;
+    }
+    std::vector<uint8_t> data(FRAME_HEADER_SIZE + sizeof(id) + text.size());
+    Writer writer(data.data(), data.size());
+    writer.begin_frame(type);
+    writer.put(id);
+    writer.put_bytes(text.data(), text.size());
+    writer.end_frame();
+    binary_state.write(data);
+    return true;
+  };
+
+  if (binary_state.next_tag_id >= binary_state.max_tags ||
+      binary_state.next_format_id >= binary_state.max_formats) {
+    // out of ids (e.g. because of format strings which are not literals), so
+    // start again, the ids are defined again as they are used
+    binary_state.clear_ids();
+  }
+  generation = binary_state.generation;
+  if (cache.generation != generation) {
+    cache = {};
+    cache.generation = generation;
+  }
+
+  if (!cache.has_tag_id) {
+    const auto &tag = tag_;
+    auto tag_it = binary_state.tag_ids.find(std::string_view(tag));
+    if (tag_it == binary_state.tag_ids.end()) {
+      uint16_t id = binary_state.next_tag_id;
+      if (!send_definition(FrameType::TAG_DEF, id, tag)) {
+        return false;
+      }
+      binary_state.next_tag_id++;
+      tag_it = binary_state.tag_ids.emplace(tag, id).first;
+    }
+    cache.tag_id = tag_it->second;
+    cache.has_tag_id = true;
+  }
+  tag_id = cache.tag_id;
+
+  auto format_it = binary_state.format_ids.find(format.data());
+  if (format_it == binary_state.format_ids.end() || format_it->second.hash != hash) {
+    // new format string, or a different format string at the same address
+    uint16_t id = binary_state.next_format_id;
+    if (!send_definition(FrameType::FORMAT_DEF, id, format)) {
+      return false;
+    }
+    binary_state.next_format_id++;
+    binary_state.format_ids[format.data()] = {hash, id};
+    format_id = id;
+  } else {
+    format_id = format_it->second.id;
+  }
+  cached_format = {format.data(), format.size(), hash, format_id};
+  return true;
+}
+
+bool Logger::write_binary_frames(std::span<const uint8_t> frames, uint32_t generation) {
+  if (frames.empty()) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(binary_state.mutex);
+  if (binary_state.generation != generation) {
+    // the ids in the frames may have been reused for something else since
+    return false;
+  }
+  if (binary_state.write) {
+    binary_state.write(frames);
+  }
+  return true;
+}
@@ -55,6 +55,14 @@ public:
       , port_0_interrupt_mask_(config.port_0_interrupt_mask)
       , port_1_direction_mask_(config.port_1_direction_mask)
       , port_1_interrupt_mask_(config.port_1_interrupt_mask) {
+    // the pins and interrupt flags / captures can change at any time, writing
+    // GPIO writes OLAT, and IOCON_0 is an alias of IOCON, so they must not be
+    // cached
+    set_registers_volatile({(uint8_t)Registers::GPIOA, (uint8_t)Registers::GPIOB,
+                            (uint8_t)Registers::OLATA, (uint8_t)Registers::OLATB,
+                            (uint8_t)Registers::INTFA, (uint8_t)Registers::INTFB,
+                            (uint8_t)Registers::INTCAPA, (uint8_t)Registers::INTCAPB,
+                            (uint8_t)Registers::IOCON_0});
     if (config.auto_init) {
       std::error_code ec;
       init(ec);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <mutex>
+#include <span>
 
 #include <driver/gpio.h>
 
@@ -45,10 +46,25 @@ public:
   /// \param index The index of the pixel to set.
   void set_color(const espp::Hsv &hsv, std::size_t index = 0) { set_color(hsv.rgb(), index); }
 
+  /// Set the color of a single pixel.
+  /// \param rgb The color to set the pixel to.
+  /// \param index The index of the pixel to set.
+  void set_color(const espp::Rgb8 &rgb, std::size_t index = 0);
+
+  /// Set the colors of a range of pixels.
+  /// \param colors The colors to set the pixels to, starting at pixel \p first.
+  /// \param first The index of the pixel to set to the first color.
+  /// \note Colors past the end of the strip are ignored.
+  void set_colors(std::span<const espp::Rgb8> colors, std::size_t first = 0);
+
   /// Set the color of all pixels.
   /// \param rgb The color to set all pixels to.
   void set_all(const espp::Rgb &rgb);
 
+  /// Set the color of all pixels.
+  /// \param rgb The color to set all pixels to.
+  void set_all(const espp::Rgb8 &rgb);
+
   /// Set the color of all pixels.
   /// \param hsv The color to set all pixels to.
   void set_all(const espp::Hsv &hsv) { set_all(hsv.rgb()); }
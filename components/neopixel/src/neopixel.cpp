@@ -131,6 +131,37 @@ void Neopixel::set_all(const espp::Rgb &rgb) {
   }
 }
 
+void Neopixel::set_color(const espp::Rgb8 &rgb, std::size_t index) {
+  // return if the index is out of bounds
+  if (index >= config_.num_leds) {
+    return;
+  }
+  led_data_[index * 3] = rgb.g;
+  led_data_[index * 3 + 1] = rgb.r;
+  led_data_[index * 3 + 2] = rgb.b;
+}
+
+void Neopixel::set_colors(std::span<const espp::Rgb8> colors, std::size_t first) {
+  if (first >= config_.num_leds) {
+    return;
+  }
+  std::size_t count = std::min(colors.size(), config_.num_leds - first);
+  uint8_t *data = &led_data_[first * 3];
+  for (std::size_t i = 0; i < count; i++) {
+    *data++ = colors[i].g;
+    *data++ = colors[i].r;
+    *data++ = colors[i].b;
+  }
+}
+
+void Neopixel::set_all(const espp::Rgb8 &rgb) {
+  for (int i = 0; i < led_data_.size(); i += 3) {
+    led_data_[i] = rgb.g;
+    led_data_[i + 1] = rgb.r;
+    led_data_[i + 2] = rgb.b;
+  }
+}
+
 void Neopixel::show() {
   // now we can send the data to the LED
   rmt_->transmit(led_data_.data(), led_data_.size());
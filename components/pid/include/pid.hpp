@@ -102,6 +102,22 @@ public:
     float t = std::chrono::duration<float>(curr_ts - prev_ts_).count();
 #endif                                     // ESP_PLATFORM
     prev_ts_ = curr_ts;
+    return update(error, t);
+  }
+
+  /**
+   * @brief Update the PID controller with the latest error measurement and
+   *        the time since the previous update, getting the output control
+   *        signal in return.
+   *
+   * @note Unlike update(float), this does not track invocation timing, which
+   *       makes it suitable for replaying recorded data or for simulation.
+   *
+   * @param error Latest error signal.
+   * @param t Time since the previous update, in seconds.
+   * @return The output control signal based on the PID state and error.
+   */
+  float update(float error, float t) {
     std::lock_guard<std::recursive_mutex> lk(mutex_);
     error_ = error;
     float integrand = config_.ki * error_ * t;
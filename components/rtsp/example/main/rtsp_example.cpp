@@ -67,10 +67,12 @@ extern "C" void app_main(void) {
   });
   rtsp_server.start();
 
-  espp::JpegFrame jpeg_frame(jpeg_data, sizeof(jpeg_data));
+  // share the frame with the server, so that it can send the frame's data
+  // directly without copying it
+  auto jpeg_frame = std::make_shared<const espp::JpegFrame>(jpeg_data, sizeof(jpeg_data));
 
-  logger.info("Parsed JPEG image, num bytes: {}", jpeg_frame.get_data().size());
-  logger.info("Created frame of size {}x{}", jpeg_frame.get_width(), jpeg_frame.get_height());
+  logger.info("Parsed JPEG image, num bytes: {}", jpeg_frame->get_data().size());
+  logger.info("Created frame of size {}x{}", jpeg_frame->get_width(), jpeg_frame->get_height());
   rtsp_server.send_frame(jpeg_frame);
   //! [rtsp_server_example]
 
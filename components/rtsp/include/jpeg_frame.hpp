@@ -25,6 +25,27 @@ public:
     add_scan(packet);
   }
 
+  /// Construct a complete JpegFrame from the fields of its RTP/JPEG packets
+  /// and its reassembled scan data.
+  ///
+  /// The frame's buffer is allocated once, with the exact size of the header
+  /// and the scan data.
+  ///
+  /// @param width The width of the frame.
+  /// @param height The height of the frame.
+  /// @param q0 The first quantization table.
+  /// @param q1 The second quantization table.
+  /// @param scan_data The complete scan data of the frame.
+  explicit JpegFrame(int width, int height, std::string_view q0, std::string_view q1,
+                     std::string_view scan_data)
+      : header_(width, height, q0, q1) {
+    auto header_data = header_.get_data();
+    data_.reserve(header_data.size() + scan_data.size());
+    data_.insert(std::end(data_), std::begin(header_data), std::end(header_data));
+    data_.insert(std::end(data_), std::begin(scan_data), std::end(scan_data));
+    finalized_ = true;
+  }
+
   /// Construct a JpegFrame from buffer of jpeg data
   /// @param data The buffer containing the jpeg data.
   /// @param size The size of the buffer.
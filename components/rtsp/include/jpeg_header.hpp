@@ -574,6 +574,8 @@ protected:
     data_[offset++] = 0x43;
     data_[offset++] = 0x00;
     memcpy(data_.data() + offset, q0_table_.data(), q0_table_.size());
+    // refer to our own copy of the table, which outlives the caller's
+    q0_table_ = std::string_view((const char *)data_.data() + offset, q0_table_.size());
     offset += q0_table_.size();
 
     // add the DQT marker for chrominance
@@ -583,6 +585,7 @@ protected:
     data_[offset++] = 0x43;
     data_[offset++] = 0x01;
     memcpy(data_.data() + offset, q1_table_.data(), q1_table_.size());
+    q1_table_ = std::string_view((const char *)data_.data() + offset, q1_table_.size());
     offset += q1_table_.size();
 
     // add huffman tables
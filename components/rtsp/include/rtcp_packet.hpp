@@ -1,16 +1,33 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace espp {
 /// @brief A class to represent a RTCP packet
-/// @details This class is used to represent a RTCP packet.
-///          It is used as a base class for all RTCP packet types.
-/// @note At the moment, this class is not used.
+/// @details This class is used to represent a RTCP packet (RFC 3550).
+///          It is used as a base class for all RTCP packet types, and has
+///          helpers for splitting a compound RTCP packet into its packets.
 class RtcpPacket {
 public:
+  static constexpr int SENDER_REPORT = 200;   ///< Packet type of a sender report (SR)
+  static constexpr int RECEIVER_REPORT = 201; ///< Packet type of a receiver report (RR)
+
+  /// @brief A reception report block, which is part of sender and receiver
+  ///        reports and describes the reception of one RTP source.
+  struct ReportBlock {
+    uint32_t ssrc{0};             ///< The SSRC of the source this block is about
+    uint8_t fraction_lost{0};     ///< Fraction of packets lost since the last report, out of 256
+    int32_t cumulative_lost{0};   ///< Total packets lost (24 bit signed)
+    uint32_t highest_sequence{0}; ///< Extended highest sequence number received
+    uint32_t jitter{0};           ///< Interarrival jitter, in RTP timestamp units
+    uint32_t last_sender_report{0}; ///< Middle 32 bits of the NTP timestamp of the last SR
+    uint32_t delay_since_last_sender_report{0}; ///< Delay since the last SR, in 1/65536 s
+  };
+
   /// @brief Constructor, default
   RtcpPacket() = default;
 
@@ -18,11 +35,103 @@ public:
   virtual ~RtcpPacket() = default;
 
   /// @brief Get the buffer of the packet
+  /// @note The packet must be serialized first.
   /// @return The buffer of the packet
   std::string_view get_data() const;
 
+  /// @brief Get the first RTCP packet of a (compound) RTCP packet
+  /// @param data The data of the compound packet
+  /// @return The first packet, or an empty string_view if \p data does not
+  ///         start with a valid RTCP packet. Removing it from the front of
+  ///         \p data gives the rest of the compound packet.
+  static std::string_view get_first_packet(std::string_view data);
+
+  /// @brief Get the packet type of an RTCP packet
+  /// @param packet The RTCP packet, e.g. from get_first_packet()
+  /// @return The packet type, e.g. SENDER_REPORT
+  static int get_packet_type(std::string_view packet);
+
+  /// @brief Convert a time to a 64 bit NTP timestamp
+  /// @param time The time to convert
+  /// @return The NTP timestamp, seconds since 1900 in 32.32 fixed point
+  static uint64_t to_ntp_timestamp(std::chrono::system_clock::time_point time);
+
+  /// @brief Get the middle 32 bits of an NTP timestamp, as used in report
+  ///        blocks
+  /// @param ntp_timestamp The NTP timestamp
+  /// @return The middle 32 bits, seconds in 16.16 fixed point
+  static uint32_t to_compact_ntp(uint64_t ntp_timestamp);
+
+protected:
+  static constexpr size_t HEADER_SIZE = 4;
+  static constexpr size_t REPORT_BLOCK_SIZE = 24;
+
+  void serialize_header(int count, int packet_type, size_t size);
+  static void serialize_report_block(uint8_t *data, const ReportBlock &block);
+  static ReportBlock parse_report_block(const uint8_t *data);
+  static void write_u32(uint8_t *data, uint32_t value);
+  static uint32_t read_u32(const uint8_t *data);
+
+  std::vector<uint8_t> buffer_;
+};
+
+/// @brief An RTCP sender report (SR), which is sent by the sender of an RTP
+///        stream so that receivers can relate its RTP timestamps to wallclock
+///        time and estimate the round trip time.
+class RtcpSenderReport : public RtcpPacket {
+public:
+  /// @brief Construct an empty sender report
+  RtcpSenderReport() = default;
+
+  /// @brief Construct a sender report by parsing \p data
+  /// @param data The RTCP packet, which should be a sender report
+  explicit RtcpSenderReport(std::string_view data);
+
+  /// @brief Whether the packet was parsed successfully
+  /// @return True if the packet is a valid sender report
+  bool is_valid() const { return valid_; }
+
+  uint32_t ssrc{0};          ///< The SSRC of the sender
+  uint64_t ntp_timestamp{0}; ///< The wallclock time the report was sent, as an NTP timestamp
+  uint32_t rtp_timestamp{0}; ///< The RTP timestamp corresponding to ntp_timestamp
+  uint32_t packet_count{0};  ///< The number of RTP packets sent
+  uint32_t octet_count{0};   ///< The number of RTP payload bytes sent
+  std::vector<ReportBlock> report_blocks; ///< Reception reports about other sources
+
+  /// @brief Serialize the fields into the packet's buffer
+  /// @note This should be called after modifying the fields, and before
+  ///       get_data().
+  void serialize();
+
+protected:
+  static constexpr size_t SENDER_INFO_SIZE = 20;
+  bool valid_{false};
+};
+
+/// @brief An RTCP receiver report (RR), which is sent by the receivers of an
+///        RTP stream to report the loss and jitter they see.
+class RtcpReceiverReport : public RtcpPacket {
+public:
+  /// @brief Construct an empty receiver report
+  RtcpReceiverReport() = default;
+
+  /// @brief Construct a receiver report by parsing \p data
+  /// @param data The RTCP packet, which should be a receiver report
+  explicit RtcpReceiverReport(std::string_view data);
+
+  /// @brief Whether the packet was parsed successfully
+  /// @return True if the packet is a valid receiver report
+  bool is_valid() const { return valid_; }
+
+  uint32_t ssrc{0};                       ///< The SSRC of the receiver
+  std::vector<ReportBlock> report_blocks; ///< Reception reports, one per source
+
+  /// @brief Serialize the fields into the packet's buffer
+  /// @note This should be called after modifying the fields, and before
+  ///       get_data().
+  void serialize();
+
 protected:
-  uint8_t *m_buffer{nullptr};
-  uint32_t m_bufferSize{0};
+  bool valid_{false};
 };
 } // namespace espp
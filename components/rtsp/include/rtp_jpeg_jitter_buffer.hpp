@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "base_component.hpp"
+#include "jpeg_frame.hpp"
+#include "rtp_jpeg_packet.hpp"
+
+namespace espp {
+/// A jitter buffer which reassembles the RTP/JPEG (RFC 2435) packets of a
+/// stream into complete JPEG frames.
+///
+/// Packets are grouped into frames by their RTP timestamp, and the scan data
+/// of each packet is copied to its fragment offset in a buffer which is
+/// preallocated for the frame (and reused for later frames), so packets can
+/// arrive in any order and duplicates are ignored. A frame is complete once
+/// its first packet (which carries the quantization tables), its last packet
+/// (which has the marker bit set) and all of the bytes in between have been
+/// received.
+///
+/// Frames are delivered in timestamp order. A frame which is still
+/// incomplete after max_latency, or when a newer frame completes, is dropped
+/// rather than delivered with missing data, and any packets for it (or for
+/// an older frame) which arrive later are discarded.
+///
+/// The buffer also keeps loss and reordering statistics based on the RTP
+/// sequence numbers, and the interarrival jitter, which are what an RTCP
+/// receiver report needs, see get_stats().
+class RtpJpegJitterBuffer : public BaseComponent {
+public:
+  /// Function type for the callback to call when a JPEG frame is complete
+  using jpeg_frame_callback_t = std::function<void(std::unique_ptr<JpegFrame> jpeg_frame)>;
+
+  /// Configuration for the jitter buffer
+  struct Config {
+    std::chrono::milliseconds max_latency{
+        100}; ///< How long to wait for the missing packets of a frame before dropping it
+    size_t max_frames{3};               ///< Maximum number of frames being reassembled at once
+    size_t frame_capacity{64 * 1024};   ///< Bytes of scan data preallocated for each frame
+    size_t max_frame_size{1024 * 1024}; ///< Frames with more scan data than this are dropped
+    jpeg_frame_callback_t on_jpeg_frame{nullptr}; ///< Called with each complete frame
+    espp::Logger::Verbosity log_level =
+        espp::Logger::Verbosity::WARN; ///< The verbosity of the logger
+  };
+
+  /// Statistics of the packets and frames handled by the jitter buffer
+  struct Stats {
+    uint32_t packets_received{0};   ///< Packets received, including duplicates and late packets
+    uint32_t packets_lost{0};       ///< Packets never received, from the sequence numbers
+    uint32_t packets_reordered{0};  ///< Packets received after a packet with a later sequence
+    uint32_t packets_duplicated{0}; ///< Packets received more than once
+    uint32_t packets_late{0};       ///< Packets for a frame which was already delivered / dropped
+    uint32_t packets_invalid{0};    ///< Packets which could not be placed in a frame
+    uint32_t frames_completed{0};   ///< Frames delivered to the callback
+    uint32_t frames_dropped{0};     ///< Frames dropped because they were incomplete
+    uint32_t packets_expected{0};   ///< Packets expected, from the first and highest sequence
+    uint32_t highest_sequence{0};   ///< Extended highest sequence number received
+    uint32_t jitter{0};             ///< Interarrival jitter (RFC 3550), in RTP timestamp units
+    uint32_t ssrc{0};               ///< SSRC of the stream
+  };
+
+  /// Constructor
+  /// @param config The configuration for the jitter buffer
+  explicit RtpJpegJitterBuffer(const Config &config);
+
+  /// Add a received packet to the jitter buffer.
+  /// @note If this completes a frame, the on_jpeg_frame callback is called
+  ///       from within this function.
+  /// @param packet The RTP/JPEG packet.
+  void add_packet(const RtpJpegPacket &packet);
+
+  /// Drop all frames being reassembled and reset the statistics, e.g. when
+  /// (re)starting a stream.
+  void reset();
+
+  /// Get the statistics of the jitter buffer.
+  /// @return The statistics.
+  Stats get_stats() const;
+
+protected:
+  using clock = std::chrono::steady_clock;
+
+  struct Frame {
+    bool in_use{false};
+    uint32_t timestamp{0};
+    clock::time_point first_arrival;
+    int width{0};
+    int height{0};
+    bool has_first{false}; ///< whether the packet at offset 0 has been received
+    bool has_last{false};  ///< whether the packet with the marker bit has been received
+    size_t size{0};        ///< total size of the scan data, known once has_last is true
+    size_t received_bytes{0};
+    std::array<char, 64> q0_table{}; ///< the quantization tables of the frame
+    std::array<char, 64> q1_table{};
+    std::vector<uint8_t> scan_data; ///< reused between frames, so it keeps its capacity
+    std::vector<std::pair<uint32_t, uint32_t>> fragments; ///< offset and size of each fragment
+  };
+
+  Frame &get_frame(uint32_t timestamp, clock::time_point now);
+  bool update_sequence(uint16_t sequence_number);
+  static bool is_duplicate(const Frame &frame, uint32_t offset);
+  bool place_fragment(Frame &frame, const RtpJpegPacket &packet);
+  std::unique_ptr<JpegFrame> complete_frame(Frame &frame);
+  void drop_frame(Frame &frame);
+  void release_frame(Frame &frame);
+  void drop_expired_frames(clock::time_point now);
+  void update_jitter(uint32_t timestamp, clock::time_point now);
+  static bool is_newer(uint32_t timestamp, uint32_t other);
+
+  static constexpr int CLOCK_RATE = 90000; ///< RTP/JPEG timestamps are in 90 kHz units
+
+  Config config_;
+  mutable std::mutex mutex_;
+  std::vector<Frame> frames_;
+  std::array<char, 64> q0_table_{}; ///< the most recently received quantization tables
+  std::array<char, 64> q1_table_{};
+  bool has_q_tables_{false};
+
+  bool has_released_{false};
+  uint32_t last_released_timestamp_{0}; ///< the newest frame delivered or dropped
+  bool has_sequence_{false};
+  int64_t base_sequence_{0};    ///< extended sequence number of the first packet
+  int64_t max_sequence_{0};     ///< highest extended sequence number received
+  uint32_t unique_received_{0}; ///< packets received, not counting duplicates
+  bool has_transit_{false};
+  int64_t last_transit_{0}; ///< relative transit time of the previous packet, in RTP units
+  float jitter_{0};         ///< interarrival jitter, in RTP units
+  Stats stats_;
+};
+} // namespace espp
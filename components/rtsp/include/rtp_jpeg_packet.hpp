@@ -155,7 +155,10 @@ protected:
       MJPEG_HEADER_SIZE + QUANT_HEADER_SIZE + (NUM_Q_TABLES * Q_TABLE_SIZE);
 
   void parse_mjpeg_header() {
-    auto payload = get_payload();
+    // read the header as unsigned bytes, so that bytes >= 0x80 (e.g. in the
+    // fragment offset) are not sign extended
+    auto payload = std::basic_string_view<uint8_t>((const uint8_t *)get_payload().data(),
+                                                   get_payload().size());
     type_specific_ = payload[0];
     offset_ = (payload[1] << 16) | (payload[2] << 8) | payload[3];
     frag_type_ = payload[4];
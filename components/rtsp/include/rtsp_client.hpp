@@ -3,16 +3,25 @@
 #include "socket_msvc.hpp"
 
 #include <memory>
+#include <span>
 #include <string>
 #include <system_error>
 #include <unordered_map>
 #include <vector>
 
+#if defined(ESP_PLATFORM)
+#include <esp_random.h>
+#else
+#include <random>
+#endif
+
 #include "base_component.hpp"
 #include "tcp_socket.hpp"
 #include "udp_socket.hpp"
 
 #include "jpeg_frame.hpp"
+#include "rtcp_packet.hpp"
+#include "rtp_jpeg_jitter_buffer.hpp"
 
 namespace espp {
 
@@ -42,6 +51,9 @@ public:
                                   ///< form "rtsp://<server_address>:<rtsp_port><path>"
     espp::RtspClient::jpeg_frame_callback_t
         on_jpeg_frame; ///< The callback to call when a JPEG frame is received
+    std::chrono::milliseconds jitter_buffer_latency{
+        100}; ///< How long to wait for missing or reordered RTP packets before dropping a frame
+    size_t max_pending_frames{3}; ///< Maximum number of frames being reassembled at once
     espp::Logger::Verbosity log_level =
         espp::Logger::Verbosity::INFO; ///< The verbosity of the logger
   };
@@ -127,6 +139,10 @@ public:
   /// \param ec The error code to set if an error occurs
   void teardown(std::error_code &ec);
 
+  /// Get the statistics of the received RTP packets and JPEG frames
+  /// \return The loss, reordering, and frame statistics of the jitter buffer
+  RtpJpegJitterBuffer::Stats get_rtp_stats() const;
+
 protected:
   /// Parse the RTSP response
   /// \note Parses response data for the following fields:
@@ -156,31 +172,49 @@ protected:
                  std::error_code &ec);
 
   /// Handle an RTP packet
-  /// \note Parses the RTP packet and appends it to the current JPEG frame.
-  /// \note If the packet is the last fragment of the JPEG frame, the frame is sent to the
-  /// on_jpeg_frame callback. \note This function is called by the RTP socket task. \param data The
-  /// data to handle \param sender_info The sender info \return Optional data to send back to the
-  /// sender
-  std::optional<std::vector<uint8_t>> handle_rtp_packet(std::vector<uint8_t> &data,
-                                                        const espp::Socket::Info &sender_info);
+  /// \note Parses the RTP packet and adds it to the jitter buffer, which
+  ///       places it in its JPEG frame by sequence and fragment offset.
+  /// \note When the packet completes a JPEG frame, the frame is sent to the
+  /// on_jpeg_frame callback. \note This function is called by the RTP socket task, with packets
+  /// received in batches into the socket's buffers. \param data The data to handle, which is
+  /// only valid during the call \param sender_info The sender info
+  void handle_rtp_packet(std::span<const uint8_t> data, const espp::Socket::Info &sender_info);
 
   /// Handle an RTCP packet
-  /// \note Parses the RTCP packet and sends a response if necessary.
+  /// \note Parses the RTCP packet, and responds to each sender report from
+  ///       the server with a receiver report, which tells the server the
+  ///       loss and jitter of the RTP stream and lets it estimate the round
+  ///       trip time.
   /// \note This function is called by the RTCP socket task.
   /// \param data The data to handle
   /// \param sender_info The sender info
   /// \return Optional data to send back to the sender
   std::optional<std::vector<uint8_t>> handle_rtcp_packet(std::vector<uint8_t> &data,
                                                          const espp::Socket::Info &sender_info);
+
+  /// Build a receiver report about the RTP stream, from the statistics of
+  /// the jitter buffer
+  /// \return The receiver report
+  RtcpReceiverReport make_receiver_report();
+
   std::string server_address_;
   int rtsp_port_;
 
+  // used by the receive tasks of the sockets, so declared before them, so
+  // that they are destroyed after the tasks have stopped
+  jpeg_frame_callback_t on_jpeg_frame_{nullptr};
+  RtpJpegJitterBuffer jitter_buffer_;
+
+  uint32_t ssrc_;                   ///< our ssrc, for the receiver reports
+  uint32_t expected_prior_{0};      ///< packets expected at the last receiver report
+  uint32_t received_prior_{0};      ///< packets received at the last receiver report
+  uint32_t last_sender_report_{0};  ///< middle 32 bits of the last sender report's NTP timestamp
+  std::chrono::steady_clock::time_point last_sender_report_time_{}; ///< when it was received
+
   espp::TcpSocket rtsp_socket_;
   espp::UdpSocket rtp_socket_;
   espp::UdpSocket rtcp_socket_;
 
-  jpeg_frame_callback_t on_jpeg_frame_{nullptr};
-
   int cseq_ = 0;
   int video_port_ = 0;
   int video_payload_type_ = 0;
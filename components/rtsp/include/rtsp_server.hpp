@@ -2,9 +2,12 @@
 
 #include "socket_msvc.hpp"
 
+#include <array>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <system_error>
+#include <unordered_map>
 #include <vector>
 
 #if defined(ESP_PLATFORM)
@@ -30,7 +33,16 @@ namespace espp {
 /// Starts a TCP socket to listen for RTSP connections, and then spawns off a
 /// new RTSP session for each connection.
 /// @see RtspSession
-/// @note This class does not currently send RTCP packets
+///
+/// Each session sends RTCP sender reports to its client and receives the
+/// client's receiver reports, on a SocketReactor shared by all the sessions.
+/// With adaptive pacing, a session whose client reports loss is sent fewer
+/// frames, without affecting the frames sent to the other clients.
+///
+/// send_frame() packetizes each frame once and queues a shared reference to
+/// it on every session, which sends it to its client from its own task. A
+/// client which is slow to send to only fills its own queue, and drops its
+/// own oldest frames, without delaying the other clients.
 ///
 /// \section rtsp_server_ex1 RtspServer example
 /// \snippet rtsp_example.cpp rtsp_server_example
@@ -46,6 +58,13 @@ public:
               ///< up into multiple packets if they are larger than this. It seems that 1500 works
               ///< well for sending, but is too large for the esp32 (camera-display) to receive
               ///< properly.
+    std::chrono::duration<float> rtcp_interval =
+        std::chrono::seconds(1); ///< The interval between RTCP sender reports to each client
+    bool adaptive_pacing{true};  ///< Whether to send fewer frames to clients which report loss
+    std::chrono::duration<float> max_frame_interval =
+        std::chrono::seconds(1); ///< The longest time between frames sent to a paced client
+    size_t max_queued_frames{2}; ///< The number of frames queued for each client before its
+                                 ///< oldest frame is dropped
     espp::Logger::Verbosity log_level =
         espp::Logger::Verbosity::WARN; ///< The log level for the RTSP server
   };
@@ -65,29 +84,55 @@ public:
   void set_session_log_level(espp::Logger::Verbosity log_level);
 
   /// @brief Start the RTSP server
-  /// Starts the accept task, session task, and binds the RTSP socket
+  /// Starts the accept task and binds the RTSP socket
   /// @param accept_timeout The timeout for accepting new connections
   /// @return True if the server was started successfully, false otherwise
   bool start(const std::chrono::duration<float> &accept_timeout = std::chrono::seconds(5));
 
   /// @brief Stop the FTP server
-  /// Stops the accept task, session task, and closes the RTSP socket
+  /// Stops the accept task, the sessions, and closes the RTSP socket
   void stop();
 
   /// @brief Send a frame over the RTSP connection
-  /// Converts the full JPEG frame into a series of simplified RTP/JPEG
-  /// packets and stores it to be sent over the RTP socket, but does not
-  /// actually send it
-  /// @note Overwrites any existing frame that has not been sent
+  /// Splits the JPEG frame into a series of simplified RTP/JPEG packets and
+  /// queues it to be sent to each client, but does not wait for it to be sent
+  /// @note If a client already has max_queued_frames frames waiting, its
+  ///       oldest frame is dropped
+  /// @note The frame's scan data is copied once, into a buffer which is reused
+  ///       for later frames. Use the std::shared_ptr overload to avoid the
+  ///       copy.
   /// @param frame The frame to send
   void send_frame(const espp::JpegFrame &frame);
 
+  /// @brief Send a frame over the RTSP connection, without copying it
+  /// Splits the JPEG frame into a series of simplified RTP/JPEG packets and
+  /// queues it to be sent to each client, but does not wait for it to be
+  /// sent. Only the packet headers are built, the payload of each packet is
+  /// sent directly from the frame's data, which is kept alive until the frame
+  /// has been sent to (or dropped by) every client.
+  /// @note If a client already has max_queued_frames frames waiting, its
+  ///       oldest frame is dropped
+  /// @param frame The frame to send
+  void send_frame(std::shared_ptr<const espp::JpegFrame> frame);
+
+  /// @brief Get the statistics of each session, from the packets sent and
+  ///        the RTCP receiver reports of its client
+  /// @return The statistics of each session, by session id
+  std::unordered_map<uint32_t, RtspSession::Stats> get_session_stats();
+
 protected:
+  using PacketizedFrame = RtspSession::PacketizedFrame;
+
+  std::shared_ptr<PacketizedFrame> acquire_frame();
+  void packetize(PacketizedFrame &packetized_frame, const JpegHeader &header);
+  void enqueue_frame(std::shared_ptr<const PacketizedFrame> frame);
+  uint32_t get_rtp_timestamp(std::chrono::steady_clock::time_point time) const;
+
+  void remove_closed_sessions();
+
   bool accept_task_function(std::mutex &m, std::condition_variable &cv, bool &task_notified);
-  bool session_task_function(std::mutex &m, std::condition_variable &cv, bool &task_notified);
 
   uint32_t ssrc_; ///< the ssrc (synchronization source identifier) for the RTP packets
-  uint16_t sequence_number_{0}; ///< the sequence number for the RTP packets
 
   std::string server_address_; ///< the address of the server
   int port_;                   ///< the port of the RTSP server
@@ -96,15 +141,22 @@ protected:
   espp::TcpSocket rtsp_socket_;
 
   size_t max_data_size_;
+  std::chrono::duration<float> rtcp_interval_;
+  bool adaptive_pacing_;
+  std::chrono::duration<float> max_frame_interval_;
+  size_t max_queued_frames_;
+  std::shared_ptr<espp::SocketReactor> socket_reactor_; ///< receives RTCP for all the sessions
+
+  std::chrono::steady_clock::time_point start_time_; ///< reference for the RTP timestamps
 
-  std::mutex rtp_packets_mutex_;
-  std::vector<std::unique_ptr<espp::RtpJpegPacket>> rtp_packets_;
+  std::mutex staging_mutex_; ///< guards frame_pool_
+  std::vector<std::shared_ptr<PacketizedFrame>>
+      frame_pool_; ///< packetized frames, reused once no session uses them
 
   espp::Logger::Verbosity session_log_level_{espp::Logger::Verbosity::WARN};
   std::mutex session_mutex_;
   std::unordered_map<int, std::unique_ptr<espp::RtspSession>> sessions_;
 
   std::unique_ptr<Task> accept_task_;
-  std::unique_ptr<Task> session_task_;
 };
 } // namespace espp
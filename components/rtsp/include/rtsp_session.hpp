@@ -2,7 +2,11 @@
 
 #include "socket_msvc.hpp"
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <span>
 #include <string>
 #include <system_error>
 #include <vector>
@@ -14,16 +18,33 @@
 #endif
 
 #include "base_component.hpp"
+#include "socket_reactor.hpp"
 #include "task.hpp"
 #include "tcp_socket.hpp"
 #include "udp_socket.hpp"
 
+#include "jpeg_frame.hpp"
 #include "rtcp_packet.hpp"
 #include "rtp_packet.hpp"
 
 namespace espp {
 /// Class that reepresents an RTSP session, which is uniquely identified by a
 /// session id and sends frame data over RTP and RTCP to the client
+///
+/// Once the session is set up, it sends RTCP sender reports (SR) to the
+/// client and receives the client's RTCP receiver reports (RR), from which it
+/// estimates the loss, jitter and round trip time the client sees (see
+/// get_stats()). With adaptive pacing enabled, the session uses the reported
+/// loss to decide how often to send frames to the client (see
+/// should_send_frame()), so that a client on a poor link gets fewer frames
+/// rather than more lost packets.
+///
+/// Frames are given to the session with enqueue_frame(), which only queues a
+/// shared reference to the frame. Each session sends its queued frames from
+/// its own task, so a client which is slow to send to does not delay the
+/// frames sent to the other clients. If the client falls behind and the queue
+/// is full, the oldest queued frame is dropped, so the client always gets the
+/// latest frames.
 class RtspSession : public BaseComponent {
 public:
   /// Configuration for the RTSP session
@@ -32,17 +53,89 @@ public:
     std::string rtsp_path;      ///< The RTSP path of the session
     std::chrono::duration<float> receive_timeout =
         std::chrono::seconds(5); ///< The timeout for receiving data. Should be > 0.
+    uint32_t ssrc{0};            ///< The SSRC of the RTP stream, used in the sender reports
+    std::chrono::duration<float> rtcp_interval =
+        std::chrono::seconds(1); ///< The interval between RTCP sender reports
+    bool adaptive_pacing{true};  ///< Whether to skip frames for the client when it reports loss
+    std::chrono::duration<float> max_frame_interval =
+        std::chrono::seconds(1); ///< The longest time between frames when pacing
+    size_t max_queued_frames{
+        2}; ///< The number of frames queued for the client before the oldest is dropped
+    std::shared_ptr<espp::SocketReactor> socket_reactor{
+        nullptr}; ///< The reactor to receive RTCP packets on, e.g. one shared by all sessions
+                  ///< of a server. If not set, the session creates a reactor of its own.
     espp::Logger::Verbosity log_level =
         espp::Logger::Verbosity::WARN; ///< The log level of the session
   };
 
+  /// Statistics of the session, from the packets sent and the client's
+  /// receiver reports
+  struct Stats {
+    uint32_t packets_sent{0};   ///< RTP packets sent to the client
+    uint32_t octets_sent{0};    ///< RTP payload bytes sent to the client
+    uint32_t frames_sent{0};    ///< Frames sent to the client
+    uint32_t frames_skipped{0}; ///< Frames not sent to the client because of pacing
+    uint32_t frames_dropped{0}; ///< Frames dropped from the queue because the client fell behind
+    uint32_t receiver_reports{0}; ///< Receiver reports received from the client
+    float fraction_lost{0};     ///< Fraction of packets lost in the last report interval, 0-1
+    int32_t packets_lost{0};    ///< Total packets lost, as reported by the client
+    std::chrono::duration<float> jitter{0};          ///< Interarrival jitter reported by the client
+    std::chrono::duration<float> round_trip_time{0}; ///< Round trip time, 0 if not known yet
+    std::chrono::duration<float> frame_interval{0}; ///< Minimum time between frames from pacing
+  };
+
+  /// Size of the RTP/JPEG header and quantization tables
+  static constexpr size_t MAX_PACKET_HEADER_SIZE = 8 + 4 + 2 * 64;
+
+  /// The RTP/JPEG headers of one packet, and the part of the frame's scan data
+  /// which is its payload. The RTP header is added by each session, since
+  /// each session has its own sequence numbers.
+  struct PacketHeader {
+    std::array<uint8_t, MAX_PACKET_HEADER_SIZE> data; ///< the serialized headers
+    size_t size{0};                                   ///< the number of bytes of data used
+    size_t payload_offset{0};                         ///< offset of the payload in the scan data
+    size_t payload_size{0};                           ///< size of the payload
+  };
+
+  /// A frame which has been split into RTP/JPEG packets, which is shared by
+  /// all the sessions it is queued for
+  struct PacketizedFrame {
+    std::shared_ptr<const JpegFrame> frame; ///< the frame, if it was shared with the server
+    std::vector<uint8_t> scan_data_copy;    ///< copy of the scan data, if it was not shared
+    std::vector<PacketHeader> packets;      ///< the packets of the frame
+    uint32_t timestamp{0};                  ///< the RTP timestamp of the frame
+    std::chrono::steady_clock::time_point time{}; ///< when the frame was packetized
+
+    /// Get the scan data of the frame, which contains the packet payloads
+    std::string_view get_scan_data() const {
+      if (frame) {
+        return frame->get_scan_data();
+      }
+      return std::string_view((const char *)scan_data_copy.data(), scan_data_copy.size());
+    }
+
+    /// Called by a session when it queues the frame
+    void add_user() const { num_users.fetch_add(1, std::memory_order_relaxed); }
+
+    /// Called by a session once it has sent or dropped the frame, after which
+    /// it must not use the frame any more
+    void remove_user() const { num_users.fetch_sub(1, std::memory_order_release); }
+
+    /// Whether any session has yet to send or drop the frame. Once this is
+    /// false, the frame can be reused by the server.
+    bool is_in_use() const { return num_users.load(std::memory_order_acquire) != 0; }
+
+  private:
+    mutable std::atomic<size_t> num_users{0}; ///< sessions which have the frame queued
+  };
+
   /// @brief Construct a new RtspSession object
   /// @param control_socket The control socket of the session
   /// @param config The configuration of the session
   explicit RtspSession(std::unique_ptr<espp::TcpSocket> control_socket, const Config &config);
 
   /// @brief Destroy the RtspSession object
-  /// Stop the session task
+  /// Stop the control and send tasks
   ~RtspSession();
 
   /// @brief Get the session id
@@ -81,11 +174,36 @@ public:
   /// @return True if the packet was sent successfully, false otherwise
   bool send_rtp_packet(const espp::RtpPacket &packet);
 
+  /// Send an RTP packet to the client, made up of several buffers (e.g. the
+  /// packet headers and the payload), without copying them into one buffer.
+  /// @param buffers The buffers which make up the packet, in order
+  /// @return True if the packet was sent successfully, false otherwise
+  bool send_rtp_packet(std::span<const std::string_view> buffers);
+
+  /// Send several RTP packets to the client (e.g. all the packets of a frame),
+  /// with as few system calls as possible
+  /// @see UdpSocket::send_batch
+  /// @param packets The packets to send, each made up of several buffers
+  /// @return The number of packets which were sent
+  size_t send_rtp_packets(std::span<const espp::UdpSocket::Datagram> packets);
+
   /// Send an RTCP packet to the client
   /// @param packet The RTCP packet to send
   /// @return True if the packet was sent successfully, false otherwise
   bool send_rtcp_packet(const espp::RtcpPacket &packet);
 
+  /// Queue a frame to be sent to the client, if the session is playing and
+  /// the frame is not skipped by adaptive pacing. This does not wait for the
+  /// frame to be sent.
+  /// @note If max_queued_frames frames are already queued, the oldest is
+  ///       dropped and counted in Stats::frames_dropped.
+  /// @param frame The frame to send, which is shared with the other sessions
+  void enqueue_frame(std::shared_ptr<const PacketizedFrame> frame);
+
+  /// Get the statistics of the session
+  /// @return The statistics of the session
+  Stats get_stats() const;
+
 protected:
   /// Send a response to a RTSP request
   /// @param code The response code
@@ -151,6 +269,47 @@ protected:
   /// @return True if the task should stop, false otherwise
   bool control_task_fn(std::mutex &m, std::condition_variable &cv, bool &task_notified);
 
+  /// @brief The task function for the send thread, which sends the queued
+  ///        frames to the client
+  /// @param m The mutex to lock when waiting on the condition variable
+  /// @param cv The condition variable to wait on
+  /// @param task_notified A flag to indicate if the task has been notified
+  /// @return True if the task should stop, false otherwise
+  bool send_task_fn(std::mutex &m, std::condition_variable &cv, bool &task_notified);
+
+  /// Send all the packets of a frame to the client, with this session's
+  /// sequence numbers, and a sender report if one is due
+  /// @param frame The frame to send
+  void send_frame_packets(const PacketizedFrame &frame);
+
+  /// Decide whether to send a frame to the client, based on the frame
+  /// interval from adaptive pacing, and count the frame as skipped if not.
+  /// @param now The time the frame was produced
+  /// @return True if the frame should be sent, false if it should be skipped
+  bool should_send_frame(std::chrono::steady_clock::time_point now);
+
+  /// Send an RTCP sender report to the client, if rtcp_interval has passed
+  /// since the last one
+  /// @param rtp_timestamp The RTP timestamp corresponding to the current time
+  void send_sender_report_if_due(uint32_t rtp_timestamp);
+
+  /// Bind the RTP socket and start receiving RTCP packets from the client,
+  /// both on ephemeral ports, which are stored in server_rtp_port_ and
+  /// server_rtcp_port_ to be sent to the client
+  /// @return True if the RTCP socket is receiving, false otherwise
+  bool init_rtcp();
+
+  /// Handle an RTCP packet from the client, e.g. a receiver report
+  /// @param data The (compound) RTCP packet
+  /// @param sender_info The sender info
+  void handle_rtcp_packet(std::span<const uint8_t> data, const espp::Socket::Info &sender_info);
+
+  /// Update the statistics and the frame interval from a report block about
+  /// our stream, received at \p ntp_timestamp
+  /// @param block The report block
+  /// @param ntp_timestamp The NTP timestamp when the report was received
+  void handle_report_block(const RtcpPacket::ReportBlock &block, uint64_t ntp_timestamp);
+
   /// Generate a new RTSP session id for the client
   /// Session IDs are generated randomly when a client sends a SETUP request and are
   /// used to identify the client in subsequent requests when managing the RTP session.
@@ -179,6 +338,15 @@ protected:
   bool parse_rtsp_setup_request(std::string_view request, std::string_view &rtsp_path,
                                 int &client_rtp_port, int &client_rtcp_port);
 
+  /// Size of the RTP header, which is not counted in the octets sent
+  static constexpr size_t RTP_HEADER_SIZE = 12;
+  /// RTP payload type of JPEG (RFC 3551)
+  static constexpr uint8_t JPEG_PAYLOAD_TYPE = 26;
+  /// Loss above which the frame interval is increased, when pacing
+  static constexpr float HIGH_LOSS_FRACTION = 0.05f;
+  /// Loss below which the frame interval is decreased, when pacing
+  static constexpr float LOW_LOSS_FRACTION = 0.01f;
+
   std::unique_ptr<espp::TcpSocket> control_socket_;
   espp::UdpSocket rtp_socket_;
   espp::UdpSocket rtcp_socket_;
@@ -194,6 +362,34 @@ protected:
   int client_rtp_port_;
   int client_rtcp_port_;
 
+  uint32_t ssrc_;
+  std::chrono::duration<float> rtcp_interval_;
+  bool adaptive_pacing_;
+  std::chrono::duration<float> max_frame_interval_;
+  std::shared_ptr<espp::SocketReactor> socket_reactor_;
+  bool rtcp_receiving_{false};
+  size_t server_rtp_port_{0};  ///< port the RTP packets are sent from, once bound
+  size_t server_rtcp_port_{0}; ///< port the RTCP packets are sent from and received on
+  uint16_t rtp_sequence_number_;
+  std::chrono::steady_clock::time_point last_sender_report_time_{};
+  // the frame timing used for pacing, guarded by stats_mutex_
+  std::chrono::steady_clock::time_point last_frame_time_{};
+  std::chrono::duration<float> source_frame_interval_{0}; ///< average time between frames offered
+  std::chrono::steady_clock::time_point last_offered_frame_time_{};
+  mutable std::mutex stats_mutex_; ///< guards stats_ (which the RTCP receive updates) and pacing
+  Stats stats_;
+
+  size_t max_queued_frames_;
+  std::mutex queue_mutex_; ///< guards frame_queue_ and stop_sending_
+  std::condition_variable queue_cv_;
+  std::deque<std::shared_ptr<const PacketizedFrame>> frame_queue_;
+  bool stop_sending_{false};
+  // reused for each frame, so that sending does not allocate
+  std::vector<std::array<uint8_t, RTP_HEADER_SIZE>> rtp_headers_;
+  std::vector<std::array<std::string_view, 3>> send_buffers_;
+  std::vector<espp::UdpSocket::Datagram> send_packets_;
+
   std::unique_ptr<Task> control_task_;
+  std::unique_ptr<Task> send_task_;
 };
 } // namespace espp
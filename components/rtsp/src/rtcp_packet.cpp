@@ -1,7 +1,168 @@
 #include "rtcp_packet.hpp"
 
+#include <algorithm>
+
 using namespace espp;
 
 std::string_view RtcpPacket::get_data() const {
-  return std::string_view(reinterpret_cast<const char *>(m_buffer), m_bufferSize);
+  return std::string_view(reinterpret_cast<const char *>(buffer_.data()), buffer_.size());
+}
+
+std::string_view RtcpPacket::get_first_packet(std::string_view data) {
+  if (data.size() < HEADER_SIZE) {
+    return {};
+  }
+  auto bytes = reinterpret_cast<const uint8_t *>(data.data());
+  // version must be 2
+  if ((bytes[0] >> 6) != 2) {
+    return {};
+  }
+  // the length is in 32 bit words, minus one
+  size_t size = (((bytes[2] << 8) | bytes[3]) + 1) * 4;
+  if (size > data.size()) {
+    return {};
+  }
+  return data.substr(0, size);
+}
+
+int RtcpPacket::get_packet_type(std::string_view packet) {
+  if (packet.size() < HEADER_SIZE) {
+    return -1;
+  }
+  return static_cast<uint8_t>(packet[1]);
+}
+
+uint64_t RtcpPacket::to_ntp_timestamp(std::chrono::system_clock::time_point time) {
+  // seconds between the NTP epoch (1900) and the unix epoch (1970)
+  static constexpr uint64_t ntp_unix_offset = 2208988800ULL;
+  auto since_epoch = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch());
+  uint64_t seconds = since_epoch.count() / 1000000 + ntp_unix_offset;
+  uint64_t fraction = ((since_epoch.count() % 1000000) << 32) / 1000000;
+  return (seconds << 32) | fraction;
+}
+
+uint32_t RtcpPacket::to_compact_ntp(uint64_t ntp_timestamp) {
+  return static_cast<uint32_t>(ntp_timestamp >> 16);
+}
+
+void RtcpPacket::serialize_header(int count, int packet_type, size_t size) {
+  buffer_.resize(size);
+  size_t length = size / 4 - 1;
+  buffer_[0] = (2 << 6) | (count & 0x1F);
+  buffer_[1] = packet_type;
+  buffer_[2] = length >> 8;
+  buffer_[3] = length & 0xFF;
+}
+
+void RtcpPacket::serialize_report_block(uint8_t *data, const ReportBlock &block) {
+  write_u32(data, block.ssrc);
+  // the cumulative number lost is a 24 bit signed value
+  int32_t cumulative_lost = std::clamp<int32_t>(block.cumulative_lost, -0x800000, 0x7FFFFF);
+  write_u32(data + 4, (block.fraction_lost << 24) | (cumulative_lost & 0xFFFFFF));
+  write_u32(data + 8, block.highest_sequence);
+  write_u32(data + 12, block.jitter);
+  write_u32(data + 16, block.last_sender_report);
+  write_u32(data + 20, block.delay_since_last_sender_report);
+}
+
+RtcpPacket::ReportBlock RtcpPacket::parse_report_block(const uint8_t *data) {
+  ReportBlock block;
+  block.ssrc = read_u32(data);
+  uint32_t lost = read_u32(data + 4);
+  block.fraction_lost = lost >> 24;
+  // sign extend the 24 bit cumulative number lost
+  block.cumulative_lost = static_cast<int32_t>(lost << 8) >> 8;
+  block.highest_sequence = read_u32(data + 8);
+  block.jitter = read_u32(data + 12);
+  block.last_sender_report = read_u32(data + 16);
+  block.delay_since_last_sender_report = read_u32(data + 20);
+  return block;
+}
+
+void RtcpPacket::write_u32(uint8_t *data, uint32_t value) {
+  data[0] = value >> 24;
+  data[1] = (value >> 16) & 0xFF;
+  data[2] = (value >> 8) & 0xFF;
+  data[3] = value & 0xFF;
+}
+
+uint32_t RtcpPacket::read_u32(const uint8_t *data) {
+  return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) |
+         uint32_t(data[3]);
+}
+
+RtcpSenderReport::RtcpSenderReport(std::string_view data) {
+  auto packet = get_first_packet(data);
+  if (get_packet_type(packet) != SENDER_REPORT) {
+    return;
+  }
+  buffer_.assign(packet.begin(), packet.end());
+  size_t count = buffer_[0] & 0x1F;
+  if (buffer_.size() < HEADER_SIZE + 4 + SENDER_INFO_SIZE + count * REPORT_BLOCK_SIZE) {
+    return;
+  }
+  const uint8_t *bytes = buffer_.data() + HEADER_SIZE;
+  ssrc = read_u32(bytes);
+  ntp_timestamp = (uint64_t(read_u32(bytes + 4)) << 32) | read_u32(bytes + 8);
+  rtp_timestamp = read_u32(bytes + 12);
+  packet_count = read_u32(bytes + 16);
+  octet_count = read_u32(bytes + 20);
+  bytes += 4 + SENDER_INFO_SIZE;
+  for (size_t i = 0; i < count; i++) {
+    report_blocks.push_back(parse_report_block(bytes));
+    bytes += REPORT_BLOCK_SIZE;
+  }
+  valid_ = true;
+}
+
+void RtcpSenderReport::serialize() {
+  size_t count = std::min<size_t>(report_blocks.size(), 31);
+  serialize_header(count, SENDER_REPORT,
+                   HEADER_SIZE + 4 + SENDER_INFO_SIZE + count * REPORT_BLOCK_SIZE);
+  uint8_t *bytes = buffer_.data() + HEADER_SIZE;
+  write_u32(bytes, ssrc);
+  write_u32(bytes + 4, ntp_timestamp >> 32);
+  write_u32(bytes + 8, ntp_timestamp & 0xFFFFFFFF);
+  write_u32(bytes + 12, rtp_timestamp);
+  write_u32(bytes + 16, packet_count);
+  write_u32(bytes + 20, octet_count);
+  bytes += 4 + SENDER_INFO_SIZE;
+  for (size_t i = 0; i < count; i++) {
+    serialize_report_block(bytes, report_blocks[i]);
+    bytes += REPORT_BLOCK_SIZE;
+  }
+  valid_ = true;
+}
+
+RtcpReceiverReport::RtcpReceiverReport(std::string_view data) {
+  auto packet = get_first_packet(data);
+  if (get_packet_type(packet) != RECEIVER_REPORT) {
+    return;
+  }
+  buffer_.assign(packet.begin(), packet.end());
+  size_t count = buffer_[0] & 0x1F;
+  if (buffer_.size() < HEADER_SIZE + 4 + count * REPORT_BLOCK_SIZE) {
+    return;
+  }
+  const uint8_t *bytes = buffer_.data() + HEADER_SIZE;
+  ssrc = read_u32(bytes);
+  bytes += 4;
+  for (size_t i = 0; i < count; i++) {
+    report_blocks.push_back(parse_report_block(bytes));
+    bytes += REPORT_BLOCK_SIZE;
+  }
+  valid_ = true;
+}
+
+void RtcpReceiverReport::serialize() {
+  size_t count = std::min<size_t>(report_blocks.size(), 31);
+  serialize_header(count, RECEIVER_REPORT, HEADER_SIZE + 4 + count * REPORT_BLOCK_SIZE);
+  uint8_t *bytes = buffer_.data() + HEADER_SIZE;
+  write_u32(bytes, ssrc);
+  bytes += 4;
+  for (size_t i = 0; i < count; i++) {
+    serialize_report_block(bytes, report_blocks[i]);
+    bytes += REPORT_BLOCK_SIZE;
+  }
+  valid_ = true;
 }
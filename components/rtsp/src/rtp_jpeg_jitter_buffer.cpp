@@ -0,0 +1,248 @@
+#include "rtp_jpeg_jitter_buffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace espp;
+
+RtpJpegJitterBuffer::RtpJpegJitterBuffer(const RtpJpegJitterBuffer::Config &config)
+    : BaseComponent("RtpJpegJitterBuffer", config.log_level)
+    , config_(config) {
+  // preallocate the frames, so that reassembly does not reallocate
+  frames_.resize(std::max<size_t>(1, config.max_frames));
+  for (auto &frame : frames_) {
+    frame.scan_data.reserve(config.frame_capacity);
+    frame.fragments.reserve(config.frame_capacity / 1024 + 1);
+  }
+}
+
+void RtpJpegJitterBuffer::add_packet(const RtpJpegPacket &packet) {
+  std::unique_ptr<JpegFrame> jpeg_frame;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = clock::now();
+    stats_.packets_received++;
+    bool is_reordered = update_sequence(packet.get_sequence_number());
+    uint32_t timestamp = packet.get_timestamp();
+    update_jitter(timestamp, now);
+    stats_.ssrc = packet.get_ssrc();
+    drop_expired_frames(now);
+    if (has_released_ && !is_newer(timestamp, last_released_timestamp_)) {
+      // the frame was already delivered or dropped
+      logger_.debug("Late packet {} for frame {}", packet.get_sequence_number(), timestamp);
+      unique_received_++;
+      stats_.packets_late++;
+      return;
+    }
+    auto &frame = get_frame(timestamp, now);
+    if (is_duplicate(frame, packet.get_offset())) {
+      stats_.packets_duplicated++;
+      return;
+    }
+    unique_received_++;
+    if (is_reordered) {
+      stats_.packets_reordered++;
+    }
+    if (!place_fragment(frame, packet)) {
+      stats_.packets_invalid++;
+      return;
+    }
+    if (frame.has_first && frame.has_last && frame.received_bytes == frame.size) {
+      jpeg_frame = complete_frame(frame);
+    }
+  }
+  // call the callback without holding the lock, so it can get the stats
+  if (jpeg_frame && config_.on_jpeg_frame) {
+    config_.on_jpeg_frame(std::move(jpeg_frame));
+  }
+}
+
+void RtpJpegJitterBuffer::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &frame : frames_) {
+    frame.in_use = false;
+  }
+  has_released_ = false;
+  has_sequence_ = false;
+  unique_received_ = 0;
+  has_transit_ = false;
+  jitter_ = 0;
+  stats_ = {};
+}
+
+RtpJpegJitterBuffer::Stats RtpJpegJitterBuffer::get_stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats stats = stats_;
+  if (has_sequence_) {
+    int64_t expected = max_sequence_ - base_sequence_ + 1;
+    stats.packets_lost = expected > unique_received_ ? expected - unique_received_ : 0;
+    stats.packets_expected = expected;
+    stats.highest_sequence = max_sequence_;
+  }
+  stats.jitter = jitter_;
+  return stats;
+}
+
+RtpJpegJitterBuffer::Frame &RtpJpegJitterBuffer::get_frame(uint32_t timestamp,
+                                                           clock::time_point now) {
+  Frame *free_frame = nullptr;
+  Frame *oldest_frame = nullptr;
+  for (auto &frame : frames_) {
+    if (!frame.in_use) {
+      free_frame = free_frame ? free_frame : &frame;
+      continue;
+    }
+    if (frame.timestamp == timestamp) {
+      return frame;
+    }
+    if (!oldest_frame || is_newer(oldest_frame->timestamp, frame.timestamp)) {
+      oldest_frame = &frame;
+    }
+  }
+  if (!free_frame) {
+    // all the frames are in use, so give up on the oldest one
+    drop_frame(*oldest_frame);
+    free_frame = oldest_frame;
+  }
+  auto &frame = *free_frame;
+  frame.in_use = true;
+  frame.timestamp = timestamp;
+  frame.first_arrival = now;
+  frame.has_first = false;
+  frame.has_last = false;
+  frame.size = 0;
+  frame.received_bytes = 0;
+  // clearing keeps the capacity, so the buffers are not reallocated
+  frame.scan_data.clear();
+  frame.fragments.clear();
+  return frame;
+}
+
+bool RtpJpegJitterBuffer::update_sequence(uint16_t sequence_number) {
+  if (!has_sequence_) {
+    has_sequence_ = true;
+    base_sequence_ = sequence_number;
+    max_sequence_ = sequence_number;
+    return false;
+  }
+  // the difference from the highest sequence number so far, accounting for
+  // wrap around
+  auto delta = static_cast<int16_t>(sequence_number - static_cast<uint16_t>(max_sequence_));
+  if (delta > 0) {
+    max_sequence_ += delta;
+  }
+  return delta < 0;
+}
+
+void RtpJpegJitterBuffer::update_jitter(uint32_t timestamp, clock::time_point now) {
+  // the transit time of the packet, relative to an arbitrary offset, in RTP
+  // timestamp units (RFC 3550 A.8)
+  auto arrival = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch());
+  int64_t transit = arrival.count() * CLOCK_RATE / 1000000 - timestamp;
+  if (has_transit_) {
+    // the timestamps are only 32 bits, so the difference must be as well
+    auto delta = static_cast<int32_t>(transit - last_transit_);
+    jitter_ += (std::abs((float)delta) - jitter_) / 16.0f;
+  }
+  has_transit_ = true;
+  last_transit_ = transit;
+}
+
+bool RtpJpegJitterBuffer::is_duplicate(const Frame &frame, uint32_t offset) {
+  return std::any_of(frame.fragments.begin(), frame.fragments.end(),
+                     [offset](const auto &fragment) { return fragment.first == offset; });
+}
+
+bool RtpJpegJitterBuffer::place_fragment(Frame &frame, const RtpJpegPacket &packet) {
+  uint32_t offset = packet.get_offset();
+  auto jpeg_data = packet.get_jpeg_data();
+  size_t end = offset + jpeg_data.size();
+  if (end > config_.max_frame_size || (frame.has_last && end > frame.size)) {
+    logger_.warn("Fragment at {} of size {} does not fit in frame {}", offset, jpeg_data.size(),
+                 frame.timestamp);
+    return false;
+  }
+  if (offset == 0) {
+    // the first packet carries the quantization tables, unless they are the
+    // same as in a previous frame
+    if (packet.get_num_q_tables() == 2 && packet.get_q_table(0).size() == q0_table_.size() &&
+        packet.get_q_table(1).size() == q1_table_.size()) {
+      memcpy(q0_table_.data(), packet.get_q_table(0).data(), q0_table_.size());
+      memcpy(q1_table_.data(), packet.get_q_table(1).data(), q1_table_.size());
+      has_q_tables_ = true;
+    }
+    if (!has_q_tables_) {
+      logger_.warn("First fragment of frame {} has no quantization tables", frame.timestamp);
+      return false;
+    }
+    frame.q0_table = q0_table_;
+    frame.q1_table = q1_table_;
+    frame.has_first = true;
+  }
+  if (packet.get_marker()) {
+    if (end < frame.scan_data.size()) {
+      logger_.warn("Last fragment of frame {} ends before other fragments", frame.timestamp);
+      return false;
+    }
+    frame.has_last = true;
+    frame.size = end;
+  }
+  frame.width = packet.get_width();
+  frame.height = packet.get_height();
+  // place the fragment at its offset, so the order of arrival doesn't matter
+  if (frame.scan_data.size() < end) {
+    frame.scan_data.resize(end);
+  }
+  memcpy(frame.scan_data.data() + offset, jpeg_data.data(), jpeg_data.size());
+  frame.fragments.emplace_back(offset, jpeg_data.size());
+  frame.received_bytes += jpeg_data.size();
+  return true;
+}
+
+std::unique_ptr<JpegFrame> RtpJpegJitterBuffer::complete_frame(Frame &frame) {
+  // frames are delivered in order, so older frames which are still
+  // incomplete can no longer be delivered
+  for (auto &other : frames_) {
+    if (other.in_use && &other != &frame && is_newer(frame.timestamp, other.timestamp)) {
+      drop_frame(other);
+    }
+  }
+  logger_.debug("Completed frame {} of {} B in {} fragments", frame.timestamp, frame.size,
+                frame.fragments.size());
+  auto jpeg_frame = std::make_unique<JpegFrame>(
+      frame.width, frame.height, std::string_view(frame.q0_table.data(), frame.q0_table.size()),
+      std::string_view(frame.q1_table.data(), frame.q1_table.size()),
+      std::string_view((const char *)frame.scan_data.data(), frame.size));
+  stats_.frames_completed++;
+  release_frame(frame);
+  return jpeg_frame;
+}
+
+void RtpJpegJitterBuffer::drop_frame(Frame &frame) {
+  logger_.debug("Dropping incomplete frame {} ({} of {} B received)", frame.timestamp,
+                frame.received_bytes, frame.has_last ? frame.size : 0);
+  stats_.frames_dropped++;
+  release_frame(frame);
+}
+
+void RtpJpegJitterBuffer::release_frame(Frame &frame) {
+  frame.in_use = false;
+  if (!has_released_ || is_newer(frame.timestamp, last_released_timestamp_)) {
+    has_released_ = true;
+    last_released_timestamp_ = frame.timestamp;
+  }
+}
+
+void RtpJpegJitterBuffer::drop_expired_frames(clock::time_point now) {
+  for (auto &frame : frames_) {
+    if (frame.in_use && now - frame.first_arrival > config_.max_latency) {
+      drop_frame(frame);
+    }
+  }
+}
+
+bool RtpJpegJitterBuffer::is_newer(uint32_t timestamp, uint32_t other) {
+  // compare the timestamps accounting for wrap around
+  return static_cast<int32_t>(timestamp - other) > 0;
+}
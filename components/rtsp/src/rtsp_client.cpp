@@ -6,12 +6,34 @@ RtspClient::RtspClient(const Config &config)
     : BaseComponent("RtspClient", config.log_level)
     , server_address_(config.server_address)
     , rtsp_port_(config.rtsp_port)
+    , on_jpeg_frame_(config.on_jpeg_frame)
+    , jitter_buffer_({
+          .max_latency = config.jitter_buffer_latency,
+          .max_frames = config.max_pending_frames,
+          .on_jpeg_frame =
+              [this](std::unique_ptr<JpegFrame> jpeg_frame) {
+                logger_.debug("Received jpeg frame of size: {} B", jpeg_frame->get_data().size());
+                if (on_jpeg_frame_) {
+                  on_jpeg_frame_(std::move(jpeg_frame));
+                }
+              },
+          .log_level = config.log_level,
+      })
     , rtsp_socket_({.log_level = espp::Logger::Verbosity::WARN})
     , rtp_socket_({.log_level = espp::Logger::Verbosity::WARN})
     , rtcp_socket_({.log_level = espp::Logger::Verbosity::WARN})
-    , on_jpeg_frame_(config.on_jpeg_frame)
     , cseq_(0)
-    , path_("rtsp://" + server_address_ + ":" + std::to_string(rtsp_port_) + config.path) {}
+    , path_("rtsp://" + server_address_ + ":" + std::to_string(rtsp_port_) + config.path) {
+  // generate a random ssrc
+#if defined(ESP_PLATFORM)
+  ssrc_ = esp_random();
+#else
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<uint32_t> dis;
+  ssrc_ = dis(gen);
+#endif
+}
 
 RtspClient::~RtspClient() {
   std::error_code ec;
@@ -174,6 +196,12 @@ void RtspClient::setup(size_t rtp_port, size_t rtcp_port,
     return;
   }
 
+  // start from a clean slate, since the sequence numbers and timestamps of
+  // the new stream are unrelated to any previous one
+  jitter_buffer_.reset();
+  expected_prior_ = 0;
+  received_prior_ = 0;
+  last_sender_report_ = 0;
   init_rtp(rtp_port, receive_timeout, ec);
   init_rtcp(rtcp_port, receive_timeout, ec);
 }
@@ -205,6 +233,8 @@ void RtspClient::teardown(std::error_code &ec) {
   send_request("TEARDOWN", path_, {}, ec);
 }
 
+RtpJpegJitterBuffer::Stats RtspClient::get_rtp_stats() const { return jitter_buffer_.get_stats(); }
+
 bool RtspClient::parse_response(const std::string &response_data, std::error_code &ec) {
   // exit early if the error code is set
   if (ec) {
@@ -258,8 +288,8 @@ void RtspClient::init_rtp(size_t rtp_port, const std::chrono::duration<float> &r
   auto rtp_config = espp::UdpSocket::ReceiveConfig{
       .port = rtp_port,
       .buffer_size = 2 * 1024,
-      .on_receive_callback = std::bind(&RtspClient::handle_rtp_packet, this, std::placeholders::_1,
-                                       std::placeholders::_2),
+      .on_receive_span_callback = std::bind(&RtspClient::handle_rtp_packet, this,
+                                            std::placeholders::_1, std::placeholders::_2),
   };
   if (!rtp_socket_.start_receiving(rtp_task_config, rtp_config)) {
     ec = std::make_error_code(std::errc::operation_canceled);
@@ -293,61 +323,81 @@ void RtspClient::init_rtcp(size_t rtcp_port, const std::chrono::duration<float>
   }
 }
 
-std::optional<std::vector<uint8_t>>
-RtspClient::handle_rtp_packet(std::vector<uint8_t> &data, const espp::Socket::Info &sender_info) {
-  // jpeg frame that we are building
-  static std::unique_ptr<JpegFrame> jpeg_frame;
-
+void RtspClient::handle_rtp_packet(std::span<const uint8_t> data,
+                                   [[maybe_unused]] const espp::Socket::Info &sender_info) {
   logger_.debug("Got RTP packet of size: {}", data.size());
-
-  std::string_view packet(reinterpret_cast<char *>(data.data()), data.size());
+  std::string_view packet(reinterpret_cast<const char *>(data.data()), data.size());
   // parse the rtp packet
   RtpJpegPacket rtp_jpeg_packet(packet);
-  auto frag_offset = rtp_jpeg_packet.get_offset();
-  if (frag_offset == 0) {
-    // first fragment
-    logger_.debug("Received first fragment, size: {}, sequence number: {}",
-                  rtp_jpeg_packet.get_data().size(), rtp_jpeg_packet.get_sequence_number());
-    if (jpeg_frame) {
-      // we already have a frame, this is an error
-      logger_.warn("Received first fragment but already have a frame");
-      jpeg_frame.reset();
-    }
-    jpeg_frame = std::make_unique<JpegFrame>(rtp_jpeg_packet);
-  } else if (jpeg_frame) {
-    logger_.debug("Received middle fragment, size: {}, sequence number: {}",
-                  rtp_jpeg_packet.get_data().size(), rtp_jpeg_packet.get_sequence_number());
-    // middle fragment
-    jpeg_frame->append(rtp_jpeg_packet);
-  } else {
-    // we don't have a frame to append to but we got a middle fragment
-    // this is an error
-    logger_.warn("Received middle fragment without a frame");
-    return {};
-  }
+  logger_.debug("Received fragment at offset {}, size: {}, sequence number: {}",
+                rtp_jpeg_packet.get_offset(), rtp_jpeg_packet.get_data().size(),
+                rtp_jpeg_packet.get_sequence_number());
+  // the jitter buffer calls on_jpeg_frame_ if this completes a frame
+  jitter_buffer_.add_packet(rtp_jpeg_packet);
+}
 
-  // check if this is the last packet of the frame (the last packet will have
-  // the marker bit set)
-  if (jpeg_frame && jpeg_frame->is_complete()) {
-    // get the jpeg data
-    auto jpeg_data = jpeg_frame->get_data();
-    logger_.debug("Received jpeg frame of size: {} B", jpeg_data.size());
-    // call the on_jpeg_frame callback
-    if (on_jpeg_frame_) {
-      on_jpeg_frame_(std::move(jpeg_frame));
+std::optional<std::vector<uint8_t>>
+RtspClient::handle_rtcp_packet(std::vector<uint8_t> &data, const espp::Socket::Info &sender_info) {
+  std::string_view remaining(reinterpret_cast<char *>(data.data()), data.size());
+  bool got_sender_report = false;
+  // a compound packet may contain several RTCP packets, e.g. a sender report
+  // and a source description
+  while (!remaining.empty()) {
+    auto packet = RtcpPacket::get_first_packet(remaining);
+    if (packet.empty()) {
+      logger_.warn("Invalid RTCP packet from {}", sender_info);
+      break;
+    }
+    remaining.remove_prefix(packet.size());
+    if (RtcpPacket::get_packet_type(packet) != RtcpPacket::SENDER_REPORT) {
+      continue;
     }
-    logger_.debug("Sent jpeg frame to callback, now jpeg_frame is nullptr? {}",
-                  jpeg_frame == nullptr);
+    RtcpSenderReport report(packet);
+    if (!report.is_valid()) {
+      logger_.warn("Invalid RTCP sender report from {}", sender_info);
+      continue;
+    }
+    logger_.debug("Sender report: {} packets, {} B sent", report.packet_count, report.octet_count);
+    last_sender_report_ = RtcpPacket::to_compact_ntp(report.ntp_timestamp);
+    last_sender_report_time_ = std::chrono::steady_clock::now();
+    got_sender_report = true;
   }
-  // return an empty vector to indicate that we don't want to send a response
-  return {};
+  if (!got_sender_report) {
+    // return an empty optional to indicate that we don't want to send a response
+    return {};
+  }
+  // respond with a receiver report, sent back to the port the sender report
+  // came from
+  auto report = make_receiver_report();
+  auto report_data = report.get_data();
+  return std::vector<uint8_t>(report_data.begin(), report_data.end());
 }
 
-std::optional<std::vector<uint8_t>>
-RtspClient::handle_rtcp_packet(std::vector<uint8_t> &data, const espp::Socket::Info &sender_info) {
-  // receive the rtcp packet
-  [[maybe_unused]] std::string_view packet(reinterpret_cast<char *>(data.data()), data.size());
-  // TODO: parse the rtcp packet
-  // return an empty vector to indicate that we don't want to send a response
-  return {};
+RtcpReceiverReport RtspClient::make_receiver_report() {
+  auto stats = jitter_buffer_.get_stats();
+  RtcpPacket::ReportBlock block;
+  block.ssrc = stats.ssrc;
+  block.cumulative_lost = stats.packets_lost;
+  block.highest_sequence = stats.highest_sequence;
+  block.jitter = stats.jitter;
+  // the fraction of packets lost since the last report (RFC 3550 A.3)
+  uint32_t received = stats.packets_expected - stats.packets_lost;
+  uint32_t expected_interval = stats.packets_expected - expected_prior_;
+  uint32_t received_interval = received - received_prior_;
+  expected_prior_ = stats.packets_expected;
+  received_prior_ = received;
+  if (expected_interval > 0 && expected_interval > received_interval) {
+    block.fraction_lost = ((expected_interval - received_interval) << 8) / expected_interval;
+  }
+  if (last_sender_report_time_ != std::chrono::steady_clock::time_point{}) {
+    // the delay since the last sender report, in 1/65536 s
+    std::chrono::duration<float> delay = std::chrono::steady_clock::now() - last_sender_report_time_;
+    block.last_sender_report = last_sender_report_;
+    block.delay_since_last_sender_report = delay.count() * 65536.0f;
+  }
+  RtcpReceiverReport report;
+  report.ssrc = ssrc_;
+  report.report_blocks.push_back(block);
+  report.serialize();
+  return report;
 }
@@ -1,5 +1,8 @@
 #include "rtsp_server.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 using namespace espp;
 
 RtspServer::RtspServer(const Config &config)
@@ -8,7 +11,12 @@ RtspServer::RtspServer(const Config &config)
     , port_(config.port)
     , path_(config.path)
     , rtsp_socket_({.log_level = espp::Logger::Verbosity::WARN})
-    , max_data_size_(config.max_data_size) {
+    , max_data_size_(std::max<size_t>(1, config.max_data_size))
+    , rtcp_interval_(config.rtcp_interval)
+    , adaptive_pacing_(config.adaptive_pacing)
+    , max_frame_interval_(config.max_frame_interval)
+    , max_queued_frames_(std::max<size_t>(1, config.max_queued_frames))
+    , start_time_(std::chrono::steady_clock::now()) {
   // generate a random ssrc
 #if defined(ESP_PLATFORM)
   ssrc_ = esp_random();
@@ -49,6 +57,12 @@ bool RtspServer::start(const std::chrono::duration<float> &accept_timeout) {
     return false;
   }
 
+  // one task receives the RTCP packets of all the sessions
+  socket_reactor_ = SocketReactor::make_shared({
+      .name = "RtspRtcp",
+      .log_level = espp::Logger::Verbosity::WARN,
+  });
+
   using namespace std::placeholders;
   accept_task_ = std::make_unique<Task>(Task::Config{
       .callback = std::bind(&RtspServer::accept_task_function, this, _1, _2, _3),
@@ -69,101 +83,154 @@ void RtspServer::stop() {
   if (accept_task_) {
     accept_task_->stop();
   }
-  // stop the session task
-  if (session_task_) {
-    session_task_->stop();
+  // clear the list of sessions, which stops their tasks
+  {
+    std::lock_guard<std::mutex> lk(session_mutex_);
+    sessions_.clear();
   }
-  // clear the list of sessions
-  sessions_.clear();
+  socket_reactor_.reset();
   // close the RTSP socket
   rtsp_socket_.close();
 }
 
 void RtspServer::send_frame(const espp::JpegFrame &frame) {
-  // get the frame scan data
-  auto frame_header = frame.get_header();
-  auto frame_data = frame.get_scan_data();
-
-  auto width = frame_header.get_width();
-  auto height = frame_header.get_height();
-  auto q0 = frame_header.get_quantization_table(0);
-  auto q1 = frame_header.get_quantization_table(1);
-
-  // if the frame data is larger than the MTU, then we need to break it up
-  // into multiple RTP packets
-  size_t num_packets = frame_data.size() / max_data_size_ + 1;
-  logger_.debug("Frame data is {} bytes, breaking into {} packets", frame_data.size(), num_packets);
-
-  // create num_packets RtpJpegPackets
-  // The first packet will have the quantization tables, and the last packet
-  // will have the end of image marker and the marker bit set
-  std::vector<std::unique_ptr<RtpJpegPacket>> packets;
-  packets.reserve(num_packets);
-  for (size_t i = 0; i < num_packets; i++) {
-    // get the start and end indices for the current packet
-    size_t start_index = i * max_data_size_;
-    size_t end_index = std::min<size_t>(start_index + max_data_size_, frame_data.size());
+  std::lock_guard<std::mutex> lock(staging_mutex_);
+  // copy the scan data into the reused buffer, since the frame may not
+  // outlive this call
+  auto packetized_frame = acquire_frame();
+  auto scan_data = frame.get_scan_data();
+  packetized_frame->scan_data_copy.assign(scan_data.begin(), scan_data.end());
+  packetize(*packetized_frame, frame.get_header());
+  enqueue_frame(std::move(packetized_frame));
+}
 
-    static const int type_specific = 0;
-    static const int fragment_type = 0;
-    int offset = i * max_data_size_;
+void RtspServer::send_frame(std::shared_ptr<const espp::JpegFrame> frame) {
+  if (!frame) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(staging_mutex_);
+  // keep a reference to the frame, so the payloads can be sent from it
+  auto packetized_frame = acquire_frame();
+  packetized_frame->frame = std::move(frame);
+  packetized_frame->scan_data_copy.clear();
+  packetize(*packetized_frame, packetized_frame->frame->get_header());
+  enqueue_frame(std::move(packetized_frame));
+}
 
-    std::unique_ptr<RtpJpegPacket> packet;
-    // if this is the first packet, it has the quantization tables
-    if (i == 0) {
-      // use the original q value and include the quantization tables
-      packet = std::make_unique<espp::RtpJpegPacket>(
-          type_specific, fragment_type, 128, width, height, q0, q1,
-          frame_data.substr(start_index, end_index - start_index));
-    } else {
-      // use a different q value (less than 128) and don't include the
-      // quantization tables
-      packet = std::make_unique<espp::RtpJpegPacket>(
-          type_specific, offset, fragment_type, 96, width, height,
-          frame_data.substr(start_index, end_index - start_index));
+std::shared_ptr<RtspServer::PacketizedFrame> RtspServer::acquire_frame() {
+  // frames which no session uses any more have been sent (or dropped), so
+  // release the frames they shared and reuse the first of them, so that
+  // packetizing does not allocate once the pool has grown. The sessions say
+  // when they are done with a frame, rather than the pool relying on the
+  // frame's use_count(), which is not synchronized with the sessions.
+  std::shared_ptr<PacketizedFrame> free_frame;
+  for (auto &packetized_frame : frame_pool_) {
+    if (packetized_frame->is_in_use()) {
+      continue;
+    }
+    packetized_frame->frame.reset();
+    if (!free_frame) {
+      free_frame = packetized_frame;
     }
+  }
+  if (!free_frame) {
+    free_frame = frame_pool_.emplace_back(std::make_shared<PacketizedFrame>());
+  }
+  return free_frame;
+}
 
-    // set the payload type to 26 (JPEG)
-    packet->set_payload_type(26);
-    // set the sequence number
-    packet->set_sequence_number(sequence_number_++);
-    // set the timestamp
-    static auto start_time = std::chrono::steady_clock::now();
-    auto now = std::chrono::steady_clock::now();
-    auto timestamp =
-        std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
-    packet->set_timestamp(timestamp * 90);
+void RtspServer::packetize(PacketizedFrame &packetized_frame, const JpegHeader &header) {
+  auto frame_data = packetized_frame.get_scan_data();
 
-    // set the ssrc
-    packet->set_ssrc(ssrc_);
+  auto width = header.get_width();
+  auto height = header.get_height();
+  auto q0 = header.get_quantization_table(0);
+  auto q1 = header.get_quantization_table(1);
 
-    // auto mjpeg_header = packet->get_mjpeg_header();
-    // std::vector<char> mjpeg_vec(mjpeg_header.begin(), mjpeg_header.end());
+  // if the frame data is larger than the MTU, then we need to break it up
+  // into multiple RTP packets
+  size_t num_packets =
+      std::max<size_t>(1, (frame_data.size() + max_data_size_ - 1) / max_data_size_);
+  logger_.debug("Frame data is {} bytes, breaking into {} packets", frame_data.size(), num_packets);
 
-    // if it's the last packet, set the marker bit
-    if (i == num_packets - 1) {
-      packet->set_marker(true);
-    }
+  // all the packets of the frame have the same timestamp
+  packetized_frame.time = std::chrono::steady_clock::now();
+  packetized_frame.timestamp = get_rtp_timestamp(packetized_frame.time);
 
-    // make sure the packet header has been serialized
-    packet->serialize();
+  // build only the RTP/JPEG headers of the packets, each session adds the RTP
+  // header with its own sequence numbers. The first packet has the
+  // quantization tables
+  packetized_frame.packets.resize(num_packets);
+  for (size_t i = 0; i < num_packets; i++) {
+    auto &packet = packetized_frame.packets[i];
+    packet.payload_offset = i * max_data_size_;
+    packet.payload_size =
+        std::min<size_t>(max_data_size_, frame_data.size() - packet.payload_offset);
+
+    bool is_first = i == 0;
+    uint8_t *data = packet.data.data();
+    size_t size = 0;
+
+    // RTP/JPEG header (RFC 2435). The first packet uses the original q value
+    // and includes the quantization tables, the others use a q value less
+    // than 128 and don't include them
+    static constexpr int type_specific = 0;
+    static constexpr int fragment_type = 0;
+    uint32_t offset = packet.payload_offset;
+    data[size++] = type_specific;
+    data[size++] = (offset >> 16) & 0xff;
+    data[size++] = (offset >> 8) & 0xff;
+    data[size++] = offset & 0xff;
+    data[size++] = fragment_type;
+    data[size++] = is_first ? 128 : 96;
+    data[size++] = width / 8;
+    data[size++] = height / 8;
+    if (is_first) {
+      // quantization table header: MBZ, precision, length
+      data[size++] = 0;
+      data[size++] = 0;
+      data[size++] = 0;
+      data[size++] = 2 * 64;
+      std::memcpy(data + size, q0.data(), std::min<size_t>(q0.size(), 64));
+      size += 64;
+      std::memcpy(data + size, q1.data(), std::min<size_t>(q1.size(), 64));
+      size += 64;
+    }
+    packet.size = size;
+  }
+}
 
-    // add the packet to the list of packets
-    packets.emplace_back(std::move(packet));
+void RtspServer::enqueue_frame(std::shared_ptr<const PacketizedFrame> frame) {
+  logger_.debug("Queueing frame for clients");
+  // queueing does not wait for the network, so a slow client can't hold up
+  // the others
+  std::lock_guard<std::mutex> lk(session_mutex_);
+  for (auto &[session_id, session] : sessions_) {
+    session->enqueue_frame(frame);
   }
+}
 
-  // now move the packets into the rtp_packets_ vector
-  {
-    std::unique_lock<std::mutex> lock(rtp_packets_mutex_);
-    // move the new packets into the list
-    rtp_packets_ = std::move(packets);
+uint32_t RtspServer::get_rtp_timestamp(std::chrono::steady_clock::time_point time) const {
+  // RTP/JPEG uses a 90 kHz clock
+  return std::chrono::duration_cast<std::chrono::milliseconds>(time - start_time_).count() * 90;
+}
+
+std::unordered_map<uint32_t, RtspSession::Stats> RtspServer::get_session_stats() {
+  std::unordered_map<uint32_t, RtspSession::Stats> stats;
+  std::lock_guard<std::mutex> lk(session_mutex_);
+  for (const auto &[session_id, session] : sessions_) {
+    stats[session_id] = session->get_stats();
   }
+  return stats;
 }
 
 bool RtspServer::accept_task_function(std::mutex &m, std::condition_variable &cv,
                                       bool &task_notified) {
   // accept a new connection
   auto control_socket = rtsp_socket_.accept();
+  // accept times out periodically, so this also cleans up sessions which
+  // closed while no client was connecting
+  remove_closed_sessions();
   if (!control_socket) {
     logger_.info("Failed to accept new connection");
     // if we were notified, then we should stop the task
@@ -182,89 +249,39 @@ bool RtspServer::accept_task_function(std::mutex &m, std::condition_variable &cv
       std::move(control_socket),
       RtspSession::Config{.server_address = fmt::format("{}:{}", server_address_, port_),
                           .rtsp_path = path_,
+                          .ssrc = ssrc_,
+                          .rtcp_interval = rtcp_interval_,
+                          .adaptive_pacing = adaptive_pacing_,
+                          .max_frame_interval = max_frame_interval_,
+                          .max_queued_frames = max_queued_frames_,
+                          .socket_reactor = socket_reactor_,
                           .log_level = session_log_level_});
 
   // add the session to the list of sessions
   auto session_id = session->get_session_id();
-  sessions_.emplace(session_id, std::move(session));
-
-  // start the session task if it is not already running
-  using namespace std::placeholders;
-  if (!session_task_ || !session_task_->is_started()) {
-    logger_.info("Starting session task");
-    session_task_ = std::make_unique<Task>(Task::Config{
-        .callback = std::bind(&RtspServer::session_task_function, this, _1, _2, _3),
-        .task_config =
-            {
-                .name = "RtspSessionTask",
-                .stack_size_bytes = 6 * 1024,
-            },
-        .log_level = espp::Logger::Verbosity::WARN,
-    });
-    session_task_->start();
+  {
+    std::lock_guard<std::mutex> lk(session_mutex_);
+    sessions_.emplace(session_id, std::move(session));
   }
   // we do not want to stop the task
   return task_notified;
 }
 
-bool RtspServer::session_task_function(std::mutex &m, std::condition_variable &cv,
-                                       bool &task_notified) {
-  // sleep between frames
+void RtspServer::remove_closed_sessions() {
+  // take the closed sessions out of the list, and destroy them (which waits
+  // for their tasks to stop) without holding the lock, so frames can still be
+  // queued for the other sessions
+  std::vector<std::unique_ptr<RtspSession>> closed_sessions;
   {
-    using namespace std::chrono_literals;
-    std::unique_lock<std::mutex> lk(m);
-    auto stop_requested = cv.wait_for(lk, 10ms, [&task_notified] { return task_notified; });
-    task_notified = false;
-    if (stop_requested) {
-      return true;
-    }
-  }
-
-  // when this function returns, the vector of pointers will go out of scope
-  // and the pointers will be deleted (which is good because it means we
-  // won't send the same frame twice)
-  std::vector<std::unique_ptr<RtpJpegPacket>> packets;
-  {
-    // copy the rtp packets into a local vector
-    std::unique_lock<std::mutex> lock(rtp_packets_mutex_);
-    if (rtp_packets_.empty()) {
-      // if there is not a new frame (no packets), then simply return
-      // we do not want to stop the task
-      return false;
-    }
-    // move the packets into the local vector
-    packets = std::move(rtp_packets_);
-  }
-
-  logger_.debug("Sending frame data to clients");
-
-  // for each session in sessions_
-  // if the session is active
-  // send the latest frame to the client
-  std::lock_guard<std::mutex> lk(session_mutex_);
-  for (auto &session : sessions_) {
-    [[maybe_unused]] auto session_id = session.first;
-    auto &session_ptr = session.second;
-    // send the packets to the client
-    for (auto &packet : packets) {
-      // if the session is not active or is closed, then stop sending
-      if (!session_ptr->is_active() || session_ptr->is_closed()) {
-        break;
+    std::lock_guard<std::mutex> lk(session_mutex_);
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+      if (it->second->is_closed()) {
+        logger_.info("Removing session {}", it->first);
+        closed_sessions.push_back(std::move(it->second));
+        it = sessions_.erase(it);
+      } else {
+        ++it;
       }
-      session_ptr->send_rtp_packet(*packet);
-    }
-  }
-  // loop over the sessions and erase ones which are closed
-  for (auto it = sessions_.begin(); it != sessions_.end();) {
-    auto &session = it->second;
-    if (session->is_closed()) {
-      logger_.info("Removing session {}", session->get_session_id());
-      it = sessions_.erase(it);
-    } else {
-      ++it;
     }
   }
-
-  // we do not want to stop the task
-  return false;
 }
@@ -10,7 +10,15 @@ RtspSession::RtspSession(std::unique_ptr<TcpSocket> control_socket, const Config
     , session_id_(generate_session_id())
     , server_address_(config.server_address)
     , rtsp_path_(config.rtsp_path)
-    , client_address_(control_socket_->get_remote_info().address) {
+    , client_address_(control_socket_->get_remote_info().address)
+    , ssrc_(config.ssrc)
+    , rtcp_interval_(config.rtcp_interval)
+    , adaptive_pacing_(config.adaptive_pacing)
+    , max_frame_interval_(config.max_frame_interval)
+    , socket_reactor_(config.socket_reactor)
+    // start the sequence numbers at a random value, as RFC 3550 recommends
+    , rtp_sequence_number_(generate_session_id() & 0xFFFF)
+    , max_queued_frames_(std::max<size_t>(1, config.max_queued_frames)) {
   // set the logger tag to include the session id
   logger_.set_tag("RtspSession " + std::to_string(session_id_));
   // ensure there is a timeout on the control socket receive
@@ -27,10 +35,42 @@ RtspSession::RtspSession(std::unique_ptr<TcpSocket> control_socket, const Config
       .log_level = Logger::Verbosity::WARN,
   });
   control_task_->start();
+  // start the send task, which sends the frames queued for the client
+  send_task_ = std::make_unique<Task>(Task::Config{
+      .callback = std::bind(&RtspSession::send_task_fn, this, _1, _2, _3),
+      .task_config =
+          {
+              .name = "RtspSend " + std::to_string(session_id_),
+              .stack_size_bytes = 6 * 1024,
+          },
+      .log_level = Logger::Verbosity::WARN,
+  });
+  send_task_->start();
 }
 
 RtspSession::~RtspSession() {
   teardown();
+  // stop receiving RTCP packets before the state the receive callback uses
+  // is destroyed
+  rtcp_socket_.detach_from_reactor();
+  // stop the send task, which waits on the queue rather than the task's
+  // condition variable
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stop_sending_ = true;
+  }
+  queue_cv_.notify_all();
+  if (send_task_ && send_task_->is_started()) {
+    send_task_->stop();
+  }
+  // give back the frames which were not sent
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    for (auto &frame : frame_queue_) {
+      frame->remove_user();
+    }
+    frame_queue_.clear();
+  }
   // stop the session task
   if (control_task_ && control_task_->is_started()) {
     logger_.info("Stopping control task");
@@ -65,6 +105,35 @@ bool RtspSession::send_rtp_packet(const RtpPacket &packet) {
                                              });
 }
 
+bool RtspSession::send_rtp_packet(std::span<const std::string_view> buffers) {
+  logger_.debug("Sending RTP packet");
+  return rtp_socket_.send(buffers, {
+                                       .ip_address = client_address_,
+                                       .port = (size_t)client_rtp_port_,
+                                   });
+}
+
+size_t RtspSession::send_rtp_packets(std::span<const UdpSocket::Datagram> packets) {
+  logger_.debug("Sending {} RTP packets", packets.size());
+  size_t num_sent = rtp_socket_.send_batch(packets, {
+                                                        .ip_address = client_address_,
+                                                        .port = (size_t)client_rtp_port_,
+                                                    });
+  // count the payload bytes sent, for the sender reports
+  size_t num_octets = 0;
+  for (size_t i = 0; i < num_sent; i++) {
+    size_t packet_size = 0;
+    for (const auto &buffer : packets[i]) {
+      packet_size += buffer.size();
+    }
+    num_octets += packet_size - std::min(packet_size, RTP_HEADER_SIZE);
+  }
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  stats_.packets_sent += num_sent;
+  stats_.octets_sent += num_octets;
+  return num_sent;
+}
+
 bool RtspSession::send_rtcp_packet(const RtcpPacket &packet) {
   logger_.debug("Sending RTCP packet");
   return rtcp_socket_.send(packet.get_data(), {
@@ -73,6 +142,259 @@ bool RtspSession::send_rtcp_packet(const RtcpPacket &packet) {
                                               });
 }
 
+void RtspSession::enqueue_frame(std::shared_ptr<const PacketizedFrame> frame) {
+  // if the session is not active or is closed, then don't send
+  if (!frame || !is_active() || is_closed()) {
+    return;
+  }
+  // skip the frame if the client is being paced
+  if (!should_send_frame(frame->time)) {
+    return;
+  }
+  bool dropped = false;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (frame_queue_.size() >= max_queued_frames_) {
+      // the client has fallen behind, so drop its oldest frame rather than
+      // sending it ever later
+      frame_queue_.front()->remove_user();
+      frame_queue_.pop_front();
+      dropped = true;
+    }
+    frame->add_user();
+    frame_queue_.push_back(std::move(frame));
+  }
+  queue_cv_.notify_one();
+  if (dropped) {
+    logger_.debug("Send queue is full, dropped the oldest frame");
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.frames_dropped++;
+  }
+}
+
+bool RtspSession::send_task_fn(std::mutex &m, std::condition_variable &cv, bool &task_notified) {
+  std::shared_ptr<const PacketizedFrame> frame;
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    queue_cv_.wait(lock, [this] { return stop_sending_ || !frame_queue_.empty(); });
+    if (stop_sending_) {
+      return true;
+    }
+    frame = std::move(frame_queue_.front());
+    frame_queue_.pop_front();
+  }
+  send_frame_packets(*frame);
+  // the server can reuse the frame once no session is using it
+  frame->remove_user();
+  // we do not want to stop the task
+  return false;
+}
+
+void RtspSession::send_frame_packets(const PacketizedFrame &frame) {
+  // the session may have been paused since the frame was queued
+  if (!is_active() || is_closed()) {
+    return;
+  }
+  // the RTP timestamp of the current time, from the frame's timestamp
+  auto now = std::chrono::steady_clock::now();
+  uint32_t rtp_timestamp =
+      frame.timestamp +
+      std::chrono::duration_cast<std::chrono::milliseconds>(now - frame.time).count() * 90;
+  send_sender_report_if_due(rtp_timestamp);
+
+  // gather each packet from our RTP header, the shared RTP/JPEG headers and
+  // its part of the scan data
+  auto scan_data = frame.get_scan_data();
+  size_t num_packets = frame.packets.size();
+  rtp_headers_.resize(num_packets);
+  send_buffers_.resize(num_packets);
+  send_packets_.resize(num_packets);
+  for (size_t i = 0; i < num_packets; i++) {
+    const auto &packet = frame.packets[i];
+    bool is_last = i == num_packets - 1;
+    // RTP header (RFC 3550): version 2, payload type 26 (JPEG), with the
+    // marker bit set on the last packet of the frame
+    uint8_t *data = rtp_headers_[i].data();
+    uint16_t sequence_number = rtp_sequence_number_++;
+    data[0] = 2 << 6;
+    data[1] = (is_last ? 0x80 : 0x00) | JPEG_PAYLOAD_TYPE;
+    data[2] = sequence_number >> 8;
+    data[3] = sequence_number & 0xff;
+    data[4] = frame.timestamp >> 24;
+    data[5] = (frame.timestamp >> 16) & 0xff;
+    data[6] = (frame.timestamp >> 8) & 0xff;
+    data[7] = frame.timestamp & 0xff;
+    data[8] = ssrc_ >> 24;
+    data[9] = (ssrc_ >> 16) & 0xff;
+    data[10] = (ssrc_ >> 8) & 0xff;
+    data[11] = ssrc_ & 0xff;
+    send_buffers_[i] = {
+        std::string_view((const char *)data, RTP_HEADER_SIZE),
+        std::string_view((const char *)packet.data.data(), packet.size),
+        scan_data.substr(packet.payload_offset, packet.payload_size),
+    };
+    send_packets_[i] = send_buffers_[i];
+  }
+  // send all the packets to the client in as few system calls as possible
+  size_t num_sent = send_rtp_packets(send_packets_);
+  if (num_sent < num_packets) {
+    logger_.warn("Only sent {} of {} packets", num_sent, num_packets);
+  }
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  stats_.frames_sent++;
+}
+
+bool RtspSession::should_send_frame(std::chrono::steady_clock::time_point now) {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  // keep track of how often frames are offered, which is the step by which
+  // the frame interval changes
+  if (last_offered_frame_time_ != std::chrono::steady_clock::time_point{}) {
+    std::chrono::duration<float> period = now - last_offered_frame_time_;
+    source_frame_interval_ += (period - source_frame_interval_) / 8.0f;
+  }
+  last_offered_frame_time_ = now;
+  // allow for frames being offered a little early
+  if (now - last_frame_time_ + source_frame_interval_ / 2.0f < stats_.frame_interval) {
+    stats_.frames_skipped++;
+    return false;
+  }
+  last_frame_time_ = now;
+  return true;
+}
+
+void RtspSession::send_sender_report_if_due(uint32_t rtp_timestamp) {
+  auto now = std::chrono::steady_clock::now();
+  if (last_sender_report_time_ != std::chrono::steady_clock::time_point{} &&
+      now - last_sender_report_time_ < rtcp_interval_) {
+    return;
+  }
+  last_sender_report_time_ = now;
+  RtcpSenderReport report;
+  report.ssrc = ssrc_;
+  report.ntp_timestamp = RtcpPacket::to_ntp_timestamp(std::chrono::system_clock::now());
+  report.rtp_timestamp = rtp_timestamp;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    report.packet_count = stats_.packets_sent;
+    report.octet_count = stats_.octets_sent;
+  }
+  report.serialize();
+  if (!send_rtcp_packet(report)) {
+    logger_.warn("Failed to send RTCP sender report");
+  }
+}
+
+RtspSession::Stats RtspSession::get_stats() const {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  return stats_;
+}
+
+bool RtspSession::init_rtcp() {
+  if (rtcp_receiving_) {
+    return true;
+  }
+  if (!socket_reactor_) {
+    socket_reactor_ = SocketReactor::make_shared({
+        .name = "RtspSessionRtcp",
+        .log_level = Logger::Verbosity::WARN,
+    });
+  }
+  // bind both sockets to ephemeral ports, which are sent to the client in the
+  // SETUP response. The client sends its receiver reports to the RTCP port
+  // (or back to the port the sender reports come from, which is the same).
+  if (!rtp_socket_.bind(0)) {
+    logger_.error("Failed to bind the RTP socket");
+    return false;
+  }
+  using namespace std::placeholders;
+  rtcp_receiving_ = rtcp_socket_.start_receiving(
+      socket_reactor_, {
+                           .port = 0,
+                           .buffer_size = 1024,
+                           .on_receive_span_callback =
+                               std::bind(&RtspSession::handle_rtcp_packet, this, _1, _2),
+                       });
+  if (!rtcp_receiving_) {
+    logger_.error("Failed to start receiving RTCP packets");
+    return false;
+  }
+  auto rtp_info = rtp_socket_.get_ipv4_info();
+  auto rtcp_info = rtcp_socket_.get_ipv4_info();
+  if (rtp_info && rtcp_info) {
+    server_rtp_port_ = rtp_info->port;
+    server_rtcp_port_ = rtcp_info->port;
+  }
+  return true;
+}
+
+void RtspSession::handle_rtcp_packet(std::span<const uint8_t> data,
+                                     const Socket::Info &sender_info) {
+  auto ntp_timestamp = RtcpPacket::to_ntp_timestamp(std::chrono::system_clock::now());
+  std::string_view remaining(reinterpret_cast<const char *>(data.data()), data.size());
+  // a compound packet may contain several RTCP packets, e.g. a receiver
+  // report and a source description
+  while (!remaining.empty()) {
+    auto packet = RtcpPacket::get_first_packet(remaining);
+    if (packet.empty()) {
+      logger_.warn("Invalid RTCP packet from {}", sender_info);
+      return;
+    }
+    remaining.remove_prefix(packet.size());
+    if (RtcpPacket::get_packet_type(packet) != RtcpPacket::RECEIVER_REPORT) {
+      continue;
+    }
+    RtcpReceiverReport report(packet);
+    if (!report.is_valid()) {
+      logger_.warn("Invalid RTCP receiver report from {}", sender_info);
+      continue;
+    }
+    for (const auto &block : report.report_blocks) {
+      if (block.ssrc == ssrc_) {
+        handle_report_block(block, ntp_timestamp);
+      }
+    }
+  }
+}
+
+void RtspSession::handle_report_block(const RtcpPacket::ReportBlock &block,
+                                      uint64_t ntp_timestamp) {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  stats_.receiver_reports++;
+  stats_.fraction_lost = block.fraction_lost / 256.0f;
+  stats_.packets_lost = block.cumulative_lost;
+  // RTP/JPEG timestamps are in 90 kHz units
+  stats_.jitter = std::chrono::duration<float>(block.jitter / 90000.0f);
+  if (block.last_sender_report != 0) {
+    // the round trip time is the time since the sender report was sent,
+    // minus the time the client held on to it, in 1/65536 s (RFC 3550 6.4.1)
+    auto round_trip = static_cast<int32_t>(RtcpPacket::to_compact_ntp(ntp_timestamp) -
+                                           block.last_sender_report -
+                                           block.delay_since_last_sender_report);
+    if (round_trip >= 0) {
+      stats_.round_trip_time = std::chrono::duration<float>(round_trip / 65536.0f);
+    }
+  }
+  if (!adaptive_pacing_) {
+    return;
+  }
+  // back off quickly when the client sees loss, and speed up slowly when it
+  // doesn't, until every frame is sent again
+  auto &frame_interval = stats_.frame_interval;
+  if (stats_.fraction_lost > HIGH_LOSS_FRACTION) {
+    frame_interval = std::min(max_frame_interval_,
+                              std::max(frame_interval, source_frame_interval_) * 2.0f);
+  } else if (stats_.fraction_lost < LOW_LOSS_FRACTION) {
+    frame_interval *= 0.75f;
+    if (frame_interval < source_frame_interval_) {
+      frame_interval = std::chrono::duration<float>::zero();
+    }
+  }
+  logger_.debug("Receiver report: {:.1f}% lost, jitter {:.1f} ms, rtt {:.1f} ms, frame interval "
+                "{:.1f} ms",
+                stats_.fraction_lost * 100.0f, stats_.jitter.count() * 1e3f,
+                stats_.round_trip_time.count() * 1e3f, frame_interval.count() * 1e3f);
+}
+
 bool RtspSession::send_response(int code, std::string_view message, int sequence_number,
                                 std::string_view headers, std::string_view body) {
   // create a response
@@ -164,14 +486,21 @@ bool RtspSession::handle_rtsp_setup(std::string_view request) {
   // save the client port numbers
   client_rtp_port_ = client_rtp_port;
   client_rtcp_port_ = client_rtcp_port;
+  // start receiving the client's receiver reports
+  init_rtcp();
   // create a response
   int code = 200;
   std::string message = "OK";
-  // flesh out the transport header
-  std::string headers =
-      "Session: " + std::to_string(session_id_) + "\r\n" +
-      "Transport: RTP/AVP;unicast;client_port=" + std::to_string(client_rtp_port) + "-" +
-      std::to_string(client_rtcp_port) + "\r\n";
+  // flesh out the transport header, with the ports the RTP and RTCP packets
+  // are sent from (and the receiver reports should be sent to)
+  std::string transport = "RTP/AVP;unicast;client_port=" + std::to_string(client_rtp_port) + "-" +
+                          std::to_string(client_rtcp_port);
+  if (server_rtp_port_ != 0 && server_rtcp_port_ != 0) {
+    transport += ";server_port=" + std::to_string(server_rtp_port_) + "-" +
+                 std::to_string(server_rtcp_port_);
+  }
+  std::string headers = "Session: " + std::to_string(session_id_) + "\r\n" +
+                        "Transport: " + transport + "\r\n";
   return send_response(code, message, sequence_number, headers);
 }
 
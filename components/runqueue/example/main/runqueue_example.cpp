@@ -1,3 +1,4 @@
+#include <atomic>
 #include <chrono>
 #include <vector>
 
@@ -189,6 +190,80 @@ extern "C" void app_main(void) {
     //! [multiple runqueue example]
   }
 
+  {
+    logger.info("Multiple worker runqueue example!");
+    //! [multiple worker runqueue example]
+    // a single runqueue with one worker task pinned to each core, so that up
+    // to two functions can run at the same time
+    espp::RunQueue runqueue({
+        .num_workers = 2,
+        .task_config = {.name = "worker runq"},
+        .worker_core_ids = {0, 1},
+    });
+
+    std::atomic<int> num_done{0};
+    auto task = [&logger, &num_done](int id) {
+      auto core = xPortGetCoreID();
+      logger.info("Task {} running on core {}", id, core);
+      std::this_thread::sleep_for(500ms);
+      num_done++;
+    };
+
+    logger.info("Scheduling tasks...");
+    static constexpr int num_tasks = 4;
+    for (int i = 0; i < num_tasks; i++) {
+      // NOTE: this lambda is small enough that queueing it does not allocate
+      runqueue.add_function([&task, i]() { task(i); }, espp::RunQueue::MIN_PRIORITY + i);
+    }
+
+    // the 4 tasks take ~1s to complete, since two of them run at a time
+    while (num_done < num_tasks) {
+      std::this_thread::sleep_for(100ms);
+    }
+    logger.info("All tasks done!");
+    //! [multiple worker runqueue example]
+  }
+
+  {
+    logger.info("Deadline runqueue example!");
+    //! [deadline runqueue example]
+    // run functions in order of their deadlines, and log any that are late
+    espp::RunQueue runqueue({
+        .scheduling_policy = espp::RunQueue::SchedulingPolicy::EARLIEST_DEADLINE_FIRST,
+        .deadline_miss_callback =
+            [&logger](espp::RunQueue::Id id, std::chrono::microseconds lateness) {
+              logger.warn("Function {} missed its deadline by {} us", id, lateness.count());
+            },
+    });
+
+    auto control_loop = [&logger]() {
+      logger.info("Control loop update");
+      std::this_thread::sleep_for(1ms);
+    };
+    auto ui_update = [&logger]() {
+      logger.info("UI update");
+      std::this_thread::sleep_for(10ms);
+    };
+
+    for (int i = 0; i < 10; i++) {
+      // the control loop must be updated within 5ms, the UI within 50ms
+      runqueue.add_function(control_loop, 5ms);
+      runqueue.add_function(ui_update, 50ms);
+      std::this_thread::sleep_for(20ms);
+    }
+    std::this_thread::sleep_for(100ms);
+
+    auto stats = runqueue.get_stats();
+    logger.info("Executed {} functions, {} deadline misses", stats.num_executed,
+                stats.num_deadline_misses);
+    logger.info("Queue time: mean {} us, p99 < {} us, max {} us",
+                stats.queue_time.mean().count(), stats.queue_time.percentile(99).count(),
+                stats.queue_time.max.count());
+    logger.info("Run time: mean {} us, p99 < {} us, max {} us", stats.run_time.mean().count(),
+                stats.run_time.percentile(99).count(), stats.run_time.max.count());
+    //! [deadline runqueue example]
+  }
+
   logger.info("Example complete!");
 
   while (true) {
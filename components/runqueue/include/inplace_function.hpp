@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace espp {
+template <typename Signature, size_t Capacity> class InplaceFunction;
+
+/// A copyable, type-erased callable (like std::function) which stores
+/// callables of up to \p Capacity bytes inside the object itself, so that
+/// constructing, copying, and destroying it does not allocate. Larger
+/// callables are stored on the heap.
+///
+/// This is used by the RunQueue so that queueing a function (e.g. a lambda
+/// with a few captures) does not require any heap allocation.
+///
+/// \tparam R The return type of the callable.
+/// \tparam Args The argument types of the callable.
+/// \tparam Capacity The number of bytes of inline storage.
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+public:
+  /// Construct an empty InplaceFunction.
+  InplaceFunction() = default;
+
+  /// Construct an empty InplaceFunction.
+  InplaceFunction(std::nullptr_t) {}
+
+  /// Construct an InplaceFunction from a callable.
+  /// \param f The callable to store. It is stored inline if it fits in
+  ///          \p Capacity bytes, otherwise it is stored on the heap.
+  template <typename F, typename D = std::decay_t<F>,
+            typename = std::enable_if_t<!std::is_same_v<D, InplaceFunction> &&
+                                        std::is_invocable_r_v<R, D &, Args...>>>
+  InplaceFunction(F &&f) {
+    if constexpr (std::is_pointer_v<D> || std::is_member_pointer_v<D> ||
+                  std::is_same_v<D, std::function<R(Args...)>>) {
+      if (!f) {
+        // leave empty, so that operator bool matches the callable
+        return;
+      }
+    }
+    if constexpr (is_inline<D>()) {
+      new (&storage_) D(std::forward<F>(f));
+    } else {
+      *reinterpret_cast<D **>(&storage_) = new D(std::forward<F>(f));
+    }
+    vtable_ = &vtable_for<D>;
+  }
+
+  InplaceFunction(const InplaceFunction &other) {
+    if (other.vtable_) {
+      other.vtable_->copy(&storage_, &other.storage_);
+      vtable_ = other.vtable_;
+    }
+  }
+
+  InplaceFunction(InplaceFunction &&other) noexcept {
+    if (other.vtable_) {
+      other.vtable_->move(&storage_, &other.storage_);
+      vtable_ = other.vtable_;
+      other.reset();
+    }
+  }
+
+  InplaceFunction &operator=(const InplaceFunction &other) {
+    if (this != &other) {
+      reset();
+      if (other.vtable_) {
+        other.vtable_->copy(&storage_, &other.storage_);
+        vtable_ = other.vtable_;
+      }
+    }
+    return *this;
+  }
+
+  InplaceFunction &operator=(InplaceFunction &&other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other.vtable_) {
+        other.vtable_->move(&storage_, &other.storage_);
+        vtable_ = other.vtable_;
+        other.reset();
+      }
+    }
+    return *this;
+  }
+
+  ~InplaceFunction() { reset(); }
+
+  /// Destroy the stored callable (if any), leaving this empty.
+  void reset() {
+    if (vtable_) {
+      vtable_->destroy(&storage_);
+      vtable_ = nullptr;
+    }
+  }
+
+  /// Whether this contains a callable.
+  /// \return True if this contains a callable.
+  explicit operator bool() const { return vtable_ != nullptr; }
+
+  /// Call the stored callable.
+  /// \param args The arguments to pass to the callable.
+  /// \return The result of the callable.
+  /// \note Calling an empty InplaceFunction which returns void does nothing.
+  ///       Otherwise it must not be empty.
+  R operator()(Args... args) const {
+    if constexpr (std::is_void_v<R>) {
+      if (!vtable_) {
+        return;
+      }
+    }
+    return vtable_->invoke(const_cast<void *>(static_cast<const void *>(&storage_)),
+                           std::forward<Args>(args)...);
+  }
+
+  /// Whether a callable of type \p F would be stored inline (without
+  /// allocating).
+  /// \tparam F The type of the callable.
+  /// \return True if the callable would be stored inline.
+  template <typename F> static constexpr bool is_inline() {
+    return sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible_v<F>;
+  }
+
+protected:
+  struct VTable {
+    R (*invoke)(void *storage, Args &&...args);
+    void (*copy)(void *dst, const void *src);
+    void (*move)(void *dst, void *src);
+    void (*destroy)(void *storage);
+  };
+
+  template <typename F> static F *get(void *storage) {
+    if constexpr (is_inline<F>()) {
+      return std::launder(reinterpret_cast<F *>(storage));
+    } else {
+      return *reinterpret_cast<F **>(storage);
+    }
+  }
+
+  template <typename F> static const F *get(const void *storage) {
+    return get<F>(const_cast<void *>(storage));
+  }
+
+  template <typename F>
+  static constexpr VTable vtable_for = {
+      .invoke = [](void *storage, Args &&...args) -> R {
+        return std::invoke(*get<F>(storage), std::forward<Args>(args)...);
+      },
+      .copy =
+          [](void *dst, const void *src) {
+            if constexpr (is_inline<F>()) {
+              new (dst) F(*get<F>(src));
+            } else {
+              *reinterpret_cast<F **>(dst) = new F(*get<F>(src));
+            }
+          },
+      .move =
+          [](void *dst, void *src) {
+            if constexpr (is_inline<F>()) {
+              new (dst) F(std::move(*get<F>(src)));
+            } else {
+              // just take ownership of the heap allocated callable
+              *reinterpret_cast<F **>(dst) = get<F>(src);
+              *reinterpret_cast<F **>(src) = nullptr;
+            }
+          },
+      .destroy =
+          [](void *storage) {
+            if constexpr (is_inline<F>()) {
+              get<F>(storage)->~F();
+            } else {
+              delete get<F>(storage);
+            }
+          },
+  };
+
+  alignas(std::max_align_t) std::byte storage_[Capacity < sizeof(void *) ? sizeof(void *)
+                                                                          : Capacity];
+  const VTable *vtable_{nullptr};
+};
+} // namespace espp
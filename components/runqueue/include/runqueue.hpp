@@ -1,12 +1,18 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <functional>
 #include <mutex>
-#include <set>
+#include <optional>
 #include <utility>
+#include <vector>
 
 #include "base_component.hpp"
+#include "inplace_function.hpp"
 #include "task.hpp"
 
 namespace espp {
@@ -19,7 +25,25 @@ namespace espp {
 /// The RunQueue is implemented as a Task that runs the functions in the queue.
 /// The Task will run the highest priority function in the queue (if any) and
 /// will block indefinitely until either either a new function is added to the
-/// queue or the RunQueue is stopped.
+/// queue or the RunQueue is stopped. Functions with the same priority are run
+/// in the order they were added.
+///
+/// The RunQueue can optionally have multiple worker tasks (see
+/// Config::num_workers), each of which runs the highest priority function in
+/// the queue when it becomes free, so that multiple functions can run
+/// concurrently (e.g. one on each core, see Config::worker_core_ids).
+///
+/// Functions can also be given a deadline (see add_function()). By default the
+/// deadline is only used to track deadline misses, but if the RunQueue is
+/// configured with SchedulingPolicy::EARLIEST_DEADLINE_FIRST, functions with
+/// deadlines are run in order of their deadline, before any functions without
+/// a deadline. The RunQueue keeps histograms of how long functions wait in the
+/// queue and how long they take to run (see get_stats()).
+///
+/// Functions are stored in a small-buffer-optimized callable
+/// (espp::InplaceFunction) and the queue storage is reused, so once the queue
+/// has reached its working size adding a function only allocates if the
+/// function's captured state is larger than FUNCTION_STORAGE_SIZE bytes.
 ///
 /// \note Function priorities are relative to each other and are only compared
 ///       to other tasks in the specific RunQueue object. Different RunQueue
@@ -57,6 +81,10 @@ namespace espp {
 /// \snippet runqueue_example.cpp runqueue example
 /// \section runq_ex1 Multiple RunQueues Example
 /// \snippet runqueue_example.cpp multiple runqueue example
+/// \section runq_ex2 Multiple Worker RunQueue Example
+/// \snippet runqueue_example.cpp multiple worker runqueue example
+/// \section runq_ex3 Deadline RunQueue Example
+/// \snippet runqueue_example.cpp deadline runqueue example
 class RunQueue : public espp::BaseComponent {
 public:
   /// The type used to represent the priority of a function.
@@ -74,15 +102,75 @@ public:
   /// The invalid id value. This is used to know if an id is valid or not.
   static constexpr Id INVALID_ID = std::numeric_limits<Id>::min();
 
+  /// The number of bytes of captured state which can be stored in a Function
+  /// without allocating. This fits a std::function, or a lambda capturing up
+  /// to 4 pointers.
+  static constexpr size_t FUNCTION_STORAGE_SIZE = 4 * sizeof(void *);
+
   /// A function that takes no arguments and returns void.
-  using Function = std::function<void(void)>;
-  // typedef std::function<void(void)> Function;
+  using Function = espp::InplaceFunction<void(void), FUNCTION_STORAGE_SIZE>;
+
+  /// The clock used for deadlines and latency measurements.
+  using Clock = std::chrono::steady_clock;
+
+  /// The deadline used for functions which do not have a deadline.
+  static constexpr Clock::time_point NO_DEADLINE = Clock::time_point::max();
+
+  /// How the RunQueue chooses which function to run next.
+  enum class SchedulingPolicy {
+    PRIORITY,                ///< Run the highest priority function first (default).
+    EARLIEST_DEADLINE_FIRST, ///< Run the function with the earliest deadline first. Functions
+                             ///< without a deadline are run by priority when there are no
+                             ///< functions with a deadline queued.
+  };
+
+  /// Callback called when a function completes after its deadline.
+  /// \param id The id of the function which missed its deadline.
+  /// \param lateness How long after its deadline the function completed.
+  typedef std::function<void(Id id, std::chrono::microseconds lateness)> deadline_miss_fn;
 
   /// A pair of a priority and a function.
   struct PriorityFunction {
     Priority priority; ///< The priority of the function. Lower values have lower priority.
-    Id id;             ///< The id of the function. Can be provided or auto-generated.
+    Id id{INVALID_ID}; ///< The id of the function. Can be provided or auto-generated.
     Function function; ///< The function.
+    Clock::time_point deadline{NO_DEADLINE}; ///< When the function must have completed by.
+    Clock::time_point enqueue_time{};        ///< When the function was added to the queue.
+  };
+
+  /// Histogram of latencies, using power of two buckets.
+  struct LatencyHistogram {
+    static constexpr size_t NUM_BUCKETS = 24; ///< Number of buckets, the last bucket holds all
+                                              ///< latencies >= 2^22 us (~4.2 s).
+    std::array<uint32_t, NUM_BUCKETS> buckets{}; ///< Bucket i holds latencies in [2^(i-1),
+                                                 ///< 2^i) us, bucket 0 holds latencies < 1 us.
+    uint32_t count{0};                           ///< Number of latencies recorded.
+    std::chrono::microseconds min{std::chrono::microseconds::max()}; ///< Minimum latency.
+    std::chrono::microseconds max{0};                                ///< Maximum latency.
+    std::chrono::microseconds total{0}; ///< Sum of all latencies, for computing the mean.
+
+    /// Record a latency.
+    /// \param latency The latency to record.
+    void add(std::chrono::microseconds latency);
+
+    /// Get the mean latency.
+    /// \return The mean latency, or 0 if no latencies have been recorded.
+    std::chrono::microseconds mean() const;
+
+    /// Get an upper bound on the given percentile of the latencies.
+    /// \param percentile The percentile, in the range [0, 100].
+    /// \return The upper bound of the bucket containing the percentile (which
+    ///         is clamped to the maximum recorded latency).
+    std::chrono::microseconds percentile(float percentile) const;
+  };
+
+  /// Statistics about the functions run by the RunQueue.
+  struct Stats {
+    uint32_t num_executed{0};        ///< Number of functions which have completed.
+    uint32_t num_deadline_misses{0}; ///< Number of functions which completed after their
+                                     ///< deadline.
+    LatencyHistogram queue_time;     ///< Time from when a function was added to when it started.
+    LatencyHistogram run_time;       ///< Time the function took to run.
   };
 
   /// Less than operator for PriorityFunction.
@@ -111,8 +199,20 @@ public:
 
   /// Configuration struct for the RunQueue
   struct Config {
-    bool auto_start = true;                  ///< Whether the RunQueue should start automatically.
-    espp::Task::BaseConfig task_config = {}; ///< The configuration for the runner task.
+    bool auto_start = true;   ///< Whether the RunQueue should start automatically.
+    size_t num_workers = 1;   ///< The number of worker tasks which run functions concurrently.
+    espp::Task::BaseConfig task_config = {}; ///< The configuration for the runner task(s). If
+                                             ///< there are multiple workers, the worker index is
+                                             ///< appended to the name.
+    std::vector<int> worker_core_ids = {};   ///< Optional core id for each worker. If empty, all
+                                             ///< workers use task_config.core_id, otherwise
+                                             ///< worker i is pinned to
+                                             ///< worker_core_ids[i % worker_core_ids.size()].
+    SchedulingPolicy scheduling_policy =
+        SchedulingPolicy::PRIORITY; ///< How to choose the next function to run.
+    deadline_miss_fn deadline_miss_callback =
+        nullptr; ///< Optional callback for when a function misses its deadline. It is called
+                 ///< from the worker task which ran the function.
     espp::Logger::Verbosity log_level =
         espp::Logger::Verbosity::WARN; ///< The log level for the RunQueue.
   };
@@ -136,8 +236,8 @@ public:
   void start();
 
   /// Stop the run queue.
-  /// \note This must wait until the currently running function (if any) has
-  ///       completed before stopping the run queue.
+  /// \note This must wait until the currently running function(s) (if any)
+  ///       have completed before stopping the run queue.
   void stop();
 
   /// Add a function to the queue.
@@ -147,6 +247,20 @@ public:
   ///         used to query or remove the function from the queue.
   Id add_function(const Function &function, Priority priority = MIN_PRIORITY);
 
+  /// Add a function with a deadline to the queue.
+  /// \param function The function to add.
+  /// \param deadline How long from now the function must have completed by.
+  /// \param priority The priority of the function. Defaults to MIN_PRIORITY.
+  ///                 This is only used to order the function if the RunQueue
+  ///                 uses SchedulingPolicy::PRIORITY.
+  /// \return The id of the function. This will be auto-generated and can be
+  ///         used to query or remove the function from the queue.
+  /// \note If the function completes after its deadline, it is counted in
+  ///       Stats::num_deadline_misses and the deadline_miss_callback (if any)
+  ///       is called.
+  Id add_function(const Function &function, const std::chrono::microseconds &deadline,
+                  Priority priority = MIN_PRIORITY);
+
   /// Remove a function from the queue.
   /// \param id The id of the function to remove. Cannot be INVALID_ID.
   /// \return True if the function was removed.
@@ -177,34 +291,77 @@ public:
   /// \note The vector will be in order of priority, with the highest priority
   ///       function at the end of the vector. This means that if include_running
   ///       is true, the id of the currently running function will be the last
-  ///       element in the vector.
+  ///       element in the vector (or the last elements, if there are multiple
+  ///       workers).
   std::vector<Id> get_queued_ids(bool include_running = false);
 
   /// Get the id of the currently running function.
   /// \return The id of the currently running function, or std::nullopt if no
-  ///         function is currently running.
+  ///         function is currently running. If there are multiple workers, this
+  ///         is the id of the function running on the lowest numbered busy
+  ///         worker.
   /// \note This may return nullopt if the currently running function has
   ///       completed but the runner task has not yet fetched the next function
   ///       from the queue.
   std::optional<Id> get_running_id();
 
+  /// Get the statistics of the functions run by the RunQueue.
+  /// \return The statistics since the RunQueue was created or the stats were
+  ///         last reset.
+  Stats get_stats();
+
+  /// Reset the statistics of the functions run by the RunQueue.
+  void reset_stats();
+
 protected:
+  /// Queued functions of a single priority, stored in a ring which is only
+  /// grown (never shrunk) so that it does not allocate once it has reached its
+  /// working size.
+  struct Lane {
+    Priority priority;
+    std::vector<PriorityFunction> ring{};
+    size_t head{0};
+    size_t count{0};
+
+    PriorityFunction &at(size_t index) { return ring[(head + index) % ring.size()]; }
+    void push_back(PriorityFunction &&pf);
+    PriorityFunction pop_front();
+    void erase(size_t index);
+  };
+
   /// Manage the run queue.
-  /// \details This function is called by the runner task to manage the run
+  /// \details This function is called by the runner task(s) to manage the run
   ///          queue. It will run the highest priority function in the queue
   ///          (if any) and will return true if there are more functions to
   ///          run.
+  /// \param worker The index of the worker calling this function.
   /// \return True if there are more functions to run.
-  bool manage_queue();
+  bool manage_queue(size_t worker);
+
+  Id add_function(PriorityFunction &&pf);
+
+  // order for the deadline heap, so that the earliest deadline is at the front
+  static bool later_deadline(const PriorityFunction &lhs, const PriorityFunction &rhs) {
+    return lhs.deadline > rhs.deadline || (lhs.deadline == rhs.deadline && lhs.id > rhs.id);
+  }
 
-  bool task_fn(std::mutex &m, std::condition_variable &cv, bool &task_notified);
+  bool task_fn(size_t worker, std::mutex &m, std::condition_variable &cv, bool &task_notified);
 
-  std::unique_ptr<espp::Task> runner_;
+  std::vector<std::unique_ptr<espp::Task>> runners_;
   std::atomic<Id> id_counter_{INVALID_ID};
-  std::atomic<Id> running_id_{INVALID_ID};
   std::mutex queue_mutex_;
   std::condition_variable queue_cv_;
   bool queue_notified_ = false;
-  std::multiset<PriorityFunction> priority_function_queue_;
+  std::atomic<size_t> queue_size_{0};
+  // sorted by descending priority, lanes are created as needed and never removed
+  std::vector<Lane> lanes_;
+  // functions with deadlines when using EARLIEST_DEADLINE_FIRST, as a heap
+  // ordered by later_deadline
+  std::vector<PriorityFunction> deadline_queue_;
+  // id of the function running on each worker (or INVALID_ID)
+  std::vector<Id> running_ids_;
+  SchedulingPolicy scheduling_policy_;
+  deadline_miss_fn deadline_miss_callback_;
+  Stats stats_;
 }; // class RunQueue
 } // namespace espp
@@ -1,14 +1,32 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <utility>
+
 #include "runqueue.hpp"
 
 using namespace espp;
 
 RunQueue::RunQueue(const RunQueue::Config &config)
-    : BaseComponent("RunQueue", config.log_level) {
+    : BaseComponent("RunQueue", config.log_level)
+    , scheduling_policy_(config.scheduling_policy)
+    , deadline_miss_callback_(config.deadline_miss_callback) {
   using namespace std::placeholders;
-  runner_ = espp::Task::make_unique({
-      .callback = std::bind(&RunQueue::task_fn, this, _1, _2, _3),
-      .task_config = config.task_config,
-  });
+  size_t num_workers = std::max<size_t>(1, config.num_workers);
+  running_ids_.resize(num_workers, INVALID_ID);
+  for (size_t i = 0; i < num_workers; i++) {
+    auto task_config = config.task_config;
+    if (num_workers > 1) {
+      task_config.name += fmt::format(" {}", i);
+    }
+    if (!config.worker_core_ids.empty()) {
+      task_config.core_id = config.worker_core_ids[i % config.worker_core_ids.size()];
+    }
+    runners_.push_back(espp::Task::make_unique({
+        .callback = std::bind(&RunQueue::task_fn, this, i, _1, _2, _3),
+        .task_config = task_config,
+    }));
+  }
   if (config.auto_start) {
     start();
   }
@@ -16,27 +34,55 @@ RunQueue::RunQueue(const RunQueue::Config &config)
 
 RunQueue::~RunQueue() { stop(); }
 
-std::size_t RunQueue::queue_size() const { return priority_function_queue_.size(); }
+std::size_t RunQueue::queue_size() const { return queue_size_; }
 
-bool RunQueue::is_running() const { return runner_->is_running(); }
+bool RunQueue::is_running() const { return runners_[0]->is_running(); }
 
 void RunQueue::start() {
   logger_.debug("Starting run queue");
-  runner_->start();
+  {
+    std::unique_lock lock(queue_mutex_);
+    queue_notified_ = false;
+  }
+  for (auto &runner : runners_) {
+    runner->start();
+  }
 }
 
 void RunQueue::stop() {
   logger_.debug("Stopping run queue");
-  // notify the queue so that the runner wakes up and exits
+  // notify the queue so that the runners wake up and exit
   {
     std::unique_lock lock(queue_mutex_);
     queue_notified_ = true;
   }
   queue_cv_.notify_all();
-  runner_->stop();
+  for (auto &runner : runners_) {
+    runner->stop();
+  }
 }
 
 RunQueue::Id RunQueue::add_function(const Function &function, Priority priority) {
+  return add_function({
+      .priority = priority,
+      .function = function,
+      .enqueue_time = Clock::now(),
+  });
+}
+
+RunQueue::Id RunQueue::add_function(const Function &function,
+                                    const std::chrono::microseconds &deadline,
+                                    Priority priority) {
+  auto now = Clock::now();
+  return add_function({
+      .priority = priority,
+      .function = function,
+      .deadline = now + deadline,
+      .enqueue_time = now,
+  });
+}
+
+RunQueue::Id RunQueue::add_function(PriorityFunction &&pf) {
   // generate an Id for this function
   Id id = ++id_counter_; // pre-increment so the first id is 1
   if (id == INVALID_ID) {
@@ -44,10 +90,27 @@ RunQueue::Id RunQueue::add_function(const Function &function, Priority priority)
     // happen if the id_counter_ overflows
     id = ++id_counter_;
   }
-  std::unique_lock lock(queue_mutex_);
-  priority_function_queue_.insert({priority, id, function});
-  // notify the queue so that the runner wakes up and runs the function
-  queue_cv_.notify_all();
+  pf.id = id;
+  {
+    std::unique_lock lock(queue_mutex_);
+    if (scheduling_policy_ == SchedulingPolicy::EARLIEST_DEADLINE_FIRST &&
+        pf.deadline != NO_DEADLINE) {
+      deadline_queue_.push_back(std::move(pf));
+      std::push_heap(deadline_queue_.begin(), deadline_queue_.end(), later_deadline);
+    } else {
+      // find the lane for this priority, lanes are sorted by descending priority
+      auto priority = pf.priority;
+      auto lane = std::find_if(lanes_.begin(), lanes_.end(),
+                               [priority](const Lane &l) { return l.priority <= priority; });
+      if (lane == lanes_.end() || lane->priority != priority) {
+        lane = lanes_.insert(lane, {.priority = priority});
+      }
+      lane->push_back(std::move(pf));
+    }
+    queue_size_++;
+  }
+  // notify the queue so that a runner wakes up and runs the function
+  queue_cv_.notify_one();
   return id;
 }
 
@@ -57,20 +120,31 @@ bool RunQueue::remove_function(RunQueue::Id id) {
     logger_.debug("Cannot remove function with id: {}, it is invalid", id);
     return false;
   }
-  // return false if the function is the one currently running, as we cannot
-  // remove the running function
-  if (id == running_id_) {
+  std::unique_lock lock(queue_mutex_);
+  // return false if the function is one that is currently running, as we
+  // cannot remove a running function
+  if (std::find(running_ids_.begin(), running_ids_.end(), id) != running_ids_.end()) {
     logger_.debug("Cannot remove function with id: {}, it is running", id);
     return false;
   }
   logger_.debug("Removing function from queue with id: {}", id);
-  std::unique_lock lock(queue_mutex_);
-  auto it = std::find_if(priority_function_queue_.begin(), priority_function_queue_.end(),
-                         [&](const auto &pf) { return pf.id == id; });
-  if (it != priority_function_queue_.end()) {
-    priority_function_queue_.erase(it);
+  auto is_id = [id](const PriorityFunction &pf) { return pf.id == id; };
+  auto it = std::find_if(deadline_queue_.begin(), deadline_queue_.end(), is_id);
+  if (it != deadline_queue_.end()) {
+    deadline_queue_.erase(it);
+    std::make_heap(deadline_queue_.begin(), deadline_queue_.end(), later_deadline);
+    queue_size_--;
     return true;
   }
+  for (auto &lane : lanes_) {
+    for (size_t i = 0; i < lane.count; i++) {
+      if (lane.at(i).id == id) {
+        lane.erase(i);
+        queue_size_--;
+        return true;
+      }
+    }
+  }
   logger_.debug("Function with id: {} not found in queue", id);
   return false;
 }
@@ -80,87 +154,169 @@ bool RunQueue::is_function_queued(RunQueue::Id id) {
   if (id == INVALID_ID) {
     return false;
   }
-  // return true if the function is the one currently running
-  if (id == running_id_) {
+  std::unique_lock lock(queue_mutex_);
+  // return true if the function is one that is currently running
+  if (std::find(running_ids_.begin(), running_ids_.end(), id) != running_ids_.end()) {
     return true;
   }
   // otherwise, check if the function is in the queue
-  std::unique_lock lock(queue_mutex_);
-  auto it = std::find_if(priority_function_queue_.begin(), priority_function_queue_.end(),
-                         [&](const auto &pf) { return pf.id == id; });
-  // return whether or not the function was found
-  return it != priority_function_queue_.end();
+  if (std::any_of(deadline_queue_.begin(), deadline_queue_.end(),
+                  [id](const PriorityFunction &pf) { return pf.id == id; })) {
+    return true;
+  }
+  for (auto &lane : lanes_) {
+    for (size_t i = 0; i < lane.count; i++) {
+      if (lane.at(i).id == id) {
+        return true;
+      }
+    }
+  }
+  return false;
 }
 
 void RunQueue::clear_queue() {
   logger_.debug("Clearing queue");
   std::unique_lock lock(queue_mutex_);
-  priority_function_queue_.clear();
+  for (auto &lane : lanes_) {
+    while (lane.count > 0) {
+      lane.pop_front();
+    }
+  }
+  deadline_queue_.clear();
+  queue_size_ = 0;
 }
 
 std::vector<RunQueue::Id> RunQueue::get_queued_ids(bool include_running) {
   std::vector<Id> ids;
   // Note: the vector will be in order of priority, with the highest priority
-  // function at the end of the vector
-  {
-    std::unique_lock lock(queue_mutex_);
-    for (const auto &pf : priority_function_queue_) {
-      ids.push_back(pf.id);
+  // function at the end of the vector. Within a priority, the function which
+  // will run next is last. Functions in the deadline queue (which run before
+  // any others) are after all the prioritized functions, with the earliest
+  // deadline last.
+  std::unique_lock lock(queue_mutex_);
+  ids.reserve(queue_size_ + running_ids_.size());
+  for (auto lane = lanes_.rbegin(); lane != lanes_.rend(); ++lane) {
+    for (size_t i = lane->count; i > 0; i--) {
+      ids.push_back(lane->at(i - 1).id);
     }
   }
-  if (include_running && running_id_ != INVALID_ID) {
-    ids.push_back(running_id_);
+  if (!deadline_queue_.empty()) {
+    // only copy the deadlines and ids (not the functions) to sort them by
+    // descending deadline, in the same order as later_deadline
+    std::vector<std::pair<Clock::time_point, Id>> deadlines;
+    deadlines.reserve(deadline_queue_.size());
+    for (const auto &pf : deadline_queue_) {
+      deadlines.emplace_back(pf.deadline, pf.id);
+    }
+    std::sort(deadlines.begin(), deadlines.end(), std::greater<>());
+    for (const auto &[deadline, id] : deadlines) {
+      ids.push_back(id);
+    }
+  }
+  if (include_running) {
+    for (auto running_id : running_ids_) {
+      if (running_id != INVALID_ID) {
+        ids.push_back(running_id);
+      }
+    }
   }
   return ids;
 }
 
 std::optional<RunQueue::Id> RunQueue::get_running_id() {
-  if (running_id_ != INVALID_ID) {
-    return running_id_;
+  std::unique_lock lock(queue_mutex_);
+  for (auto running_id : running_ids_) {
+    if (running_id != INVALID_ID) {
+      return running_id;
+    }
   }
   return std::nullopt;
 }
 
-bool RunQueue::manage_queue() {
+bool RunQueue::manage_queue(size_t worker) {
   logger_.debug("Managing queue");
   // check to see if there are any functions in the queue, and if so, then get
   // the highest priority function and run it
   PriorityFunction highest_priority_function;
   {
     std::unique_lock lock(queue_mutex_);
-    if (priority_function_queue_.empty()) {
-      // there are no functions in the queue, so return false
-      return false;
+    if (!deadline_queue_.empty()) {
+      // take the function with the earliest deadline
+      std::pop_heap(deadline_queue_.begin(), deadline_queue_.end(), later_deadline);
+      highest_priority_function = std::move(deadline_queue_.back());
+      deadline_queue_.pop_back();
+    } else {
+      auto lane = std::find_if(lanes_.begin(), lanes_.end(),
+                               [](const Lane &l) { return l.count > 0; });
+      if (lane == lanes_.end()) {
+        // there are no functions in the queue, so return false
+        return false;
+      }
+      // take the oldest function in the highest priority lane
+      highest_priority_function = lane->pop_front();
     }
-    // store the function to run. rbegin() is the highest priority function
-    auto top = priority_function_queue_.rbegin();
-    highest_priority_function = *top;
-    // remove the function from the queue
-    priority_function_queue_.erase(std::next(top).base());
+    queue_size_--;
+    // set the running id
+    running_ids_[worker] = highest_priority_function.id;
   }
 
-  // set the running id
-  running_id_ = highest_priority_function.id;
-
   logger_.debug("Running function with priority: {}", highest_priority_function.priority);
+  auto start = Clock::now();
   // run the function
   highest_priority_function.function();
+  auto end = Clock::now();
+  // destroy the function (and its captured state) before we report that it is
+  // no longer running
+  highest_priority_function.function.reset();
 
-  // clear the running id
-  running_id_ = INVALID_ID;
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  const auto &deadline = highest_priority_function.deadline;
+  bool missed_deadline = deadline != NO_DEADLINE && end > deadline;
+  bool more_functions;
+  {
+    // update the stats, clear the running id, and check whether or not there
+    // are more functions in the queue
+    std::unique_lock lock(queue_mutex_);
+    stats_.num_executed++;
+    stats_.queue_time.add(
+        duration_cast<microseconds>(start - highest_priority_function.enqueue_time));
+    stats_.run_time.add(duration_cast<microseconds>(end - start));
+    if (missed_deadline) {
+      stats_.num_deadline_misses++;
+    }
+    running_ids_[worker] = INVALID_ID;
+    more_functions = queue_size_ > 0;
+  }
+  if (missed_deadline) {
+    auto lateness = duration_cast<microseconds>(end - deadline);
+    logger_.debug("Function with id: {} missed its deadline by {} us",
+                  highest_priority_function.id, lateness.count());
+    if (deadline_miss_callback_) {
+      deadline_miss_callback_(highest_priority_function.id, lateness);
+    }
+  }
+  return more_functions;
+}
 
-  // return whether or not there are more functions in the queue
+RunQueue::Stats RunQueue::get_stats() {
   std::unique_lock lock(queue_mutex_);
-  return !priority_function_queue_.empty();
+  return stats_;
 }
 
-bool RunQueue::task_fn(std::mutex &m, std::condition_variable &cv, bool &task_notified) {
+void RunQueue::reset_stats() {
+  std::unique_lock lock(queue_mutex_);
+  stats_ = {};
+}
+
+bool RunQueue::task_fn(size_t worker, std::mutex &m, std::condition_variable &cv,
+                       bool &task_notified) {
   // run manage queue, and if it returns false, then wait for the queue cv to be
   // notified
-  if (!manage_queue()) {
+  if (!manage_queue(worker)) {
     logger_.debug("Waiting for queue to be notified");
     std::unique_lock lock(queue_mutex_);
-    queue_cv_.wait(lock, [&] { return queue_notified_ || !priority_function_queue_.empty(); });
+    queue_cv_.wait(lock, [&] { return queue_notified_ || queue_size_ > 0; });
     if (queue_notified_) {
       // the queue was notified, so we should return true to indicate that the
       // task is being stopped
@@ -177,3 +333,74 @@ bool RunQueue::task_fn(std::mutex &m, std::condition_variable &cv, bool &task_no
   logger_.debug("Task notified: {}", task_notified);
   return task_notified;
 }
+
+void RunQueue::Lane::push_back(PriorityFunction &&pf) {
+  if (count == ring.size()) {
+    // grow the ring, keeping the queued functions in order
+    std::vector<PriorityFunction> new_ring(std::max<size_t>(4, ring.size() * 2));
+    for (size_t i = 0; i < count; i++) {
+      new_ring[i] = std::move(at(i));
+    }
+    ring = std::move(new_ring);
+    head = 0;
+  }
+  at(count) = std::move(pf);
+  count++;
+}
+
+RunQueue::PriorityFunction RunQueue::Lane::pop_front() {
+  PriorityFunction pf = std::move(at(0));
+  at(0).function.reset();
+  head = (head + 1) % ring.size();
+  count--;
+  return pf;
+}
+
+void RunQueue::Lane::erase(size_t index) {
+  // shift the following functions forward to fill the gap
+  for (size_t i = index; i + 1 < count; i++) {
+    at(i) = std::move(at(i + 1));
+  }
+  at(count - 1).function.reset();
+  count--;
+}
+
+void RunQueue::LatencyHistogram::add(std::chrono::microseconds latency) {
+  auto us = std::max<int64_t>(0, latency.count());
+  // bucket i holds latencies in [2^(i-1), 2^i) us
+  size_t bucket = 0;
+  while (us > 0 && bucket < NUM_BUCKETS - 1) {
+    us >>= 1;
+    bucket++;
+  }
+  buckets[bucket]++;
+  count++;
+  min = std::min(min, latency);
+  max = std::max(max, latency);
+  total += latency;
+}
+
+std::chrono::microseconds RunQueue::LatencyHistogram::mean() const {
+  if (count == 0) {
+    return std::chrono::microseconds(0);
+  }
+  return total / count;
+}
+
+std::chrono::microseconds RunQueue::LatencyHistogram::percentile(float percentile) const {
+  if (count == 0) {
+    return std::chrono::microseconds(0);
+  }
+  auto target = static_cast<uint32_t>(std::ceil(std::clamp(percentile, 0.0f, 100.0f) / 100.0f *
+                                                count));
+  target = std::max<uint32_t>(target, 1);
+  uint32_t seen = 0;
+  for (size_t i = 0; i < NUM_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= target) {
+      // the upper bound of bucket i is 2^i us
+      return std::min(max, std::chrono::microseconds(int64_t(1) << i));
+    }
+  }
+  return max;
+}
@@ -1,7 +1,9 @@
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <iterator>
+#include <mutex>
 #include <thread>
 
 #if CONFIG_ESP32_WIFI_NVS_ENABLED
@@ -9,8 +11,10 @@
 #endif
 
 #include "logger.hpp"
+#include "socket_reactor.hpp"
 #include "task.hpp"
 #include "tcp_socket.hpp"
+#include "udp_log_sink.hpp"
 #include "udp_socket.hpp"
 #include "wifi_ap.hpp"
 
@@ -215,6 +219,97 @@ std::this_thread::sleep_for(test_duration);
 
 fmt::print(fg(fmt::terminal_color::green) | fmt::emphasis::bold, "UDP multicast test finished.\n");
 std::this_thread::sleep_for(100ms);
+fmt::print(fg(fmt::terminal_color::yellow) | fmt::emphasis::bold, "Staring UDP log sink test.\n");
+
+// Log sink example
+{
+  size_t port = 5001;
+  // receive the logs, as a host would
+  espp::UdpSocket server_socket({.log_level = espp::Logger::Verbosity::WARN});
+  auto server_task_config = espp::Task::BaseConfig{
+      .name = "UdpLogServer",
+      .stack_size_bytes = 6 * 1024,
+  };
+  auto server_config = espp::UdpSocket::ReceiveConfig{
+      .port = port,
+      .buffer_size = 1024,
+      .on_receive_callback = [](auto &data,
+                                auto &source) -> std::optional<std::vector<uint8_t>> {
+        fmt::print("Log server received {} bytes:\n{}", data.size(),
+                   std::string_view((const char *)data.data(), data.size()));
+        return {};
+      }};
+  server_socket.start_receiving(server_task_config, server_config);
+
+  //! [UDP Log Sink example]
+  // send the logs from all loggers to a udp endpoint as JSON lines, batched
+  // into datagrams of up to 512 bytes
+  auto udp_sink = std::make_shared<espp::UdpLogSink>(espp::UdpLogSink::Config{
+      .ip_address = "127.0.0.1",
+      .port = port,
+      .max_datagram_size = 512,
+      .sink_config = {.level = espp::Logger::Verbosity::INFO,
+                      .format = espp::LogSink::Format::JSON,
+                      .batch_size_bytes = 512},
+  });
+  espp::Logger::add_sink(udp_sink);
+  // keep printing warnings and errors to the console
+  espp::Logger::add_sink(std::make_shared<espp::ConsoleLogSink>(
+      espp::LogSink::Config{.level = espp::Logger::Verbosity::WARN, .color = true}));
+  espp::Logger logger({.tag = "UDP Log", .level = espp::Logger::Verbosity::INFO});
+  for (int i = 0; i < 20; i++) {
+    logger.info("sensor reading {}: {:.2f}", i, 0.1f * i);
+  }
+  logger.warn("sensor reading out of range");
+  // send anything remaining and go back to printing to the console
+  espp::Logger::clear_sinks();
+  //! [UDP Log Sink example]
+  std::this_thread::sleep_for(500ms);
+}
+
+fmt::print(fg(fmt::terminal_color::green) | fmt::emphasis::bold, "UDP log sink test finished.\n");
+std::this_thread::sleep_for(100ms);
+fmt::print(fg(fmt::terminal_color::yellow) | fmt::emphasis::bold,
+           "Staring UDP batch receive test.\n");
+
+// Batched, allocation-free receive example
+{
+  //! [UDP Batch Receive example]
+  size_t port = 5002;
+  espp::UdpSocket server_socket({.log_level = espp::Logger::Verbosity::WARN});
+  auto server_task_config = espp::Task::BaseConfig{
+      .name = "UdpBatchServer",
+      .stack_size_bytes = 6 * 1024,
+  };
+  std::atomic<size_t> num_received{0};
+  auto server_config = espp::UdpSocket::ReceiveConfig{
+      .port = port,
+      .buffer_size = 1500,
+      // receive up to 8 datagrams per call into buffers allocated once by
+      // start_receiving, and pass each one to the callback without copying it
+      .on_receive_span_callback =
+          [&num_received](std::span<const uint8_t> data, auto &source) {
+            num_received++;
+            fmt::print("Server received {} bytes from {}\n", data.size(), source);
+          },
+      .max_batch_size = 8,
+  };
+  server_socket.start_receiving(server_task_config, server_config);
+  //! [UDP Batch Receive example]
+
+  // send a burst of datagrams, which will be received in batches
+  espp::UdpSocket client_socket({});
+  auto send_config = espp::UdpSocket::SendConfig{.ip_address = "127.0.0.1", .port = port};
+  for (int i = 0; i < 20; i++) {
+    client_socket.send(fmt::format("datagram {}", i), send_config);
+  }
+  std::this_thread::sleep_for(500ms);
+  fmt::print("Server received {} datagrams\n", num_received.load());
+}
+
+fmt::print(fg(fmt::terminal_color::green) | fmt::emphasis::bold,
+           "UDP batch receive test finished.\n");
+std::this_thread::sleep_for(100ms);
 fmt::print(fg(fmt::terminal_color::yellow) | fmt::emphasis::bold, "Staring Basic TCP test.\n");
 
 // Unicast (client-server) example
@@ -377,6 +472,83 @@ fmt::print(fg(fmt::terminal_color::yellow) | fmt::emphasis::bold,
 fmt::print(fg(fmt::terminal_color::green) | fmt::emphasis::bold,
            "TCP send waiting for response test finished.\n");
 std::this_thread::sleep_for(100ms);
+fmt::print(fg(fmt::terminal_color::yellow) | fmt::emphasis::bold,
+           "Staring socket reactor test.\n");
+
+// Many sockets serviced by one task
+{
+  //! [Socket Reactor example]
+  // one task waits for all of the sockets below
+  auto reactor = espp::SocketReactor::make_shared({
+      .name = "SocketReactor",
+      .stack_size_bytes = 6 * 1024,
+  });
+
+  // a UDP server, which does not need a task of its own
+  size_t udp_port = 5003;
+  espp::UdpSocket udp_server({.log_level = espp::Logger::Verbosity::WARN});
+  udp_server.start_receiving(reactor,
+                             {
+                                 .port = udp_port,
+                                 .buffer_size = 1024,
+                                 .on_receive_span_callback =
+                                     [](std::span<const uint8_t> data, auto &source) {
+                                       fmt::print("UDP server received {} bytes from {}\n",
+                                                  data.size(), source);
+                                     },
+                             });
+
+  // a TCP server, whose connections are also serviced by the reactor
+  size_t tcp_port = 5004;
+  espp::TcpSocket tcp_server({.log_level = espp::Logger::Verbosity::WARN});
+  tcp_server.bind(tcp_port);
+  tcp_server.listen(5);
+  std::mutex connections_mutex;
+  std::vector<std::unique_ptr<espp::TcpSocket>> connections;
+  tcp_server.start_accepting(reactor, [&](std::unique_ptr<espp::TcpSocket> connection) {
+    fmt::print("TCP server accepted connection from: {}\n", connection->get_remote_info());
+    auto *connection_ptr = connection.get();
+    connection->start_receiving(
+        reactor, {
+                     .buffer_size = 1024,
+                     .on_receive_callback =
+                         [](std::span<const uint8_t> data) {
+                           fmt::print("TCP server received: {}\n", data);
+                         },
+                     .on_disconnect_callback =
+                         [&, connection_ptr]() {
+                           fmt::print("TCP client disconnected\n");
+                           // the connection has been detached from the
+                           // reactor, so it can be destroyed here
+                           std::lock_guard<std::mutex> lock(connections_mutex);
+                           std::erase_if(connections, [connection_ptr](const auto &c) {
+                             return c.get() == connection_ptr;
+                           });
+                         },
+                 });
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    connections.push_back(std::move(connection));
+  });
+  //! [Socket Reactor example]
+
+  // send some data to both servers
+  espp::UdpSocket udp_client({});
+  espp::TcpSocket tcp_client({});
+  tcp_client.connect({.ip_address = "127.0.0.1", .port = tcp_port});
+  for (int i = 0; i < 3; i++) {
+    udp_client.send(fmt::format("datagram {}", i),
+                    {.ip_address = "127.0.0.1", .port = udp_port});
+    tcp_client.transmit(std::vector<uint8_t>{0, 1, 2, (uint8_t)i});
+    std::this_thread::sleep_for(100ms);
+  }
+  tcp_client.reinit();
+  std::this_thread::sleep_for(500ms);
+  fmt::print("Reactor is servicing {} sockets\n", reactor->get_num_sockets());
+}
+
+fmt::print(fg(fmt::terminal_color::green) | fmt::emphasis::bold,
+           "Socket reactor test finished.\n");
+std::this_thread::sleep_for(100ms);
 fmt::print(fg(fmt::terminal_color::green) | fmt::emphasis::bold, "Socket example finished!\n");
 
 // sleep forever
@@ -16,6 +16,7 @@ typedef int sock_type_t;
 #endif
 
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -26,6 +27,8 @@ typedef int sock_type_t;
 #include "format.hpp"
 
 namespace espp {
+class SocketReactor;
+
 /**
  *   @brief Class for a generic socket with some helper functions for
  *          configuring the socket.
@@ -148,6 +151,14 @@ public:
    */
   static bool is_valid_fd(sock_type_t socket_fd);
 
+  /**
+   * @brief Get the socket file descriptor, e.g. to pass it to system calls
+   *        which this class does not wrap (such as sendfile).
+   * @note The socket is still owned (and will be closed) by this object.
+   * @return The socket file descriptor.
+   */
+  sock_type_t get_socket_fd() const;
+
   /**
    * @brief Get the Socket::Info for the socket.
    * @details This will call getsockname() on the socket to get the
@@ -203,6 +214,24 @@ public:
    */
   int select(const std::chrono::microseconds &timeout);
 
+  /**
+   * @brief Put the socket in (or take it out of) non-blocking mode, in which
+   *        receive / accept / send calls which would block fail immediately
+   *        instead.
+   * @param non_blocking Whether the socket should be non-blocking.
+   * @return true if O_NONBLOCK (FIONBIO on Windows) was successfully set.
+   */
+  bool set_non_blocking(bool non_blocking = true);
+
+  /**
+   * @brief Stop handling the socket from the SocketReactor it was attached
+   *        to (if any). The socket stays in non-blocking mode.
+   * @note This is called automatically when the socket is closed or
+   *       destroyed. No reactor callback will be called for the socket after
+   *       this returns.
+   */
+  void detach_from_reactor();
+
 protected:
   /**
    * @brief Create the TCP socket and enable reuse.
@@ -223,6 +252,13 @@ protected:
    */
   std::string error_string(int error) const;
 
+  /**
+   * @brief Whether the last error means that a non-blocking call would have
+   *        blocked (EAGAIN / EWOULDBLOCK).
+   * @return true if the last call failed because it would have blocked.
+   */
+  bool would_block() const;
+
   /**
    *  @brief If the socket was created, we shut it down and close it here.
    */
@@ -232,6 +268,8 @@ protected:
   static constexpr int ip_protocol_{IPPROTO_IP};
 
   sock_type_t socket_;
+  std::shared_ptr<SocketReactor> reactor_; ///< the reactor the socket is attached to, if any
+  uint32_t reactor_handler_id_{0};         ///< the id of the socket within reactor_
 };
 } // namespace espp
 
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "socket_msvc.hpp"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base_component.hpp"
+#include "socket.hpp"
+#include "task.hpp"
+
+namespace espp {
+/// @brief An event loop which waits for many non-blocking sockets from a
+///        single task, and calls a callback for each socket which is ready.
+/// @details Normally each receiving espp::UdpSocket, and each espp::TcpSocket
+///          server or connection, is serviced by its own espp::Task which
+///          blocks in recv / accept, so a server with many clients needs many
+///          threads / FreeRTOS tasks (and their stacks). The SocketReactor
+///          instead puts the sockets in non-blocking mode and waits for all of
+///          them at once (with epoll on Linux, and select on lwIP and other
+///          platforms), then calls the callback of each socket which is ready
+///          to be read from or written to.
+///
+///          Sockets can be added to a SocketReactor directly with add(), or
+///          (more commonly) by passing the reactor to
+///          UdpSocket::start_receiving(), TcpSocket::start_accepting() or
+///          TcpSocket::start_receiving(). Sockets are removed from the reactor
+///          automatically when they are closed or destroyed.
+///
+///          Readiness is level-triggered: if a callback does not read all of
+///          the data which is available, it will be called again.
+///
+/// @note All sockets attached to a SocketReactor share the same task context,
+///       so the stack size of the reactor should be set to accommodate the
+///       largest callback, and a callback which blocks will delay all other
+///       sockets on the same reactor.
+///
+/// \section socket_reactor_ex1 Socket Reactor Example
+/// \snippet socket_example.cpp Socket Reactor example
+class SocketReactor : public BaseComponent {
+public:
+  /// @brief The events a socket is interested in, or which occurred.
+  struct Events {
+    bool readable{false}; ///< The socket can be read from (or accepted on) without blocking.
+    bool writable{false}; ///< The socket can be written to without blocking.
+    bool error{false}; ///< An error or hang-up occurred on the socket. Always reported, so it is
+                       ///< ignored when adding a socket.
+  };
+
+  /// The callback function type, called from the reactor task with the
+  /// events which occurred on the socket.
+  typedef std::function<void(const Events &events)> callback_fn;
+
+  /// The type used to identify sockets within the reactor.
+  using handler_id_t = uint32_t;
+
+  /// The invalid handler id, returned when a socket could not be added.
+  static constexpr handler_id_t INVALID_HANDLER_ID = 0;
+
+  /// @brief The configuration for the socket reactor.
+  struct Config {
+    std::string_view name{"SocketReactor"}; ///< The name of the socket reactor.
+    size_t stack_size_bytes{6 * 1024};      ///< The stack size of the task that runs the reactor.
+    size_t priority{0}; ///< Priority of the reactor task, 0 is lowest priority on ESP / FreeRTOS.
+    int core_id{-1};    ///< Core ID of the reactor task, -1 means it is not pinned to any core.
+    size_t max_events{32}; ///< Maximum number of ready sockets handled per wait (epoll only).
+    espp::Logger::Verbosity log_level =
+        espp::Logger::Verbosity::WARN; ///< The log level for the socket reactor.
+  };
+
+  /// @brief Construct a new SocketReactor object and start its task.
+  /// @param config The configuration for the socket reactor.
+  explicit SocketReactor(const Config &config);
+
+  /// @brief Get a shared pointer to a new SocketReactor created with \p config.
+  /// @details Sockets hold a shared pointer to the reactor they are attached
+  ///          to, so this is the recommended way to create a SocketReactor.
+  /// @param config The configuration for the socket reactor.
+  /// @return std::shared_ptr<SocketReactor> pointer to the new socket reactor.
+  static std::shared_ptr<SocketReactor> make_shared(const Config &config);
+
+  /// @brief Destroy the SocketReactor object
+  /// @details Stops the reactor task. No callbacks will be called after this
+  ///          returns.
+  ~SocketReactor();
+
+  /// @brief Add a socket to the reactor.
+  /// @note The socket should be in non-blocking mode (see
+  ///       Socket::set_non_blocking()), so that the callback cannot block the
+  ///       reactor if the socket is no longer ready when it is called.
+  /// @param socket_fd The socket file descriptor.
+  /// @param interest The events to wait for.
+  /// @param callback The callback function to call when the socket is ready.
+  /// @return The id of the socket within the reactor, or INVALID_HANDLER_ID
+  ///         if it could not be added.
+  handler_id_t add(sock_type_t socket_fd, const Events &interest, const callback_fn &callback);
+
+  /// @brief Change the events a socket is interested in.
+  /// @param id The id of the socket.
+  /// @param interest The events to wait for.
+  /// @return true if the socket's interest was changed, false otherwise.
+  bool modify(handler_id_t id, const Events &interest);
+
+  /// @brief Remove a socket from the reactor.
+  /// @details If the socket's callback is currently running in the reactor
+  ///          task, this blocks until the callback returns (unless it is
+  ///          called from within a callback), so that no callback will be
+  ///          called for this socket after this returns. It must be called
+  ///          before the socket is closed.
+  /// @param id The id of the socket to remove.
+  void remove(handler_id_t id);
+
+  /// @brief Get the number of sockets attached to the reactor.
+  /// @return The number of sockets attached to the reactor.
+  size_t get_num_sockets() const;
+
+protected:
+  struct Entry {
+    sock_type_t socket_fd;
+    Events interest;
+    callback_fn callback;
+    bool executing{false}; ///< True while the callback is running in the reactor task.
+    bool removed{false};   ///< True if the socket was removed from within its own callback.
+  };
+
+  bool task_callback();
+  bool init_wake();
+  void wake();
+  void clear_wake();
+  void wait();
+  void dispatch(handler_id_t id, const Events &events);
+  bool in_reactor_task() const;
+
+  std::atomic<bool> running_{false};
+  mutable std::mutex mutex_;
+  std::condition_variable done_cv_; ///< Notified when a callback finishes.
+  handler_id_t next_id_{INVALID_HANDLER_ID + 1};
+  std::unordered_map<handler_id_t, Entry> entries_;
+  std::vector<std::pair<handler_id_t, Events>> ready_; ///< sockets which are ready after a wait
+#if defined(__linux__)
+  int epoll_fd_{-1};
+  int wake_fd_{-1}; ///< eventfd which is written to by wake()
+  std::vector<struct epoll_event> epoll_events_;
+#else
+  sock_type_t wake_socket_; ///< loopback UDP socket which wake() sends a datagram to
+  struct sockaddr_in wake_address_ {};
+  std::vector<std::pair<handler_id_t, sock_type_t>> select_sockets_; ///< sockets in the select
+#endif
+  std::unique_ptr<espp::Task> task_;
+};
+} // namespace espp
@@ -7,11 +7,13 @@
 #endif // _MSC_VER
 
 #include <optional>
+#include <span>
 #include <string_view>
 #include <vector>
 
 #include "logger.hpp"
 #include "socket.hpp"
+#include "socket_reactor.hpp"
 #include "task.hpp"
 
 namespace espp {
@@ -29,9 +31,33 @@ namespace espp {
  * \section tcp_ex4 TCP Server Response Example
  * \snippet socket_example.cpp TCP Server Response example
  *
+ * \section tcp_ex5 Socket Reactor Example
+ * \snippet socket_example.cpp Socket Reactor example
+ *
  */
 class TcpSocket : public Socket {
 public:
+  /**
+   * @brief Callback function to be called with each connection accepted by
+   *        a server socket attached to a SocketReactor.
+   * @param client The socket for the accepted connection.
+   */
+  typedef std::function<void(std::unique_ptr<TcpSocket> client)> accept_callback_fn;
+
+  /**
+   * @brief Callback function to be called with the data received by a socket
+   *        attached to a SocketReactor.
+   * @param data The data received. It is stored in a buffer owned by the
+   *        socket, which is reused once the callback returns.
+   */
+  typedef std::function<void(std::span<const uint8_t> data)> receive_span_callback_fn;
+
+  /**
+   * @brief Callback function to be called when the remote end of a socket
+   *        attached to a SocketReactor closes the connection (or it fails).
+   */
+  typedef std::function<void()> disconnect_callback_fn;
+
   /**
    * @brief Config struct for the TCP socket.
    */
@@ -40,6 +66,20 @@ public:
         espp::Logger::Verbosity::WARN}; /**< Verbosity level for the TCP socket logger. */
   };
 
+  /**
+   * @brief Config struct for receiving on a connected TCP socket from a
+   *        SocketReactor.
+   */
+  struct ReactorReceiveConfig {
+    size_t buffer_size{1024}; /**< Max size of data we can receive at one time. */
+    receive_span_callback_fn on_receive_callback{
+        nullptr}; /**< Function containing business logic to handle data received. */
+    disconnect_callback_fn on_disconnect_callback{
+        nullptr}; /**< Optional function called once when the connection is closed. The socket
+                     has already been detached from the reactor, so it may be destroyed from
+                     within this callback. */
+  };
+
   /**
    * @brief Config struct for connecting to a remote TCP server.
    */
@@ -202,6 +242,39 @@ public:
    */
   std::unique_ptr<espp::TcpSocket> accept();
 
+  /**
+   * @brief Accept incoming connections from the task of a SocketReactor,
+   *        instead of blocking in accept(). The socket is put in non-blocking
+   *        mode.
+   * @note Must be called after listen.
+   * @note The accepted sockets are blocking; they can be attached to the
+   *       reactor with start_receiving().
+   * @note The callback is called from the reactor task, so it should not
+   *       block, and this socket must not be destroyed from within it.
+   * @param reactor The SocketReactor which will wait for connections.
+   * @param on_accept Function called with each accepted connection.
+   * @return true if the socket was added to the reactor, false otherwise.
+   */
+  bool start_accepting(std::shared_ptr<SocketReactor> reactor,
+                       const accept_callback_fn &on_accept);
+
+  /**
+   * @brief Receive data on a connected socket from the task of a
+   *        SocketReactor, instead of blocking in receive(). The socket is put
+   *        in non-blocking mode, so transmit() fails instead of blocking when
+   *        the send buffer is full. If only part of the data fits, transmit()
+   *        waits until the rest is sent, so that the stream is never left with
+   *        a truncated message.
+   * @note The callbacks are called from the reactor task, so they should not
+   *       block, and the socket must not be destroyed from within
+   *       on_receive_callback (but may be from within on_disconnect_callback).
+   * @param reactor The SocketReactor which will wait for data.
+   * @param config ReactorReceiveConfig struct with the buffer size and callbacks.
+   * @return true if the socket was added to the reactor, false otherwise.
+   */
+  bool start_receiving(std::shared_ptr<SocketReactor> reactor,
+                       const ReactorReceiveConfig &config);
+
 protected:
   /**
    * @brief Construct a new TcpSocket object
@@ -218,7 +291,31 @@ protected:
                      const std::chrono::seconds &interval = std::chrono::seconds{10},
                      int max_probes = 5);
 
+  /**
+   * @brief Called by the SocketReactor when a connection can be accepted.
+   */
+  void handle_accept();
+
+  /**
+   * @brief Called by the SocketReactor when the socket is readable. Receives
+   *        once without blocking and passes the data to the callback, or
+   *        handles the disconnection.
+   */
+  void handle_readable();
+
+  /**
+   * @brief Wait (without a timeout) until the socket can be written to, so
+   *        that a non-blocking transmit() can finish a partially sent write.
+   * @return true if the socket is writable, false if it failed.
+   */
+  bool wait_until_writable();
+
   bool connected_{false};
   espp::Socket::Info remote_info_{};
+
+  accept_callback_fn accept_callback_;
+  receive_span_callback_fn receive_callback_;
+  disconnect_callback_fn disconnect_callback_;
+  std::vector<uint8_t> receive_buffer_; ///< reused for each receive from the reactor
 };
 } // namespace espp
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "log_sink.hpp"
+#include "udp_socket.hpp"
+
+namespace espp {
+/**
+ * @brief Log sink which sends the log output to a UDP endpoint, e.g. a host
+ *        running `nc -ul <port>` or a log collector. Records are batched into
+ *        datagrams of at most Config::max_datagram_size bytes, which are split
+ *        at line boundaries (unless a single line is longer). Using the JSON
+ *        format lets the host filter on the tag, level, timestamp, and thread
+ *        id without parsing the text.
+ *
+ * \section udp_log_sink_ex1 UDP Log Sink Example
+ * \snippet socket_example.cpp UDP Log Sink example
+ */
+class UdpLogSink : public LogSink {
+public:
+  /**
+   * @brief Configuration for the UDP sink.
+   */
+  struct Config {
+    std::string ip_address;            /**< Address to send the logs to. */
+    size_t port;                       /**< Port to send the logs to. */
+    bool is_multicast_endpoint{false}; /**< Whether the address is a multicast group. */
+    size_t max_datagram_size{1024};    /**< Maximum size of each datagram. */
+    LogSink::Config sink_config{
+        .format = LogSink::Format::JSON,
+        .batch_size_bytes = 1024}; /**< Configuration common to all sinks. */
+  };
+
+  /**
+   * @brief Create the socket.
+   * @param config The configuration for the sink.
+   */
+  explicit UdpLogSink(const Config &config)
+      : LogSink(config.sink_config)
+      , socket_({.log_level = espp::Logger::Verbosity::WARN})
+      , send_config_({.ip_address = config.ip_address,
+                      .port = config.port,
+                      .is_multicast_endpoint = config.is_multicast_endpoint})
+      , max_datagram_size_(std::max<size_t>(1, config.max_datagram_size)) {}
+
+  /**
+   * @brief Send anything buffered.
+   */
+  ~UdpLogSink() override { flush(); }
+
+protected:
+  void write_batch(std::string_view data) override {
+    while (!data.empty()) {
+      size_t size = data.size();
+      if (size > max_datagram_size_) {
+        // split after the last complete line which fits
+        auto end = data.rfind('\n', max_datagram_size_ - 1);
+        size = end == std::string_view::npos ? max_datagram_size_ : end + 1;
+      }
+      socket_.send(data.substr(0, size), send_config_);
+      data.remove_prefix(size);
+    }
+  }
+
+  UdpSocket socket_;
+  UdpSocket::SendConfig send_config_;
+  size_t max_datagram_size_;
+};
+} // namespace espp
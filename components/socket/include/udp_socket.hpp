@@ -2,12 +2,18 @@
 
 #include "socket_msvc.hpp"
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <string_view>
 #include <vector>
 
 #include "logger.hpp"
 #include "socket.hpp"
+#include "socket_reactor.hpp"
 #include "task.hpp"
 
 // TODO: should this class _contain_ a socket or just create sockets within each
@@ -37,9 +43,25 @@ namespace espp {
  * \section udp_ex6 UDP Multicast Server Example
  * \snippet socket_example.cpp UDP Multicast Server example
  *
+ * \section udp_ex7 UDP Batch Receive Example
+ * \snippet socket_example.cpp UDP Batch Receive example
+ *
+ * \section udp_ex8 Socket Reactor Example
+ * \snippet socket_example.cpp Socket Reactor example
+ *
  */
 class UdpSocket : public Socket {
 public:
+  /**
+   * @brief Callback function for the batched, allocation-free receive path,
+   *        called once for each datagram received.
+   * @param data The datagram. It is stored in a buffer owned by the socket,
+   *        which is reused once the callback returns.
+   * @param sender_info Sender information (address, port)
+   */
+  typedef std::function<void(std::span<const uint8_t> data, const Socket::Info &sender_info)>
+      receive_span_callback_fn;
+
   struct ReceiveConfig {
     size_t port;                       /**< Port number to bind to / receive from. */
     size_t buffer_size;                /**< Max size of data we can receive at one time. */
@@ -48,6 +70,14 @@ public:
         ""}; /**< If this is a multicast endpoint, this is the group it belongs to. */
     espp::Socket::receive_callback_fn on_receive_callback{
         nullptr}; /**< Function containing business logic to handle data received. */
+    receive_span_callback_fn on_receive_span_callback{
+        nullptr}; /**< Optional alternative to on_receive_callback. If provided, datagrams are
+                     received in batches (using recvmmsg on Linux) into buffers allocated by
+                     start_receiving(), and passed to this callback without being copied, so
+                     that receiving does not allocate. No response can be sent to the sender. */
+    size_t max_batch_size{16}; /**< When using on_receive_span_callback, the maximum number of
+                                  datagrams received at once. Each one has a buffer of
+                                  buffer_size bytes. */
   };
 
   struct SendConfig {
@@ -67,8 +97,17 @@ public:
   struct Config {
     espp::Logger::Verbosity log_level{
         espp::Logger::Verbosity::WARN}; /**< Verbosity level for the UDP socket logger. */
+    bool enable_gso{true}; /**< Whether send_batch() may use UDP generic segmentation offload
+                              (Linux only), which is disabled automatically if the kernel does
+                              not support it. */
   };
 
+  /**
+   * @brief A datagram made up of several buffers (at most MAX_SEND_BUFFERS),
+   *        e.g. a header and a payload, for send_batch().
+   */
+  typedef std::span<const std::string_view> Datagram;
+
   /**
    * @brief Initialize the socket and associated resources.
    * @param config Config for the socket.
@@ -116,12 +155,51 @@ public:
    */
   bool send(std::string_view data, const SendConfig &send_config);
 
+  /**
+   * @brief Send a single datagram made up of several buffers to the endpoint
+   *        specified by the send_config, without first copying the buffers
+   *        into one contiguous buffer (scatter / gather, using sendmsg). This
+   *        is useful for sending a small header followed by a payload which
+   *        is stored elsewhere.
+   *
+   *        Otherwise it behaves the same as the other send functions.
+   * @param buffers The buffers to send, in order. At most MAX_SEND_BUFFERS.
+   * @param send_config SendConfig struct indicating where to send and whether
+   *        to wait for a response.
+   * @return true if the data was sent, false otherwise.
+   */
+  bool send(std::span<const std::string_view> buffers, const SendConfig &send_config);
+
+  /// Maximum number of buffers which can be sent as one datagram.
+  static constexpr size_t MAX_SEND_BUFFERS = 8;
+
+  /**
+   * @brief Send several datagrams to the endpoint specified by the
+   *        send_config, with as few system calls as possible.
+   *
+   *        On Linux, runs of datagrams with the same size (the last one may
+   *        be smaller) are sent with a single sendmsg using UDP generic
+   *        segmentation offload (GSO), and the others are sent with
+   *        sendmmsg. On other platforms the datagrams are sent one at a time.
+   *
+   *        @note This does not wait for a response, even if the send_config
+   *              requests one.
+   * @param datagrams The datagrams to send, in order.
+   * @param send_config SendConfig struct indicating where to send.
+   * @return The number of datagrams which were sent. If this is less than
+   *         datagrams.size(), sending stopped at the first datagram which
+   *         failed.
+   */
+  size_t send_batch(std::span<const Datagram> datagrams, const SendConfig &send_config);
+
   /**
    * @brief Call recvfrom on the socket, assuming it has already been
    *        configured appropriately.
    *
    * @param max_num_bytes Maximum number of bytes to receive.
-   * @param data Vector of bytes of received data.
+   * @param data Vector of bytes of received data. Its storage is reused, so
+   *        receiving into the same vector each time does not reallocate it. It
+   *        is left unchanged if nothing was received.
    * @param remote_info Socket::Info containing the sender's information. This
    *        will be populated with the information about the sender.
    * @return true if successfully received, false otherwise.
@@ -138,7 +216,79 @@ public:
    */
   bool start_receiving(Task::BaseConfig &task_config, const ReceiveConfig &receive_config);
 
+  /**
+   * @brief Configure a server socket and receive and handle data coming in on
+   *        that socket from the task of a SocketReactor, instead of from a
+   *        task of its own. The socket is put in non-blocking mode.
+   *
+   *        Datagrams are handed to the callbacks in receive_config as they
+   *        would be by the other start_receiving(), including the response
+   *        from on_receive_callback.
+   *
+   * @note The callbacks are called from the reactor task, so they should not
+   *       block, and the socket must not be destroyed from within them.
+   * @param reactor The SocketReactor which will wait for the socket.
+   * @param receive_config ReceiveConfig struct with socket and callback info.
+   * @return true if the socket was created and added to the reactor, false
+   *         otherwise.
+   */
+  bool start_receiving(std::shared_ptr<SocketReactor> reactor,
+                       const ReceiveConfig &receive_config);
+
+  /**
+   * @brief Bind the socket to \p port, e.g. so that the datagrams it sends
+   *        come from a known port. start_receiving() binds the socket itself.
+   * @param port The port to which to bind the socket, or 0 for an ephemeral
+   *        port (see get_ipv4_info()).
+   * @return true if the socket was bound.
+   */
+  bool bind(int port);
+
 protected:
+  /**
+   * @brief Store the callbacks and allocate the receive buffers from the
+   *        receive_config, then bind the socket (and join its multicast
+   *        group).
+   * @param receive_config ReceiveConfig struct with socket and callback info.
+   * @return true if the socket is ready to receive, false otherwise.
+   */
+  bool init_receiving(const ReceiveConfig &receive_config);
+
+  /**
+   * @brief Call recvfrom on the socket, receiving into \p buffer, then copy
+   *        what was received into \p data.
+   * @param buffer The buffer to receive into, of at least max_num_bytes.
+   * @param max_num_bytes Maximum number of bytes to receive.
+   * @param data Vector of bytes of received data, left unchanged if nothing
+   *        was received.
+   * @param remote_info Socket::Info which is populated with the sender's
+   *        information.
+   * @return true if successfully received, false otherwise.
+   */
+  bool receive_into(uint8_t *buffer, size_t max_num_bytes, std::vector<uint8_t> &data,
+                    Socket::Info &remote_info);
+
+  /**
+   * @brief Pass the datagram in received_data_ to the on_receive_callback
+   *        and send its response (if any) to the sender.
+   * @param sender_info Sender of the datagram.
+   */
+  void handle_datagram(Socket::Info &sender_info);
+
+  /**
+   * @brief Pass each datagram of a batch received by receive_batch() to the
+   *        on_receive_span_callback.
+   * @param num_received number of datagrams in the batch.
+   */
+  void dispatch_batch(int num_received);
+
+  /**
+   * @brief Called by the SocketReactor when the socket is readable. Receives
+   *        one batch (or one datagram) without blocking and handles it.
+   * @param buffer_size number of bytes of receive buffer for each datagram.
+   */
+  void handle_readable(size_t buffer_size);
+
   /**
    * @brief Function run in the task_ when start_receiving is called.
    *        Continuously receive data on the socket, pass the received data to
@@ -158,7 +308,90 @@ protected:
   bool server_task_function(size_t buffer_size, std::mutex &m, std::condition_variable &cv,
                             bool &task_notified);
 
+  /**
+   * @brief Function run in the task_ when start_receiving is called with an
+   *        on_receive_span_callback. Receives as many datagrams as are
+   *        available (up to the batch size) into the preallocated buffers and
+   *        passes each one to the callback.
+   * @param m std::mutex provided from the task for use with the
+   *          condition_variable (cv)
+   * @param cv std::condition_variable from the task for allowing
+   *           interruptible wait / delay.
+   * @param task_notified bool from the task to indicate whether the task has
+   *        been notified - used with the condition variable to ignore spurious
+   *        wakeups.
+   * @return Return true if the task should stop; false if it should continue.
+   */
+  bool batch_receive_task_function(std::mutex &m, std::condition_variable &cv,
+                                   bool &task_notified);
+
+  /**
+   * @brief Receive a batch of datagrams into receive_buffer_, blocking (up to
+   *        the receive timeout) until at least one is available.
+   * @return The number of datagrams received, or -1 on error.
+   */
+  int receive_batch();
+
+  /**
+   * @brief Send one datagram made up of several buffers.
+   * @param buffers The buffers which make up the datagram.
+   * @param address The address to send to.
+   * @return The number of bytes sent, or -1 on error.
+   */
+  int send_datagram(Datagram buffers, struct sockaddr_in *address);
+
+#if defined(__linux__)
+  /**
+   * @brief Get the number of datagrams, starting at the first one, which can
+   *        be sent as one GSO send.
+   * @param datagrams The datagrams to send.
+   * @return The number of datagrams in the run, 1 if the first datagram
+   *         cannot be sent with the ones after it.
+   */
+  static size_t get_gso_run_length(std::span<const Datagram> datagrams);
+
+  /**
+   * @brief Send a run of datagrams (see get_gso_run_length()) with a single
+   *        sendmsg using UDP GSO.
+   * @param datagrams The datagrams to send.
+   * @param address The address to send to.
+   * @return The number of datagrams sent, or -1 on error.
+   */
+  int send_gso(std::span<const Datagram> datagrams, struct sockaddr_in *address);
+
+  /**
+   * @brief Send datagrams with a single sendmmsg.
+   * @param datagrams The datagrams to send.
+   * @param address The address to send to.
+   * @return The number of datagrams sent, or -1 on error.
+   */
+  int send_mmsg(std::span<const Datagram> datagrams, struct sockaddr_in *address);
+#endif
+
+  /// Maximum number of datagrams sent by one sendmmsg or GSO send.
+  static constexpr size_t MAX_SEND_BATCH_SIZE = 64;
+
+  std::atomic<bool> gso_enabled_{false};
+  std::mutex send_batch_mutex_; ///< guards the send_batch() buffers
+  bool gso_works_{false}; ///< whether a GSO send has succeeded, guarded by send_batch_mutex_
+#if defined(__linux__)
+  std::vector<struct mmsghdr> send_messages_; ///< headers for sendmmsg
+  std::vector<struct iovec> send_iovecs_;     ///< buffers for sendmmsg / GSO sends
+#endif
+
   std::unique_ptr<Task> task_;
   receive_callback_fn server_receive_callback_;
+  std::vector<uint8_t> received_data_; ///< reused for each datagram by server_task_function
+
+  receive_span_callback_fn server_receive_span_callback_;
+  size_t receive_buffer_size_{0};              ///< bytes of receive_buffer_ for each datagram
+  std::vector<uint8_t> receive_buffer_;        ///< buffer_size bytes for each datagram in a batch
+                                               ///< (or for the one datagram being received)
+  std::vector<size_t> received_sizes_;         ///< size of each datagram in a batch
+  std::vector<Socket::Info> received_senders_; ///< sender of each datagram in a batch
+#if defined(__linux__)
+  std::vector<struct mmsghdr> receive_messages_; ///< headers for recvmmsg
+  std::vector<struct iovec> receive_iovecs_;     ///< one iovec per buffer for recvmmsg
+#endif
 };
 } // namespace espp
@@ -1,4 +1,9 @@
 #include "socket.hpp"
+#include "socket_reactor.hpp"
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#endif
 
 using namespace espp;
 
@@ -22,7 +27,7 @@ struct sockaddr_in6 *Socket::Info::ipv6_ptr() {
 void Socket::Info::update() {
   if (raw.ss_family == PF_INET) {
     address = inet_ntoa(((struct sockaddr_in *)&raw)->sin_addr);
-    port = ((struct sockaddr_in *)&raw)->sin_port;
+    port = ntohs(((struct sockaddr_in *)&raw)->sin_port);
   } else if (raw.ss_family == PF_INET6) {
 #if defined(ESP_PLATFORM)
     address = inet_ntoa(((struct sockaddr_in6 *)&raw)->sin6_addr);
@@ -31,7 +36,7 @@ void Socket::Info::update() {
     inet_ntop(AF_INET6, &(((struct sockaddr_in6 *)&raw)->sin6_addr), str, INET6_ADDRSTRLEN);
     address = str;
 #endif
-    port = ((struct sockaddr_in6 *)&raw)->sin6_port;
+    port = ntohs(((struct sockaddr_in6 *)&raw)->sin6_port);
   }
 }
 
@@ -43,7 +48,7 @@ void Socket::Info::from_sockaddr(const struct sockaddr_storage &source_address)
 void Socket::Info::from_sockaddr(const struct sockaddr_in &source_address) {
   memcpy(&raw, &source_address, sizeof(source_address));
   address = inet_ntoa(source_address.sin_addr);
-  port = source_address.sin_port;
+  port = ntohs(source_address.sin_port);
 }
 
 void Socket::Info::from_sockaddr(const struct sockaddr_in6 &source_address) {
@@ -54,7 +59,7 @@ void Socket::Info::from_sockaddr(const struct sockaddr_in6 &source_address) {
   inet_ntop(AF_INET6, &(source_address.sin6_addr), str, INET6_ADDRSTRLEN);
   address = str;
 #endif
-  port = source_address.sin6_port;
+  port = ntohs(source_address.sin6_port);
   memcpy(&raw, &source_address, sizeof(source_address));
 }
 
@@ -109,6 +114,8 @@ bool Socket::is_valid_fd(sock_type_t socket_fd) {
 #endif
 }
 
+sock_type_t Socket::get_socket_fd() const { return socket_; }
+
 std::optional<Socket::Info> Socket::get_ipv4_info() {
   struct sockaddr_storage addr;
   socklen_t addr_len = sizeof(addr);
@@ -278,6 +285,36 @@ int Socket::select(const std::chrono::microseconds &timeout) {
   return retval;
 }
 
+bool Socket::set_non_blocking(bool non_blocking) {
+#ifdef _MSC_VER
+  u_long mode = non_blocking ? 1 : 0;
+  if (ioctlsocket(socket_, FIONBIO, &mode) != 0) {
+    logger_.error("Couldn't set FIONBIO: {}", error_string());
+    return false;
+  }
+#else
+  int flags = fcntl(socket_, F_GETFL, 0);
+  if (flags < 0) {
+    logger_.error("Couldn't get socket flags: {}", error_string());
+    return false;
+  }
+  flags = non_blocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+  if (fcntl(socket_, F_SETFL, flags) < 0) {
+    logger_.error("Couldn't set O_NONBLOCK: {}", error_string());
+    return false;
+  }
+#endif
+  return true;
+}
+
+void Socket::detach_from_reactor() {
+  if (reactor_) {
+    reactor_->remove(reactor_handler_id_);
+    reactor_.reset();
+    reactor_handler_id_ = SocketReactor::INVALID_HANDLER_ID;
+  }
+}
+
 bool Socket::init(Socket::Type type) {
   // actually make the socket
   socket_ = socket(address_family_, (int)type, ip_protocol_);
@@ -301,6 +338,14 @@ std::string Socket::error_string() const {
 #endif
 }
 
+bool Socket::would_block() const {
+#ifdef _MSC_VER
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
 std::string Socket::error_string(int err) const {
 #ifdef _MSC_VER
   if (err == WSAEWOULDBLOCK) {
@@ -328,20 +373,22 @@ std::string Socket::error_string(int err) const {
 }
 
 void Socket::cleanup() {
+  // stop the reactor from waiting for the socket before it is closed
+  detach_from_reactor();
   if (is_valid()) {
-    int status = 0;
+    // invalidate the socket before shutting it down, so that a task which is
+    // woken from a receive by the shutdown sees that the socket is closed.
+    // NOTE: shutdown fails (ENOTCONN) on an unconnected UDP socket, though it
+    // still wakes a blocked receive, so the socket is closed regardless.
+    auto socket = socket_;
 #ifdef _MSC_VER
-    status = shutdown(socket_, SD_BOTH);
-    if (status == 0) {
-      closesocket(socket_);
-    }
     socket_ = INVALID_SOCKET;
+    shutdown(socket, SD_BOTH);
+    closesocket(socket);
 #else
-    status = shutdown(socket_, SHUT_RDWR);
-    if (status == 0) {
-      close(socket_);
-    }
     socket_ = -1;
+    shutdown(socket, SHUT_RDWR);
+    close(socket);
 #endif
 
     logger_.info("Closed socket");
@@ -0,0 +1,376 @@
+#include "socket_reactor.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#elif !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/select.h>
+#endif
+
+using namespace espp;
+
+#if defined(__linux__)
+static uint32_t get_epoll_events(const SocketReactor::Events &interest) {
+  uint32_t events = 0;
+  if (interest.readable) {
+    events |= EPOLLIN;
+  }
+  if (interest.writable) {
+    events |= EPOLLOUT;
+  }
+  return events;
+}
+#else
+static int get_last_error() {
+#ifdef _MSC_VER
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+#endif
+
+SocketReactor::SocketReactor(const SocketReactor::Config &config)
+    : BaseComponent(config.name, config.log_level) {
+  // set the logger rate limit
+  logger_.set_rate_limit(std::chrono::milliseconds(100));
+#if defined(__linux__)
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    logger_.error("Could not create epoll instance: {}", strerror(errno));
+  }
+  epoll_events_.resize(std::max<size_t>(1, config.max_events));
+#endif
+  if (!init_wake()) {
+    logger_.error("Could not create the wake socket, sockets added while waiting may not be "
+                  "waited for until another socket is ready");
+  }
+  running_ = true;
+  // make the task
+  task_ = espp::Task::make_unique({
+      .callback = [this]() -> bool { return task_callback(); },
+      .task_config =
+          {
+              .name = std::string(config.name) + "_task",
+              .stack_size_bytes = config.stack_size_bytes,
+              .priority = config.priority,
+              .core_id = config.core_id,
+          },
+      .log_level = config.log_level,
+  });
+  task_->start();
+}
+
+std::shared_ptr<SocketReactor> SocketReactor::make_shared(const SocketReactor::Config &config) {
+  return std::make_shared<SocketReactor>(config);
+}
+
+SocketReactor::~SocketReactor() {
+  logger_.info("stopping");
+  running_ = false;
+  wake();
+  task_->stop();
+  if (!entries_.empty()) {
+    logger_.warn("destroyed with {} sockets still attached", entries_.size());
+  }
+#if defined(__linux__)
+  if (wake_fd_ >= 0) {
+    close(wake_fd_);
+  }
+  if (epoll_fd_ >= 0) {
+    close(epoll_fd_);
+  }
+#elif defined(_MSC_VER)
+  if (wake_socket_ != INVALID_SOCKET) {
+    closesocket(wake_socket_);
+  }
+  WSACleanup();
+#else
+  if (wake_socket_ >= 0) {
+    close(wake_socket_);
+  }
+#endif
+}
+
+SocketReactor::handler_id_t SocketReactor::add(sock_type_t socket_fd, const Events &interest,
+                                               const callback_fn &callback) {
+  if (!Socket::is_valid_fd(socket_fd)) {
+    logger_.error("cannot add an invalid socket");
+    return INVALID_HANDLER_ID;
+  }
+#if !defined(__linux__) && !defined(_MSC_VER)
+  if (socket_fd >= FD_SETSIZE) {
+    logger_.error("cannot add socket {}, select only supports sockets < {}", socket_fd,
+                  FD_SETSIZE);
+    return INVALID_HANDLER_ID;
+  }
+#endif
+  handler_id_t id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = next_id_++;
+    if (next_id_ == INVALID_HANDLER_ID) {
+      next_id_++;
+    }
+#if defined(__linux__)
+    struct epoll_event event = {};
+    event.events = get_epoll_events(interest);
+    event.data.u64 = id;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket_fd, &event) < 0) {
+      logger_.error("cannot add socket {}: {}", socket_fd, strerror(errno));
+      return INVALID_HANDLER_ID;
+    }
+#endif
+    entries_[id] = {
+        .socket_fd = socket_fd,
+        .interest = interest,
+        .callback = callback,
+    };
+    logger_.debug("added socket {} as {}, {} sockets total", socket_fd, id, entries_.size());
+  }
+#if !defined(__linux__)
+  // make the task wait for the new socket too
+  wake();
+#endif
+  return id;
+}
+
+bool SocketReactor::modify(handler_id_t id, const Events &interest) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it == entries_.end() || it->second.removed) {
+      logger_.error("cannot modify socket {}, it does not exist", id);
+      return false;
+    }
+    auto &entry = it->second;
+#if defined(__linux__)
+    struct epoll_event event = {};
+    event.events = get_epoll_events(interest);
+    event.data.u64 = id;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, entry.socket_fd, &event) < 0) {
+      logger_.error("cannot modify socket {}: {}", id, strerror(errno));
+      return false;
+    }
+#endif
+    entry.interest = interest;
+  }
+#if !defined(__linux__)
+  // make the task wait for the new events
+  wake();
+#endif
+  return true;
+}
+
+void SocketReactor::remove(handler_id_t id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it == entries_.end() || it->second.removed) {
+    return;
+  }
+  auto &entry = it->second;
+#if defined(__linux__)
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, entry.socket_fd, nullptr) < 0) {
+    logger_.warn("cannot remove socket {} from epoll: {}", id, strerror(errno));
+  }
+#endif
+  if (entry.executing) {
+    if (in_reactor_task()) {
+      // the socket is being removed from within a callback, let the task
+      // erase it once the callback returns
+      entry.removed = true;
+      return;
+    }
+    done_cv_.wait(lock, [&entry] { return !entry.executing; });
+  }
+  entries_.erase(id);
+  logger_.debug("removed socket {}, {} sockets total", id, entries_.size());
+#if !defined(__linux__)
+  lock.unlock();
+  // make the task stop waiting for the socket, which is about to be closed
+  wake();
+#endif
+}
+
+size_t SocketReactor::get_num_sockets() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+bool SocketReactor::in_reactor_task() const {
+  return task_ && Task::get_current_id() == task_->get_id();
+}
+
+bool SocketReactor::init_wake() {
+#if defined(__linux__)
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd_ < 0) {
+    return false;
+  }
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = INVALID_HANDLER_ID;
+  return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) == 0;
+#else
+#ifdef _MSC_VER
+  WSADATA wsa_data;
+  WSAStartup(MAKEWORD(1, 1), &wsa_data);
+#endif
+  // a UDP socket bound to an ephemeral loopback port, which is always in the
+  // read set, so that sending a datagram to it wakes up the select
+  wake_socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+  if (!Socket::is_valid_fd(wake_socket_)) {
+    return false;
+  }
+  wake_address_.sin_family = AF_INET;
+  wake_address_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  wake_address_.sin_port = 0;
+  if (bind(wake_socket_, (struct sockaddr *)&wake_address_, sizeof(wake_address_)) < 0) {
+    return false;
+  }
+  socklen_t address_len = sizeof(wake_address_);
+  if (getsockname(wake_socket_, (struct sockaddr *)&wake_address_, &address_len) < 0) {
+    return false;
+  }
+#ifdef _MSC_VER
+  u_long non_blocking = 1;
+  return ioctlsocket(wake_socket_, FIONBIO, &non_blocking) == 0;
+#else
+  int flags = fcntl(wake_socket_, F_GETFL, 0);
+  return fcntl(wake_socket_, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+#endif
+}
+
+void SocketReactor::wake() {
+#if defined(__linux__)
+  uint64_t value = 1;
+  [[maybe_unused]] auto written = write(wake_fd_, &value, sizeof(value));
+#else
+  char value = 0;
+  sendto(wake_socket_, &value, sizeof(value), 0, (struct sockaddr *)&wake_address_,
+         sizeof(wake_address_));
+#endif
+}
+
+void SocketReactor::clear_wake() {
+#if defined(__linux__)
+  uint64_t value;
+  [[maybe_unused]] auto num_read = read(wake_fd_, &value, sizeof(value));
+#else
+  char buffer[16];
+  while (recv(wake_socket_, buffer, sizeof(buffer), 0) > 0) {
+  }
+#endif
+}
+
+void SocketReactor::wait() {
+  ready_.clear();
+#if defined(__linux__)
+  int num_events = epoll_wait(epoll_fd_, epoll_events_.data(), epoll_events_.size(), -1);
+  if (num_events < 0) {
+    if (errno != EINTR) {
+      logger_.error("epoll_wait failed: {}", strerror(errno));
+    }
+    return;
+  }
+  for (int i = 0; i < num_events; i++) {
+    const auto &event = epoll_events_[i];
+    handler_id_t id = event.data.u64;
+    if (id == INVALID_HANDLER_ID) {
+      clear_wake();
+      continue;
+    }
+    ready_.push_back({id,
+                      {
+                          .readable = (event.events & EPOLLIN) != 0,
+                          .writable = (event.events & EPOLLOUT) != 0,
+                          .error = (event.events & (EPOLLERR | EPOLLHUP)) != 0,
+                      }});
+  }
+#else
+  fd_set readfds;
+  fd_set writefds;
+  FD_ZERO(&readfds);
+  FD_ZERO(&writefds);
+  FD_SET(wake_socket_, &readfds);
+  sock_type_t max_fd = wake_socket_;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    select_sockets_.clear();
+    for (const auto &[id, entry] : entries_) {
+      if (entry.removed) {
+        continue;
+      }
+      if (entry.interest.readable) {
+        FD_SET(entry.socket_fd, &readfds);
+      }
+      if (entry.interest.writable) {
+        FD_SET(entry.socket_fd, &writefds);
+      }
+      max_fd = std::max(max_fd, entry.socket_fd);
+      select_sockets_.push_back({id, entry.socket_fd});
+    }
+  }
+  int retval = ::select(max_fd + 1, &readfds, &writefds, nullptr, nullptr);
+  if (retval < 0) {
+    // a socket may have been removed and closed while we were waiting, in
+    // which case the next wait will no longer include it
+    logger_.debug("select failed: {}", get_last_error());
+    return;
+  }
+  if (FD_ISSET(wake_socket_, &readfds)) {
+    clear_wake();
+  }
+  for (const auto &[id, socket_fd] : select_sockets_) {
+    Events events{
+        .readable = FD_ISSET(socket_fd, &readfds) != 0,
+        .writable = FD_ISSET(socket_fd, &writefds) != 0,
+    };
+    if (events.readable || events.writable) {
+      ready_.push_back({id, events});
+    }
+  }
+#endif
+}
+
+void SocketReactor::dispatch(handler_id_t id, const Events &events) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it == entries_.end() || it->second.removed) {
+    // removed by an earlier callback in this batch
+    return;
+  }
+  // entries are not erased while they are executing, and references to the
+  // elements of an unordered_map stay valid when other elements are added,
+  // so the entry can be used without holding the lock
+  auto &entry = it->second;
+  entry.executing = true;
+  lock.unlock();
+  entry.callback(events);
+  lock.lock();
+  entry.executing = false;
+  if (entry.removed) {
+    entries_.erase(id);
+    logger_.debug("removed socket {}, {} sockets total", id, entries_.size());
+  }
+  lock.unlock();
+  done_cv_.notify_all();
+}
+
+bool SocketReactor::task_callback() {
+  if (!running_) {
+    return true;
+  }
+  wait();
+  for (const auto &[id, events] : ready_) {
+    if (!running_) {
+      break;
+    }
+    dispatch(id, events);
+  }
+  return !running_;
+}
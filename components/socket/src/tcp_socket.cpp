@@ -21,7 +21,23 @@ void TcpSocket::reinit() {
   init(Type::STREAM);
 }
 
-void TcpSocket::close() { ::close(socket_); }
+void TcpSocket::close() {
+  // stop the reactor from waiting for the socket before it is closed
+  detach_from_reactor();
+  if (!is_valid()) {
+    return;
+  }
+  // invalidate the socket before closing it, so that it is not closed again
+  // (e.g. when it is destroyed) after its descriptor may have been reused
+  auto socket = socket_;
+#ifdef _MSC_VER
+  socket_ = INVALID_SOCKET;
+#else
+  socket_ = -1;
+#endif
+  connected_ = false;
+  ::close(socket);
+}
 
 bool TcpSocket::is_connected() const { return connected_; }
 
@@ -65,16 +81,42 @@ bool TcpSocket::transmit(std::string_view data, const TransmitConfig &transmit_c
                   transmit_config.response_timeout.count(), error_string());
     return false;
   }
-  // write
+  // write, until all the data is sent, since a large write may only be
+  // partially sent
   logger_.info("Client sending {} bytes", data.size());
-  int num_bytes_sent = write(socket_, data.data(), data.size());
-  if (num_bytes_sent < 0) {
-    logger_.error("Error occurred during sending: {}", error_string());
-    // update our connection state here since remote end was likely closed...
-    connected_ = false;
-    return false;
+  size_t total_bytes_sent = 0;
+  while (total_bytes_sent < data.size()) {
+    int num_bytes_sent =
+        write(socket_, data.data() + total_bytes_sent, data.size() - total_bytes_sent);
+    if (num_bytes_sent < 0 && would_block()) {
+      // the socket is non-blocking and its send buffer is full, but it is
+      // still connected
+      if (total_bytes_sent == 0) {
+        // nothing was sent, so the caller can simply try again later
+        logger_.warn("Could not send without blocking");
+        return false;
+      }
+      // part of the data is already in the stream, so the rest has to follow
+      // it, or the remote would get a truncated message; wait until it can be
+      // sent
+      logger_.debug("Sent {} of {} bytes, waiting to send the rest", total_bytes_sent,
+                    data.size());
+      if (!wait_until_writable()) {
+        logger_.error("Could not wait to send the rest of the data: {}", error_string());
+        connected_ = false;
+        return false;
+      }
+      continue;
+    }
+    if (num_bytes_sent < 0) {
+      logger_.error("Error occurred during sending: {}", error_string());
+      // update our connection state here since remote end was likely closed...
+      connected_ = false;
+      return false;
+    }
+    total_bytes_sent += num_bytes_sent;
   }
-  logger_.debug("Client sent {} bytes", num_bytes_sent);
+  logger_.debug("Client sent {} bytes", total_bytes_sent);
   // we don't need to wait for a response and the socket is good;
   if (!transmit_config.wait_for_response) {
     return true;
@@ -101,6 +143,19 @@ bool TcpSocket::transmit(std::string_view data, const TransmitConfig &transmit_c
   return true;
 }
 
+bool TcpSocket::wait_until_writable() {
+  fd_set writefds;
+  fd_set exceptfds;
+  FD_ZERO(&writefds);
+  FD_ZERO(&exceptfds);
+  FD_SET(socket_, &writefds);
+  FD_SET(socket_, &exceptfds);
+  int nfds = socket_ + 1;
+  // no timeout, like a blocking write
+  int retval = ::select(nfds, nullptr, &writefds, &exceptfds, nullptr);
+  return retval > 0 && !FD_ISSET(socket_, &exceptfds);
+}
+
 bool TcpSocket::receive(std::vector<uint8_t> &data, size_t max_num_bytes) {
   // make some space for received data - put it on the heap so that our
   // stack usage doesn't change depending on max_num_bytes
@@ -195,6 +250,100 @@ std::unique_ptr<TcpSocket> TcpSocket::accept() {
   return std::unique_ptr<TcpSocket>(new TcpSocket(accepted_socket, connected_client_info));
 }
 
+bool TcpSocket::start_accepting(std::shared_ptr<SocketReactor> reactor,
+                                const accept_callback_fn &on_accept) {
+  if (!is_valid()) {
+    logger_.error("Socket invalid, cannot start accepting.");
+    return false;
+  }
+  if (!reactor || !on_accept) {
+    logger_.error("Reactor or accept callback invalid, cannot start accepting.");
+    return false;
+  }
+  if (reactor_) {
+    logger_.error("Socket is already attached to a reactor");
+    return false;
+  }
+  if (!set_non_blocking()) {
+    return false;
+  }
+  accept_callback_ = on_accept;
+  auto id = reactor->add(socket_, {.readable = true}, [this](const auto &) { handle_accept(); });
+  if (id == SocketReactor::INVALID_HANDLER_ID) {
+    logger_.error("Unable to add socket to reactor");
+    return false;
+  }
+  reactor_ = reactor;
+  reactor_handler_id_ = id;
+  return true;
+}
+
+bool TcpSocket::start_receiving(std::shared_ptr<SocketReactor> reactor,
+                                const ReactorReceiveConfig &config) {
+  if (!is_valid() || !is_connected()) {
+    logger_.error("Socket invalid or not connected, cannot start receiving.");
+    return false;
+  }
+  if (!reactor || !config.on_receive_callback || config.buffer_size == 0) {
+    logger_.error("Reactor, receive callback or buffer size invalid, cannot start receiving.");
+    return false;
+  }
+  if (reactor_) {
+    logger_.error("Socket is already attached to a reactor");
+    return false;
+  }
+  if (!set_non_blocking()) {
+    return false;
+  }
+  receive_callback_ = config.on_receive_callback;
+  disconnect_callback_ = config.on_disconnect_callback;
+  receive_buffer_.resize(config.buffer_size);
+  auto id = reactor->add(socket_, {.readable = true}, [this](const auto &) { handle_readable(); });
+  if (id == SocketReactor::INVALID_HANDLER_ID) {
+    logger_.error("Unable to add socket to reactor");
+    return false;
+  }
+  reactor_ = reactor;
+  reactor_handler_id_ = id;
+  return true;
+}
+
+void TcpSocket::handle_accept() {
+  // accept one connection; if there are more pending, the reactor will call
+  // this again
+  auto client = accept();
+  if (client) {
+    accept_callback_(std::move(client));
+  }
+}
+
+void TcpSocket::handle_readable() {
+  int num_bytes_received =
+      ::recv(socket_, (char *)receive_buffer_.data(), receive_buffer_.size(), 0);
+  if (num_bytes_received > 0) {
+    logger_.debug("Received {} bytes", num_bytes_received);
+    receive_callback_(std::span<const uint8_t>(receive_buffer_.data(), num_bytes_received));
+    return;
+  }
+  if (num_bytes_received < 0 && would_block()) {
+    // spurious wakeup, nothing to receive yet
+    return;
+  }
+  if (num_bytes_received == 0) {
+    logger_.warn("Remote socket closed!");
+  } else {
+    logger_.warn("Receive failed: {}", error_string());
+  }
+  connected_ = false;
+  // stop waiting for the socket, and call the disconnect callback last,
+  // since it may destroy this socket
+  detach_from_reactor();
+  if (disconnect_callback_) {
+    auto on_disconnect = disconnect_callback_;
+    on_disconnect();
+  }
+}
+
 TcpSocket::TcpSocket(sock_type_t socket_fd, const Socket::Info &remote_info)
     : Socket(socket_fd, Logger::Config{.tag = "TcpSocket", .level = Logger::Verbosity::WARN})
     , remote_info_(remote_info) {
@@ -1,14 +1,28 @@
 #include "udp_socket.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <netinet/udp.h>
+#endif
+
 using namespace espp;
 
 UdpSocket::UdpSocket(const UdpSocket::Config &config)
-    : Socket(Type::DGRAM, Logger::Config{.tag = "UdpSocket", .level = config.log_level}) {}
+    : Socket(Type::DGRAM, Logger::Config{.tag = "UdpSocket", .level = config.log_level}) {
+#if defined(__linux__) && defined(UDP_SEGMENT)
+  gso_enabled_ = config.enable_gso;
+#endif
+}
 
 UdpSocket::~UdpSocket() {
   // we have to explicitly call cleanup here so that the server recvfrom
   // will return and the task can stop.
   cleanup();
+  // stop the task before the receive callback it uses is destroyed
+  task_.reset();
 }
 
 bool UdpSocket::send(const std::vector<uint8_t> &data, const UdpSocket::SendConfig &send_config) {
@@ -16,6 +30,15 @@ bool UdpSocket::send(const std::vector<uint8_t> &data, const UdpSocket::SendConf
 }
 
 bool UdpSocket::send(std::string_view data, const UdpSocket::SendConfig &send_config) {
+  return send(std::span<const std::string_view>(&data, 1), send_config);
+}
+
+bool UdpSocket::send(std::span<const std::string_view> buffers,
+                     const UdpSocket::SendConfig &send_config) {
+  if (buffers.size() > MAX_SEND_BUFFERS) {
+    logger_.error("Cannot send {} buffers, the maximum is {}", buffers.size(), MAX_SEND_BUFFERS);
+    return false;
+  }
   if (!is_valid()) {
     logger_.error("Socket invalid, cannot send");
     return false;
@@ -39,10 +62,13 @@ bool UdpSocket::send(std::string_view data, const UdpSocket::SendConfig &send_co
   Socket::Info server_info;
   server_info.init_ipv4(send_config.ip_address, send_config.port);
   auto server_address = server_info.ipv4_ptr();
-  logger_.info("Client sending {} bytes to {}:{}", data.size(), send_config.ip_address,
+  size_t num_bytes = 0;
+  for (const auto &buffer : buffers) {
+    num_bytes += buffer.size();
+  }
+  logger_.info("Client sending {} bytes to {}:{}", num_bytes, send_config.ip_address,
                send_config.port);
-  int num_bytes_sent = sendto(socket_, data.data(), data.size(), 0,
-                              (struct sockaddr *)server_address, sizeof(*server_address));
+  int num_bytes_sent = send_datagram(buffers, server_address);
   if (num_bytes_sent < 0) {
     logger_.error("Error occurred during sending: {}", error_string());
     return false;
@@ -72,8 +98,230 @@ bool UdpSocket::send(std::string_view data, const UdpSocket::SendConfig &send_co
   return true;
 }
 
+int UdpSocket::send_datagram(Datagram buffers, struct sockaddr_in *address) {
+  if (buffers.size() == 1) {
+    return sendto(socket_, buffers[0].data(), buffers[0].size(), 0, (struct sockaddr *)address,
+                  sizeof(*address));
+  }
+#ifdef _MSC_VER
+  WSABUF wsa_buffers[MAX_SEND_BUFFERS];
+  for (size_t i = 0; i < buffers.size(); i++) {
+    wsa_buffers[i].buf = const_cast<char *>(buffers[i].data());
+    wsa_buffers[i].len = static_cast<ULONG>(buffers[i].size());
+  }
+  DWORD num_sent = 0;
+  if (WSASendTo(socket_, wsa_buffers, static_cast<DWORD>(buffers.size()), &num_sent, 0,
+                (struct sockaddr *)address, sizeof(*address), nullptr, nullptr) != 0) {
+    return -1;
+  }
+  return static_cast<int>(num_sent);
+#else
+  struct iovec iov[MAX_SEND_BUFFERS];
+  for (size_t i = 0; i < buffers.size(); i++) {
+    iov[i].iov_base = const_cast<char *>(buffers[i].data());
+    iov[i].iov_len = buffers[i].size();
+  }
+  struct msghdr message = {};
+  message.msg_name = address;
+  message.msg_namelen = sizeof(*address);
+  message.msg_iov = iov;
+  message.msg_iovlen = buffers.size();
+  return sendmsg(socket_, &message, 0);
+#endif
+}
+
+size_t UdpSocket::send_batch(std::span<const Datagram> datagrams,
+                             const UdpSocket::SendConfig &send_config) {
+  if (!is_valid()) {
+    logger_.error("Socket invalid, cannot send");
+    return 0;
+  }
+  if (send_config.wait_for_response) {
+    logger_.warn("send_batch does not wait for responses");
+  }
+  for (size_t i = 0; i < datagrams.size(); i++) {
+    if (datagrams[i].size() > MAX_SEND_BUFFERS) {
+      logger_.error("Cannot send {} buffers, the maximum is {}", datagrams[i].size(),
+                    MAX_SEND_BUFFERS);
+      // only send the datagrams before it
+      datagrams = datagrams.first(i);
+      break;
+    }
+  }
+  if (send_config.is_multicast_endpoint) {
+    // configure it for multicast
+    if (!make_multicast()) {
+      logger_.error("Cannot make multicast: {}", error_string());
+      return 0;
+    }
+  }
+  Socket::Info server_info;
+  server_info.init_ipv4(send_config.ip_address, send_config.port);
+  auto server_address = server_info.ipv4_ptr();
+  logger_.info("Client sending {} datagrams to {}:{}", datagrams.size(), send_config.ip_address,
+               send_config.port);
+  std::lock_guard<std::mutex> lock(send_batch_mutex_);
+  size_t num_sent = 0;
+  while (num_sent < datagrams.size()) {
+    auto remaining = datagrams.subspan(num_sent);
+    int num_sent_now = 0;
+#if defined(__linux__)
+    if (gso_enabled_) {
+      // send the datagrams before the next run which can use GSO with
+      // sendmmsg, then send the run with GSO
+      size_t num_before_run = 0;
+      size_t run_length = 1;
+      while (num_before_run < remaining.size() && num_before_run < MAX_SEND_BATCH_SIZE) {
+        run_length = get_gso_run_length(remaining.subspan(num_before_run));
+        if (run_length > 1) {
+          break;
+        }
+        num_before_run++;
+      }
+      if (num_before_run > 0) {
+        num_sent_now = send_mmsg(remaining.first(num_before_run), server_address);
+      } else {
+        num_sent_now = send_gso(remaining.first(run_length), server_address);
+        if (num_sent_now > 0) {
+          gso_works_ = true;
+        } else if (num_sent_now < 0 && (errno == ENOPROTOOPT || errno == EOPNOTSUPP ||
+                                        (!gso_works_ && (errno == EINVAL || errno == EIO)))) {
+          // the kernel (or the network interface) does not support GSO, so
+          // don't use it again and retry without it
+          logger_.info("UDP GSO is not supported ({}), using sendmmsg", error_string());
+          gso_enabled_ = false;
+          continue;
+        } else if (num_sent_now < 0 && (errno == EINVAL || errno == EIO)) {
+          // GSO has worked before, so it is only this run which it cannot
+          // send (e.g. it is too large for the route), so send it without
+          logger_.debug("UDP GSO failed for {} datagrams ({}), using sendmmsg", run_length,
+                        error_string());
+          num_sent_now = send_mmsg(remaining.first(run_length), server_address);
+        }
+      }
+    } else {
+      num_sent_now = send_mmsg(remaining.first(std::min(remaining.size(), MAX_SEND_BATCH_SIZE)),
+                               server_address);
+    }
+#else
+    num_sent_now = send_datagram(remaining[0], server_address) < 0 ? -1 : 1;
+#endif
+    if (num_sent_now <= 0) {
+      logger_.error("Error occurred during sending: {}", error_string());
+      break;
+    }
+    num_sent += num_sent_now;
+  }
+  logger_.debug("Client sent {} of {} datagrams", num_sent, datagrams.size());
+  return num_sent;
+}
+
+#if defined(__linux__)
+static size_t get_datagram_size(UdpSocket::Datagram datagram) {
+  size_t size = 0;
+  for (const auto &buffer : datagram) {
+    size += buffer.size();
+  }
+  return size;
+}
+
+size_t UdpSocket::get_gso_run_length(std::span<const Datagram> datagrams) {
+#if defined(UDP_SEGMENT)
+  // the total size of the run must fit in one (IPv4) UDP datagram
+  static constexpr size_t max_run_size = 65535 - 20 - 8;
+  size_t segment_size = get_datagram_size(datagrams[0]);
+  if (segment_size == 0) {
+    return 1;
+  }
+  size_t run_size = segment_size;
+  size_t run_length = 1;
+  while (run_length < datagrams.size() && run_length < MAX_SEND_BATCH_SIZE) {
+    size_t size = get_datagram_size(datagrams[run_length]);
+    if (size == 0 || size > segment_size || run_size + size > max_run_size) {
+      break;
+    }
+    run_size += size;
+    run_length++;
+    if (size < segment_size) {
+      // only the last segment may be smaller
+      break;
+    }
+  }
+  return run_length;
+#else
+  return 1;
+#endif
+}
+
+int UdpSocket::send_gso(std::span<const Datagram> datagrams, struct sockaddr_in *address) {
+#if defined(UDP_SEGMENT)
+  send_iovecs_.clear();
+  for (const auto &datagram : datagrams) {
+    for (const auto &buffer : datagram) {
+      send_iovecs_.push_back({const_cast<char *>(buffer.data()), buffer.size()});
+    }
+  }
+  // tell the kernel the size of each segment (all but the last are the same)
+  uint16_t segment_size = get_datagram_size(datagrams[0]);
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(segment_size))] = {};
+  struct msghdr message = {};
+  message.msg_name = address;
+  message.msg_namelen = sizeof(*address);
+  message.msg_iov = send_iovecs_.data();
+  message.msg_iovlen = send_iovecs_.size();
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = IPPROTO_UDP;
+  cmsg->cmsg_type = UDP_SEGMENT;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(segment_size));
+  std::memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+  if (sendmsg(socket_, &message, 0) < 0) {
+    return -1;
+  }
+  return datagrams.size();
+#else
+  errno = EOPNOTSUPP;
+  return -1;
+#endif
+}
+
+int UdpSocket::send_mmsg(std::span<const Datagram> datagrams, struct sockaddr_in *address) {
+  // size the buffers first, so that they don't move while we point into them
+  size_t num_buffers = 0;
+  for (const auto &datagram : datagrams) {
+    num_buffers += datagram.size();
+  }
+  send_iovecs_.resize(num_buffers);
+  send_messages_.resize(datagrams.size());
+  size_t iovec_index = 0;
+  for (size_t i = 0; i < datagrams.size(); i++) {
+    auto *iov = send_iovecs_.data() + iovec_index;
+    for (const auto &buffer : datagrams[i]) {
+      send_iovecs_[iovec_index++] = {const_cast<char *>(buffer.data()), buffer.size()};
+    }
+    auto &header = send_messages_[i].msg_hdr;
+    header = {};
+    header.msg_name = address;
+    header.msg_namelen = sizeof(*address);
+    header.msg_iov = iov;
+    header.msg_iovlen = datagrams[i].size();
+  }
+  return sendmmsg(socket_, send_messages_.data(), datagrams.size(), 0);
+}
+#endif
+
 bool UdpSocket::receive(size_t max_num_bytes, std::vector<uint8_t> &data,
                         Socket::Info &remote_info) {
+  // put it on the heap so that our stack usage doesn't change depending on
+  // max_num_bytes. each call has its own buffer, so that receive() can be
+  // called from several threads at once
+  std::unique_ptr<uint8_t[]> receive_buffer(new uint8_t[max_num_bytes]);
+  return receive_into(receive_buffer.get(), max_num_bytes, data, remote_info);
+}
+
+bool UdpSocket::receive_into(uint8_t *buffer, size_t max_num_bytes, std::vector<uint8_t> &data,
+                             Socket::Info &remote_info) {
   if (!is_valid()) {
     logger_.error("Socket invalid, cannot receive.");
     return false;
@@ -81,49 +329,137 @@ bool UdpSocket::receive(size_t max_num_bytes, std::vector<uint8_t> &data,
   // recvfrom
   auto remote_address = remote_info.ipv4_ptr();
   socklen_t socklen = sizeof(*remote_address);
-  // put it on the heap so that our stack usage doesn't change depending on
-  // max_num_bytes
-  std::unique_ptr<uint8_t[]> receive_buffer(new uint8_t[max_num_bytes]());
   // now actually receive
   logger_.info("Receiving up to {} bytes", max_num_bytes);
-  int num_bytes_received = recvfrom(socket_, (char *)receive_buffer.get(), max_num_bytes, 0,
+  int num_bytes_received = recvfrom(socket_, (char *)buffer, max_num_bytes, 0,
                                     (struct sockaddr *)remote_address, &socklen);
   // if we didn't receive anything return false and don't do anything else
   if (num_bytes_received < 0) {
     logger_.info("Receive failed: {}", error_string());
     return false;
   }
-  // we received data, so call the callback function if one was provided.
-  uint8_t *data_ptr = (uint8_t *)receive_buffer.get();
-  data.assign(data_ptr, data_ptr + num_bytes_received);
+  // only the bytes actually received are copied, and the data's storage is
+  // reused if it is already large enough
+  data.assign(buffer, buffer + num_bytes_received);
   remote_info.update();
   logger_.debug("Received {} bytes from {}", num_bytes_received, remote_info);
   return true;
 }
 
-bool UdpSocket::start_receiving(Task::BaseConfig &task_config,
-                                const UdpSocket::ReceiveConfig &receive_config) {
-  if (task_ && task_->is_started()) {
-    logger_.error("Server is alrady receiving");
-    return false;
+int UdpSocket::receive_batch() {
+  if (!is_valid()) {
+    logger_.error("Socket invalid, cannot receive.");
+    return -1;
+  }
+  int max_batch_size = static_cast<int>(received_sizes_.size());
+  int num_received = 0;
+#if defined(__linux__)
+  // recvmmsg overwrites the address lengths, so reset them for each batch
+  for (auto &message : receive_messages_) {
+    message.msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+  }
+  // block until the first datagram arrives, then take any others which are
+  // already queued, all in one call
+  num_received =
+      recvmmsg(socket_, receive_messages_.data(), max_batch_size, MSG_WAITFORONE, nullptr);
+  for (int i = 0; i < num_received; i++) {
+    received_sizes_[i] = receive_messages_[i].msg_len;
+  }
+#else
+  while (num_received < max_batch_size) {
+    auto remote_address = received_senders_[num_received].ipv4_ptr();
+    socklen_t socklen = sizeof(struct sockaddr_storage);
+#if defined(_MSC_VER)
+    // there is no per-call non-blocking flag, so receive one at a time
+    int flags = 0;
+#else
+    // block until the first datagram arrives, then only take the ones which
+    // are already queued
+    int flags = num_received == 0 ? 0 : MSG_DONTWAIT;
+#endif
+    int num_bytes_received = recvfrom(
+        socket_, (char *)receive_buffer_.data() + num_received * receive_buffer_size_,
+        receive_buffer_size_, flags, (struct sockaddr *)remote_address, &socklen);
+    if (num_bytes_received < 0) {
+      break;
+    }
+    received_sizes_[num_received++] = num_bytes_received;
+#if defined(_MSC_VER)
+    break;
+#endif
   }
+  if (num_received == 0) {
+    num_received = -1;
+  }
+#endif
+  if (num_received < 0) {
+    logger_.info("Receive failed: {}", error_string());
+    return -1;
+  }
+  logger_.debug("Received {} datagrams", num_received);
+  return num_received;
+}
+
+bool UdpSocket::bind(int port) {
   if (!is_valid()) {
-    logger_.error("Socket invalid, cannot start receiving.");
+    logger_.error("Socket invalid, cannot bind.");
     return false;
   }
-  server_receive_callback_ = receive_config.on_receive_callback;
-  // bind
   struct sockaddr_in server_addr;
   // configure the server socket accordingly - assume IPV4 and bind to the
   // any address "0.0.0.0"
   server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
   server_addr.sin_family = address_family_;
-  server_addr.sin_port = htons(receive_config.port);
-  int err = bind(socket_, (struct sockaddr *)&server_addr, sizeof(server_addr));
+  server_addr.sin_port = htons(port);
+  auto err = ::bind(socket_, (struct sockaddr *)&server_addr, sizeof(server_addr));
   if (err < 0) {
     logger_.error("Unable to bind: {}", error_string());
     return false;
   }
+  return true;
+}
+
+bool UdpSocket::init_receiving(const UdpSocket::ReceiveConfig &receive_config) {
+  if ((task_ && task_->is_started()) || reactor_) {
+    logger_.error("Server is alrady receiving");
+    return false;
+  }
+  if (!is_valid()) {
+    logger_.error("Socket invalid, cannot start receiving.");
+    return false;
+  }
+  server_receive_callback_ = receive_config.on_receive_callback;
+  server_receive_span_callback_ = receive_config.on_receive_span_callback;
+  if (server_receive_span_callback_) {
+    // allocate the buffers for the batches up front, so that receiving does
+    // not allocate
+    size_t max_batch_size = std::max<size_t>(1, receive_config.max_batch_size);
+    receive_buffer_size_ = receive_config.buffer_size;
+    receive_buffer_.resize(max_batch_size * receive_config.buffer_size);
+    received_sizes_.resize(max_batch_size);
+    received_senders_.resize(max_batch_size);
+#if defined(__linux__)
+    receive_messages_.resize(max_batch_size);
+    receive_iovecs_.resize(max_batch_size);
+    for (size_t i = 0; i < max_batch_size; i++) {
+      receive_iovecs_[i].iov_base = receive_buffer_.data() + i * receive_config.buffer_size;
+      receive_iovecs_[i].iov_len = receive_config.buffer_size;
+      auto &header = receive_messages_[i].msg_hdr;
+      header = {};
+      header.msg_name = received_senders_[i].ipv4_ptr();
+      header.msg_namelen = sizeof(struct sockaddr_storage);
+      header.msg_iov = &receive_iovecs_[i];
+      header.msg_iovlen = 1;
+    }
+#endif
+  } else {
+    // the receive task / reactor receives each datagram into the same buffer
+    receive_buffer_size_ = receive_config.buffer_size;
+    receive_buffer_.resize(receive_config.buffer_size);
+  }
+  if (!bind(receive_config.port)) {
+    return false;
+  }
   if (receive_config.is_multicast_endpoint) {
     // enable multicast
     if (!make_multicast()) {
@@ -136,24 +472,61 @@ bool UdpSocket::start_receiving(Task::BaseConfig &task_config,
       return false;
     }
   }
+  return true;
+}
+
+bool UdpSocket::start_receiving(Task::BaseConfig &task_config,
+                                const UdpSocket::ReceiveConfig &receive_config) {
+  if (!init_receiving(receive_config)) {
+    return false;
+  }
   // set the callback function
   using namespace std::placeholders;
   // start the thread
+  Task::callback_m_cv_notified_fn task_function;
+  if (server_receive_span_callback_) {
+    task_function = std::bind(&UdpSocket::batch_receive_task_function, this, _1, _2, _3);
+  } else {
+    task_function =
+        std::bind(&UdpSocket::server_task_function, this, receive_config.buffer_size, _1, _2, _3);
+  }
   task_ = Task::make_unique({
-      .callback =
-          std::bind(&UdpSocket::server_task_function, this, receive_config.buffer_size, _1, _2, _3),
+      .callback = task_function,
       .task_config = task_config,
   });
   task_->start();
   return true;
 }
 
+bool UdpSocket::start_receiving(std::shared_ptr<SocketReactor> reactor,
+                                const UdpSocket::ReceiveConfig &receive_config) {
+  if (!reactor) {
+    logger_.error("Reactor invalid, cannot start receiving.");
+    return false;
+  }
+  if (!init_receiving(receive_config)) {
+    return false;
+  }
+  if (!set_non_blocking()) {
+    return false;
+  }
+  size_t buffer_size = receive_config.buffer_size;
+  auto id = reactor->add(socket_, {.readable = true},
+                         [this, buffer_size](const auto &) { handle_readable(buffer_size); });
+  if (id == SocketReactor::INVALID_HANDLER_ID) {
+    logger_.error("Unable to add socket to reactor");
+    return false;
+  }
+  reactor_ = reactor;
+  reactor_handler_id_ = id;
+  return true;
+}
+
 bool UdpSocket::server_task_function(size_t buffer_size, std::mutex &m, std::condition_variable &cv,
                                      bool &task_notified) {
-  // receive data
-  std::vector<uint8_t> received_data;
+  // receive data, reusing the same buffers for each datagram
   Socket::Info sender_info;
-  if (!receive(buffer_size, received_data, sender_info)) {
+  if (!receive_into(receive_buffer_.data(), buffer_size, received_data_, sender_info)) {
     // if we failed to receive, then likely we should delay a little bit
     using namespace std::chrono_literals;
     std::unique_lock<std::mutex> lk(m);
@@ -164,15 +537,26 @@ bool UdpSocket::server_task_function(size_t buffer_size, std::mutex &m, std::con
     }
     return false;
   }
+  if (!is_valid()) {
+    // the socket was closed while we were receiving, so what we received is
+    // not a real packet and the task should stop
+    return true;
+  }
+  handle_datagram(sender_info);
+  // don't want to stop the task
+  return false;
+}
+
+void UdpSocket::handle_datagram(Socket::Info &sender_info) {
   if (!server_receive_callback_) {
     logger_.error("Server receive callback is invalid");
-    return false;
+    return;
   }
   // callback
-  auto maybe_response = server_receive_callback_(received_data, sender_info);
+  auto maybe_response = server_receive_callback_(received_data_, sender_info);
   // send if callback returned data
   if (!maybe_response.has_value()) {
-    return false;
+    return;
   }
   auto response = maybe_response.value();
   // sendto
@@ -184,6 +568,55 @@ bool UdpSocket::server_task_function(size_t buffer_size, std::mutex &m, std::con
     logger_.error("Error occurred responding: {}", error_string());
   }
   logger_.info("Server responded with {} bytes", num_bytes_sent);
+}
+
+bool UdpSocket::batch_receive_task_function(std::mutex &m, std::condition_variable &cv,
+                                            bool &task_notified) {
+  int num_received = receive_batch();
+  if (num_received < 0) {
+    // if we failed to receive, then likely we should delay a little bit
+    using namespace std::chrono_literals;
+    std::unique_lock<std::mutex> lk(m);
+    auto stop_requested = cv.wait_for(lk, 1ms, [&task_notified] { return task_notified; });
+    task_notified = false;
+    if (stop_requested) {
+      return true;
+    }
+    return false;
+  }
+  if (!is_valid()) {
+    // the socket was closed while we were receiving, so what we received is
+    // not a real packet and the task should stop
+    return true;
+  }
+  dispatch_batch(num_received);
   // don't want to stop the task
   return false;
 }
+
+void UdpSocket::dispatch_batch(int num_received) {
+  // pass each datagram to the callback, directly from its buffer
+  for (int i = 0; i < num_received; i++) {
+    auto &sender_info = received_senders_[i];
+    sender_info.update();
+    std::span<const uint8_t> data(receive_buffer_.data() + i * receive_buffer_size_,
+                                  received_sizes_[i]);
+    server_receive_span_callback_(data, sender_info);
+  }
+}
+
+void UdpSocket::handle_readable(size_t buffer_size) {
+  // receive what is available without blocking; if there is more than one
+  // batch / datagram, the reactor will call this again
+  if (server_receive_span_callback_) {
+    int num_received = receive_batch();
+    if (num_received > 0) {
+      dispatch_batch(num_received);
+    }
+    return;
+  }
+  Socket::Info sender_info;
+  if (receive_into(receive_buffer_.data(), buffer_size, received_data_, sender_info)) {
+    handle_datagram(sender_info);
+  }
+}
@@ -240,13 +240,13 @@ void Task::thread_function() {
   while (started_) {
     bool should_stop = false;
     if (std::holds_alternative<callback_m_cv_notified_fn>(callback_)) {
-      auto cb = std::get<callback_m_cv_notified_fn>(callback_);
+      auto &cb = std::get<callback_m_cv_notified_fn>(callback_);
       should_stop = cb(cv_m_, cv_, notified_);
     } else if (std::holds_alternative<callback_m_cv_fn>(callback_)) {
-      auto cb = std::get<callback_m_cv_fn>(callback_);
+      auto &cb = std::get<callback_m_cv_fn>(callback_);
       should_stop = cb(cv_m_, cv_);
     } else if (std::holds_alternative<callback_no_params_fn>(callback_)) {
-      auto cb = std::get<callback_no_params_fn>(callback_);
+      auto &cb = std::get<callback_no_params_fn>(callback_);
       should_stop = cb();
     } else {
       started_ = false;
@@ -10,6 +10,7 @@
 #include "high_resolution_timer.hpp"
 #include "logger.hpp"
 #include "timer.hpp"
+#include "timer_service.hpp"
 
 using namespace std::chrono_literals;
 
@@ -233,6 +234,37 @@ extern "C" void app_main(void) {
     std::this_thread::sleep_for(num_seconds_to_run * 1s);
   }
 
+  // timer service example
+  {
+    logger.info("Starting timer service example");
+    //! [timer service example]
+    // all timers attached to this service will run in the service's task,
+    // rather than each timer having its own task
+    auto timer_service = espp::TimerService::make_shared({
+        .name = "Timer Service",
+        .stack_size_bytes = 4096,
+        .log_level = espp::Logger::Verbosity::WARN,
+    });
+    static constexpr size_t num_timers = 10;
+    std::vector<std::unique_ptr<espp::Timer>> timers;
+    for (size_t i = 0; i < num_timers; i++) {
+      auto timer_fn = [i]() {
+        fmt::print("[{:.3f}] timer {} fired\n", elapsed(), i);
+        // we don't want to stop, so return false
+        return false;
+      };
+      timers.push_back(std::make_unique<espp::Timer>(
+          espp::Timer::Config{.name = "Service Timer",
+                              .period = std::chrono::milliseconds(500 + 100 * i),
+                              .callback = timer_fn,
+                              .timer_service = timer_service,
+                              .log_level = espp::Logger::Verbosity::WARN}));
+    }
+    logger.info("Created {} timers on the timer service", timer_service->get_num_timers());
+    //! [timer service example]
+    std::this_thread::sleep_for(num_seconds_to_run * 1s);
+  }
+
   // high resolution timer example
   {
     logger.info("Starting high resolution timer example");
@@ -6,6 +6,7 @@
 
 #include "base_component.hpp"
 #include "task.hpp"
+#include "timer_service.hpp"
 
 namespace espp {
 /// @brief A timer that can be used to schedule tasks to run at a later time.
@@ -28,6 +29,13 @@ namespace espp {
 ///          automatically, then the timer can be started by calling start().
 ///          The timer can be canceled at any time by calling cancel().
 ///
+///          Instead of running in its own task, the timer can optionally be
+///          attached to a shared espp::TimerService by setting the
+///          `timer_service` field of the Config. In this case the timer
+///          callback will be called in the context of the service's task
+///          (which is shared with all other timers attached to that service),
+///          and no task is created for the timer.
+///
 /// @note The timer uses a task to run in the background, so the timer
 ///       callback function will be called in the context of the task. The
 ///       timer callback function should not block for a long time because it
@@ -51,6 +59,8 @@ namespace espp {
 /// \snippet timer_example.cpp timer update period example
 /// \section timer_ex8 Timer AdvancedConfig Example
 /// \snippet timer_example.cpp timer advanced config example
+/// \section timer_ex9 Timer Service Example
+/// \snippet timer_example.cpp timer service example
 class Timer : public BaseComponent {
 public:
   typedef std::function<bool()>
@@ -68,6 +78,9 @@ public:
     size_t stack_size_bytes{4096}; ///< The stack size of the task that runs the timer.
     size_t priority{0}; ///< Priority of the timer, 0 is lowest priority on ESP / FreeRTOS.
     int core_id{-1};    ///< Core ID of the timer, -1 means it is not pinned to any core.
+    std::shared_ptr<espp::TimerService> timer_service{
+        nullptr}; ///< Optional timer service to run the timer on. If set, no task is created for
+                  ///< the timer and stack_size_bytes, priority, and core_id are ignored.
     espp::Logger::Verbosity log_level =
         espp::Logger::Verbosity::WARN; ///< The log level for the timer.
   };
@@ -124,6 +137,8 @@ public:
   /// @note This function is only available on ESP
   /// @note This function will do nothing unless CONFIG_ESP_TASK_WDT_EN is
   ///       enabled in the menuconfig. Default is y (enabled).
+  /// @note This function will do nothing if the timer is attached to a
+  ///       TimerService.
   /// @see stop_watchdog()
   /// @see Task::start_watchdog()
   /// @see Task::stop_watchdog()
@@ -134,6 +149,8 @@ public:
   /// @note This function is only available on ESP
   /// @note This function will do nothing unless CONFIG_ESP_TASK_WDT_EN is
   ///       enabled in the menuconfig. Default is y (enabled).
+  /// @note This function will do nothing if the timer is attached to a
+  ///       TimerService.
   /// @see start_watchdog()
   /// @see Task::start_watchdog()
   /// @see Task::stop_watchdog()
@@ -156,6 +173,7 @@ public:
 
 protected:
   bool timer_callback_fn(std::mutex &m, std::condition_variable &cv, bool &task_notified);
+  bool service_callback_fn();
 
   std::chrono::microseconds period_{0}; ///< The period of the timer. If 0, the timer will run once.
   std::chrono::microseconds delay_{0};  ///< The delay before the timer starts.
@@ -164,5 +182,9 @@ protected:
   float delay_float;
   callback_fn callback_;             ///< The callback function to call when the timer expires.
   std::unique_ptr<espp::Task> task_; ///< The task that runs the timer.
+  std::shared_ptr<espp::TimerService>
+      timer_service_; ///< The timer service that runs the timer, if any (instead of task_).
+  espp::TimerService::timer_id_t timer_id_{
+      espp::TimerService::INVALID_TIMER_ID}; ///< The id of the timer within timer_service_.
 };
 } // namespace espp
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base_component.hpp"
+#include "task.hpp"
+
+namespace espp {
+/// @brief A service which runs the callbacks of many timers from a single task.
+/// @details Each espp::Timer normally creates its own espp::Task, which means
+///          each timer has its own thread / FreeRTOS task and stack. When a
+///          system has many periodic timers, the memory used by those stacks
+///          can become significant. The TimerService instead keeps all of its
+///          timers in a min-heap ordered by expiry time and runs their
+///          callbacks from a single task, which sleeps until the next timer
+///          expires (or until a timer with an earlier expiry is started).
+///
+///          Timers can be attached to a TimerService by setting the
+///          `timer_service` field of espp::Timer::Config. The timer API is
+///          otherwise unchanged.
+///
+///          Periodic timers are rescheduled relative to their previous expiry
+///          time (not relative to when their callback ran), so jitter from one
+///          callback does not accumulate into drift. If a timer falls behind
+///          by more than one period, it is rescheduled to run immediately.
+///
+/// @note All timers attached to a TimerService share the same task context,
+///       so the stack size of the service should be set to accommodate the
+///       largest timer callback, and a timer callback which blocks for a
+///       long time will delay all other timers on the same service. If you
+///       have timers which need to run independently of each other, you can
+///       spread them across multiple TimerService objects (e.g. one per
+///       priority level or per core).
+///
+/// \section timer_service_ex1 Timer Service Example
+/// \snippet timer_example.cpp timer service example
+class TimerService : public BaseComponent {
+public:
+  /// The callback function type. Return true to cancel the timer.
+  typedef std::function<bool()> callback_fn;
+
+  /// The type used to identify timers within the service.
+  using timer_id_t = uint32_t;
+
+  /// The invalid timer id, returned when a timer could not be added.
+  static constexpr timer_id_t INVALID_TIMER_ID = 0;
+
+  /// @brief The configuration for the timer service.
+  struct Config {
+    std::string_view name{"TimerService"}; ///< The name of the timer service.
+    size_t stack_size_bytes{4096};         ///< The stack size of the task that runs the timers.
+    size_t priority{0}; ///< Priority of the service task, 0 is lowest priority on ESP / FreeRTOS.
+    int core_id{-1};    ///< Core ID of the service task, -1 means it is not pinned to any core.
+    espp::Logger::Verbosity log_level =
+        espp::Logger::Verbosity::WARN; ///< The log level for the timer service.
+  };
+
+  /// @brief Construct a new TimerService object and start its task.
+  /// @param config The configuration for the timer service.
+  explicit TimerService(const Config &config);
+
+  /// @brief Get a shared pointer to a new TimerService created with \p config.
+  /// @details Timers hold a shared pointer to the service they are attached to,
+  ///          so this is the recommended way to create a TimerService.
+  /// @param config The configuration for the timer service.
+  /// @return std::shared_ptr<TimerService> pointer to the new timer service.
+  static std::shared_ptr<TimerService> make_shared(const Config &config);
+
+  /// @brief Destroy the TimerService object
+  /// @details Stops the service task. No timer callbacks will be called after
+  ///          this returns.
+  ~TimerService();
+
+  /// @brief Add a timer to the service.
+  /// @details The timer is not started until start_timer() is called.
+  /// @param callback The callback function to call when the timer expires.
+  /// @param period The period of the timer. If 0, the timer will run once.
+  /// @return The id of the new timer.
+  timer_id_t add_timer(const callback_fn &callback, const std::chrono::microseconds &period);
+
+  /// @brief Remove a timer from the service.
+  /// @details Cancels the timer if it is running. If the timer's callback is
+  ///          currently running in the service task, this blocks until the
+  ///          callback returns (unless it is called from within the callback).
+  /// @param id The id of the timer to remove.
+  void remove_timer(timer_id_t id);
+
+  /// @brief Start a timer.
+  /// @details Does nothing if the timer is already running.
+  /// @param id The id of the timer to start.
+  /// @param delay The delay before the first execution of the timer callback.
+  /// @return true if the timer was started, false if it was already running
+  ///         or does not exist.
+  bool start_timer(timer_id_t id, const std::chrono::microseconds &delay);
+
+  /// @brief Cancel a timer.
+  /// @details If the timer's callback is currently running in the service
+  ///          task, this blocks until the callback returns (unless it is
+  ///          called from within the callback), so that no callback will be
+  ///          called for this timer after this returns.
+  /// @param id The id of the timer to cancel.
+  void cancel_timer(timer_id_t id);
+
+  /// @brief Set the period of a timer.
+  /// @details If the timer is running, the new period will be used after the
+  ///          current period has elapsed.
+  /// @param id The id of the timer.
+  /// @param period The new period of the timer. If 0, the timer will run once.
+  void set_period(timer_id_t id, const std::chrono::microseconds &period);
+
+  /// @brief Check if a timer is running.
+  /// @param id The id of the timer.
+  /// @return true if the timer is running, false otherwise.
+  bool is_timer_running(timer_id_t id) const;
+
+  /// @brief Get the number of timers attached to the service.
+  /// @return The number of timers attached to the service.
+  size_t get_num_timers() const;
+
+protected:
+  using clock = std::chrono::steady_clock;
+
+  struct Entry {
+    callback_fn callback;
+    std::chrono::microseconds period{0};
+    uint32_t generation{0}; ///< Incremented on start / cancel to invalidate stale heap items.
+    bool active{false};     ///< True if the timer has been started and not canceled / stopped.
+    bool executing{false};  ///< True while the callback is running in the service task.
+    bool removed{false};    ///< True if the timer was removed from within its own callback.
+  };
+
+  struct HeapItem {
+    clock::time_point expiry;
+    timer_id_t id;
+    uint32_t generation;
+  };
+
+  // comparator which makes std::push_heap / std::pop_heap a min-heap on expiry
+  static bool later(const HeapItem &lhs, const HeapItem &rhs) { return lhs.expiry > rhs.expiry; }
+
+  bool task_callback();
+  bool is_stale(const HeapItem &item) const;
+  void push(const HeapItem &item);
+  void compact();
+  bool in_service_task() const;
+
+  std::atomic<bool> running_{false};
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;      ///< Notified when the heap changes or the service stops.
+  std::condition_variable done_cv_; ///< Notified when a timer callback finishes.
+  timer_id_t next_id_{INVALID_TIMER_ID + 1};
+  std::unordered_map<timer_id_t, Entry> entries_;
+  std::vector<HeapItem> heap_;
+  std::unique_ptr<espp::Task> task_;
+};
+} // namespace espp
@@ -6,22 +6,28 @@ Timer::Timer(const Timer::Config &config)
     : BaseComponent(config.name, config.log_level)
     , period_(std::chrono::duration_cast<std::chrono::microseconds>(config.period))
     , delay_(std::chrono::duration_cast<std::chrono::microseconds>(config.delay))
-    , callback_(config.callback) {
+    , callback_(config.callback)
+    , timer_service_(config.timer_service) {
   // set the logger rate limit
   logger_.set_rate_limit(std::chrono::milliseconds(100));
-  // make the task
-  task_ = espp::Task::make_unique({
-      .callback = std::bind(&Timer::timer_callback_fn, this, std::placeholders::_1,
-                            std::placeholders::_2, std::placeholders::_3),
-      .task_config =
-          {
-              .name = std::string(config.name) + "_task",
-              .stack_size_bytes = config.stack_size_bytes,
-              .priority = config.priority,
-              .core_id = config.core_id,
-          },
-      .log_level = config.log_level,
-  });
+  if (timer_service_) {
+    // register with the timer service instead of making our own task
+    timer_id_ = timer_service_->add_timer(std::bind(&Timer::service_callback_fn, this), period_);
+  } else {
+    // make the task
+    task_ = espp::Task::make_unique({
+        .callback = std::bind(&Timer::timer_callback_fn, this, std::placeholders::_1,
+                              std::placeholders::_2, std::placeholders::_3),
+        .task_config =
+            {
+                .name = std::string(config.name) + "_task",
+                .stack_size_bytes = config.stack_size_bytes,
+                .priority = config.priority,
+                .core_id = config.core_id,
+            },
+        .log_level = config.log_level,
+    });
+  }
   period_float = std::chrono::duration<float>(period_).count();
   delay_float = std::chrono::duration<float>(delay_).count();
   if (config.auto_start) {
@@ -50,11 +56,23 @@ Timer::Timer(const Timer::AdvancedConfig &config)
   }
 }
 
-Timer::~Timer() { cancel(); }
+Timer::~Timer() {
+  cancel();
+  if (timer_service_) {
+    timer_service_->remove_timer(timer_id_);
+  }
+}
 
 void Timer::start() {
   logger_.info("starting with period {:.3f} s and delay {:.3f} s", period_float, delay_float);
   running_ = true;
+  if (timer_service_) {
+    // the delay is only used the first time the timer runs
+    timer_service_->start_timer(timer_id_, delay_);
+    delay_ = std::chrono::microseconds(0);
+    delay_float = 0;
+    return;
+  }
   // start the task
   task_->start();
 }
@@ -78,14 +96,30 @@ void Timer::stop() { cancel(); }
 void Timer::cancel() {
   logger_.info("canceling");
   running_ = false;
+  if (timer_service_) {
+    timer_service_->cancel_timer(timer_id_);
+    return;
+  }
   // cancel the task
   task_->stop();
 }
 
 #if defined(ESP_PLATFORM)
-bool Timer::start_watchdog() { return task_->start_watchdog(); }
+bool Timer::start_watchdog() {
+  if (!task_) {
+    logger_.warn("timer is attached to a timer service, cannot start watchdog");
+    return false;
+  }
+  return task_->start_watchdog();
+}
 
-bool Timer::stop_watchdog() { return task_->stop_watchdog(); }
+bool Timer::stop_watchdog() {
+  if (!task_) {
+    logger_.warn("timer is attached to a timer service, cannot stop watchdog");
+    return false;
+  }
+  return task_->stop_watchdog();
+}
 #endif
 
 void Timer::set_period(const std::chrono::duration<float> &period) {
@@ -96,9 +130,40 @@ void Timer::set_period(const std::chrono::duration<float> &period) {
   period_ = std::chrono::duration_cast<std::chrono::microseconds>(period);
   period_float = std::chrono::duration<float>(period_).count();
   logger_.info("setting period to {:.3f} s", period_float);
+  if (timer_service_) {
+    timer_service_->set_period(timer_id_, period_);
+  }
 }
 
-bool Timer::is_running() const { return running_ && task_->is_running(); }
+bool Timer::is_running() const {
+  if (timer_service_) {
+    return running_ && timer_service_->is_timer_running(timer_id_);
+  }
+  return running_ && task_->is_running();
+}
+
+bool Timer::service_callback_fn() {
+  if (!running_) {
+    // stop the timer, the timer was canceled
+    return true;
+  }
+  if (!callback_) {
+    // stop the timer, the callback is null
+    logger_.debug("callback is null, stopping");
+    running_ = false;
+    return true;
+  }
+  logger_.debug("running callback");
+  bool requested_stop = callback_();
+  if (requested_stop || period_float <= 0) {
+    // stop the timer if requested or if the period is <= 0
+    logger_.debug("callback requested stop or period is <= 0, stopping");
+    running_ = false;
+    return true;
+  }
+  // keep the timer running, the timer service will reschedule it
+  return false;
+}
 
 bool Timer::timer_callback_fn(std::mutex &m, std::condition_variable &cv, bool &task_notified) {
   logger_.debug("callback entered");
@@ -0,0 +1,217 @@
+#include "timer_service.hpp"
+
+using namespace espp;
+
+TimerService::TimerService(const TimerService::Config &config)
+    : BaseComponent(config.name, config.log_level) {
+  // set the logger rate limit
+  logger_.set_rate_limit(std::chrono::milliseconds(100));
+  running_ = true;
+  // make the task
+  task_ = espp::Task::make_unique({
+      .callback = [this]() -> bool { return task_callback(); },
+      .task_config =
+          {
+              .name = std::string(config.name) + "_task",
+              .stack_size_bytes = config.stack_size_bytes,
+              .priority = config.priority,
+              .core_id = config.core_id,
+          },
+      .log_level = config.log_level,
+  });
+  task_->start();
+}
+
+std::shared_ptr<TimerService> TimerService::make_shared(const TimerService::Config &config) {
+  return std::make_shared<TimerService>(config);
+}
+
+TimerService::~TimerService() {
+  logger_.info("stopping");
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  cv_.notify_all();
+  task_->stop();
+}
+
+TimerService::timer_id_t TimerService::add_timer(const callback_fn &callback,
+                                                 const std::chrono::microseconds &period) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  timer_id_t id = next_id_++;
+  if (next_id_ == INVALID_TIMER_ID) {
+    next_id_++;
+  }
+  auto &entry = entries_[id];
+  entry.callback = callback;
+  entry.period = period;
+  logger_.debug("added timer {}, {} timers total", id, entries_.size());
+  return id;
+}
+
+void TimerService::remove_timer(timer_id_t id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it == entries_.end()) {
+    return;
+  }
+  auto &entry = it->second;
+  entry.active = false;
+  entry.generation++;
+  if (entry.executing) {
+    if (in_service_task()) {
+      // the callback is removing its own timer, let the task erase it once
+      // the callback returns
+      entry.removed = true;
+      return;
+    }
+    done_cv_.wait(lock, [&entry] { return !entry.executing; });
+  }
+  entries_.erase(id);
+  logger_.debug("removed timer {}, {} timers total", id, entries_.size());
+}
+
+bool TimerService::start_timer(timer_id_t id, const std::chrono::microseconds &delay) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+      logger_.error("cannot start timer {}, it does not exist", id);
+      return false;
+    }
+    auto &entry = it->second;
+    if (entry.active) {
+      logger_.debug("timer {} already running", id);
+      return false;
+    }
+    entry.active = true;
+    entry.generation++;
+    push({clock::now() + delay, id, entry.generation});
+  }
+  // wake the task in case this timer expires before the one it is waiting on
+  cv_.notify_all();
+  return true;
+}
+
+void TimerService::cancel_timer(timer_id_t id) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it == entries_.end()) {
+    return;
+  }
+  auto &entry = it->second;
+  entry.active = false;
+  // invalidate the timer's heap item (if any), it will be discarded when it
+  // reaches the top of the heap
+  entry.generation++;
+  if (entry.executing && !in_service_task()) {
+    done_cv_.wait(lock, [&entry] { return !entry.executing; });
+  }
+}
+
+void TimerService::set_period(timer_id_t id, const std::chrono::microseconds &period) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  if (it == entries_.end()) {
+    return;
+  }
+  it->second.period = period;
+}
+
+bool TimerService::is_timer_running(timer_id_t id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(id);
+  return it != entries_.end() && it->second.active;
+}
+
+size_t TimerService::get_num_timers() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+bool TimerService::is_stale(const HeapItem &item) const {
+  auto it = entries_.find(item.id);
+  return it == entries_.end() || it->second.generation != item.generation;
+}
+
+void TimerService::push(const HeapItem &item) {
+  // canceled timers leave stale items in the heap, so if timers are
+  // frequently restarted we occasionally need to clean them out
+  if (heap_.size() > 2 * entries_.size() + 16) {
+    compact();
+  }
+  heap_.push_back(item);
+  std::push_heap(heap_.begin(), heap_.end(), later);
+}
+
+void TimerService::compact() {
+  std::erase_if(heap_, [this](const HeapItem &item) { return is_stale(item); });
+  std::make_heap(heap_.begin(), heap_.end(), later);
+}
+
+bool TimerService::in_service_task() const {
+  return task_ && Task::get_current_id() == task_->get_id();
+}
+
+bool TimerService::task_callback() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!running_) {
+    return true;
+  }
+  // discard any items for timers which have been canceled / restarted
+  while (!heap_.empty() && is_stale(heap_.front())) {
+    std::pop_heap(heap_.begin(), heap_.end(), later);
+    heap_.pop_back();
+  }
+  if (heap_.empty()) {
+    // nothing to do, wait until a timer is started or we are stopped
+    cv_.wait(lock);
+    return !running_;
+  }
+  auto now = clock::now();
+  auto item = heap_.front();
+  if (item.expiry > now) {
+    // wait until the next timer expires, or until the heap changes (which
+    // may mean there is a new earliest timer) or we are stopped
+    cv_.wait_until(lock, item.expiry);
+    return !running_;
+  }
+  std::pop_heap(heap_.begin(), heap_.end(), later);
+  heap_.pop_back();
+
+  // NOTE: references into the unordered_map remain valid until the element
+  // is erased, which cannot happen while the entry is executing
+  auto &entry = entries_.at(item.id);
+  entry.executing = true;
+  lock.unlock();
+
+  logger_.debug("running timer {}", item.id);
+  bool requested_stop = entry.callback ? entry.callback() : true;
+
+  lock.lock();
+  entry.executing = false;
+  if (entry.removed) {
+    entries_.erase(item.id);
+  } else if (entry.generation == item.generation) {
+    // the timer was not canceled / restarted while its callback was running
+    if (requested_stop || entry.period.count() <= 0) {
+      logger_.debug("timer {} requested stop or period is <= 0, stopping", item.id);
+      entry.active = false;
+    } else {
+      // reschedule relative to the previous expiry so that the timer does
+      // not drift
+      auto expiry = item.expiry + entry.period;
+      now = clock::now();
+      if (expiry < now) {
+        logger_.warn_rate_limited("timer {} fell behind by {:.3f} s", item.id,
+                                  std::chrono::duration<float>(now - expiry).count());
+        expiry = now;
+      }
+      push({expiry, item.id, item.generation});
+    }
+  }
+  lock.unlock();
+  done_cv_.notify_all();
+  return false;
+}
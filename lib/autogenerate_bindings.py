@@ -1,6 +1,7 @@
 import litgen
 from srcmlcpp import SrcmlcppOptions
 import os
+import re
 
 
 def my_litgen_options() -> litgen.LitgenOptions:
@@ -99,6 +100,106 @@ def my_litgen_options() -> litgen.LitgenOptions:
     return options
 
 
+# Methods which block in C++, and which release the GIL while they block, so
+# that they don't block every other Python thread. litgen has no option for
+# this, so the call guards are added to the generated code. Methods which take
+# a Python callable (e.g. in their config, like UdpSocket.start_receiving or
+# TcpSocket.transmit) are left out, since the callable would then be copied
+# (and possibly called) without the GIL.
+GIL_RELEASE_METHODS = {
+    "Socket": ["select"],
+    "TcpSocket": ["reinit", "close", "connect", "receive", "bind", "listen", "accept"],
+    "UdpSocket": ["receive"],
+    "Task": ["start", "stop"],
+    "Timer": ["start", "stop", "cancel"],
+}
+
+GIL_RELEASE_CALL_GUARD = "py::call_guard<py::gil_scoped_release>()"
+
+
+def _skip_string(code: str, i: int) -> int:
+    # return the index just past the string (or char) literal starting at i
+    quote = code[i]
+    i += 1
+    while code[i] != quote:
+        i += 2 if code[i] == "\\" else 1
+    return i + 1
+
+
+def _find_statement_end(code: str, start: int) -> int:
+    # return the index of the ';' which ends the statement starting at start
+    depth = 0
+    i = start
+    while True:
+        c = code[i]
+        if c in "\"'":
+            i = _skip_string(code, i)
+            continue
+        if c in "([{":
+            depth += 1
+        elif c in ")]}":
+            depth -= 1
+        elif c == ";" and depth == 0:
+            return i
+        i += 1
+
+
+def _find_def_arguments(code: str, start: int) -> list:
+    # return the indices of the commas between the arguments of the call whose
+    # '(' is at start, followed by the index of its ')'
+    separators = []
+    depth = 0
+    i = start
+    while True:
+        c = code[i]
+        if c in "\"'":
+            i = _skip_string(code, i)
+            continue
+        if c in "([{":
+            depth += 1
+        elif c == "<" and code[i - 1].isalnum():
+            # template arguments (e.g. py::overload_cast<float, float>)
+            depth += 1
+        elif c in ")]}" or (c == ">" and code[i - 1] != "-"):
+            depth -= 1
+            if depth == 0:
+                separators.append(i)
+                return separators
+        elif c == "," and depth == 1:
+            separators.append(i)
+        i += 1
+
+
+def add_gil_release_call_guards(code: str) -> str:
+    """Add the GIL releasing call guard to the bound GIL_RELEASE_METHODS."""
+    for class_name, method_names in GIL_RELEASE_METHODS.items():
+        start = re.search(r"^  pyClass" + class_name + r"\s*\.def\(", code, re.MULTILINE)
+        if start is None:
+            print(f"WARNING: could not find the bindings of {class_name}")
+            continue
+        end = _find_statement_end(code, start.start())
+        statement = code[start.start():end]
+        # insert from the end, so that the indices found before stay valid
+        for match in reversed(list(re.finditer(r'\.def\(\s*"(\w+)"', statement))):
+            if match.group(1) not in method_names:
+                continue
+            # the '(' of .def(
+            separators = _find_def_arguments(statement, match.start() + 4)
+            if GIL_RELEASE_CALL_GUARD in statement[match.start():separators[-1]]:
+                continue
+            # before the docstring (the last argument), if there is one
+            last_argument = statement[separators[-2] + 1:separators[-1]].lstrip()
+            if len(separators) > 2 and last_argument.startswith('"'):
+                position = separators[-2] + 1
+                guard = " " + GIL_RELEASE_CALL_GUARD + ","
+            else:
+                position = separators[-1]
+                guard = ", " + GIL_RELEASE_CALL_GUARD
+            statement = statement[:position] + guard + statement[position:]
+        code = code[:start.start()] + statement + code[end:]
+    return code
+
+
 def autogenerate() -> None:
     repository_dir = os.path.realpath(os.path.dirname(__file__) + "/../")
     output_dir = repository_dir + "/lib/python_bindings"
@@ -164,6 +265,12 @@ def autogenerate() -> None:
         output_stub_pyi_file=output_dir + "/espp/__init__.pyi",
     )
 
+    pydef_file = output_dir + "/pybind_espp.cpp"
+    with open(pydef_file) as f:
+        code = f.read()
+    with open(pydef_file, "w") as f:
+        f.write(add_gil_release_call_guards(code))
+
 
 if __name__ == "__main__":
     autogenerate()
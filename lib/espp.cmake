@@ -17,6 +17,7 @@ set(ESPP_EXTERNAL_INCLUDES_SEPARATE
 )
 
 set(ESPP_INCLUDES
+  ${ESPP_COMPONENTS}/aw9523/include
   ${ESPP_COMPONENTS}/base_component/include
   ${ESPP_COMPONENTS}/base_peripheral/include
   ${ESPP_COMPONENTS}/color/include
@@ -28,11 +29,14 @@ set(ESPP_INCLUDES
   ${ESPP_COMPONENTS}/format/include
   ${ESPP_COMPONENTS}/hid-rp/include
   ${ESPP_COMPONENTS}/joystick/include
+  ${ESPP_COMPONENTS}/led_strip/include
   ${ESPP_COMPONENTS}/logger/include
   ${ESPP_COMPONENTS}/math/include
+  ${ESPP_COMPONENTS}/mcp23x17/include
   ${ESPP_COMPONENTS}/ndef/include
   ${ESPP_COMPONENTS}/pid/include
   ${ESPP_COMPONENTS}/rtsp/include
+  ${ESPP_COMPONENTS}/runqueue/include
   ${ESPP_COMPONENTS}/serialization/include
   ${ESPP_COMPONENTS}/tabulate/include
   ${ESPP_COMPONENTS}/task/include
@@ -45,19 +49,25 @@ set(ESPP_INCLUDES
 set(ESPP_SOURCES
   ${ESPP_COMPONENTS}/color/src/color.cpp
   ${ESPP_COMPONENTS}/event_manager/src/event_manager.cpp
+  ${ESPP_COMPONENTS}/logger/src/log_sink.cpp
   ${ESPP_COMPONENTS}/logger/src/logger.cpp
   ${ESPP_COMPONENTS}/file_system/src/file_system.cpp
   ${ESPP_COMPONENTS}/filters/src/lowpass_filter.cpp
   ${ESPP_COMPONENTS}/filters/src/simple_lowpass_filter.cpp
   ${ESPP_COMPONENTS}/joystick/src/joystick.cpp
+  ${ESPP_COMPONENTS}/led_strip/src/led_strip.cpp
   ${ESPP_COMPONENTS}/rtsp/src/rtcp_packet.cpp
+  ${ESPP_COMPONENTS}/rtsp/src/rtp_jpeg_jitter_buffer.cpp
   ${ESPP_COMPONENTS}/rtsp/src/rtp_packet.cpp
   ${ESPP_COMPONENTS}/rtsp/src/rtsp_client.cpp
   ${ESPP_COMPONENTS}/rtsp/src/rtsp_server.cpp
   ${ESPP_COMPONENTS}/rtsp/src/rtsp_session.cpp
+  ${ESPP_COMPONENTS}/runqueue/src/runqueue.cpp
   ${ESPP_COMPONENTS}/task/src/task.cpp
   ${ESPP_COMPONENTS}/timer/src/timer.cpp
+  ${ESPP_COMPONENTS}/timer/src/timer_service.cpp
   ${ESPP_COMPONENTS}/socket/src/socket.cpp
+  ${ESPP_COMPONENTS}/socket/src/socket_reactor.cpp
   ${ESPP_COMPONENTS}/socket/src/tcp_socket.cpp
   ${ESPP_COMPONENTS}/socket/src/udp_socket.cpp
   ${CMAKE_CURRENT_LIST_DIR}/espp.cpp
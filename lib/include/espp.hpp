@@ -14,6 +14,7 @@ extern "C" {
 
 #include "base_component.hpp"
 #include "bezier.hpp"
+#include "biquad_filter.hpp"
 #include "butterworth_filter.hpp"
 #include "color.hpp"
 #include "csv.hpp"
@@ -27,8 +28,10 @@ extern "C" {
 // #include "hid-rp.hpp"
 // #include "hid-rp-gamepad.hpp"
 #include "joystick.hpp"
+#include "kalman_filter.hpp"
 #include "logger.hpp"
 #include "lowpass_filter.hpp"
+#include "madgwick_filter.hpp"
 #include "ndef.hpp"
 #include "pid.hpp"
 #include "range_mapper.hpp"
@@ -2,7 +2,9 @@
 
 # mypy: disable-error-code="type-arg"
 
-from typing import overload, List
+from typing import overload, List, Optional, Tuple
+
+import numpy as np
 
 NumberType = (int, float, np.number)
 
@@ -2422,6 +2424,7 @@ class Pid:
         """
         pass
 
+    @overload
     def update(self, error: float) -> float:
         """*
            * @brief Update the PID controller with the latest error measurement,
@@ -2436,6 +2439,23 @@ class Pid:
         """
         pass
 
+    @overload
+    def update(self, error: float, t: float) -> float:
+        """*
+           * @brief Update the PID controller with the latest error measurement and
+           *        the time since the previous update, getting the output control
+           *        signal in return.
+           *
+           * @note Unlike update(float), this does not track invocation timing, which
+           *       makes it suitable for replaying recorded data or for simulation.
+           *
+           * @param error Latest error signal.
+           * @param t Time since the previous update, in seconds.
+           * @return The output control signal based on the PID state and error.
+
+        """
+        pass
+
     def __call__(self, error: float) -> float:
         """*
            * @brief Update the PID controller with the latest error measurement,
@@ -3800,6 +3820,7 @@ class SimpleLowpassFilter:
         """
         pass
 
+    @overload
     def update(self, input: float) -> float:
         """*
            * @brief Filter the signal sampled by input, updating internal state, and
@@ -3810,6 +3831,25 @@ class SimpleLowpassFilter:
         """
         pass
 
+    @overload
+    def update(self, input: float, output: float, length: int, dt: float) -> None:
+        """*
+           * @brief Filter a block of samples, updating internal state, and writing
+           *        the filtered samples to output.
+           * @details The samples are dt seconds apart, so the filter coefficient is
+           *        only computed once for the block, and the output is the same as
+           *        calling update(input) for each sample dt seconds apart. The time
+           *        the next update(input) measures starts at the end of the block.
+           * @param input Pointer to (floating point) array of new samples of the input data
+           * @param output Pointer to (floating point) array which will be filled with
+           *        the filtered input. May be the same as input.
+           * @param length Number of samples, should be >= length of input & output memory.
+           * @param dt Sample period of the block, i.e. the time between consecutive
+           *        samples, in seconds.
+
+        """
+        pass
+
     def __call__(self, input: float) -> float:
         """*
            * @brief Filter the signal sampled by input, updating internal state, and
@@ -195,7 +195,10 @@ void py_init_module_espp(py::module &m) {
                "subscriber is already registered for\n   *       that topic, the task_config is "
                "ignored.\n   * @return True if the subscriber was added, False if it was already\n "
                "  *         registered for that component.\n")
-          .def("publish", &espp::EventManager::publish, py::arg("topic"), py::arg("data"),
+          .def("publish",
+               py::overload_cast<const std::string &, const std::vector<uint8_t> &>(
+                   &espp::EventManager::publish),
+               py::arg("topic"), py::arg("data"),
                "*\n   * @brief Publish \\p data on \\p topic.\n   * @param topic Topic to publish "
                "data on.\n   * @param data Data to publish, within a vector container.\n   * "
                "@return True if \\p data was successfully published to \\p topic, False\n   *      "
@@ -1450,12 +1453,21 @@ void py_init_module_espp(py::module &m) {
            "@param config Configuration struct with new gains and sampling time.\n   * @param "
            "reset_state Reset / clear the PID controller state.\n")
       .def("clear", &espp::Pid::clear, "*\n   * @brief Clear the PID controller state.\n")
-      .def("update", &espp::Pid::update, py::arg("error"),
+      .def("update", py::overload_cast<float>(&espp::Pid::update), py::arg("error"),
            "*\n   * @brief Update the PID controller with the latest error measurement,\n   *      "
            "  getting the output control signal in return.\n   *\n   * @note Tracks invocation "
            "timing to better compute time-accurate\n   *       integral/derivative signals.\n   "
            "*\n   * @param error Latest error signal.\n   * @return The output control signal "
            "based on the PID state and error.\n")
+      .def("update", py::overload_cast<float, float>(&espp::Pid::update), py::arg("error"),
+           py::arg("t"),
+           "*\n   * @brief Update the PID controller with the latest error measurement and\n   *  "
+           "      the time since the previous update, getting the output control\n   *        "
+           "signal in return.\n   *\n   * @note Unlike update(float), this does not track "
+           "invocation timing, which\n   *       makes it suitable for replaying recorded data or "
+           "for simulation.\n   *\n   * @param error Latest error signal.\n   * @param t Time "
+           "since the previous update, in seconds.\n   * @return The output control signal based "
+           "on the PID state and error.\n")
       .def("__call__", &espp::Pid::operator(), py::arg("error"),
            "*\n   * @brief Update the PID controller with the latest error measurement,\n   *      "
            "  getting the output control signal in return.\n   *\n   * @note Tracks invocation "
@@ -1569,6 +1581,7 @@ void py_init_module_espp(py::module &m) {
            "* @param multicast_group multicast group to join.\n   * @return True if "
            "IP_ADD_MEMBERSHIP was successfully set.\n")
       .def("select", &espp::Socket::select, py::arg("timeout"),
+           py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Select on the socket for read events.\n   * @param timeout how long to "
            "wait for an event.\n   * @return number of events that occurred.\n");
   ////////////////////    </generated_from:socket.hpp>    ////////////////////
@@ -1646,14 +1659,16 @@ void py_init_module_espp(py::module &m) {
   } // end of inner classes & enums of TcpSocket
 
   pyClassTcpSocket.def(py::init<const espp::TcpSocket::Config &>())
-      .def("reinit", &espp::TcpSocket::reinit,
+      .def("reinit", &espp::TcpSocket::reinit, py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Reinitialize the socket, cleaning it up if first it is already\n   *    "
            "    initalized.\n")
-      .def("close", &espp::TcpSocket::close, "*\n   * @brief Close the socket.\n")
+      .def("close", &espp::TcpSocket::close, py::call_guard<py::gil_scoped_release>(),
+           "*\n   * @brief Close the socket.\n")
       .def("is_connected", &espp::TcpSocket::is_connected,
            "*\n   * @brief Check if the socket is connected to a remote endpoint.\n   * @return "
            "True if the socket is connected to a remote endpoint.\n")
       .def("connect", &espp::TcpSocket::connect, py::arg("connect_config"),
+           py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Open a connection to the remote TCP server.\n   * @param connect_config "
            "ConnectConfig struct describing the server endpoint.\n   * @return True if the client "
            "successfully connected to the server.\n")
@@ -1693,13 +1708,13 @@ void py_init_module_espp(py::module &m) {
            "transmit_config TransmitConfig struct indicating whether to wait for a\n   *        "
            "response.\n   * @return True if the data was sent, False otherwise.\n")
       .def("receive", py::overload_cast<std::vector<uint8_t> &, size_t>(&espp::TcpSocket::receive),
-           py::arg("data"), py::arg("max_num_bytes"),
+           py::arg("data"), py::arg("max_num_bytes"), py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Call read on the socket, assuming it has already been configured\n   *  "
            "      appropriately.\n   *\n   * @param data Vector of bytes of received data.\n   * "
            "@param max_num_bytes Maximum number of bytes to receive.\n   * @return True if "
            "successfully received, False otherwise.\n")
       .def("receive", py::overload_cast<uint8_t *, size_t>(&espp::TcpSocket::receive),
-           py::arg("data"), py::arg("max_num_bytes"),
+           py::arg("data"), py::arg("max_num_bytes"), py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Call read on the socket, assuming it has already been configured\n   *  "
            "      appropriately.\n   * @note This function will block until max_num_bytes are "
            "received or the\n   *       receive timeout is reached.\n   * @note The data pointed "
@@ -1707,14 +1722,16 @@ void py_init_module_espp(py::module &m) {
            "to receive data.\n   * @param max_num_bytes Maximum number of bytes to receive.\n   * "
            "@return Number of bytes received.\n")
       .def("bind", &espp::TcpSocket::bind, py::arg("port"),
+           py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Bind the socket as a server on \\p port.\n   * @param port The port to "
            "which to bind the socket.\n   * @return True if the socket was bound.\n")
       .def("listen", &espp::TcpSocket::listen, py::arg("max_pending_connections"),
+           py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Listen for incoming client connections.\n   * @note Must be called "
            "after bind and before accept.\n   * @see bind\n   * @see accept\n   * @param "
            "max_pending_connections Max number of allowed pending connections.\n   * @return True "
            "if socket was able to start listening.\n")
-      .def("accept", &espp::TcpSocket::accept,
+      .def("accept", &espp::TcpSocket::accept, py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Accept an incoming connection.\n   * @note Blocks until a connection is "
            "accepted.\n   * @note Must be called after listen.\n   * @note This function will "
            "block until a connection is accepted.\n   * @return A unique pointer to a "
@@ -1852,7 +1869,7 @@ void py_init_module_espp(py::module &m) {
            "send_config SendConfig struct indicating where to send and whether\n   *        to "
            "wait for a response.\n   * @return True if the data was sent, False otherwise.\n")
       .def("receive", &espp::UdpSocket::receive, py::arg("max_num_bytes"), py::arg("data"),
-           py::arg("remote_info"),
+           py::arg("remote_info"), py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Call recvfrom on the socket, assuming it has already been\n   *        "
            "configured appropriately.\n   *\n   * @param max_num_bytes Maximum number of bytes to "
            "receive.\n   * @param data Vector of bytes of received data.\n   * @param remote_info "
@@ -1946,10 +1963,10 @@ void py_init_module_espp(py::module &m) {
                   "*        Useful to not have to use templated std::make_unique (less typing).\n  "
                   " * @param config Config struct to initialize the Task with.\n   * @return "
                   "std::unique_ptr<Task> pointer to the newly created task.\n")
-      .def("start", &espp::Task::start,
+      .def("start", &espp::Task::start, py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Start executing the task.\n   *\n   * @return True if the task started, "
            "False if it was already started.\n")
-      .def("stop", &espp::Task::stop,
+      .def("stop", &espp::Task::stop, py::call_guard<py::gil_scoped_release>(),
            "*\n   * @brief Stop the task execution.\n   * @details This will request the task to "
            "stop, notify the condition variable,\n   *          and (if this calling context is "
            "not the task context) join the\n   *          thread.\n   * @return True if the task "
@@ -2093,20 +2110,21 @@ void py_init_module_espp(py::module &m) {
       .def(py::init<const espp::Timer::AdvancedConfig &>())
       .def(
           "start", [](espp::Timer &self) { return self.start(); },
+          py::call_guard<py::gil_scoped_release>(),
           "/ @brief Start the timer.\n/ @details Starts the timer. Does nothing if the timer is "
           "already running.")
       .def("start", py::overload_cast<const std::chrono::duration<float> &>(&espp::Timer::start),
-           py::arg("delay"),
+           py::arg("delay"), py::call_guard<py::gil_scoped_release>(),
            "/ @brief Start the timer with a delay.\n/ @details Starts the timer with a delay. If "
            "the timer is already running,\n/          this will cancel the timer and start it "
            "again with the new\n/          delay. If the timer is not running, this will start the "
            "timer\n/          with the delay. Overwrites any previous delay that might have\n/     "
            "     been set.\n/ @param delay The delay before the first execution of the timer "
            "callback.")
-      .def("stop", &espp::Timer::stop,
+      .def("stop", &espp::Timer::stop, py::call_guard<py::gil_scoped_release>(),
            "/ @brief Stop the timer, same as cancel().\n/ @details Stops the timer, same as "
            "cancel().")
-      .def("cancel", &espp::Timer::cancel,
+      .def("cancel", &espp::Timer::cancel, py::call_guard<py::gil_scoped_release>(),
            "/ @brief Cancel the timer.\n/ @details Cancels the timer.")
       .def("set_period", &espp::Timer::set_period, py::arg("period"),
            "/ @brief Set the period of the timer.\n/ @details Sets the period of the timer.\n/ "
@@ -2369,10 +2387,26 @@ void py_init_module_espp(py::module &m) {
       .def("get_time_constant", &espp::SimpleLowpassFilter::get_time_constant,
            "*\n   * @brief Get the time constant of the filter.\n   * @return Time constant of the "
            "filter.\n")
-      .def("update", &espp::SimpleLowpassFilter::update, py::arg("input"),
+      .def("update", py::overload_cast<const float>(&espp::SimpleLowpassFilter::update),
+           py::arg("input"),
            "*\n   * @brief Filter the signal sampled by input, updating internal state, and\n   *  "
            "      returning the filtered output.\n   * @param input New sample of the input "
            "data.\n   * @return Filtered output based on input, time, and history.\n")
+      .def("update",
+           py::overload_cast<const float *, float *, size_t, float>(
+               &espp::SimpleLowpassFilter::update),
+           py::arg("input"), py::arg("output"), py::arg("length"), py::arg("dt"),
+           "*\n   * @brief Filter a block of samples, updating internal state, and writing\n   *  "
+           "      the filtered samples to output.\n   * @details The samples are dt seconds "
+           "apart, so the filter coefficient is\n   *        only computed once for the block, "
+           "and the output is the same as\n   *        calling update(input) for each sample dt "
+           "seconds apart. The time\n   *        the next update(input) measures starts at the "
+           "end of the block.\n   * @param input Pointer to (floating point) array of new "
+           "samples of the input data\n   * @param output Pointer to (floating point) array which "
+           "will be filled with\n   *        the filtered input. May be the same as input.\n   * "
+           "@param length Number of samples, should be >= length of input & output memory.\n   * "
+           "@param dt Sample period of the block, i.e. the time between consecutive\n   *        "
+           "samples, in seconds.\n")
       .def("__call__", &espp::SimpleLowpassFilter::operator(), py::arg("input"),
            "*\n   * @brief Filter the signal sampled by input, updating internal state, and\n   *  "
            "      returning the filtered output.\n   * @param input New sample of the input "
@@ -0,0 +1,124 @@
+#include <array>
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+#include "format.hpp"
+
+#include "aw9523.hpp"
+#include "mcp23x17.hpp"
+
+// Run the same sequence of operations on an Mcp23x17 (configuration, which is
+// mostly read-modify-writes of its control registers) and an Aw9523 (setting
+// and clearing output pins, and reading input pins) with and without the
+// register cache. The peripherals are mocks which count the bus transactions
+// and whose input pins change on every read. Check that the mocks end up with
+// the same register values and that the inputs are never read from the cache.
+
+// an 8 bit register map, which auto-increments the register address
+struct MockDevice {
+  std::array<uint8_t, 256> registers{};
+  uint8_t input_register{0};
+  size_t reads{0};
+  size_t writes{0};
+
+  bool write(const uint8_t *data, size_t length) {
+    writes++;
+    for (size_t i = 1; i < length; i++) {
+      registers[(data[0] + i - 1) & 0xff] = data[i];
+    }
+    return true;
+  }
+
+  bool read(uint8_t reg, uint8_t *data, size_t length) {
+    reads++;
+    for (size_t i = 0; i < length; i++) {
+      uint8_t address = (reg + i) & 0xff;
+      if (address == input_register) {
+        // the input pins change all the time
+        registers[address]++;
+      }
+      data[i] = registers[address];
+    }
+    return true;
+  }
+};
+
+struct Result {
+  size_t reads;
+  size_t writes;
+  espp::BasePeripheral<>::RegisterCacheStats stats;
+  bool inputs_fresh;
+};
+
+static Result run_mcp23x17(MockDevice &mock, bool cache) {
+  espp::Mcp23x17 mcp(
+      {.write = [&mock](uint8_t, const uint8_t *data,
+                        size_t length) { return mock.write(data, length); },
+       .read_register = [&mock](uint8_t, uint8_t reg, uint8_t *data,
+                                size_t length) { return mock.read(reg, data, length); },
+       .auto_init = false,
+       .log_level = espp::Logger::Verbosity::WARN});
+  mcp.set_register_cache_enabled(cache);
+  std::error_code ec;
+  mcp.initialize(ec);
+  bool inputs_fresh = true;
+  uint8_t last_input = mcp.get_pins(espp::Mcp23x17::Port::PORT0, ec);
+  for (int i = 0; i < 100; i++) {
+    mcp.set_interrupt_mirror(i % 2, ec);
+    mcp.set_interrupt_polarity(i % 3, ec);
+    mcp.set_pins(espp::Mcp23x17::Port::PORT1, i, ec);
+    uint8_t input = mcp.get_pins(espp::Mcp23x17::Port::PORT0, ec);
+    inputs_fresh = inputs_fresh && input == uint8_t(last_input + 1);
+    last_input = input;
+  }
+  return {mock.reads, mock.writes, mcp.register_cache_stats(), inputs_fresh && !ec};
+}
+
+static Result run_aw9523(MockDevice &mock, bool cache) {
+  espp::Aw9523 aw(
+      {.write = [&mock](uint8_t, const uint8_t *data,
+                        size_t length) { return mock.write(data, length); },
+       .write_then_read =
+           [&mock](uint8_t, const uint8_t *write_data, size_t, uint8_t *read_data,
+                   size_t read_length) { return mock.read(write_data[0], read_data, read_length); },
+       .auto_init = false,
+       .log_level = espp::Logger::Verbosity::WARN});
+  aw.set_register_cache_enabled(cache);
+  std::error_code ec;
+  aw.initialize(ec);
+  bool inputs_fresh = true;
+  uint8_t last_input = aw.get_pins(espp::Aw9523::Port::PORT0, ec);
+  for (int i = 0; i < 100; i++) {
+    aw.set_pins(espp::Aw9523::Port::PORT1, 1 << (i % 8), ec);
+    aw.clear_pins(espp::Aw9523::Port::PORT1, 1 << ((i + 4) % 8), ec);
+    uint8_t input = aw.get_pins(espp::Aw9523::Port::PORT0, ec);
+    inputs_fresh = inputs_fresh && input == uint8_t(last_input + 1);
+    last_input = input;
+  }
+  return {mock.reads, mock.writes, aw.register_cache_stats(), inputs_fresh && !ec};
+}
+
+template <typename F> static bool compare(const std::string &name, uint8_t input_register, F run) {
+  MockDevice uncached_mock{.input_register = input_register};
+  MockDevice cached_mock{.input_register = input_register};
+  auto uncached = run(uncached_mock, false);
+  auto cached = run(cached_mock, true);
+  bool same = uncached_mock.registers == cached_mock.registers;
+  for (auto [label, result] : {std::pair{"uncached", uncached}, std::pair{"cached", cached}}) {
+    fmt::print("{:<10} {:<8} | {:>5} | {:>6} | {:>11} | {:>4} | {:>6} | {}\n", name, label,
+               result.reads, result.writes, result.reads + result.writes, result.stats.hits,
+               result.stats.misses, result.inputs_fresh);
+  }
+  bool ok = same && uncached.inputs_fresh && cached.inputs_fresh;
+  fmt::print("{:<19} | registers match: {}\n", name, same);
+  return ok;
+}
+
+int main() {
+  fmt::print("{:<19} | {:>5} | {:>6} | {:>11} | {:>4} | {:>6} | {}\n", "peripheral", "reads",
+             "writes", "transactions", "hits", "misses", "inputs fresh");
+  bool ok = compare("Mcp23x17", 0x12 /* GPIOA */, run_mcp23x17);
+  ok = compare("Aw9523", 0x00 /* INPORT0 */, run_aw9523) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "format.hpp"
+
+#include "event_manager.hpp"
+
+using namespace std::chrono_literals;
+
+// Check that an EventBuffer published through a topic handle reaches its
+// subscribers without being copied, the queue overflow policies of the
+// EventManager (with a task per topic and with the shared dispatcher), and
+// that stopping the dispatcher while topics are queued on it (or being
+// published to) does not leave them marked as scheduled. A subscriber which
+// is blocked in its callback keeps the first event, so that the following
+// ones fill up the topic's queue.
+
+// EventManager is a singleton, this makes a new one for each test and exposes
+// the dispatcher internals
+class TestEventManager : public espp::EventManager {
+public:
+  TestEventManager() = default;
+  ~TestEventManager() = default;
+
+  using EventManager::stop_dispatcher;
+
+  bool is_scheduled(const std::string &topic) {
+    SubscriberData *sub_data = get_subscriber_data(topic);
+    std::lock_guard<std::mutex> lk(sub_data->m);
+    return sub_data->scheduled;
+  }
+};
+
+// blocks the subscriber callbacks until it is opened
+class Gate {
+public:
+  void wait() {
+    std::unique_lock<std::mutex> lk(m_);
+    waiting_ = true;
+    cv_.notify_all();
+    cv_.wait(lk, [this] { return open_; });
+  }
+
+  void wait_until_waiting() {
+    std::unique_lock<std::mutex> lk(m_);
+    cv_.wait(lk, [this] { return waiting_; });
+  }
+
+  void open() {
+    std::lock_guard<std::mutex> lk(m_);
+    open_ = true;
+    cv_.notify_all();
+  }
+
+protected:
+  std::mutex m_;
+  std::condition_variable cv_;
+  bool waiting_{false};
+  bool open_{false};
+};
+
+// the values received by a subscriber, which blocks on its first event
+struct Received {
+  Gate gate;
+  std::mutex m;
+  std::vector<int> values;
+
+  void add(const std::vector<uint8_t> &data) {
+    {
+      std::lock_guard<std::mutex> lk(m);
+      values.push_back(data[0]);
+    }
+    if (data[0] == 1) {
+      gate.wait();
+    }
+  }
+
+  std::vector<int> wait_for(size_t count) {
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (std::chrono::steady_clock::now() < deadline) {
+      {
+        std::lock_guard<std::mutex> lk(m);
+        if (values.size() >= count) {
+          break;
+        }
+      }
+      std::this_thread::sleep_for(1ms);
+    }
+    // make sure no more values arrive
+    std::this_thread::sleep_for(20ms);
+    std::lock_guard<std::mutex> lk(m);
+    return values;
+  }
+};
+
+static bool check(const std::string &name, bool ok) {
+  fmt::print("{:<50} {}\n", name, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static bool publish_value(TestEventManager &em, const std::string &topic, int value) {
+  return em.publish(topic, std::vector<uint8_t>{static_cast<uint8_t>(value)});
+}
+
+// two subscribers get the published buffer itself, and it goes back to its
+// pool once they are done with it
+static bool test_event_buffer(size_t num_workers) {
+  TestEventManager em;
+  em.set_dispatcher_config({.num_workers = num_workers});
+  espp::EventBufferPool pool({.block_size = 64, .num_blocks = 2});
+  std::mutex m;
+  std::vector<const uint8_t *> received;
+  for (auto component : {"first", "second"}) {
+    em.add_subscriber("buffers", component, [&](const espp::EventBuffer &buffer) {
+      std::lock_guard<std::mutex> lk(m);
+      received.push_back(buffer.data());
+    });
+  }
+  auto handle = em.get_topic_handle("buffers");
+  std::vector<uint8_t> data(64, 42);
+  const uint8_t *published;
+  {
+    auto buffer = pool.make(data);
+    published = buffer.data();
+    em.publish(handle, buffer);
+  }
+  auto deadline = std::chrono::steady_clock::now() + 2s;
+  while (std::chrono::steady_clock::now() < deadline && pool.get_num_free() < 2) {
+    std::this_thread::sleep_for(1ms);
+  }
+  em.remove_subscriber("buffers", "first");
+  em.remove_subscriber("buffers", "second");
+  std::lock_guard<std::mutex> lk(m);
+  bool ok = received == std::vector{published, published} && pool.get_num_free() == 2;
+  return check(fmt::format("EventBuffer is shared, not copied ({} workers)", num_workers), ok);
+}
+
+// publish 1..10 to a topic with a capacity of 4 while the subscriber is
+// blocked on 1, and check what the subscriber receives
+static bool test_policy(const std::string &name, espp::EventManager::OverflowPolicy policy,
+                        size_t capacity, size_t num_workers, const std::vector<int> &expected,
+                        size_t expected_dropped) {
+  TestEventManager em;
+  em.set_dispatcher_config({.num_workers = num_workers});
+  em.set_queue_config("topic", {.capacity = capacity,
+                                .overflow_policy = policy,
+                                .block_timeout = std::chrono::duration<float>(0.01f)});
+  Received received;
+  em.add_subscriber("topic", "subscriber",
+                    [&received](const std::vector<uint8_t> &data) { received.add(data); });
+  publish_value(em, "topic", 1);
+  received.gate.wait_until_waiting();
+  size_t num_accepted = 1;
+  for (int value = 2; value <= 10; value++) {
+    num_accepted += publish_value(em, "topic", value);
+  }
+  auto stats = em.get_topic_stats("topic");
+  received.gate.open();
+  auto values = received.wait_for(expected.size());
+  em.remove_subscriber("topic", "subscriber");
+  bool ok = values == expected && stats.num_dropped == expected_dropped &&
+            stats.high_water_mark <= capacity && num_accepted == stats.num_published;
+  if (!ok) {
+    fmt::print("  received {}, dropped {}, high water mark {}, accepted {}, published {}\n",
+               values, stats.num_dropped, stats.high_water_mark, num_accepted,
+               stats.num_published);
+  }
+  return check(fmt::format("{} ({} workers)", name, num_workers), ok);
+}
+
+// a publisher blocked on a full queue is released when the subscriber takes
+// an event
+static bool test_block_until_space(size_t num_workers) {
+  TestEventManager em;
+  em.set_dispatcher_config({.num_workers = num_workers});
+  em.set_queue_config("topic", {.capacity = 1,
+                                .overflow_policy = espp::EventManager::OverflowPolicy::BLOCK,
+                                .block_timeout = std::chrono::duration<float>(1.0f)});
+  Received received;
+  em.add_subscriber("topic", "subscriber",
+                    [&received](const std::vector<uint8_t> &data) { received.add(data); });
+  publish_value(em, "topic", 1);
+  received.gate.wait_until_waiting();
+  publish_value(em, "topic", 2);
+  std::thread opener([&received]() {
+    std::this_thread::sleep_for(50ms);
+    received.gate.open();
+  });
+  auto start = std::chrono::steady_clock::now();
+  bool published = publish_value(em, "topic", 3);
+  auto blocked = std::chrono::steady_clock::now() - start;
+  opener.join();
+  auto values = received.wait_for(3);
+  em.remove_subscriber("topic", "subscriber");
+  bool ok = published && blocked >= 40ms && blocked < 900ms && values == std::vector{1, 2, 3};
+  return check(fmt::format("BLOCK until space ({} workers)", num_workers), ok);
+}
+
+// stop the dispatcher while a topic is queued on it (its only worker is busy
+// with another topic), and while another thread is publishing
+static bool test_stop_dispatcher() {
+  TestEventManager em;
+  em.set_dispatcher_config({.num_workers = 1});
+  Received busy;
+  em.add_subscriber("busy", "subscriber",
+                    [&busy](const std::vector<uint8_t> &data) { busy.add(data); });
+  std::atomic<int> num_waiting{0};
+  em.add_subscriber("waiting", "subscriber",
+                    [&num_waiting](const std::vector<uint8_t> &) { num_waiting++; });
+  publish_value(em, "busy", 1);
+  busy.gate.wait_until_waiting();
+  publish_value(em, "waiting", 2);
+  bool was_scheduled = em.is_scheduled("waiting");
+
+  std::atomic<bool> publishing{true};
+  std::thread publisher([&]() {
+    while (publishing) {
+      publish_value(em, "waiting", 3);
+    }
+  });
+  // the stop joins the worker, which is blocked in the busy callback
+  std::thread stopper([&em]() { em.stop_dispatcher(); });
+  std::this_thread::sleep_for(20ms);
+  busy.gate.open();
+  stopper.join();
+  // keep publishing for a bit after the dispatcher has stopped
+  std::this_thread::sleep_for(10ms);
+  publishing = false;
+  publisher.join();
+
+  bool ok = was_scheduled && !em.is_scheduled("waiting") && !em.is_scheduled("busy");
+  em.remove_subscriber("busy", "subscriber");
+  em.remove_subscriber("waiting", "subscriber");
+  return check("stop dispatcher while a topic is scheduled", ok);
+}
+
+int main() {
+  using Policy = espp::EventManager::OverflowPolicy;
+  bool ok = true;
+  for (size_t num_workers : {0, 2}) {
+    ok &= test_event_buffer(num_workers);
+    // the subscriber has 1, the queue keeps the 4 latest values
+    ok &= test_policy("DROP_OLDEST", Policy::DROP_OLDEST, 4, num_workers, {1, 7, 8, 9, 10}, 5);
+    // the subscriber has 1, the queue keeps the 4 first values
+    ok &= test_policy("DROP_NEWEST", Policy::DROP_NEWEST, 4, num_workers, {1, 2, 3, 4, 5}, 5);
+    // each publish to the full queue times out
+    ok &= test_policy("BLOCK timeout", Policy::BLOCK, 4, num_workers, {1, 2, 3, 4, 5}, 5);
+    // the latest queued value is replaced by each new value
+    ok &= test_policy("COALESCE", Policy::COALESCE, 1, num_workers, {1, 10}, 8);
+    ok &= test_block_until_space(num_workers);
+  }
+  ok &= test_stop_dispatcher();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "format.hpp"
+
+#include "filter_bank.hpp"
+#include "vector2d.hpp"
+
+// Filter 9 axes of simulated IMU data (accelerometer, gyroscope and
+// magnetometer), 1M samples per axis, with 9 separate filters (one call per
+// axis per sample) and with filter banks (one call per sample for all 9
+// axes, or one per sensor with the Value struct of the IMU drivers), and
+// report the time per 9-axis sample of each and the largest difference
+// between their outputs.
+
+static constexpr size_t num_samples = 1024 * 1024;
+static constexpr size_t num_axes = 9;
+static constexpr float cutoff = 2.0f * 20.0f / 1000.0f; // 20 Hz at 1 kHz
+
+// the same layout as the Value of the Icm42607 / Icm20948 drivers
+struct Value {
+  union {
+    struct {
+      float x;
+      float y;
+      float z;
+    };
+    float values[3];
+  };
+};
+
+// keep the compiler from optimizing away the filtering
+static volatile float sink;
+
+// the best time per 9-axis sample of a few runs of f
+template <typename F> static float time_ns_per_sample(F &&f) {
+  float best = INFINITY;
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<float, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / num_samples);
+  }
+  return best;
+}
+
+static void print_row(const std::string &name, float separate_ns, float bank_ns,
+                      float difference) {
+  fmt::print("{:<38} | {:>11.2f} | {:>7.2f} | {:>7.1f}x | {:.1e}\n", name, separate_ns, bank_ns,
+             separate_ns / bank_ns, difference);
+}
+
+using Samples = std::vector<std::array<float, num_axes>>;
+
+static float max_difference(const Samples &a, const Samples &b) {
+  float difference = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    for (size_t j = 0; j < num_axes; j++) {
+      difference = std::max(difference, std::abs(a[i][j] - b[i][j]));
+    }
+  }
+  return difference;
+}
+
+// 9 separate filters vs a bank of 9, updated with all the axes at once, and
+// vs 3 banks of 3, updated with a Value of each sensor
+template <typename Filter, typename... Args>
+static void run(const std::string &name, const Samples &input, const Args &...args) {
+  Samples separate_output(input.size());
+  Samples bank_output(input.size());
+  Samples value_output(input.size());
+  std::vector<Filter> filters(num_axes, Filter(args...));
+  float separate_ns = time_ns_per_sample([&] {
+    for (size_t i = 0; i < input.size(); i++) {
+      for (size_t j = 0; j < num_axes; j++) {
+        separate_output[i][j] = filters[j].update(input[i][j]);
+      }
+    }
+  });
+  espp::FilterBank<Filter, num_axes> bank(args...);
+  float bank_ns = time_ns_per_sample([&] {
+    for (size_t i = 0; i < input.size(); i++) {
+      bank_output[i] = bank.update(input[i]);
+    }
+  });
+  std::array<espp::FilterBank<Filter, 3>, 3> sensor_banks{espp::FilterBank<Filter, 3>(args...),
+                                                          espp::FilterBank<Filter, 3>(args...),
+                                                          espp::FilterBank<Filter, 3>(args...)};
+  float value_ns = time_ns_per_sample([&] {
+    for (size_t i = 0; i < input.size(); i++) {
+      const auto &axes = input[i];
+      Value accel = sensor_banks[0].update(Value{.values = {axes[0], axes[1], axes[2]}});
+      Value gyro = sensor_banks[1].update(Value{.values = {axes[3], axes[4], axes[5]}});
+      Value mag = sensor_banks[2].update(Value{.values = {axes[6], axes[7], axes[8]}});
+      value_output[i] = {accel.x, accel.y, accel.z, gyro.x, gyro.y, gyro.z, mag.x, mag.y, mag.z};
+    }
+  });
+  sink = separate_output.back()[0] + bank_output.back()[0] + value_output.back()[0];
+  print_row(name + ", 9 axes", separate_ns, bank_ns, max_difference(separate_output, bank_output));
+  print_row(name + ", 3 x Value", separate_ns, value_ns,
+            max_difference(separate_output, value_output));
+}
+
+// 9 separate single state Kalman filters vs a bank of 9, predicting with the
+// gyroscope axes and updating with the accelerometer axes
+static void run_kalman(const Samples &input) {
+  using Filter = espp::KalmanFilter<1>;
+  constexpr float dt = 0.001f;
+  Samples separate_output(input.size());
+  Samples bank_output(input.size());
+  std::vector<Filter> filters(num_axes);
+  float separate_ns = time_ns_per_sample([&] {
+    for (size_t i = 0; i < input.size(); i++) {
+      for (size_t j = 0; j < num_axes; j++) {
+        filters[j].predict({input[i][(j + 3) % num_axes]}, dt);
+        filters[j].update({input[i][j]});
+        separate_output[i][j] = filters[j].get_state()[0];
+      }
+    }
+  });
+  espp::FilterBank<Filter, num_axes> bank;
+  float bank_ns = time_ns_per_sample([&] {
+    for (size_t i = 0; i < input.size(); i++) {
+      std::array<float, num_axes> control;
+      for (size_t j = 0; j < num_axes; j++) {
+        control[j] = input[i][(j + 3) % num_axes];
+      }
+      bank.predict(control, dt);
+      bank.update(input[i]);
+      bank_output[i] = bank.get_state<std::array<float, num_axes>>();
+    }
+  });
+  sink = separate_output.back()[0] + bank_output.back()[0];
+  print_row("KalmanFilter<1>, 9 axes", separate_ns, bank_ns,
+            max_difference(separate_output, bank_output));
+}
+
+int main() {
+  std::mt19937 gen(0);
+  std::normal_distribution<float> noise(0.0f, 0.1f);
+  Samples input(num_samples);
+  for (size_t i = 0; i < num_samples; i++) {
+    for (size_t j = 0; j < num_axes; j++) {
+      input[i][j] = std::sin(i * 0.01f + j) + noise(gen);
+    }
+  }
+
+  fmt::print("{:<38} | {:>11} | {:>7} | {:>8} | {}\n", "filter", "separate ns", "bank ns",
+             "speedup", "max difference");
+  run<espp::LowpassFilter>(
+      "LowpassFilter", input,
+      espp::LowpassFilter::Config{.normalized_cutoff_frequency = cutoff, .q_factor = 0.707f});
+  run<espp::ButterworthFilter<2, espp::BiquadFilterDf2>>(
+      "ButterworthFilter<2, Df2>", input,
+      espp::ButterworthFilter<2, espp::BiquadFilterDf2>::Config{.normalized_cutoff_frequency =
+                                                                    cutoff});
+  run<espp::ButterworthFilter<4, espp::BiquadFilterDf1>>(
+      "ButterworthFilter<4, Df1>", input,
+      espp::ButterworthFilter<4, espp::BiquadFilterDf1>::Config{.normalized_cutoff_frequency =
+                                                                    cutoff});
+  run_kalman(input);
+
+  // other value types work the same way
+  espp::FilterBank<espp::LowpassFilter, 2> vector_bank(
+      {.normalized_cutoff_frequency = cutoff, .q_factor = 0.707f});
+  espp::Vector2f filtered = vector_bank.update(espp::Vector2f(1.0f, 2.0f));
+  fmt::print("\nVector2f (1, 2) filtered: ({}, {})\n", filtered.x(), filtered.y());
+  return 0;
+}
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "format.hpp"
+
+#include "biquad_filter.hpp"
+#include "butterworth_filter.hpp"
+#include "lowpass_filter.hpp"
+#include "simple_lowpass_filter.hpp"
+
+// Filter 1M samples (per channel) of noise in blocks of 256 samples, once
+// sample by sample with update(float) and once a block at a time with
+// update(input, output, length), and report the time per sample of each and
+// the largest difference between their outputs (for the SimpleLowpassFilter,
+// between blocks of one sample and of 256 samples with the same sample period,
+// since update(float) uses the time between calls). The multi-channel rows
+// filter 8 interleaved channels, either with 8 single channel filters (one
+// sample of each channel at a time) or with one 8 channel filter.
+
+static constexpr size_t num_samples = 1024 * 1024;
+static constexpr size_t block_size = 256;
+static constexpr size_t num_channels = 8;
+static constexpr float cutoff = 0.1f;
+
+// keep the compiler from optimizing away the filtering
+static volatile float sink;
+
+// the best time per sample of a few runs of f
+template <typename F> static float time_ns_per_sample(size_t samples, F &&f) {
+  float best = INFINITY;
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<float, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / samples);
+  }
+  return best;
+}
+
+static float max_difference(const std::vector<float> &a, const std::vector<float> &b) {
+  float difference = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+  }
+  return difference;
+}
+
+static void print_row(const std::string &name, float per_sample_ns, float block_ns,
+                      float difference) {
+  fmt::print("{:<32} | {:>13.2f} | {:>8.2f} | {:>7.1f}x | {:.1e}\n", name, per_sample_ns, block_ns,
+             per_sample_ns / block_ns, difference);
+}
+
+// compare update(float) on one filter with update(input, output, length) on
+// another filter configured the same way
+template <typename Filter>
+static void run(const std::string &name, Filter per_sample_filter, Filter block_filter,
+                const std::vector<float> &input) {
+  std::vector<float> per_sample_output(input.size());
+  std::vector<float> block_output(input.size());
+  float per_sample_ns = time_ns_per_sample(input.size(), [&] {
+    for (size_t i = 0; i < input.size(); i++) {
+      per_sample_output[i] = per_sample_filter.update(input[i]);
+    }
+  });
+  float block_ns = time_ns_per_sample(input.size(), [&] {
+    for (size_t offset = 0; offset < input.size(); offset += block_size) {
+      block_filter.update(input.data() + offset, block_output.data() + offset, block_size);
+    }
+  });
+  sink = per_sample_output.back() + block_output.back();
+  print_row(name, per_sample_ns, block_ns, max_difference(per_sample_output, block_output));
+}
+
+// compare num_channels single channel filters, each updated with one sample
+// at a time, with one num_channels channel filter updated a block at a time
+template <typename Filter, typename MultiChannelFilter>
+static void run_multi_channel(const std::string &name, const Filter &filter,
+                              MultiChannelFilter multi_channel_filter,
+                              const std::vector<float> &input) {
+  std::vector<Filter> filters(num_channels, filter);
+  std::vector<float> per_sample_output(input.size());
+  std::vector<float> block_output(input.size());
+  float per_sample_ns = time_ns_per_sample(input.size(), [&] {
+    for (size_t i = 0; i < input.size(); i += num_channels) {
+      for (size_t c = 0; c < num_channels; c++) {
+        per_sample_output[i + c] = filters[c].update(input[i + c]);
+      }
+    }
+  });
+  float block_ns = time_ns_per_sample(input.size(), [&] {
+    for (size_t offset = 0; offset < input.size(); offset += block_size * num_channels) {
+      multi_channel_filter.update(input.data() + offset, block_output.data() + offset, block_size);
+    }
+  });
+  sink = per_sample_output.back() + block_output.back();
+  print_row(name, per_sample_ns, block_ns, max_difference(per_sample_output, block_output));
+}
+
+int main() {
+  std::mt19937 gen(0);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::vector<float> input(num_samples);
+  for (auto &sample : input) {
+    sample = noise(gen);
+  }
+  std::vector<float> interleaved_input(num_samples * num_channels);
+  for (auto &sample : interleaved_input) {
+    sample = noise(gen);
+  }
+
+  fmt::print("{:<32} | {:>13} | {:>8} | {:>8} | {}\n", "filter", "per sample ns", "block ns",
+             "speedup", "max difference");
+  {
+    // a 2nd order butterworth section, for the biquads
+    float gamma = 1.0f / std::tan(M_PI * cutoff / 2.0f);
+    float g = gamma * gamma;
+    float alpha = 2.0f * std::cos(2.0f * M_PI * 3 / 8);
+    espp::TransferFunction<3> section{{{1.0f, 2.0f, 1.0f}},
+                                      {{g - alpha * gamma + 1, 2.0f * (1.0f - g),
+                                        g + alpha * gamma + 1}}};
+    run("BiquadFilterDf1", espp::BiquadFilterDf1(section), espp::BiquadFilterDf1(section), input);
+    run("BiquadFilterDf2", espp::BiquadFilterDf2(section), espp::BiquadFilterDf2(section), input);
+  }
+  espp::LowpassFilter::Config lowpass_config{.normalized_cutoff_frequency = cutoff,
+                                             .q_factor = 1.0f};
+  run("LowpassFilter", espp::LowpassFilter(lowpass_config), espp::LowpassFilter(lowpass_config),
+      input);
+  run("ButterworthFilter<4, Df1>", espp::ButterworthFilter<4, espp::BiquadFilterDf1>({cutoff}),
+      espp::ButterworthFilter<4, espp::BiquadFilterDf1>({cutoff}), input);
+  run("ButterworthFilter<4, Df2>", espp::ButterworthFilter<4, espp::BiquadFilterDf2>({cutoff}),
+      espp::ButterworthFilter<4, espp::BiquadFilterDf2>({cutoff}), input);
+  run("ButterworthFilter<8, Df2>", espp::ButterworthFilter<8, espp::BiquadFilterDf2>({cutoff}),
+      espp::ButterworthFilter<8, espp::BiquadFilterDf2>({cutoff}), input);
+  {
+    // update(float) measures the time between the updates, so its output is
+    // compared with one sample blocks of the same sample period instead
+    static constexpr float dt = 0.001f;
+    espp::SimpleLowpassFilter per_sample_filter({.time_constant = 0.01f});
+    espp::SimpleLowpassFilter single_sample_filter({.time_constant = 0.01f});
+    espp::SimpleLowpassFilter block_filter({.time_constant = 0.01f});
+    std::vector<float> single_sample_output(input.size());
+    std::vector<float> block_output(input.size());
+    float per_sample_ns = time_ns_per_sample(input.size(), [&] {
+      for (size_t i = 0; i < input.size(); i++) {
+        block_output[i] = per_sample_filter.update(input[i]);
+      }
+    });
+    for (size_t i = 0; i < input.size(); i++) {
+      single_sample_filter.update(&input[i], &single_sample_output[i], 1, dt);
+    }
+    // each run starts from the initial state, like the single sample blocks
+    float block_ns = time_ns_per_sample(input.size(), [&] {
+      block_filter.reset();
+      for (size_t offset = 0; offset < input.size(); offset += block_size) {
+        block_filter.update(input.data() + offset, block_output.data() + offset, block_size, dt);
+      }
+    });
+    sink = block_output.back();
+    print_row("SimpleLowpassFilter", per_sample_ns, block_ns,
+              max_difference(single_sample_output, block_output));
+  }
+  run_multi_channel("8 channels, Df1 biquad section",
+                    espp::ButterworthFilter<2, espp::BiquadFilterDf1>({cutoff}),
+                    espp::ButterworthFilter<2, espp::BiquadFilterDf1, num_channels>({cutoff}),
+                    interleaved_input);
+  run_multi_channel("8 channels, ButterworthFilter<4>",
+                    espp::ButterworthFilter<4, espp::BiquadFilterDf2>({cutoff}),
+                    espp::ButterworthFilter<4, espp::BiquadFilterDf2, num_channels>({cutoff}),
+                    interleaved_input);
+  return 0;
+}
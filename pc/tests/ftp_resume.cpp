@@ -0,0 +1,260 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ftp_server.hpp"
+
+using namespace std::chrono_literals;
+
+// Resume interrupted RETR and STOR transfers of a 64 MB file with REST,
+// download it in segments over several connections at once (as e.g. lftp's
+// pget does), with and without a cap on concurrent transfers, and list a
+// directory of 2000 files with MLSD and LIST, all over loopback.
+
+static constexpr size_t file_size = 64 * 1024 * 1024;
+static constexpr size_t num_listed_files = 2000;
+
+// A minimal FTP client, which only does what the benchmark needs
+class FtpClient {
+public:
+  explicit FtpClient(int port) {
+    control_.connect({.ip_address = "127.0.0.1", .port = (size_t)port});
+    read_reply();
+    command("USER test\r\n");
+    command("PASS test\r\n");
+    command("TYPE I\r\n");
+  }
+
+  ~FtpClient() { command("QUIT\r\n"); }
+
+  // retrieve up to max_size bytes of a file from offset, returning the reply
+  // code of the transfer
+  int retrieve(const std::string &name, size_t offset, size_t max_size, std::string &data) {
+    auto data_socket = open_data_connection();
+    if (offset > 0) {
+      command(fmt::format("REST {}\r\n", offset));
+    }
+    auto reply = command("RETR " + name + "\r\n");
+    if (!reply.starts_with("150")) {
+      return std::stoi(reply.substr(0, 3));
+    }
+    std::vector<uint8_t> buffer(64 * 1024);
+    while (data.size() < max_size) {
+      size_t received = data_socket->receive(buffer.data(), buffer.size());
+      if (received == 0) {
+        break;
+      }
+      data.append(buffer.begin(), buffer.begin() + std::min(received, max_size - data.size()));
+    }
+    data_socket->close();
+    return std::stoi(read_reply().substr(0, 3));
+  }
+
+  // store data in a file at offset
+  int store(const std::string &name, size_t offset, std::string_view data) {
+    auto data_socket = open_data_connection();
+    if (offset > 0) {
+      command(fmt::format("REST {}\r\n", offset));
+    }
+    auto reply = command("STOR " + name + "\r\n");
+    if (!reply.starts_with("150")) {
+      return std::stoi(reply.substr(0, 3));
+    }
+    for (size_t position = 0; position < data.size(); position += 64 * 1024) {
+      data_socket->transmit(data.substr(position, 64 * 1024));
+    }
+    data_socket->close();
+    return std::stoi(read_reply().substr(0, 3));
+  }
+
+  // list the current directory, returning the size of the listing
+  size_t list(const std::string &list_command) {
+    auto data_socket = open_data_connection();
+    command(list_command + "\r\n");
+    std::vector<uint8_t> buffer(64 * 1024);
+    size_t total = 0;
+    while (size_t received = data_socket->receive(buffer.data(), buffer.size())) {
+      total += received;
+    }
+    read_reply();
+    return total;
+  }
+
+  std::string command(const std::string &request) {
+    control_.transmit(request);
+    return read_reply();
+  }
+
+protected:
+  std::unique_ptr<espp::TcpSocket> open_data_connection() {
+    auto reply = command("PASV\r\n");
+    // the reply ends with (h1,h2,h3,h4,p1,p2)
+    auto start = reply.find('(');
+    std::vector<int> values;
+    size_t position = start + 1;
+    for (int i = 0; i < 6; i++) {
+      size_t end = reply.find_first_of(",)", position);
+      values.push_back(std::stoi(reply.substr(position, end - position)));
+      position = end + 1;
+    }
+    auto data_socket = std::make_unique<espp::TcpSocket>(
+        espp::TcpSocket::Config{.log_level = espp::Logger::Verbosity::ERROR});
+    data_socket->connect(
+        {.ip_address = "127.0.0.1", .port = (size_t)(values[4] * 256 + values[5])});
+    return data_socket;
+  }
+
+  // read the next reply, which ends with the line starting with its code and
+  // a space (multiline replies start with the code and a dash)
+  std::string read_reply() {
+    std::string reply;
+    while (true) {
+      auto line_end = replies_.find("\r\n");
+      if (line_end != std::string::npos) {
+        auto line = replies_.substr(0, line_end);
+        replies_.erase(0, line_end + 2);
+        reply += line;
+        if (line.size() >= 4 && line[3] == ' ') {
+          return reply;
+        }
+        reply += '\n';
+        continue;
+      }
+      std::vector<uint8_t> data;
+      if (!control_.receive(data, 1024)) {
+        return "000 no reply";
+      }
+      replies_.append(data.begin(), data.end());
+    }
+  }
+
+  espp::TcpSocket control_{{.log_level = espp::Logger::Verbosity::ERROR}};
+  std::string replies_;
+};
+
+static void resume(int port, const std::filesystem::path &root, const std::string &data) {
+  espp::FtpServer server("127.0.0.1", port, root);
+  server.start();
+  std::this_thread::sleep_for(100ms);
+
+  // the download is interrupted after 24 MB, then resumed
+  std::string downloaded;
+  {
+    FtpClient client(port);
+    client.retrieve("source.bin", 0, 24 * 1024 * 1024, downloaded);
+  }
+  size_t interrupted_at = downloaded.size();
+  {
+    FtpClient client(port);
+    client.retrieve("source.bin", downloaded.size(), file_size, downloaded);
+  }
+  fmt::print("RETR interrupted at {} MB, resumed with REST: {}\n", interrupted_at / (1024 * 1024),
+             downloaded == data ? "file intact" : "ERROR: file differs");
+
+  // the upload is interrupted half way, then resumed
+  {
+    FtpClient client(port);
+    client.store("stored.bin", 0, std::string_view(data).substr(0, file_size / 2));
+    client.store("stored.bin", file_size / 2, std::string_view(data).substr(file_size / 2));
+  }
+  std::ifstream stored_file(root / "stored.bin", std::ios::binary);
+  std::string stored((std::istreambuf_iterator<char>(stored_file)),
+                     std::istreambuf_iterator<char>());
+  fmt::print("STOR interrupted at {} MB, resumed with REST: {}\n\n", file_size / 2 / (1024 * 1024),
+             stored == data ? "file intact" : "ERROR: file differs");
+  server.stop();
+}
+
+static void segmented(int port, const std::filesystem::path &root, const std::string &data,
+                      size_t num_connections, size_t max_transfers) {
+  espp::FtpServer server("127.0.0.1", port, root,
+                         espp::FtpClientSession::DEFAULT_TRANSFER_BUFFER_SIZE, max_transfers);
+  server.start();
+  std::this_thread::sleep_for(100ms);
+
+  size_t segment_size = (file_size + num_connections - 1) / num_connections;
+  std::vector<std::string> segments(num_connections);
+  std::atomic<size_t> refused{0};
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < num_connections; i++) {
+    threads.emplace_back([&, i] {
+      FtpClient client(port);
+      size_t offset = i * segment_size;
+      // retry transfers which are refused because of the cap
+      while (client.retrieve("source.bin", offset, segment_size, segments[i]) == 425) {
+        refused++;
+        std::this_thread::sleep_for(10ms);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+  std::string downloaded;
+  for (const auto &segment : segments) {
+    downloaded += segment;
+  }
+  fmt::print("{:>11} | {:>13} | {:>9.1f} | {:>7} | {}\n", num_connections, max_transfers,
+             file_size / elapsed.count() / (1024 * 1024), refused.load(),
+             downloaded == data ? "intact" : "ERROR: differs");
+  server.stop();
+}
+
+static void listing(int port, const std::filesystem::path &root) {
+  auto directory = root / "listing";
+  std::filesystem::create_directories(directory);
+  for (size_t i = 0; i < num_listed_files; i++) {
+    std::ofstream(directory / fmt::format("file_{:04}.log", i)) << i;
+  }
+  espp::FtpServer server("127.0.0.1", port, directory);
+  server.start();
+  std::this_thread::sleep_for(100ms);
+  {
+    FtpClient client(port);
+    for (auto list_command : {"LIST", "MLSD"}) {
+      auto start = std::chrono::steady_clock::now();
+      size_t size = client.list(list_command);
+      std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      fmt::print("{} of {} files: {} bytes in {:.1f} ms\n", list_command, num_listed_files, size,
+                 elapsed.count());
+    }
+    fmt::print("MLST reply:\n{}\n", client.command("MLST file_0000.log\r\n"));
+  }
+  server.stop();
+}
+
+int main() {
+  // the server sends to sockets which the client may have closed
+  std::signal(SIGPIPE, SIG_IGN);
+
+  auto root = std::filesystem::temp_directory_path() / "espp_ftp_resume";
+  std::filesystem::create_directories(root);
+  std::string data(file_size, '\0');
+  std::mt19937 gen(0);
+  for (auto &c : data) {
+    c = static_cast<char>(gen());
+  }
+  std::ofstream(root / "source.bin", std::ios::binary).write(data.data(), data.size());
+
+  resume(12131, root, data);
+
+  fmt::print("{:>11} | {:>13} | {:>9} | {:>7} | {}\n", "connections", "max transfers", "MB/s",
+             "refused", "file");
+  segmented(12132, root, data, 1, 8);
+  segmented(12133, root, data, 4, 8);
+  segmented(12134, root, data, 4, 2);
+  fmt::print("\n");
+
+  listing(12135, root);
+
+  std::filesystem::remove_all(root);
+  return 0;
+}
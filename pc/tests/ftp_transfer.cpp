@@ -0,0 +1,146 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ftp_server.hpp"
+
+using namespace std::chrono_literals;
+
+// Transfer a 64 MB file to and from an FtpServer over loopback, with a
+// minimal passive mode FTP client, and report the throughput of RETR and
+// STOR for different transfer buffer sizes. 1 KB is the buffer size the
+// sessions used to transfer files with.
+
+static constexpr size_t file_size = 64 * 1024 * 1024;
+
+// A minimal FTP client, which only does what the benchmark needs
+class FtpClient {
+public:
+  explicit FtpClient(int port) {
+    control_.connect({.ip_address = "127.0.0.1", .port = (size_t)port});
+    read_reply("220");
+    command("USER test\r\n", "331");
+    command("PASS test\r\n", "230");
+    command("TYPE I\r\n", "200");
+  }
+
+  ~FtpClient() { command("QUIT\r\n", "221"); }
+
+  size_t retrieve(const std::string &name) {
+    auto data_socket = open_data_connection();
+    command("RETR " + name + "\r\n", "150");
+    std::vector<uint8_t> buffer(64 * 1024);
+    size_t total = 0;
+    while (size_t received = data_socket->receive(buffer.data(), buffer.size())) {
+      total += received;
+    }
+    read_reply("226");
+    return total;
+  }
+
+  void store(const std::string &name, const std::string &data) {
+    auto data_socket = open_data_connection();
+    command("STOR " + name + "\r\n", "150");
+    for (size_t offset = 0; offset < data.size(); offset += 64 * 1024) {
+      data_socket->transmit(std::string_view(data).substr(offset, 64 * 1024));
+    }
+    data_socket->close();
+    read_reply("226");
+  }
+
+protected:
+  std::unique_ptr<espp::TcpSocket> open_data_connection() {
+    auto reply = command("PASV\r\n", "227");
+    // the reply ends with (h1,h2,h3,h4,p1,p2)
+    auto start = reply.find('(');
+    std::vector<int> values;
+    size_t position = start + 1;
+    for (int i = 0; i < 6; i++) {
+      size_t end = reply.find_first_of(",)", position);
+      values.push_back(std::stoi(reply.substr(position, end - position)));
+      position = end + 1;
+    }
+    auto data_socket = std::make_unique<espp::TcpSocket>(
+        espp::TcpSocket::Config{.log_level = espp::Logger::Verbosity::ERROR});
+    data_socket->connect(
+        {.ip_address = "127.0.0.1", .port = (size_t)(values[4] * 256 + values[5])});
+    return data_socket;
+  }
+
+  std::string command(const std::string &request, std::string_view code) {
+    control_.transmit(request);
+    return read_reply(code);
+  }
+
+  // read until we have a line of the reply with the given code
+  std::string read_reply(std::string_view code) {
+    while (true) {
+      auto line_end = replies_.find("\r\n");
+      if (line_end != std::string::npos) {
+        auto line = replies_.substr(0, line_end);
+        replies_.erase(0, line_end + 2);
+        if (line.starts_with(code)) {
+          return line;
+        }
+        continue;
+      }
+      std::vector<uint8_t> data;
+      if (!control_.receive(data, 1024)) {
+        fmt::print(stderr, "No reply, expected {}\n", code);
+        return "";
+      }
+      replies_.append(data.begin(), data.end());
+    }
+  }
+
+  espp::TcpSocket control_{{.log_level = espp::Logger::Verbosity::ERROR}};
+  std::string replies_;
+};
+
+static void run(size_t transfer_buffer_size, int port, const std::filesystem::path &root,
+                const std::string &data) {
+  espp::FtpServer server("127.0.0.1", port, root, transfer_buffer_size);
+  server.start();
+  std::this_thread::sleep_for(100ms);
+  {
+    FtpClient client(port);
+
+    auto start = std::chrono::steady_clock::now();
+    client.store("stored.bin", data);
+    std::chrono::duration<float> store_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    size_t retrieved = client.retrieve("source.bin");
+    std::chrono::duration<float> retrieve_time = std::chrono::steady_clock::now() - start;
+
+    bool stored_ok = std::filesystem::file_size(root / "stored.bin") == data.size();
+    fmt::print("{:>11} KB | {:>15.1f} | {:>15.1f}{}\n", transfer_buffer_size / 1024,
+               data.size() / store_time.count() / (1024 * 1024),
+               retrieved / retrieve_time.count() / (1024 * 1024),
+               stored_ok && retrieved == data.size() ? "" : "  (ERROR: size mismatch)");
+  }
+  server.stop();
+}
+
+int main() {
+  auto root = std::filesystem::temp_directory_path() / "espp_ftp_transfer";
+  std::filesystem::create_directories(root);
+  std::string data(file_size, '\0');
+  std::mt19937 gen(0);
+  for (auto &c : data) {
+    c = static_cast<char>(gen());
+  }
+  std::ofstream(root / "source.bin", std::ios::binary).write(data.data(), data.size());
+
+  fmt::print("{:>14} | {:>15} | {:>15}\n", "buffer size", "STOR MB/s", "RETR MB/s");
+  run(1024, 12121, root, data);
+  run(16 * 1024, 12122, root, data);
+  run(espp::FtpClientSession::DEFAULT_TRANSFER_BUFFER_SIZE, 12123, root, data);
+
+  std::filesystem::remove_all(root);
+  return 0;
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "format.hpp"
+
+#include "color.hpp"
+#include "led_strip.hpp"
+
+// Render a rainbow (with a moving offset) into a 1024 LED strip (APA102, with
+// a brightness byte, in BGR order), with the floating point color APIs (one
+// set_pixel(Hsv) per LED), with the integer ones (Hsv8 -> Rgb8 conversion and
+// one set_pixels call, or one fill_gradient call), and with a gamma lookup
+// table. Report the time per frame of each and the largest difference between
+// the bytes they write to the strip.
+
+static constexpr size_t num_leds = 1024;
+static constexpr int num_frames = 1000;
+
+// compile-time gamma (2.2) and brightness (50%) correction
+static constexpr auto gamma_lut = espp::make_color_lut(2.2f, 128);
+
+using Frame = std::vector<uint8_t>;
+
+// the best time per frame of a few runs of render(frame_index)
+template <typename F> static float time_us_per_frame(F &&render) {
+  float best = INFINITY;
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < num_frames; frame++) {
+      render(frame);
+    }
+    std::chrono::duration<float, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / num_frames);
+  }
+  return best;
+}
+
+static int max_difference(const Frame &a, const Frame &b) {
+  int difference = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+  }
+  return difference;
+}
+
+int main() {
+  // the strip "sends" its data by copying it into the frame being rendered
+  Frame *sent = nullptr;
+  auto make_strip = [&sent]() {
+    return espp::LedStrip({.num_leds = num_leds,
+                           .write = [&sent](const uint8_t *data,
+                                            size_t length) { sent->assign(data, data + length); },
+                           .send_brightness = true,
+                           .byte_order = espp::LedStrip::ByteOrder::BGR,
+                           .start_frame = espp::LedStrip::APA102_START_FRAME,
+                           .log_level = espp::Logger::Verbosity::WARN});
+  };
+
+  fmt::print("{:<40} | {:>8} | {:>7} | {}\n", "api", "us/frame", "speedup", "max difference");
+  auto print_row = [](const std::string &name, float us, float reference_us,
+                      std::optional<int> difference) {
+    fmt::print("{:<40} | {:>8.1f} | {:>6.1f}x | {}\n", name, us, reference_us / us,
+               difference ? std::to_string(*difference) : "-");
+  };
+
+  // floating point: set_pixel(Hsv) for each LED
+  Frame float_frame;
+  auto float_strip = make_strip();
+  float float_us = time_us_per_frame([&](int frame) {
+    for (size_t i = 0; i < num_leds; i++) {
+      float hue = std::fmod((i + frame) * 360.0f / num_leds, 360.0f);
+      float_strip.set_pixel(i, espp::Hsv(hue, 1.0f, 1.0f));
+    }
+    sent = &float_frame;
+    float_strip.show();
+  });
+  print_row("set_pixel(Hsv) per LED", float_us, float_us, 0);
+
+  // integer: Hsv8 -> Rgb8 for each LED, then set_pixels
+  Frame span_frame;
+  auto span_strip = make_strip();
+  std::vector<espp::Rgb8> colors(num_leds);
+  float span_us = time_us_per_frame([&](int frame) {
+    for (size_t i = 0; i < num_leds; i++) {
+      uint16_t hue = (i + frame) * espp::Hsv8::HUE_MAX / num_leds;
+      colors[i] = espp::Hsv8(hue, 255, 255).rgb();
+    }
+    span_strip.set_pixels(colors);
+    sent = &span_frame;
+    span_strip.show();
+  });
+  print_row("Hsv8::rgb() per LED + set_pixels", span_us, float_us,
+            max_difference(float_frame, span_frame));
+
+  // integer: fill_gradient, in two parts to wrap the hue around
+  Frame gradient_frame;
+  auto gradient_strip = make_strip();
+  float gradient_us = time_us_per_frame([&](int frame) {
+    // the LED at which the hue wraps around to 0
+    size_t wrap = num_leds - (frame % num_leds);
+    auto hue_at = [](size_t i) -> uint16_t { return i * espp::Hsv8::HUE_MAX / num_leds; };
+    gradient_strip.fill_gradient(0, wrap, espp::Hsv8(hue_at(frame % num_leds), 255, 255),
+                                 espp::Hsv8(hue_at(num_leds - 1), 255, 255));
+    if (wrap < num_leds) {
+      gradient_strip.fill_gradient(wrap, num_leds - wrap, espp::Hsv8(0, 255, 255),
+                                   espp::Hsv8(hue_at(num_leds - wrap - 1), 255, 255));
+    }
+    sent = &gradient_frame;
+    gradient_strip.show();
+  });
+  print_row("fill_gradient(Hsv8)", gradient_us, float_us,
+            max_difference(float_frame, gradient_frame));
+
+  // with gamma and brightness correction, which costs a table lookup per byte
+  Frame gamma_frame;
+  auto gamma_strip = make_strip();
+  gamma_strip.set_color_lut(gamma_lut);
+  float gamma_us = time_us_per_frame([&](int frame) {
+    for (size_t i = 0; i < num_leds; i++) {
+      uint16_t hue = (i + frame) * espp::Hsv8::HUE_MAX / num_leds;
+      colors[i] = espp::Hsv8(hue, 255, 255).rgb();
+    }
+    gamma_strip.set_pixels(colors);
+    sent = &gamma_frame;
+    gamma_strip.show();
+  });
+  print_row("Hsv8::rgb() + set_pixels with gamma lut", gamma_us, float_us, std::nullopt);
+
+  return 0;
+}
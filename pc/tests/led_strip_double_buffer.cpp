@@ -0,0 +1,97 @@
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "format.hpp"
+
+#include "color.hpp"
+#include "led_strip.hpp"
+
+using namespace std::chrono_literals;
+
+// Animate a 300 LED WS2812 strip (a dot moving along a gradient), with a mock
+// write function which takes as long as the real transfer would (30 us per
+// LED, at 800 kbit/s), and with 6 ms of other work per frame. Compare showing
+// the frames blocking, double buffered, and double buffered with partial
+// updates (only the bytes which changed), and check that the strip ends up
+// showing the same frames each way.
+
+static constexpr size_t num_leds = 300;
+static constexpr size_t bytes_per_led = 3;
+static constexpr int num_frames = 200;
+static constexpr auto time_per_byte = 10us;
+static constexpr auto work_per_frame = 6ms;
+
+// what the (mock) strip is showing, and a copy of it after each write
+struct MockStrip {
+  std::vector<uint8_t> leds;
+  std::vector<std::vector<uint8_t>> frames;
+
+  void write(const uint8_t *data, size_t length, size_t offset) {
+    // simulate the transfer time
+    std::this_thread::sleep_for(time_per_byte * length);
+    leds.resize(std::max(leds.size(), offset + length));
+    std::copy(data, data + length, leds.begin() + offset);
+    frames.push_back(leds);
+  }
+};
+
+static void run(const std::string &name, bool double_buffered, bool partial, MockStrip &mock) {
+  espp::LedStrip::Config config{
+      .num_leds = num_leds,
+      .write = [&mock](const uint8_t *data, size_t length) { mock.write(data, length, 0); },
+      .send_brightness = false,
+      .byte_order = espp::LedStrip::ByteOrder::GRB,
+      .log_level = espp::Logger::Verbosity::WARN,
+      .double_buffered = double_buffered,
+  };
+  if (partial) {
+    config.write_range = [&mock](const uint8_t *data, size_t length, size_t offset) {
+      mock.write(data, length, offset);
+    };
+  }
+  espp::LedStrip strip(config);
+  strip.fill_gradient(0, num_leds, espp::Rgb8(0, 0, 32), espp::Rgb8(32, 0, 0));
+
+  auto start = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < num_frames; frame++) {
+    // move the dot along the strip, restoring the gradient behind it
+    size_t previous = (frame + num_leds - 1) % num_leds;
+    size_t current = frame % num_leds;
+    uint8_t level = previous * 32 / num_leds;
+    strip.fill_gradient(previous, 1, espp::Rgb8(level, 0, 32 - level),
+                        espp::Rgb8(level, 0, 32 - level));
+    strip.set_pixels(std::vector<espp::Rgb8>{espp::Rgb8(255, 255, 255)}, current);
+    strip.show();
+    // the rest of the application's work for the frame
+    std::this_thread::sleep_for(work_per_frame);
+  }
+  strip.wait_for_show();
+  std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+
+  auto stats = strip.frame_stats();
+  fmt::print("{:<30} | {:>6.1f} | {:>10.2f} | {:>10.2f} | {:>10}\n", name,
+             num_frames / elapsed.count(), stats.average_latency * 1e3f, stats.max_latency * 1e3f,
+             stats.bytes_written / stats.frames_shown);
+}
+
+int main() {
+  fmt::print("{} LEDs, {} us per LED to write, {} ms of other work per frame\n", num_leds,
+             std::chrono::duration_cast<std::chrono::microseconds>(time_per_byte * bytes_per_led)
+                 .count(),
+             work_per_frame.count());
+  fmt::print("{:<30} | {:>6} | {:>10} | {:>10} | {:>10}\n", "mode", "fps", "latency ms",
+             "max ms", "bytes/frame");
+  MockStrip blocking, double_buffered, partial;
+  run("blocking", false, false, blocking);
+  run("double buffered", true, false, double_buffered);
+  run("double buffered, partial", true, true, partial);
+
+  // the strip must have shown the same frames each way
+  bool same = blocking.frames == double_buffered.frames && blocking.frames == partial.frames;
+  fmt::print("frames shown match: {}\n", same);
+  return same ? 0 : 1;
+}
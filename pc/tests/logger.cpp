@@ -0,0 +1,167 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.hpp"
+
+using namespace std::chrono_literals;
+
+// Benchmark measuring the cost of a log call for the calling thread, with the
+// default (synchronous) logging, with asynchronous logging, and with binary
+// logging (synchronous and asynchronous), as well as the number of bytes
+// output per message.
+//
+// NOTE: the text log output is written to stdout, so you may want to redirect
+// stdout (e.g. to /dev/null); the results are written to stderr. The binary log
+// output is written to logger.bin, which can be decoded with
+// components/logger/python/decode_binary_log.py.
+//
+// It also checks that binary logging with format strings which are not string
+// literals (and so get a new id every time) keeps reusing a bounded number of
+// ids, and that each log frame refers to the format string it was logged with.
+
+struct Result {
+  float mean_us;
+  float max_us;
+  float bytes_per_message;
+};
+
+static Result run(espp::Logger &logger, size_t num_logs, std::chrono::microseconds period) {
+  float total_us = 0;
+  float max_us = 0;
+  for (size_t i = 0; i < num_logs; i++) {
+    auto start = std::chrono::steady_clock::now();
+    logger.info("control loop iteration {}, error = {:.3f}, output = {:.3f}", i, 0.1f * i,
+                -0.2f * i);
+    auto end = std::chrono::steady_clock::now();
+    float elapsed_us = std::chrono::duration<float, std::micro>(end - start).count();
+    total_us += elapsed_us;
+    max_us = std::max(max_us, elapsed_us);
+    std::this_thread::sleep_for(period);
+  }
+  return {
+      .mean_us = total_us / num_logs,
+      .max_us = max_us,
+  };
+}
+
+// log with a different heap allocated format string each time, with only 8
+// format ids available, and check the ids in the output
+static bool check_heap_format_strings(espp::Logger &logger) {
+  using namespace espp::logger_binary_format;
+  static constexpr size_t max_formats = 8;
+  std::vector<uint8_t> output;
+  espp::Logger::start_binary({
+      .write =
+          [&](std::span<const uint8_t> data) {
+            output.insert(output.end(), data.begin(), data.end());
+          },
+      .max_formats = max_formats,
+  });
+  std::vector<std::string> logged;
+  for (size_t i = 0; i < 100; i++) {
+    std::string format = fmt::format("heap format string {}, value = {{}}", i);
+    logger.info(format, i);
+    logged.push_back(format);
+  }
+  espp::Logger::stop_binary();
+
+  std::map<uint16_t, std::string> formats;
+  std::vector<std::string> received;
+  bool ids_bounded = true;
+  for (size_t offset = 0; offset + FRAME_HEADER_SIZE <= output.size();) {
+    uint8_t type = output[offset];
+    uint16_t size;
+    std::memcpy(&size, &output[offset + 1], sizeof(size));
+    const uint8_t *payload = &output[offset + FRAME_HEADER_SIZE];
+    uint16_t id;
+    if (type == static_cast<uint8_t>(FrameType::FORMAT_DEF)) {
+      std::memcpy(&id, payload, sizeof(id));
+      formats[id] = std::string(reinterpret_cast<const char *>(payload + sizeof(id)),
+                                size - sizeof(id));
+      ids_bounded = ids_bounded && id < max_formats;
+    } else if (type == static_cast<uint8_t>(FrameType::LOG)) {
+      // level, timestamp and tag id come before the format id
+      std::memcpy(&id, payload + 1 + sizeof(uint64_t) + sizeof(uint16_t), sizeof(id));
+      received.push_back(formats[id]);
+    }
+    offset += FRAME_HEADER_SIZE + size;
+  }
+  bool ok = ids_bounded && received == logged;
+  fmt::print(stderr, "heap format strings: {} ({} format ids, {} messages)\n",
+             ok ? "ok" : "FAILED", max_formats, received.size());
+  return ok;
+}
+
+static void print_result(std::string_view mode, const Result &result, uint32_t dropped) {
+  fmt::print(stderr, "{:>12} | {:>14.2f} | {:>13.2f} | {:>13.1f} | {:>7}\n", mode, result.mean_us,
+             result.max_us, result.bytes_per_message, dropped);
+}
+
+int main() {
+  espp::Logger logger({.tag = "Logger Test", .level = espp::Logger::Verbosity::INFO});
+
+  static constexpr size_t num_logs = 2000;
+  // simulate logging from a 1 kHz control loop
+  static constexpr auto period = 1ms;
+
+  // the size of a text log message (without the color codes)
+  float text_bytes = fmt::formatted_size("[Logger Test/I][1.234]: control loop iteration {}, "
+                                         "error = {:.3f}, output = {:.3f}\n",
+                                         num_logs / 2, 0.1f * num_logs / 2, -0.2f * num_logs / 2);
+
+  auto sync_result = run(logger, num_logs, period);
+  sync_result.bytes_per_message = text_bytes;
+
+  espp::Logger::start_async({
+      .num_records = 64,
+      .drain_period = 10ms,
+  });
+  auto async_result = run(logger, num_logs, period);
+  async_result.bytes_per_message = text_bytes;
+  espp::Logger::stop_async();
+  uint32_t async_dropped = espp::Logger::get_num_dropped();
+
+  // binary logging, written to a file
+  FILE *binary_file = std::fopen("logger.bin", "wb");
+  if (!binary_file) {
+    fmt::print(stderr, "Could not open logger.bin\n");
+    return 1;
+  }
+  size_t binary_bytes = 0;
+  espp::Logger::start_binary({
+      .write =
+          [&](std::span<const uint8_t> data) {
+            binary_bytes += data.size();
+            std::fwrite(data.data(), 1, data.size(), binary_file);
+          },
+  });
+  auto binary_result = run(logger, num_logs, period);
+  binary_result.bytes_per_message = float(binary_bytes) / num_logs;
+
+  // binary and asynchronous logging
+  binary_bytes = 0;
+  espp::Logger::start_async({
+      .num_records = 64,
+      .drain_period = 10ms,
+  });
+  auto async_binary_result = run(logger, num_logs, period);
+  espp::Logger::stop_async();
+  async_binary_result.bytes_per_message = float(binary_bytes) / num_logs;
+  espp::Logger::stop_binary();
+  std::fclose(binary_file);
+
+  fmt::print(stderr, "{:>12} | {:>14} | {:>13} | {:>13} | {:>7}\n", "mode", "mean call (us)",
+             "max call (us)", "bytes/message", "dropped");
+  print_result("sync", sync_result, 0);
+  print_result("async", async_result, async_dropped);
+  print_result("binary", binary_result, 0);
+  print_result("async binary", async_binary_result,
+               espp::Logger::get_num_dropped() - async_dropped);
+
+  return check_heap_format_strings(logger) ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "logger.hpp"
+
+// Log in binary and asynchronous mode with records which are too small for
+// even a log frame without its arguments, and check that the messages are
+// counted as dropped rather than silently lost, and that no (truncated) log
+// frame is written.
+
+int main() {
+  using namespace espp::logger_binary_format;
+  static constexpr size_t num_logs = 10;
+
+  espp::Logger logger({.tag = "Small", .level = espp::Logger::Verbosity::INFO});
+  std::vector<uint8_t> output;
+  espp::Logger::start_binary({
+      .write =
+          [&](std::span<const uint8_t> data) {
+            output.insert(output.end(), data.begin(), data.end());
+          },
+  });
+  // a log frame needs FRAME_HEADER_SIZE + 13 bytes before its arguments
+  espp::Logger::start_async({.num_records = 64, .max_record_size = FRAME_HEADER_SIZE + 8});
+  uint32_t dropped_before = espp::Logger::get_num_dropped();
+  for (size_t i = 0; i < num_logs; i++) {
+    logger.info("value = {}", i);
+  }
+  espp::Logger::stop_async();
+  espp::Logger::stop_binary();
+  uint32_t num_dropped = espp::Logger::get_num_dropped() - dropped_before;
+
+  size_t num_log_frames = 0;
+  for (size_t offset = 0; offset + FRAME_HEADER_SIZE <= output.size();) {
+    uint16_t size;
+    std::memcpy(&size, &output[offset + 1], sizeof(size));
+    num_log_frames += output[offset] == static_cast<uint8_t>(FrameType::LOG);
+    offset += FRAME_HEADER_SIZE + size;
+  }
+  bool ok = num_dropped == num_logs && num_log_frames == 0;
+  fmt::print(stderr, "{} messages too large for their records: {} dropped, {} log frames: {}\n",
+             num_logs, num_dropped, num_log_frames, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
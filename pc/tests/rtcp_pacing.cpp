@@ -0,0 +1,288 @@
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rtsp_client.hpp"
+#include "rtsp_server.hpp"
+
+using namespace std::chrono_literals;
+
+// Stream 30 kB MJPEG frames at 30 fps over loopback from the RtspServer to two
+// clients: an RtspClient on a perfect link, and a client on a slow link which
+// can only carry ~10 frames per second (as a client with a poor WiFi
+// connection would have) and drops the packets which don't fit, reporting
+// that in its RTCP receiver reports, which it sends to the RTCP port the server
+// advertised in its SETUP response. Reports what each session measured from
+// the receiver reports, and how many frames each client got, with and without
+// adaptive pacing, and fails if a session got no receiver reports. First
+// checks the sender report encoding byte for byte against RFC 3550.
+
+static constexpr int base_port = 8560;
+static constexpr size_t num_frames = 300;
+static constexpr float link_bytes_per_second = 320 * 1024;
+static constexpr float link_buffer_bytes = 48 * 1024;
+
+// A minimal RTSP client whose RTP link has limited bandwidth
+class LossyClient {
+public:
+  LossyClient(int server_port, size_t rtp_port)
+      : rtp_port_(rtp_port)
+      , jitter_buffer_({
+            .on_jpeg_frame = [this](auto) { frames_received++; },
+            .log_level = espp::Logger::Verbosity::ERROR,
+        }) {
+    rtsp_socket_.connect({.ip_address = "127.0.0.1", .port = (size_t)server_port});
+    rtp_socket_.start_receiving(task_config_,
+                                {
+                                    .port = rtp_port,
+                                    .buffer_size = 2048,
+                                    .on_receive_span_callback =
+                                        [this](auto data, auto &) {
+                                          if (!link_has_room(data.size())) {
+                                            return;
+                                          }
+                                          std::string_view packet((const char *)data.data(),
+                                                                  data.size());
+                                          jitter_buffer_.add_packet(espp::RtpJpegPacket(packet));
+                                        },
+                                });
+    rtcp_socket_.start_receiving(task_config_,
+                                 {
+                                     .port = rtp_port + 1,
+                                     .buffer_size = 1024,
+                                     .on_receive_callback =
+                                         [this](auto &data, auto &) { return handle_rtcp(data); },
+                                 });
+    auto path = fmt::format("rtsp://127.0.0.1:{}/mjpeg/1", server_port);
+    auto response = request(fmt::format("SETUP {} RTSP/1.0\r\nCSeq: 1\r\nTransport: "
+                                        "RTP/AVP;unicast;client_port={}-{}\r\n\r\n",
+                                        path, rtp_port, rtp_port + 1));
+    auto session_start = response.find("Session: ") + 9;
+    auto session = response.substr(session_start, response.find("\r\n", session_start) -
+                                                       session_start);
+    // server_port=<rtp port>-<rtcp port>
+    auto server_port_start = response.find("server_port=");
+    if (server_port_start != std::string::npos) {
+      server_rtcp_port_ =
+          std::stoul(response.substr(response.find('-', server_port_start) + 1));
+    }
+    request(fmt::format("PLAY {} RTSP/1.0\r\nCSeq: 2\r\nSession: {}\r\n\r\n", path, session));
+  }
+
+  std::atomic<size_t> frames_received{0};
+
+  bool has_server_rtcp_port() const { return server_rtcp_port_ != 0; }
+
+protected:
+  std::string request(const std::string &request) {
+    std::string response;
+    rtsp_socket_.transmit(request, {
+                                       .wait_for_response = true,
+                                       .response_size = 1024,
+                                       .on_response_callback =
+                                           [&response](auto &data) {
+                                             response.assign(data.begin(), data.end());
+                                           },
+                                   });
+    return response;
+  }
+
+  // a token bucket, which packets only pass if there is room on the link
+  bool link_has_room(size_t size) {
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<float> elapsed = now - last_packet_time_;
+    last_packet_time_ = now;
+    link_tokens_ =
+        std::min(link_buffer_bytes, link_tokens_ + elapsed.count() * link_bytes_per_second);
+    if (link_tokens_ < size) {
+      return false;
+    }
+    link_tokens_ -= size;
+    return true;
+  }
+
+  // send a receiver report to the server's RTCP port for each sender report
+  std::optional<std::vector<uint8_t>> handle_rtcp(std::vector<uint8_t> &data) {
+    espp::RtcpSenderReport sender_report(
+        std::string_view((const char *)data.data(), data.size()));
+    if (!sender_report.is_valid()) {
+      return {};
+    }
+    auto stats = jitter_buffer_.get_stats();
+    uint32_t received = stats.packets_expected - stats.packets_lost;
+    uint32_t expected_interval = stats.packets_expected - expected_prior_;
+    uint32_t lost_interval = expected_interval - (received - received_prior_);
+    expected_prior_ = stats.packets_expected;
+    received_prior_ = received;
+    espp::RtcpReceiverReport report;
+    report.ssrc = 1;
+    report.report_blocks.push_back({
+        .ssrc = stats.ssrc,
+        .fraction_lost = uint8_t(expected_interval ? (lost_interval << 8) / expected_interval : 0),
+        .cumulative_lost = (int32_t)stats.packets_lost,
+        .highest_sequence = stats.highest_sequence,
+        .jitter = stats.jitter,
+        .last_sender_report = espp::RtcpPacket::to_compact_ntp(sender_report.ntp_timestamp),
+    });
+    report.serialize();
+    rtcp_socket_.send(report.get_data(), {.ip_address = "127.0.0.1", .port = server_rtcp_port_});
+    return {};
+  }
+
+  size_t rtp_port_;
+  size_t server_rtcp_port_{0};
+  // declared before the sockets, so they outlive the receive tasks
+  espp::RtpJpegJitterBuffer jitter_buffer_;
+  float link_tokens_{link_buffer_bytes};
+  std::chrono::steady_clock::time_point last_packet_time_{std::chrono::steady_clock::now()};
+  uint32_t expected_prior_{0};
+  uint32_t received_prior_{0};
+  espp::Logger::Verbosity log_level_{espp::Logger::Verbosity::ERROR};
+  espp::Task::BaseConfig task_config_{.name = "LossyClient"};
+  espp::TcpSocket rtsp_socket_{{.log_level = log_level_}};
+  espp::UdpSocket rtp_socket_{{.log_level = log_level_}};
+  espp::UdpSocket rtcp_socket_{{.log_level = log_level_}};
+};
+
+// A sender report with one report block, built by hand from the layout in
+// RFC 3550 section 6.4.1, must serialize to exactly these bytes and parse back
+// to the same fields
+static bool check_sender_report_bytes() {
+  const std::vector<uint8_t> expected = {
+      0x81, 0xC8, 0x00, 0x0C, // V=2, P=0, RC=1, PT=200, length=12 words - 1
+      0x11, 0x22, 0x33, 0x44, // SSRC of sender
+      0xAA, 0xBB, 0xCC, 0xDD, // NTP timestamp, most significant word
+      0x01, 0x02, 0x03, 0x04, // NTP timestamp, least significant word
+      0x05, 0x06, 0x07, 0x08, // RTP timestamp
+      0x00, 0x00, 0x00, 0x10, // sender's packet count
+      0x00, 0x00, 0x10, 0x00, // sender's octet count
+      0x55, 0x66, 0x77, 0x88, // SSRC of the source of the report block
+      0x40, 0xFF, 0xFF, 0xFE, // fraction lost, cumulative number of packets lost (-2)
+      0x00, 0x01, 0x00, 0x05, // extended highest sequence number received
+      0x00, 0x00, 0x00, 0x20, // interarrival jitter
+      0xCC, 0xDD, 0x01, 0x02, // last SR
+      0x00, 0x00, 0x80, 0x00, // delay since last SR
+  };
+  espp::RtcpPacket::ReportBlock block{.ssrc = 0x55667788,
+                                      .fraction_lost = 0x40,
+                                      .cumulative_lost = -2,
+                                      .highest_sequence = 0x00010005,
+                                      .jitter = 0x20,
+                                      .last_sender_report = 0xCCDD0102,
+                                      .delay_since_last_sender_report = 0x8000};
+  espp::RtcpSenderReport report;
+  report.ssrc = 0x11223344;
+  report.ntp_timestamp = 0xAABBCCDD01020304ULL;
+  report.rtp_timestamp = 0x05060708;
+  report.packet_count = 0x10;
+  report.octet_count = 0x1000;
+  report.report_blocks.push_back(block);
+  report.serialize();
+  auto data = report.get_data();
+  bool serialized = std::equal(data.begin(), data.end(), expected.begin(), expected.end(),
+                               [](char a, uint8_t b) { return static_cast<uint8_t>(a) == b; });
+
+  espp::RtcpSenderReport parsed(
+      std::string_view(reinterpret_cast<const char *>(expected.data()), expected.size()));
+  const auto &blocks = parsed.report_blocks;
+  bool parsed_ok =
+      parsed.is_valid() && parsed.ssrc == report.ssrc &&
+      parsed.ntp_timestamp == report.ntp_timestamp &&
+      parsed.rtp_timestamp == report.rtp_timestamp &&
+      parsed.packet_count == report.packet_count && parsed.octet_count == report.octet_count &&
+      blocks.size() == 1 && blocks[0].ssrc == block.ssrc &&
+      blocks[0].fraction_lost == block.fraction_lost &&
+      blocks[0].cumulative_lost == block.cumulative_lost &&
+      blocks[0].highest_sequence == block.highest_sequence && blocks[0].jitter == block.jitter &&
+      blocks[0].last_sender_report == block.last_sender_report &&
+      blocks[0].delay_since_last_sender_report == block.delay_since_last_sender_report;
+  fmt::print("sender report matches RFC 3550: serialized {}, parsed {}\n", serialized, parsed_ok);
+  return serialized && parsed_ok;
+}
+
+static bool run(bool adaptive_pacing, int port, size_t rtp_port) {
+  // a 640x480 frame with ~30 kB of (random) scan data
+  std::string q_table(64, 1);
+  espp::JpegHeader header(640, 480, q_table, q_table);
+  auto header_data = header.get_data();
+  std::vector<char> jpeg_data(header_data.begin(), header_data.end());
+  std::mt19937 gen(0);
+  for (size_t i = 0; i < 30 * 1024; i++) {
+    jpeg_data.push_back(static_cast<char>(gen()));
+  }
+  auto frame = std::make_shared<const espp::JpegFrame>(jpeg_data.data(), jpeg_data.size());
+
+  espp::RtspServer server({
+      .server_address = "127.0.0.1",
+      .port = port,
+      .path = "/mjpeg/1",
+      .rtcp_interval = 250ms,
+      .adaptive_pacing = adaptive_pacing,
+      .log_level = espp::Logger::Verbosity::WARN,
+  });
+  server.start();
+
+  std::atomic<size_t> frames_received{0};
+  espp::RtspClient client({
+      .server_address = "127.0.0.1",
+      .rtsp_port = port,
+      .path = "/mjpeg/1",
+      .on_jpeg_frame = [&](std::unique_ptr<espp::JpegFrame>) { frames_received++; },
+      .log_level = espp::Logger::Verbosity::ERROR,
+  });
+  std::error_code ec;
+  client.connect(ec);
+  client.describe(ec);
+  client.setup(rtp_port, rtp_port + 1, 5s, ec);
+  client.play(ec);
+  if (ec) {
+    fmt::print(stderr, "Could not start streaming: {}\n", ec.message());
+    return false;
+  }
+  LossyClient lossy_client(port, rtp_port + 2);
+  std::this_thread::sleep_for(100ms);
+
+  for (size_t i = 0; i < num_frames; i++) {
+    auto start = std::chrono::steady_clock::now();
+    server.send_frame(frame);
+    std::this_thread::sleep_until(start + 33ms);
+  }
+  std::this_thread::sleep_for(200ms);
+
+  auto session_stats = server.get_session_stats();
+  auto client_stats = client.get_rtp_stats();
+  client.teardown(ec);
+
+  fmt::print("adaptive pacing {}:\n", adaptive_pacing ? "on" : "off");
+  fmt::print("{:>8} | {:>8} | {:>7} | {:>6} | {:>11} | {:>9} | {:>8} | {:>14} | {:>15}\n",
+             "client", "reports", "lost %", "sent", "skipped", "jitter ms", "rtt ms",
+             "interval ms", "frames received");
+  bool ok = lossy_client.has_server_rtcp_port() && session_stats.size() == 2;
+  for (const auto &[session_id, stats] : session_stats) {
+    ok = ok && stats.receiver_reports > 0;
+    // the sessions are not named, so tell them apart by the loss they see
+    bool is_lossy = stats.packets_lost > 0;
+    fmt::print("{:>8} | {:>8} | {:>7.1f} | {:>6} | {:>11} | {:>9.2f} | {:>8.2f} | {:>14.1f} | "
+               "{:>15}\n",
+               is_lossy ? "lossy" : "perfect", stats.receiver_reports, stats.fraction_lost * 100,
+               stats.frames_sent, stats.frames_skipped, stats.jitter.count() * 1e3f,
+               stats.round_trip_time.count() * 1e3f, stats.frame_interval.count() * 1e3f,
+               is_lossy ? lossy_client.frames_received.load() : frames_received.load());
+  }
+  fmt::print("perfect client: {} packets lost, {} frames dropped\n", client_stats.packets_lost,
+             client_stats.frames_dropped);
+  fmt::print("receiver reports sent to the advertised server_port: {}\n\n",
+             ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main() {
+  bool ok = check_sender_report_bytes();
+  ok = run(false, base_port, 5000) && ok;
+  ok = run(true, base_port + 1, 5010) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rtp_jpeg_jitter_buffer.hpp"
+
+using namespace std::chrono_literals;
+
+// Reassemble a stream of RTP/JPEG frames whose packets are delivered with
+// loss, reordering and duplication, as they may be over WiFi. Checks that
+// every delivered frame is byte-for-byte identical to the frame which was
+// sent, and reports the jitter buffer's statistics and the time spent per
+// packet.
+
+static constexpr size_t num_frames = 500;
+static constexpr size_t frame_size = 30 * 1000;
+static constexpr size_t fragment_size = 1000;
+static constexpr int width = 320;
+static constexpr int height = 240;
+
+struct Impairments {
+  float loss;      ///< probability that a packet is dropped
+  float reorder;   ///< probability that a packet is swapped with the next one
+  float duplicate; ///< probability that a packet is sent twice
+};
+
+static std::vector<std::string> make_packets(size_t frame_index, std::string_view scan_data,
+                                             std::string_view q0, std::string_view q1,
+                                             uint16_t &sequence_number) {
+  std::vector<std::string> packets;
+  uint32_t timestamp = frame_index * 3000;
+  for (size_t offset = 0; offset < scan_data.size(); offset += fragment_size) {
+    auto fragment = scan_data.substr(offset, fragment_size);
+    // the first packet carries the quantization tables
+    auto packet =
+        offset == 0
+            ? espp::RtpJpegPacket(0, 1, 128, width, height, q0, q1, fragment)
+            : espp::RtpJpegPacket(0, offset, 1, 96, width, height, fragment);
+    packet.set_payload_type(26);
+    packet.set_sequence_number(sequence_number++);
+    packet.set_timestamp(timestamp);
+    packet.set_marker(offset + fragment.size() == scan_data.size());
+    packet.serialize();
+    packets.emplace_back(packet.get_data());
+  }
+  return packets;
+}
+
+static void run(std::string_view name, const Impairments &impairments) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+  std::string q0(64, '\x10');
+  std::string q1(64, '\x11');
+
+  // the frames, each with different scan data
+  std::vector<std::string> frames(num_frames);
+  for (size_t i = 0; i < num_frames; i++) {
+    frames[i].resize(frame_size);
+    std::generate(frames[i].begin(), frames[i].end(), [&] { return (char)rng(); });
+  }
+
+  // the packets of all the frames, as they arrive
+  std::vector<std::string> packets;
+  uint16_t sequence_number = 65000; // so that the sequence numbers wrap around
+  for (size_t i = 0; i < num_frames; i++) {
+    for (auto &packet : make_packets(i, frames[i], q0, q1, sequence_number)) {
+      if (chance(rng) < impairments.loss) {
+        continue;
+      }
+      packets.push_back(packet);
+      if (chance(rng) < impairments.duplicate) {
+        packets.push_back(packet);
+      }
+    }
+  }
+  for (size_t i = 0; i + 1 < packets.size(); i++) {
+    if (chance(rng) < impairments.reorder) {
+      std::swap(packets[i], packets[i + 1]);
+    }
+  }
+
+  size_t frames_correct = 0;
+  size_t frames_corrupt = 0;
+  espp::RtpJpegJitterBuffer jitter_buffer({
+      .max_latency = 1s,
+      .on_jpeg_frame =
+          [&](std::unique_ptr<espp::JpegFrame> jpeg_frame) {
+            auto data = jpeg_frame->get_scan_data();
+            bool correct = std::find(frames.begin(), frames.end(), data) != frames.end() &&
+                           jpeg_frame->get_width() == width &&
+                           jpeg_frame->get_height() == height;
+            (correct ? frames_correct : frames_corrupt)++;
+          },
+      .log_level = espp::Logger::Verbosity::ERROR,
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto &packet : packets) {
+    jitter_buffer.add_packet(espp::RtpJpegPacket(packet));
+  }
+  auto elapsed = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start);
+
+  auto stats = jitter_buffer.get_stats();
+  fmt::print("{:>12} | {:>7} | {:>5} | {:>9} | {:>10} | {:>4} | {:>9} / {:>3} | {:>7} | {:>7} | "
+             "{:>6.2f}\n",
+             name, stats.packets_received, stats.packets_lost, stats.packets_reordered,
+             stats.packets_duplicated, stats.packets_late, stats.frames_completed, num_frames,
+             stats.frames_dropped, frames_corrupt, elapsed.count() / packets.size());
+  if (frames_correct != stats.frames_completed) {
+    fmt::print("ERROR: {} of {} frames were not reassembled correctly\n",
+               stats.frames_completed - frames_correct, stats.frames_completed);
+  }
+}
+
+int main() {
+  fmt::print("{:>12} | {:>7} | {:>5} | {:>9} | {:>10} | {:>4} | {:>15} | {:>7} | {:>7} | {}\n",
+             "network", "packets", "lost", "reordered", "duplicated", "late", "frames", "dropped",
+             "corrupt", "us / packet");
+  run("perfect", {.loss = 0.0f, .reorder = 0.0f, .duplicate = 0.0f});
+  run("reordering", {.loss = 0.0f, .reorder = 0.05f, .duplicate = 0.0f});
+  run("duplicates", {.loss = 0.0f, .reorder = 0.0f, .duplicate = 0.05f});
+  run("lossy", {.loss = 0.01f, .reorder = 0.02f, .duplicate = 0.01f});
+  return 0;
+}
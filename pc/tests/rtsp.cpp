@@ -0,0 +1,121 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "rtsp_client.hpp"
+#include "rtsp_server.hpp"
+
+using namespace std::chrono_literals;
+
+// Benchmark streaming 720p MJPEG at 30 fps over loopback from the RtspServer
+// to the RtspClient, measuring the cost and the number of heap allocations of
+// RtspServer::send_frame, with and without sharing the frame with the server.
+
+static thread_local size_t num_allocations{0};
+
+// count the allocations made by each thread (the client's threads allocate
+// while send_frame runs). Not inlined, so that the compiler doesn't see the
+// malloc and warn about it being freed by operator delete.
+[[gnu::noinline]] void *operator new(size_t size) {
+  num_allocations++;
+  if (void *ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+struct Result {
+  float mean_send_frame_us;
+  float allocations_per_frame;
+  size_t frames_received;
+};
+
+template <typename SendFrame>
+static Result run(SendFrame &&send_frame, std::atomic<size_t> &frames_received, size_t num_frames) {
+  frames_received = 0;
+  float total_us = 0;
+  size_t total_allocations = 0;
+  for (size_t i = 0; i < num_frames; i++) {
+    auto allocations_before = num_allocations;
+    auto start = std::chrono::steady_clock::now();
+    send_frame();
+    auto end = std::chrono::steady_clock::now();
+    total_allocations += num_allocations - allocations_before;
+    total_us += std::chrono::duration<float, std::micro>(end - start).count();
+    std::this_thread::sleep_until(start + 33ms);
+  }
+  // let the last frame arrive
+  std::this_thread::sleep_for(200ms);
+  return {
+      .mean_send_frame_us = total_us / num_frames,
+      .allocations_per_frame = float(total_allocations) / num_frames,
+      .frames_received = frames_received,
+  };
+}
+
+int main() {
+  static constexpr int port = 8554;
+  static constexpr size_t num_frames = 90;
+
+  // make a 1280x720 frame with ~50 kB of (random) scan data
+  std::string q_table(64, 1);
+  espp::JpegHeader header(1280, 720, q_table, q_table);
+  auto header_data = header.get_data();
+  std::vector<char> jpeg_data(header_data.begin(), header_data.end());
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dis(0, 255);
+  for (size_t i = 0; i < 50 * 1024; i++) {
+    jpeg_data.push_back(static_cast<char>(dis(gen)));
+  }
+  auto frame = std::make_shared<const espp::JpegFrame>(jpeg_data.data(), jpeg_data.size());
+
+  espp::RtspServer server({
+      .server_address = "127.0.0.1",
+      .port = port,
+      .path = "/mjpeg/1",
+      .log_level = espp::Logger::Verbosity::WARN,
+  });
+  server.set_session_log_level(espp::Logger::Verbosity::WARN);
+  server.start();
+
+  std::atomic<size_t> frames_received{0};
+  espp::RtspClient client({
+      .server_address = "127.0.0.1",
+      .rtsp_port = port,
+      .path = "/mjpeg/1",
+      .on_jpeg_frame = [&](std::unique_ptr<espp::JpegFrame>) { frames_received++; },
+      .log_level = espp::Logger::Verbosity::ERROR,
+  });
+  std::error_code ec;
+  client.connect(ec);
+  client.describe(ec);
+  client.setup(ec);
+  client.play(ec);
+  if (ec) {
+    fmt::print(stderr, "Could not start streaming: {}\n", ec.message());
+    return 1;
+  }
+
+  auto copied = run([&] { server.send_frame(*frame); }, frames_received, num_frames);
+  auto shared = run([&] { server.send_frame(frame); }, frames_received, num_frames);
+
+  client.teardown(ec);
+
+  fmt::print("Streamed {} frames of {} bytes ({} x {}) at 30 fps\n", num_frames,
+             frame->get_scan_data().size(), frame->get_width(), frame->get_height());
+  fmt::print("{:>8} | {:>19} | {:>19} | {:>15}\n", "frame", "send_frame mean (us)",
+             "allocations / frame", "frames received");
+  fmt::print("{:>8} | {:>19.1f} | {:>19.2f} | {:>15}\n", "copied", copied.mean_send_frame_us,
+             copied.allocations_per_frame, copied.frames_received);
+  fmt::print("{:>8} | {:>19.1f} | {:>19.2f} | {:>15}\n", "shared", shared.mean_send_frame_us,
+             shared.allocations_per_frame, shared.frames_received);
+
+  return 0;
+}
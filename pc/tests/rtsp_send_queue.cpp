@@ -0,0 +1,103 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rtsp_client.hpp"
+#include "rtsp_server.hpp"
+
+using namespace std::chrono_literals;
+
+// Stream 30 kB MJPEG frames over loopback from the RtspServer to several
+// RtspClients, at frame rates up to well above what a fixed polling interval
+// could keep up with. Each session queues the frames for its client and sends
+// them from its own task, so the number of frames each client receives should
+// only be limited by how fast frames can be sent, not by how often the server
+// wakes up. Reports the time send_frame() takes, and the frames each session
+// sent and dropped.
+
+static constexpr size_t num_clients = 4;
+static constexpr size_t num_frames = 300;
+
+static void run(int frame_rate, int port, size_t rtp_port) {
+  // a 640x480 frame with ~30 kB of (random) scan data
+  std::string q_table(64, 1);
+  espp::JpegHeader header(640, 480, q_table, q_table);
+  auto header_data = header.get_data();
+  std::vector<char> jpeg_data(header_data.begin(), header_data.end());
+  std::mt19937 gen(0);
+  for (size_t i = 0; i < 30 * 1024; i++) {
+    jpeg_data.push_back(static_cast<char>(gen()));
+  }
+  auto frame = std::make_shared<const espp::JpegFrame>(jpeg_data.data(), jpeg_data.size());
+
+  espp::RtspServer server({
+      .server_address = "127.0.0.1",
+      .port = port,
+      .path = "/mjpeg/1",
+      .adaptive_pacing = false,
+      .log_level = espp::Logger::Verbosity::WARN,
+  });
+  server.start();
+
+  std::vector<std::atomic<size_t>> frames_received(num_clients);
+  std::vector<std::unique_ptr<espp::RtspClient>> clients;
+  for (size_t i = 0; i < num_clients; i++) {
+    auto &client = clients.emplace_back(std::make_unique<espp::RtspClient>(espp::RtspClient::Config{
+        .server_address = "127.0.0.1",
+        .rtsp_port = port,
+        .path = "/mjpeg/1",
+        .on_jpeg_frame = [&, i](std::unique_ptr<espp::JpegFrame>) { frames_received[i]++; },
+        .log_level = espp::Logger::Verbosity::ERROR,
+    }));
+    std::error_code ec;
+    client->connect(ec);
+    client->describe(ec);
+    client->setup(rtp_port + i * 2, rtp_port + i * 2 + 1, 5s, ec);
+    client->play(ec);
+    if (ec) {
+      fmt::print(stderr, "Could not start streaming: {}\n", ec.message());
+      return;
+    }
+  }
+  std::this_thread::sleep_for(100ms);
+
+  auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<float>(1.0f / frame_rate));
+  std::chrono::duration<float, std::micro> send_time{0};
+  for (size_t i = 0; i < num_frames; i++) {
+    auto start = std::chrono::steady_clock::now();
+    server.send_frame(frame);
+    send_time += std::chrono::steady_clock::now() - start;
+    std::this_thread::sleep_until(start + period);
+  }
+  std::this_thread::sleep_for(200ms);
+
+  auto session_stats = server.get_session_stats();
+
+  uint32_t frames_sent = 0;
+  uint32_t frames_dropped = 0;
+  for (const auto &[session_id, stats] : session_stats) {
+    frames_sent += stats.frames_sent;
+    frames_dropped += stats.frames_dropped;
+  }
+  size_t total_received = 0;
+  for (const auto &received : frames_received) {
+    total_received += received;
+  }
+  fmt::print("{:>4} | {:>14.1f} | {:>11} | {:>14} | {:>15} / {}\n", frame_rate,
+             send_time.count() / num_frames, frames_sent, frames_dropped, total_received,
+             num_frames * num_clients);
+}
+
+int main() {
+  fmt::print("{:>4} | {:>14} | {:>11} | {:>14} | {}\n", "fps", "send_frame us", "frames sent",
+             "frames dropped", "frames received");
+  run(30, 8570, 5100);
+  run(100, 8571, 5120);
+  run(250, 8572, 5140);
+  return 0;
+}
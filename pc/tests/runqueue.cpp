@@ -0,0 +1,85 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "logger.hpp"
+#include "runqueue.hpp"
+
+using namespace std::chrono_literals;
+
+// Benchmark measuring the throughput of the RunQueue, in functions enqueued
+// per second and functions executed per second, for different numbers of
+// producer threads and worker tasks.
+
+struct Result {
+  float enqueue_rate;
+  float execute_rate;
+};
+
+static Result run(size_t num_producers, size_t num_workers, size_t num_functions) {
+  espp::RunQueue runqueue({
+      .num_workers = num_workers,
+      .task_config = {.name = "runqueue", .stack_size_bytes = 8192},
+  });
+
+  std::atomic<size_t> num_executed{0};
+  size_t functions_per_producer = num_functions / num_producers;
+  size_t total = functions_per_producer * num_producers;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < num_producers; p++) {
+    producers.emplace_back([&, p]() {
+      for (size_t i = 0; i < functions_per_producer; i++) {
+        // capture a little state, like a typical callback would
+        std::array<uint32_t, 4> args{(uint32_t)p, (uint32_t)i, 0, 0};
+        runqueue.add_function(
+            [&num_executed, args]() {
+              if (args[0] != UINT32_MAX) {
+                num_executed.fetch_add(1, std::memory_order_relaxed);
+              }
+            },
+            i % 4);
+      }
+    });
+  }
+  for (auto &producer : producers) {
+    producer.join();
+  }
+  auto enqueued = std::chrono::high_resolution_clock::now();
+  while (num_executed < total) {
+    std::this_thread::sleep_for(100us);
+  }
+  auto executed = std::chrono::high_resolution_clock::now();
+
+  float enqueue_s = std::chrono::duration<float>(enqueued - start).count();
+  float execute_s = std::chrono::duration<float>(executed - start).count();
+  return {
+      .enqueue_rate = total / enqueue_s,
+      .execute_rate = total / execute_s,
+  };
+}
+
+int main() {
+  espp::Logger logger({.tag = "RunQueue Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting runqueue benchmark");
+
+  static constexpr size_t num_functions = 200'000;
+
+  fmt::print("{:>9} | {:>7} | {:>17} | {:>17}\n", "producers", "workers", "enqueues / s",
+             "executions / s");
+  for (size_t num_producers : {1, 2, 4}) {
+    for (size_t num_workers : {1, 2, 4}) {
+      auto result = run(num_producers, num_workers, num_functions);
+      fmt::print("{:>9} | {:>7} | {:>17.0f} | {:>17.0f}\n", num_producers, num_workers,
+                 result.enqueue_rate, result.execute_rate);
+    }
+  }
+
+  logger.info("RunQueue benchmark complete");
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "socket_reactor.hpp"
+#include "tcp_socket.hpp"
+#include "udp_socket.hpp"
+
+using namespace std::chrono_literals;
+
+// Serve 20 UDP receivers and a TCP server with 20 client connections, first
+// with one task per socket (as the sockets are used today), then with all of
+// the sockets on one SocketReactor. Reports the number of threads in the
+// process while serving, and checks that every message is received.
+
+static constexpr size_t num_udp_sockets = 20;
+static constexpr size_t num_tcp_clients = 20;
+static constexpr size_t num_messages = 50;
+
+static size_t get_num_threads() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("Threads:", 0) == 0) {
+      return std::stoul(line.substr(8));
+    }
+  }
+  return 0;
+}
+
+struct Result {
+  size_t threads;
+  size_t udp_received;
+  size_t tcp_received;
+};
+
+static Result run(bool use_reactor, size_t base_port) {
+  std::atomic<size_t> udp_received{0};
+  std::atomic<size_t> tcp_received{0};
+  std::shared_ptr<espp::SocketReactor> reactor;
+  if (use_reactor) {
+    reactor = espp::SocketReactor::make_shared({});
+  }
+
+  // the UDP receivers
+  std::vector<std::unique_ptr<espp::UdpSocket>> udp_sockets;
+  for (size_t i = 0; i < num_udp_sockets; i++) {
+    auto &socket = udp_sockets.emplace_back(std::make_unique<espp::UdpSocket>(
+        espp::UdpSocket::Config{.log_level = espp::Logger::Verbosity::ERROR}));
+    auto receive_config = espp::UdpSocket::ReceiveConfig{
+        .port = base_port + i,
+        .buffer_size = 1500,
+        .on_receive_span_callback = [&](auto, auto &) { udp_received++; },
+    };
+    if (use_reactor) {
+      socket->start_receiving(reactor, receive_config);
+    } else {
+      socket->set_receive_timeout(100ms);
+      auto task_config = espp::Task::BaseConfig{.name = "UdpReceive"};
+      socket->start_receiving(task_config, receive_config);
+    }
+  }
+
+  // the TCP server and its connections
+  size_t tcp_port = base_port + num_udp_sockets;
+  espp::TcpSocket server_socket({.log_level = espp::Logger::Verbosity::ERROR});
+  server_socket.bind(tcp_port);
+  server_socket.listen(num_tcp_clients);
+  std::mutex connections_mutex;
+  std::vector<std::unique_ptr<espp::TcpSocket>> connections;
+  std::vector<std::unique_ptr<espp::Task>> connection_tasks;
+  std::unique_ptr<espp::Task> accept_task;
+  auto on_receive = [&](std::span<const uint8_t> data) { tcp_received += data.size(); };
+  if (use_reactor) {
+    server_socket.start_accepting(reactor, [&](std::unique_ptr<espp::TcpSocket> connection) {
+      connection->start_receiving(reactor, {.on_receive_callback = on_receive});
+      std::lock_guard<std::mutex> lock(connections_mutex);
+      connections.push_back(std::move(connection));
+    });
+  } else {
+    server_socket.set_receive_timeout(100ms);
+    accept_task = espp::Task::make_unique({
+        .callback = [&]() -> bool {
+          auto connection = server_socket.accept();
+          if (!connection) {
+            return false;
+          }
+          connection->set_receive_timeout(100ms);
+          auto *connection_ptr = connection.get();
+          std::lock_guard<std::mutex> lock(connections_mutex);
+          auto &task = connection_tasks.emplace_back(espp::Task::make_unique({
+              .callback = [&, connection_ptr]() -> bool {
+                uint8_t buffer[1024];
+                size_t num_bytes = connection_ptr->receive(buffer, sizeof(buffer));
+                if (num_bytes > 0) {
+                  on_receive({buffer, num_bytes});
+                }
+                return !connection_ptr->is_connected();
+              },
+              .task_config = {.name = "TcpReceive"},
+          }));
+          task->start();
+          connections.push_back(std::move(connection));
+          return false;
+        },
+        .task_config = {.name = "TcpAccept"},
+    });
+    accept_task->start();
+  }
+
+  // the clients
+  std::vector<std::unique_ptr<espp::TcpSocket>> tcp_clients;
+  for (size_t i = 0; i < num_tcp_clients; i++) {
+    auto &client = tcp_clients.emplace_back(std::make_unique<espp::TcpSocket>(
+        espp::TcpSocket::Config{.log_level = espp::Logger::Verbosity::ERROR}));
+    client->connect({.ip_address = "127.0.0.1", .port = tcp_port});
+  }
+  std::this_thread::sleep_for(200ms);
+  size_t threads = get_num_threads();
+
+  espp::UdpSocket udp_client({.log_level = espp::Logger::Verbosity::ERROR});
+  std::string message(64, 'm');
+  for (size_t message_index = 0; message_index < num_messages; message_index++) {
+    for (size_t i = 0; i < num_udp_sockets; i++) {
+      udp_client.send(message, {.ip_address = "127.0.0.1", .port = base_port + i});
+    }
+    for (auto &client : tcp_clients) {
+      client->transmit(message);
+    }
+    std::this_thread::sleep_for(2ms);
+  }
+  std::this_thread::sleep_for(200ms);
+
+  // close the clients first, so that the server side sees them disconnect
+  tcp_clients.clear();
+  std::this_thread::sleep_for(100ms);
+  accept_task.reset();
+  connection_tasks.clear();
+  return {
+      .threads = threads,
+      .udp_received = udp_received,
+      .tcp_received = tcp_received / message.size(),
+  };
+}
+
+int main() {
+  auto tasks = run(false, 5100);
+  auto reactor = run(true, 5200);
+
+  size_t expected = num_messages * num_udp_sockets;
+  fmt::print("{:>16} | {:>8} | {:>14} | {:>14}\n", "mode", "threads", "UDP received",
+             "TCP received");
+  for (auto [name, result] : {std::make_pair("task per socket", tasks),
+                              std::make_pair("socket reactor", reactor)}) {
+    fmt::print("{:>16} | {:>8} | {:>6} / {:>5} | {:>6} / {:>5}\n", name, result.threads,
+               result.udp_received, expected, result.tcp_received,
+               num_messages * num_tcp_clients);
+  }
+  return 0;
+}
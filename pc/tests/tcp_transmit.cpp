@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_socket.hpp"
+
+using namespace std::chrono_literals;
+
+// Transmit a message much larger than the socket buffers on a non-blocking
+// TcpSocket, while the remote only starts reading after a while, and check
+// that transmit() finishes the partially sent write (instead of failing with
+// part of the message already in the stream), and that the remote receives
+// the whole message, intact.
+
+int main() {
+  static constexpr size_t port = 5030;
+  static constexpr size_t message_size = 32 * 1024 * 1024;
+
+  espp::TcpSocket server_socket({.log_level = espp::Logger::Verbosity::WARN});
+  if (!server_socket.bind(port) || !server_socket.listen(1)) {
+    fmt::print("Could not set up the server socket\n");
+    return 1;
+  }
+
+  size_t num_received = 0;
+  size_t num_corrupted = 0;
+  std::thread receiver([&]() {
+    auto client = server_socket.accept();
+    if (!client) {
+      return;
+    }
+    // let the sender fill the socket buffers first
+    std::this_thread::sleep_for(200ms);
+    std::vector<uint8_t> buffer(64 * 1024);
+    while (num_received < message_size) {
+      size_t num_bytes = client->receive(buffer.data(), buffer.size());
+      if (num_bytes == 0) {
+        break;
+      }
+      for (size_t i = 0; i < num_bytes; i++) {
+        num_corrupted += buffer[i] != (uint8_t)((num_received + i) % 251);
+      }
+      num_received += num_bytes;
+    }
+  });
+
+  espp::TcpSocket client_socket({.log_level = espp::Logger::Verbosity::WARN});
+  bool sent = false;
+  if (client_socket.connect({.ip_address = "127.0.0.1", .port = port})) {
+    client_socket.set_non_blocking(true);
+    std::vector<uint8_t> message(message_size);
+    for (size_t i = 0; i < message.size(); i++) {
+      message[i] = (uint8_t)(i % 251);
+    }
+    sent = client_socket.transmit(message);
+  }
+  // the remote stops receiving when it gets the whole message, or when we close
+  client_socket.close();
+  receiver.join();
+
+  bool ok = sent && num_received == message_size && num_corrupted == 0;
+  fmt::print("non-blocking transmit of {} bytes: {}, {} bytes received, {} corrupted: {}\n",
+             message_size, sent ? "sent" : "failed", num_received, num_corrupted,
+             ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "timer.hpp"
+#include "timer_service.hpp"
+
+using namespace std::chrono_literals;
+
+// Benchmark comparing many espp::Timer objects which each have their own task
+// against the same timers attached to a single espp::TimerService.
+
+// resident memory (kB) of this process, or 0 if it cannot be determined
+static size_t get_rss_kb() {
+#if defined(__linux__)
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("VmRSS:", 0) == 0) {
+      return std::stoul(line.substr(6));
+    }
+  }
+#endif
+  return 0;
+}
+
+struct JitterStats {
+  std::atomic<int64_t> max_us{0};
+  std::atomic<int64_t> total_us{0};
+  std::atomic<size_t> count{0};
+};
+
+struct Result {
+  size_t rss_kb;
+  size_t stack_kb;
+  float mean_jitter_us;
+  float max_jitter_us;
+  size_t num_callbacks;
+};
+
+static Result run(size_t num_timers, bool use_service, std::chrono::milliseconds period,
+                  std::chrono::seconds duration) {
+  static constexpr size_t stack_size_bytes = 4096;
+  JitterStats stats;
+  std::vector<std::chrono::steady_clock::time_point> last_fired(num_timers);
+
+  size_t rss_before = get_rss_kb();
+
+  std::shared_ptr<espp::TimerService> timer_service;
+  if (use_service) {
+    timer_service = espp::TimerService::make_shared({
+        .name = "Timer Service",
+        .stack_size_bytes = stack_size_bytes,
+    });
+  }
+
+  std::vector<std::unique_ptr<espp::Timer>> timers;
+  timers.reserve(num_timers);
+  for (size_t i = 0; i < num_timers; i++) {
+    auto callback = [&, i]() -> bool {
+      auto now = std::chrono::steady_clock::now();
+      auto &last = last_fired[i];
+      if (last.time_since_epoch().count() != 0) {
+        // jitter is the deviation of the measured period from the configured period
+        auto error = std::chrono::duration_cast<std::chrono::microseconds>(now - last - period);
+        int64_t jitter_us = std::abs(error.count());
+        stats.total_us += jitter_us;
+        stats.count++;
+        int64_t prev_max = stats.max_us;
+        while (jitter_us > prev_max && !stats.max_us.compare_exchange_weak(prev_max, jitter_us)) {
+        }
+      }
+      last = now;
+      return false;
+    };
+    timers.push_back(std::make_unique<espp::Timer>(espp::Timer::Config{
+        .name = "Timer",
+        .period = period,
+        .callback = callback,
+        .stack_size_bytes = stack_size_bytes,
+        .timer_service = timer_service,
+    }));
+  }
+
+  std::this_thread::sleep_for(duration);
+  size_t rss_after = get_rss_kb();
+  timers.clear();
+  timer_service.reset();
+
+  size_t num_tasks = use_service ? 1 : num_timers;
+  size_t count = stats.count;
+  return {
+      .rss_kb = rss_after > rss_before ? rss_after - rss_before : 0,
+      .stack_kb = num_tasks * stack_size_bytes / 1024,
+      .mean_jitter_us = count ? (float)stats.total_us / count : 0.0f,
+      .max_jitter_us = (float)stats.max_us,
+      .num_callbacks = count,
+  };
+}
+
+int main() {
+  espp::Logger logger({.tag = "Timer Service Test", .level = espp::Logger::Verbosity::INFO});
+
+  logger.info("Starting timer service benchmark");
+
+  static constexpr auto period = 10ms;
+  static constexpr auto duration = 2s;
+
+  fmt::print("{:>7} | {:>15} | {:>10} | {:>10} | {:>16} | {:>15} | {:>10}\n", "timers", "mode",
+             "rss (kB)", "stack (kB)", "mean jitter (us)", "max jitter (us)", "callbacks");
+  for (size_t num_timers : {10, 100, 1000}) {
+    for (bool use_service : {false, true}) {
+      auto result = run(num_timers, use_service, period, duration);
+      fmt::print("{:>7} | {:>15} | {:>10} | {:>10} | {:>16.1f} | {:>15.1f} | {:>10}\n", num_timers,
+                 use_service ? "timer service" : "task per timer", result.rss_kb, result.stack_kb,
+                 result.mean_jitter_us, result.max_jitter_us, result.num_callbacks);
+    }
+  }
+
+  logger.info("Timer service benchmark complete");
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "udp_socket.hpp"
+
+using namespace std::chrono_literals;
+
+// Benchmark receiving a burst of datagrams over loopback, with the
+// std::vector receive callback (one recvfrom and one vector per datagram) and
+// with the batched span receive callback (recvmmsg into preallocated buffers).
+// Then check that receive() can be called from several threads at once on the
+// same socket, with each datagram received intact by one of them.
+
+static std::atomic<size_t> num_allocations{0};
+
+// count the allocations made by the process. Not inlined, so that the compiler
+// doesn't see the malloc and warn about it being freed by operator delete.
+[[gnu::noinline]] void *operator new(size_t size) {
+  num_allocations++;
+  if (void *ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+struct Result {
+  size_t received;
+  size_t bytes;
+  float elapsed_ms;
+  float allocations_per_datagram;
+};
+
+static Result run(bool use_span_callback, size_t port) {
+  static constexpr size_t num_datagrams = 20000;
+  static constexpr size_t datagram_size = 1200;
+  static constexpr size_t burst_size = 32;
+
+  std::atomic<size_t> received{0};
+  std::atomic<size_t> bytes{0};
+  espp::UdpSocket server_socket({.log_level = espp::Logger::Verbosity::WARN});
+  server_socket.set_receive_timeout(100ms);
+  auto task_config = espp::Task::BaseConfig{.name = "UdpReceive", .stack_size_bytes = 8 * 1024};
+  auto receive_config = espp::UdpSocket::ReceiveConfig{.port = port, .buffer_size = 1500};
+  if (use_span_callback) {
+    receive_config.on_receive_span_callback = [&](std::span<const uint8_t> data, auto &) {
+      bytes += data.size();
+      received++;
+    };
+    receive_config.max_batch_size = 32;
+  } else {
+    receive_config.on_receive_callback = [&](std::vector<uint8_t> &data,
+                                             auto &) -> std::optional<std::vector<uint8_t>> {
+      bytes += data.size();
+      received++;
+      return {};
+    };
+  }
+  server_socket.start_receiving(task_config, receive_config);
+
+  espp::UdpSocket client_socket({.log_level = espp::Logger::Verbosity::WARN});
+  auto send_config = espp::UdpSocket::SendConfig{.ip_address = "127.0.0.1", .port = port};
+  std::string payload(datagram_size, 'x');
+
+  auto allocations_before = num_allocations.load();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < num_datagrams; i++) {
+    client_socket.send(std::string_view(payload), send_config);
+    if (i % burst_size == burst_size - 1) {
+      // give the receiver a chance to keep up, so the kernel doesn't drop
+      std::this_thread::sleep_for(50us);
+    }
+  }
+  // wait for the last datagrams to be received
+  auto deadline = std::chrono::steady_clock::now() + 1s;
+  while (received < num_datagrams && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(1ms);
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto allocations = num_allocations.load() - allocations_before;
+  size_t num_received = received;
+  return {
+      .received = num_received,
+      .bytes = bytes,
+      .elapsed_ms = std::chrono::duration<float, std::milli>(end - start).count(),
+      .allocations_per_datagram = float(allocations) / std::max<size_t>(1, num_received),
+  };
+}
+
+// several threads receive() from one socket while a client sends datagrams
+// whose size and contents depend on their index, and check every datagram
+static bool check_concurrent_receive(size_t port) {
+  static constexpr size_t num_threads = 4;
+  static constexpr size_t num_datagrams = 4000;
+  espp::UdpSocket server_socket({.log_level = espp::Logger::Verbosity::WARN});
+  server_socket.set_receive_timeout(100ms);
+  server_socket.bind(port);
+  std::atomic<size_t> received{0};
+  std::atomic<size_t> corrupted{0};
+  std::vector<std::thread> receivers;
+  for (size_t t = 0; t < num_threads; t++) {
+    receivers.emplace_back([&]() {
+      std::vector<uint8_t> data;
+      espp::Socket::Info sender_info;
+      // stop once nothing has arrived for a whole receive timeout
+      while (server_socket.receive(1500, data, sender_info)) {
+        bool intact =
+            !data.empty() && data.size() == 100 + data[0] * 4u &&
+            std::all_of(data.begin(), data.end(), [&](uint8_t b) { return b == data[0]; });
+        corrupted += !intact;
+        received++;
+      }
+    });
+  }
+  espp::UdpSocket client_socket({.log_level = espp::Logger::Verbosity::WARN});
+  auto send_config = espp::UdpSocket::SendConfig{.ip_address = "127.0.0.1", .port = port};
+  for (size_t i = 0; i < num_datagrams; i++) {
+    uint8_t value = i % 256;
+    std::string payload(100 + value * 4u, static_cast<char>(value));
+    client_socket.send(std::string_view(payload), send_config);
+    if (i % 32 == 31) {
+      std::this_thread::sleep_for(50us);
+    }
+  }
+  for (auto &receiver : receivers) {
+    receiver.join();
+  }
+  bool ok = received > 0 && corrupted == 0;
+  fmt::print("{} threads receiving from one socket: {} datagrams received, {} corrupted: {}\n",
+             num_threads, received.load(), corrupted.load(), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main() {
+  auto vector_result = run(false, 5010);
+  auto span_result = run(true, 5011);
+
+  fmt::print("{:>8} | {:>10} | {:>10} | {:>10} | {:>23}\n", "callback", "received", "MB",
+             "time (ms)", "allocations / datagram");
+  for (auto [name, result] : {std::make_pair("vector", vector_result),
+                              std::make_pair("span", span_result)}) {
+    fmt::print("{:>8} | {:>10} | {:>10.1f} | {:>10.1f} | {:>23.2f}\n", name, result.received,
+               result.bytes / 1e6f, result.elapsed_ms, result.allocations_per_datagram);
+  }
+  return check_concurrent_receive(5012) ? 0 : 1;
+}
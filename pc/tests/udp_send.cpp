@@ -0,0 +1,106 @@
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "udp_socket.hpp"
+
+using namespace std::chrono_literals;
+
+// Benchmark sending a 60 kB frame, as 60 RTP-sized datagrams (each a header
+// and a payload), to several receivers over loopback: one send() per
+// datagram, versus send_batch() with sendmmsg, versus send_batch() with UDP
+// GSO. Reports the CPU time of the sending thread per frame.
+
+static float get_thread_cpu_time_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e6f + ts.tv_nsec / 1e3f;
+}
+
+enum class Mode { SEND, SEND_BATCH, SEND_BATCH_GSO };
+
+struct Result {
+  float cpu_us_per_frame;
+  size_t sent;
+  size_t received;
+};
+
+static Result run(Mode mode, size_t base_port) {
+  static constexpr size_t num_receivers = 4;
+  static constexpr size_t num_frames = 200;
+  static constexpr size_t num_packets = 60;
+  static constexpr size_t header_size = 20;
+  static constexpr size_t payload_size = 1000;
+
+  // the receivers, as the clients of an RTSP server would be
+  std::atomic<size_t> received{0};
+  std::vector<std::unique_ptr<espp::UdpSocket>> receivers;
+  for (size_t i = 0; i < num_receivers; i++) {
+    auto &receiver = receivers.emplace_back(
+        std::make_unique<espp::UdpSocket>(espp::UdpSocket::Config{}));
+    receiver->set_receive_timeout(100ms);
+    auto task_config = espp::Task::BaseConfig{.name = "Receiver"};
+    receiver->start_receiving(task_config,
+                              {
+                                  .port = base_port + i,
+                                  .buffer_size = 1500,
+                                  .on_receive_span_callback = [&](auto, auto &) { received++; },
+                                  .max_batch_size = 64,
+                              });
+  }
+
+  // the frame, split into packets of a header and a payload
+  std::string header(header_size, 'h');
+  std::string frame(num_packets * payload_size, 'p');
+  std::vector<std::array<std::string_view, 2>> buffers(num_packets);
+  std::vector<espp::UdpSocket::Datagram> packets(num_packets);
+  for (size_t i = 0; i < num_packets; i++) {
+    buffers[i] = {header, std::string_view(frame).substr(i * payload_size, payload_size)};
+    packets[i] = buffers[i];
+  }
+
+  espp::UdpSocket sender({.enable_gso = mode == Mode::SEND_BATCH_GSO});
+  size_t sent = 0;
+  float cpu_us = 0;
+  for (size_t frame_index = 0; frame_index < num_frames; frame_index++) {
+    auto start = get_thread_cpu_time_us();
+    for (size_t i = 0; i < num_receivers; i++) {
+      auto send_config = espp::UdpSocket::SendConfig{.ip_address = "127.0.0.1",
+                                                     .port = base_port + i};
+      if (mode == Mode::SEND) {
+        for (const auto &packet : packets) {
+          sent += sender.send(packet, send_config);
+        }
+      } else {
+        sent += sender.send_batch(packets, send_config);
+      }
+    }
+    cpu_us += get_thread_cpu_time_us() - start;
+    // let the receivers drain their sockets
+    std::this_thread::sleep_for(5ms);
+  }
+  std::this_thread::sleep_for(100ms);
+  return {
+      .cpu_us_per_frame = cpu_us / num_frames,
+      .sent = sent,
+      .received = received,
+  };
+}
+
+int main() {
+  auto send = run(Mode::SEND, 5020);
+  auto send_batch = run(Mode::SEND_BATCH, 5030);
+  auto send_batch_gso = run(Mode::SEND_BATCH_GSO, 5040);
+
+  fmt::print("{:>14} | {:>18} | {:>10} | {:>10}\n", "mode", "CPU us / frame", "sent",
+             "received");
+  for (auto [name, result] : {std::make_pair("send", send),
+                              std::make_pair("send_batch", send_batch),
+                              std::make_pair("send_batch gso", send_batch_gso)}) {
+    fmt::print("{:>14} | {:>18.1f} | {:>10} | {:>10}\n", name, result.cpu_us_per_frame,
+               result.sent, result.received);
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "udp_socket.hpp"
+
+using namespace std::chrono_literals;
+
+// Destroy a receiving UdpSocket while datagrams keep arriving, many times, and
+// check that the receive task is stopped (rather than left blocked in its
+// receive, or woken up by the close to hand a bogus datagram to the callback),
+// and that the receive callback is never called once the socket has been
+// destroyed. The callback owns a heap allocated string, so that a callback
+// which is called after it has been destroyed is also caught by a sanitizer.
+
+int main() {
+  static constexpr size_t port = 5020;
+  static constexpr size_t num_iterations = 200;
+  // long enough that the task can only stop in time if the close wakes it
+  static constexpr auto receive_timeout = 1s;
+
+  espp::UdpSocket client_socket({.log_level = espp::Logger::Verbosity::WARN});
+  auto send_config = espp::UdpSocket::SendConfig{.ip_address = "127.0.0.1", .port = port};
+  std::atomic<bool> sending{true};
+  std::thread sender([&]() {
+    std::string payload(64, 'x');
+    while (sending) {
+      client_socket.send(std::string_view(payload), send_config);
+      std::this_thread::sleep_for(10us);
+    }
+  });
+
+  std::atomic<size_t> num_received{0};
+  std::atomic<size_t> num_empty{0};
+  size_t num_late = 0;
+  auto max_destroy_time = 0us;
+  for (size_t i = 0; i < num_iterations; i++) {
+    auto socket =
+        std::make_unique<espp::UdpSocket>(espp::UdpSocket::Config{.log_level =
+                                                                      espp::Logger::Verbosity::NONE});
+    socket->set_receive_timeout(receive_timeout);
+    auto task_config = espp::Task::BaseConfig{.name = "UdpDestroy", .stack_size_bytes = 8 * 1024};
+    socket->start_receiving(
+        task_config,
+        {.port = port,
+         .buffer_size = 1500,
+         .on_receive_callback = [&, owned = std::string(100, 'y')](
+                                    std::vector<uint8_t> &data,
+                                    auto &) -> std::optional<std::vector<uint8_t>> {
+           num_received += owned.size() == 100;
+           num_empty += data.empty();
+           return {};
+         }});
+    // destroy it at different points of its receive loop
+    std::this_thread::sleep_for(std::chrono::microseconds(1000 + i * 13 % 1000));
+    auto start = std::chrono::steady_clock::now();
+    socket.reset();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    max_destroy_time = std::max(max_destroy_time, elapsed);
+    size_t received = num_received;
+    std::this_thread::sleep_for(1ms);
+    num_late += num_received != received;
+  }
+  sending = false;
+  sender.join();
+
+  bool ok = num_late == 0 && num_empty == 0 && max_destroy_time < receive_timeout / 10.0 &&
+            num_received > 0;
+  fmt::print("{} sockets destroyed while receiving: {} datagrams received, {} empty, callback "
+             "called after destruction {} times, max destruction time {} us: {}\n",
+             num_iterations, num_received.load(), num_empty.load(), num_late,
+             max_destroy_time.count(), ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}